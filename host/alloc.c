@@ -0,0 +1,82 @@
+// Counts the heap allocations of the firmware. The objects of src/ and libmad/
+// are linked with their malloc and friends renamed to the functions here, see
+// the Makefile, so the allocations of the host stand-ins aren't counted.
+
+#include "alloc.h"
+
+#include "FreeRTOS.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+// every block starts with its size, padded to keep the alignment
+struct header {
+  size_t size;
+  size_t pad;
+};
+
+struct alloc_stats host_alloc_stats;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void account(size_t size, bool allocated) {
+  pthread_mutex_lock(&lock);
+  if (allocated) {
+    ++host_alloc_stats.allocations;
+    host_alloc_stats.in_use += size;
+    if (host_alloc_stats.in_use > host_alloc_stats.peak)
+      host_alloc_stats.peak = host_alloc_stats.in_use;
+  } else {
+    ++host_alloc_stats.frees;
+    host_alloc_stats.in_use -= size;
+  }
+  pthread_mutex_unlock(&lock);
+}
+
+void *host_malloc(size_t size) {
+  struct header *h = malloc(sizeof(*h) + size);
+  if (h == NULL)
+    return NULL;
+  h->size = size;
+  account(size, true);
+  return h + 1;
+}
+
+void *host_calloc(size_t n, size_t size) {
+  void *p = host_malloc(n * size);
+  if (p != NULL)
+    memset(p, 0, n * size);
+  return p;
+}
+
+void host_free(void *p) {
+  if (p == NULL)
+    return;
+  struct header *h = (struct header *)p - 1;
+  account(h->size, false);
+  free(h);
+}
+
+void *host_realloc(void *p, size_t size) {
+  if (p == NULL)
+    return host_malloc(size);
+  void *q = host_malloc(size);
+  if (q == NULL)
+    return NULL;
+  const size_t old = ((struct header *)p - 1)->size;
+  memcpy(q, p, old < size ? old : size);
+  host_free(p);
+  return q;
+}
+
+void host_alloc_reset_peak(void) {
+  pthread_mutex_lock(&lock);
+  host_alloc_stats.peak = host_alloc_stats.in_use;
+  host_alloc_stats.allocations = host_alloc_stats.frees = 0;
+  pthread_mutex_unlock(&lock);
+}
+
+size_t xPortGetFreeHeapSize(void) {
+  const size_t in_use = host_alloc_stats.in_use;
+  return in_use < HOST_HEAP_SIZE ? HOST_HEAP_SIZE - in_use : 0;
+}
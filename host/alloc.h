@@ -0,0 +1,26 @@
+#ifndef HOST_ALLOC_H_
+#define HOST_ALLOC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct alloc_stats {
+  unsigned int allocations;
+  unsigned int frees;
+  size_t in_use; // bytes
+  size_t peak;   // most bytes in use at once
+};
+
+extern struct alloc_stats host_alloc_stats;
+
+// The heap functions of the firmware. Stand-ins use them for memory they hand
+// over, which the firmware frees.
+void *host_malloc(size_t size);
+void *host_calloc(size_t n, size_t size);
+void *host_realloc(void *p, size_t size);
+void host_free(void *p);
+
+// Starts counting allocations and the peak from the current state
+void host_alloc_reset_peak(void);
+
+#endif /* HOST_ALLOC_H_ */
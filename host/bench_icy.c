@@ -0,0 +1,72 @@
+// Throughput of the ICY demuxer on a 128 kbit/s stream with a title in every
+// metadata block, for the chunk sizes of small reads up to whole netbufs.
+
+#include "icy.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define METAINT 16000
+#define BLOCKS 256
+#define ROUNDS 20
+
+static uint8_t capture[BLOCKS * (METAINT + 1 + 4 * 16)];
+static size_t capture_len;
+static unsigned int audio_calls, titles;
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void on_audio(const uint8_t *data, size_t len) { ++audio_calls; }
+
+static void on_metadata(enum icy_field field, char *value) { ++titles; }
+
+static void build(void) {
+  for (int n = 0; n < BLOCKS; ++n) {
+    for (int i = 0; i < METAINT; ++i)
+      capture[capture_len++] = rand();
+    char text[4 * 16 + 1] = {0};
+    snprintf(text, sizeof(text), "StreamTitle='Artist - Title %d';", n);
+    capture[capture_len++] = 4;
+    memcpy(capture + capture_len, text, 4 * 16);
+    capture_len += 4 * 16;
+  }
+}
+
+// Returns ns per byte fed in chunks of the given size
+static double run(size_t chunk) {
+  struct icy_demuxer icy;
+  audio_calls = 0;
+  titles = 0;
+  const double start = now();
+  for (int round = 0; round < ROUNDS; ++round) {
+    icy_init(&icy, METAINT, on_audio, on_metadata);
+    for (size_t pos = 0; pos < capture_len; pos += chunk)
+      icy_feed(&icy, capture + pos,
+               chunk < capture_len - pos ? chunk : capture_len - pos);
+  }
+  return (now() - start) / ROUNDS / capture_len * 1e9;
+}
+
+int main(void) {
+  srand(1);
+  build();
+
+  static const size_t chunks[] = {64, 512, 1460, 2920, 16384};
+  printf("icy_feed, %zu kB with %d titles:\n", capture_len / 1024, BLOCKS);
+  printf("  %8s %10s %8s %14s\n", "chunk", "ns/byte", "MB/s", "audio calls");
+  for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i) {
+    const double ns = run(chunks[i]);
+    printf("  %8zu %10.3f %8.0f %14u\n", chunks[i], ns, 1e3 / ns,
+           audio_calls / ROUNDS);
+    if (titles != ROUNDS * BLOCKS)
+      printf("  %u titles instead of %d\n", titles, ROUNDS * BLOCKS);
+  }
+  return 0;
+}
@@ -0,0 +1,262 @@
+// Cost of drawing text on the display model: SPI transactions and bytes per
+// character, the time the 40 MHz bus needs for them and the CPU time on the
+// host. The old renderer, which set up a window per character and expanded
+// the font bit by bit, is kept here as the reference. The marquee is compared
+// with redrawing its whole band for every row it scrolls. For the fonts, the
+// flash they take and the glyphs per second of the proportional one.
+
+#include "hspi_model.h"
+#include "lcd_font.h"
+#include "mi0283qt.h"
+#include "ui.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define ROUNDS 2000
+// A full line of the fixed font
+#define LINE "Now playing: Artist - Title   128 kbit/s"
+// Latin-1 text as UTF-8
+#define TEXT "Gr\xc3\xbc\xc3\x9f" "e aus K\xc3\xb6ln: Caf\xc3\xa9 cr\xc3\xa8me"
+// Glyphs of font_latin1
+#define GLYPHS (0x7e - 0x20 + 1 + 0xff - 0xa0 + 1)
+// Two lines of the marquee
+#define TITLE "Die \xc3\x84rzte - Schrei nach Liebe (Live im Stadion, 1998)"
+// The UI is updated every 100 ms
+#define UPDATES_PER_S 10
+
+struct cost {
+  double transactions, bytes; // per character
+  double bus_us;              // per character
+  double host_ns;             // per character
+};
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// lcd_stringn() before the single window: a window and a GRAM write per
+// character, its pixels expanded from the font on every call
+static int string_per_char(int x, int y, const char *str, size_t n,
+                           uint16_t fg, uint16_t bg) {
+  uint16_t pixels[(FONT_WIDTH + FONT_MARGIN) * FONT_HEIGHT];
+  lcd_xy_exchange(true);
+  for (size_t i = 0; i < n; ++i, ++str) {
+    if (*str < FIRST_CHAR || *str >= FIRST_CHAR + CHAR_COUNT)
+      continue;
+    lcd_set_area(y, x, y + FONT_HEIGHT - 1, x + FONT_WIDTH + FONT_MARGIN - 1);
+    size_t pos = 0;
+    for (int col = 0; col < FONT_WIDTH; ++col) {
+      const uint8_t col_byte = font[(*str - FIRST_CHAR) * FONT_WIDTH + col];
+      for (int line = 0; line < FONT_HEIGHT; ++line)
+        pixels[pos++] = col_byte & (1 << line) ? fg : bg;
+    }
+    for (int i = 0; i < FONT_MARGIN * FONT_HEIGHT; ++i)
+      pixels[pos++] = bg;
+    lcd_write_pixels(pos, pixels);
+    x += FONT_WIDTH + FONT_MARGIN;
+  }
+  lcd_xy_exchange(false);
+  return x;
+}
+
+typedef int (*string_fn)(int x, int y, const char *str, size_t n, uint16_t fg,
+                         uint16_t bg);
+
+static void reset(void) {
+  struct lcd_stats stats;
+  lcd_get_and_reset_stats(&stats);
+  memset(&host_hspi_stats[1], 0, sizeof(host_hspi_stats[1]));
+}
+
+// Draws the line ROUNDS times, each time in one of a few color pairs
+static struct cost run_string(string_fn fn) {
+  static const uint16_t colors[][2] = {
+      {0xffff, 0x0000}, {0x0000, 0xffff}, {0xe007, 0x0000}};
+  const size_t n = strlen(LINE);
+  reset();
+  const double start = now();
+  for (int i = 0; i < ROUNDS; ++i) {
+    const uint16_t *c = colors[i % 3];
+    fn(0, (i % 32) * FONT_HEIGHT, LINE, n, c[0], c[1]);
+  }
+  const double time = now() - start;
+  const struct hspi_bus_stats bus = host_hspi_stats[1];
+  const double chars = (double)ROUNDS * n;
+  return (struct cost){bus.transactions / chars,
+                       // every transaction starts with a register/data byte
+                       (bus.bytes + bus.transactions) / chars,
+                       bus.bus_ns / 1e3 / chars, time * 1e9 / chars};
+}
+
+static void print_cost(const char *name, struct cost c) {
+  printf("  %-12s %12.2f %10.1f %10.2f %10.0f %10.0f\n", name, c.transactions,
+         c.bytes, c.bus_us, 1e6 / c.bus_us, c.host_ns);
+}
+
+// Draws as much of the text as fits ROUNDS times at scale
+static struct cost run_text(int scale) {
+  const size_t n = font_fit(&font_latin1, TEXT, strlen(TEXT), LCD_WIDTH, scale);
+  int glyphs = 0;
+  for (const char *p = TEXT; p < TEXT + n; ++glyphs)
+    font_decode(&p, TEXT + n);
+
+  reset();
+  const double start = now();
+  for (int i = 0; i < ROUNDS; ++i) {
+    const int y = (i % (300 / FONT_LATIN1_HEIGHT / scale)) * 10 * scale;
+    lcd_text(&font_latin1, scale, 0, y, TEXT, n, 0xffff, 0);
+  }
+  const double time = now() - start;
+  const struct hspi_bus_stats bus = host_hspi_stats[1];
+  const double count = (double)ROUNDS * glyphs;
+  return (struct cost){bus.transactions / count,
+                       (bus.bytes + bus.transactions) / count,
+                       bus.bus_ns / 1e3 / count, time * 1e9 / count};
+}
+
+// Decoding only, into column masks, ns per glyph
+static double run_decode(void) {
+  const char *end = TEXT + strlen(TEXT);
+  uint16_t columns[FONT_MAX_WIDTH];
+  unsigned int sum = 0, glyphs = 0;
+  const double start = now();
+  for (int i = 0; i < ROUNDS * 10; ++i) {
+    for (const char *p = TEXT; p < end; ++glyphs) {
+      font_columns(&font_latin1, font_glyph(&font_latin1, font_decode(&p, end)),
+                   columns);
+      sum += columns[0];
+    }
+  }
+  const double time = now() - start;
+  // keeps the loop from being optimized away
+  if (sum == 0)
+    printf("no pixels\n");
+  return time * 1e9 / glyphs;
+}
+
+static void print_fonts(void) {
+  // the runs end with those of the last glyph
+  const struct font_glyph *last = &font_latin1.glyphs[GLYPHS - 1];
+  const uint8_t *p = font_latin1.runs + last->offset;
+  unsigned int columns = 0;
+  for (int pixels = 0; pixels < last->width * FONT_LATIN1_HEIGHT; ++p)
+    pixels += (*p >> 4) + (*p & 0x0f);
+  for (int i = 0; i < GLYPHS; ++i)
+    columns += font_latin1.glyphs[i].width;
+  const size_t runs = p - font_latin1.runs;
+  const size_t index = GLYPHS * sizeof(struct font_glyph);
+
+  printf("flash per font:\n");
+  printf("  %-12s %6s %6s %6s %10s\n", "", "glyphs", "data", "index",
+         "per glyph");
+  printf("  %-12s %6d %6d %6d %10.1f\n", "5x7", CHAR_COUNT,
+         CHAR_COUNT * FONT_WIDTH, 0, (double)FONT_WIDTH);
+  printf("  %-12s %6d %6zu %6zu %10.1f\n", "latin1", GLYPHS, runs, index,
+         (double)(runs + index) / GLYPHS);
+  printf("  %-12s %6d %6u %6zu %10.1f\n", "as columns", GLYPHS, 2 * columns,
+         index, (double)(2 * columns + index) / GLYPHS);
+}
+
+// Length of the first line of a marquee, broken after the last space that
+// fits
+static size_t first_line(const char *text, int width) {
+  const size_t fit = font_fit(&font_latin1, text, strlen(text), width, 1);
+  size_t len = fit;
+  while (text[fit] != '\0' && len > 0 && text[len] != ' ')
+    --len;
+  return len > 0 ? len : fit;
+}
+
+// Redraws the band with step rows of the next line scrolled in, row by row
+static void redraw_band(const char *line, size_t n, const char *next,
+                        size_t next_n, int step) {
+  for (int row = 0; row < UI_LINE_HEIGHT; ++row) {
+    const bool in_next = row >= UI_LINE_HEIGHT - step;
+    const int y = 38 + row;
+    const int end = lcd_text_row(
+        &font_latin1, 4, y, in_next ? next : line, in_next ? next_n : n,
+        in_next ? row - (UI_LINE_HEIGHT - step) : row + step, 0xffff, 0);
+    if (end < 236)
+      lcd_rect(0, end, y, 235, y);
+  }
+}
+
+// Scrolls both lines of the title through the band ROUNDS / 10 times,
+// returns the bus traffic per row scrolled in
+static struct cost run_marquee(bool hardware) {
+  static struct ui_widget marquee;
+  static char text[64];
+  const size_t n = first_line(TITLE, 232);
+  const char *next = TITLE + n + 1;
+  const int cycles = ROUNDS / 10;
+
+  if (hardware) {
+    ui_marquee_init(&marquee, 4, 38, 232, text, sizeof(text), 0xffff, 0);
+    ui_add(&marquee);
+    ui_marquee_set(&marquee, TITLE);
+    ui_update(UINT_MAX);
+  }
+  reset();
+  const double start = now();
+  for (int i = 0; i < cycles; ++i) {
+    for (int line = 0; line < 2; ++line) {
+      if (hardware) {
+        for (int u = 0; u < UI_MARQUEE_PAUSE + UI_LINE_HEIGHT; ++u)
+          ui_update(UINT_MAX);
+        continue;
+      }
+      for (int step = 1; step <= UI_LINE_HEIGHT; ++step) {
+        if (line == 0)
+          redraw_band(TITLE, n, next, strlen(next), step);
+        else
+          redraw_band(next, strlen(next), TITLE, n, step);
+      }
+    }
+  }
+  const double time = now() - start;
+  const struct hspi_bus_stats bus = host_hspi_stats[1];
+  const double steps = (double)cycles * 2 * UI_LINE_HEIGHT;
+  return (struct cost){bus.transactions / steps,
+                       (bus.bytes + bus.transactions) / steps,
+                       bus.bus_ns / 1e3 / steps, time * 1e9 / steps};
+}
+
+static void print_marquee(const char *name, struct cost c) {
+  printf("  %-12s %12.2f %10.1f %10.2f %10.0f %10.0f\n", name, c.transactions,
+         c.bytes, c.bus_us, c.bytes * UPDATES_PER_S, c.host_ns);
+}
+
+int main(void) {
+  if (lcd_init() != 0) {
+    printf("lcd_init failed\n");
+    return 1;
+  }
+
+  printf("strings of %zu characters, per character:\n", strlen(LINE));
+  printf("  %-12s %12s %10s %10s %10s %10s\n", "", "transactions", "bytes",
+         "bus us", "chars/s", "host ns");
+  print_cost("per char", run_string(string_per_char));
+  print_cost("window", run_string(lcd_stringn_color));
+
+  print_fonts();
+  printf("font_latin1, per glyph:\n");
+  printf("  %-12s %12s %10s %10s %10s %10s\n", "", "transactions", "bytes",
+         "bus us", "glyphs/s", "host ns");
+  print_cost("scale 1", run_text(1));
+  print_cost("scale 2", run_text(2));
+  const double decode = run_decode();
+  printf("  %-12s %12s %10s %10s %10.0f %10.1f\n", "decode only", "", "", "",
+         1e9 / decode, decode);
+
+  printf("marquee of 232 x %d pixels, per row scrolled in:\n", UI_LINE_HEIGHT);
+  printf("  %-12s %12s %10s %10s %10s %10s\n", "", "transactions", "bytes",
+         "bus us", "bytes/s", "host ns");
+  print_marquee("redraw", run_marquee(false));
+  print_marquee("scroll", run_marquee(true));
+  return 0;
+}
@@ -0,0 +1,354 @@
+// Decodes MP3 files through the same path as on the device: the file is
+// written to the FIFO in the SPI RAM model, mp3.c pulls it from there and
+// the samples go through the audio output into the DMA blocks. Reports the
+// realtime factor, the heap use, the stack high-water mark of the decoder
+// task and a checksum of all output samples. With damaged frames, it reports
+// the decode time skipping them saves. Each file is decoded in a process of
+// its own, so it starts from a fresh device, and with several files or a
+// directory of them the results are summed up at the end.
+//
+// usage: bench_mp3 [-m] [-d n] [-s speed] file.mp3|directory...
+//   -m        decode stereo streams as mono
+//   -d n      damage the side information of every nth frame
+//   -s speed  play the output at speed times real time, 0 doesn't wait
+
+#include "alloc.h"
+#include "audio.h"
+#include "fifo.h"
+#include "mp3.h"
+#include "mpeg.h"
+#include "wm8731.h"
+
+#include "espressif/esp_common.h"
+#include "i2s_dma/i2s_dma.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Stack of the decoder task in main.c
+#define DECODER_STACK 2100
+// What mp3.c reads from the FIFO at once at most
+#define INPUT_SIZE 1449
+#define CHUNK_SIZE 4096
+
+struct result {
+  unsigned int frames;
+  uint32_t samples;     // per channel
+  uint32_t decode_time; // us, without waiting for the output
+  unsigned int underruns;
+  unsigned int bad_frames;
+  uint32_t skip_time; // us of decode_time spent on the calls that skipped
+  struct alloc_stats heap;
+  size_t stack;        // bytes of the decoder task
+  unsigned int rate;   // Hz
+  uint64_t audio_time; // us
+  uint32_t checksum;
+};
+
+static const char *path;
+static unsigned int damage_every;
+static struct result result;
+static int status;
+static TaskHandle_t main_task;
+
+// Reads the whole file, returns NULL on errors
+static uint8_t *load(const char *path, size_t *len) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    perror(path);
+    return NULL;
+  }
+  uint8_t *data = NULL;
+  if (fseek(f, 0, SEEK_END) == 0 && (*len = ftell(f)) > 0 &&
+      fseek(f, 0, SEEK_SET) == 0 && (data = malloc(*len)) != NULL &&
+      fread(data, 1, *len, f) != *len) {
+    free(data);
+    data = NULL;
+  }
+  fclose(f);
+  if (data == NULL)
+    printf("%s: can't read\n", path);
+  return data;
+}
+
+// Sets big_values of the first granule out of range in every nth Layer III
+// frame, which mpeg_check_frame() rejects. Returns the frames damaged.
+static unsigned int damage(uint8_t *data, size_t len, unsigned int n) {
+  unsigned int frames = 0, damaged = 0;
+  struct mpeg_header header;
+  for (size_t i = 0; i + MPEG_HEADER_SIZE <= len;) {
+    if (mpeg_parse_header(data + i, &header) != 0 ||
+        header.frame_length == 0 || i + header.frame_length > len) {
+      ++i;
+      continue;
+    }
+    if (header.layer == 3 && ++frames % n == 0) {
+      const unsigned int nch = header.channels;
+      uint8_t *si = data + i + MPEG_HEADER_SIZE + (header.protection ? 2 : 0);
+      // after main_data_begin, the private bits, scfsi and part2_3_length
+      const unsigned int pos = header.version == MPEG_VERSION_1
+                                   ? 9 + (nch == 1 ? 5 : 3) + 4 * nch + 12
+                                   : 8 + nch + 12;
+      for (unsigned int bit = pos; bit < pos + 9; ++bit)
+        si[bit >> 3] |= 0x80 >> (bit & 7);
+      ++damaged;
+    }
+    i += header.frame_length;
+  }
+  return damaged;
+}
+
+// Keeps the FIFO topped up from the file. Returns false once the file is done
+// and the FIFO holds less than the decoder might ask for, so it never blocks.
+static bool feed(const uint8_t *data, size_t len, size_t *pos) {
+  while (*pos < len && fifo_free() >= CHUNK_SIZE) {
+    const size_t n = len - *pos < CHUNK_SIZE ? len - *pos : CHUNK_SIZE;
+    fifo_enqueue(data + *pos, n);
+    *pos += n;
+  }
+  return *pos < len || fifo_fill() >= INPUT_SIZE;
+}
+
+static void decode_task(void *arg) {
+  size_t len, pos = 0;
+  uint8_t *data = load(path, &len);
+  if (data == NULL) {
+    status = 1;
+    goto done;
+  }
+  if (damage_every > 0)
+    damage(data, len, damage_every);
+
+  feed(data, len, &pos);
+  get_and_reset_underrun_counter();
+  get_and_reset_wait_time();
+  get_and_reset_bad_frame_counter();
+  host_alloc_reset_peak();
+
+  if (codec_mp3.open() != 0) {
+    printf("opening the decoder failed\n");
+    status = 1;
+    goto done;
+  }
+  while (feed(data, len, &pos)) {
+    const uint32_t start = sdk_system_get_time();
+    if (codec_mp3.decode_frame() != 0)
+      break;
+    const uint32_t time =
+        sdk_system_get_time() - start - get_and_reset_wait_time();
+    result.decode_time += time;
+    const unsigned int bad = get_and_reset_bad_frame_counter();
+    if (bad > 0) {
+      result.bad_frames += bad;
+      result.skip_time += time;
+    }
+    ++result.frames;
+  }
+  codec_mp3.close();
+  free(data);
+
+  result.samples = audio_written();
+  result.underruns = get_and_reset_underrun_counter();
+  result.heap = host_alloc_stats;
+  result.checksum = audio_checksum();
+
+done:
+  xTaskNotifyGive(main_task);
+  vTaskDelete(NULL);
+}
+
+// Decodes the file in this process and prints its results
+static int bench(const char *file) {
+  path = file;
+  main_task = xTaskGetCurrentTaskHandle();
+  if (fifo_init() || wm8731_init()) {
+    printf("initialization failed\n");
+    return 1;
+  }
+  audio_init();
+
+  TaskHandle_t task;
+  if (xTaskCreate(decode_task, "decode", DECODER_STACK, NULL, 4, &task) !=
+      pdPASS)
+    return 1;
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  audio_stop();
+  if (status != 0)
+    return status;
+
+  result.rate = audio_sample_rate();
+  result.audio_time = (uint64_t)result.samples * 1000000 / result.rate;
+  result.stack = host_task_stack_used(task);
+  printf("%s:\n", path);
+  printf("  frames: %u (%u bad), %.2f s at %u Hz\n", result.frames,
+         result.bad_frames, result.audio_time / 1e6, result.rate);
+  printf("  decode time: %.3f s, realtime factor %.1f\n",
+         result.decode_time / 1e6,
+         result.decode_time ? (double)result.audio_time / result.decode_time
+                            : 0);
+  if (result.bad_frames > 0 && result.frames > result.bad_frames) {
+    // the decode time of an intact frame is what a damaged one would have
+    // cost without the check
+    const double decoded = (double)(result.decode_time - result.skip_time) /
+                           (result.frames - result.bad_frames);
+    const double skipped = (double)result.skip_time / result.bad_frames;
+    printf("  damaged frames: %.0f us decoded, %.0f us skipped, %.3f s saved\n",
+           decoded, skipped, (decoded - skipped) * result.bad_frames / 1e6);
+  }
+  printf("  heap: %u allocations, %zu bytes peak\n", result.heap.allocations,
+         result.heap.peak);
+  printf("  decoder stack: %zu bytes used\n", result.stack);
+  if (host_i2s_speed > 0)
+    printf("  underruns: %u\n", result.underruns);
+  printf("  checksum: %08x\n", result.checksum);
+  return 0;
+}
+
+// Runs bench() in a child process and collects its result. Returns 0 on
+// success.
+static int bench_child(const char *file, struct result *r) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    perror("pipe");
+    return 1;
+  }
+  fflush(stdout);
+  const pid_t pid = fork();
+  if (pid < 0) {
+    perror("fork");
+    return 1;
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    const int ret = bench(file);
+    if (ret == 0 && write(fds[1], &result, sizeof(result)) != sizeof(result))
+      exit(1);
+    exit(ret);
+  }
+
+  close(fds[1]);
+  const bool complete = read(fds[0], r, sizeof(*r)) == sizeof(*r);
+  close(fds[0]);
+  int wstatus;
+  waitpid(pid, &wstatus, 0);
+  return !complete || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0;
+}
+
+// The results of all files
+struct totals {
+  int files, failed;
+  struct result sum; // heap and stack are the maximum of the files
+  double slowest;    // lowest realtime factor
+};
+
+static int is_mp3(const struct dirent *entry) {
+  const size_t len = strlen(entry->d_name);
+  return entry->d_name[0] != '.' && len > 4 &&
+         strcasecmp(entry->d_name + len - 4, ".mp3") == 0;
+}
+
+// Benchmarks a file, or the MP3 files of a directory in the order of their
+// names, and adds their results to the totals
+static void bench_path(const char *path, struct totals *t) {
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    perror(path);
+    ++t->failed;
+    return;
+  }
+
+  if (!S_ISDIR(st.st_mode)) {
+    struct result r;
+    if (bench_child(path, &r) != 0) {
+      ++t->failed;
+      return;
+    }
+    struct result *sum = &t->sum;
+    sum->frames += r.frames;
+    sum->decode_time += r.decode_time;
+    sum->underruns += r.underruns;
+    sum->bad_frames += r.bad_frames;
+    sum->audio_time += r.audio_time;
+    if (r.heap.peak > sum->heap.peak)
+      sum->heap.peak = r.heap.peak;
+    if (r.stack > sum->stack)
+      sum->stack = r.stack;
+    const double factor =
+        r.decode_time ? (double)r.audio_time / r.decode_time : 0;
+    if (t->files++ == 0 || factor < t->slowest)
+      t->slowest = factor;
+    return;
+  }
+
+  struct dirent **entries;
+  const int n = scandir(path, &entries, is_mp3, alphasort);
+  if (n < 0) {
+    perror(path);
+    ++t->failed;
+    return;
+  }
+  for (int i = 0; i < n; ++i) {
+    char file[PATH_MAX];
+    snprintf(file, sizeof(file), "%s/%s", path, entries[i]->d_name);
+    bench_path(file, t);
+    free(entries[i]);
+  }
+  free(entries);
+}
+
+int main(int argc, char **argv) {
+  int opt;
+  while ((opt = getopt(argc, argv, "md:s:")) != -1) {
+    switch (opt) {
+    case 'm':
+      mp3_set_mono(true);
+      break;
+    case 'd':
+      damage_every = atoi(optarg);
+      break;
+    case 's':
+      host_i2s_speed = atoi(optarg);
+      break;
+    default:
+      optind = argc;
+      break;
+    }
+  }
+  if (optind >= argc) {
+    fprintf(stderr, "usage: %s [-m] [-d n] [-s speed] file.mp3|directory...\n",
+            argv[0]);
+    return 2;
+  }
+
+  struct totals t = {0};
+  for (int i = optind; i < argc; ++i)
+    bench_path(argv[i], &t);
+  if (t.files + t.failed > 1) {
+    printf("%d files", t.files);
+    if (t.failed > 0)
+      printf(", %d failed", t.failed);
+    printf(":\n");
+    printf("  frames: %u (%u bad), %.2f s\n", t.sum.frames, t.sum.bad_frames,
+           t.sum.audio_time / 1e6);
+    printf("  decode time: %.3f s, realtime factor %.1f, slowest file %.1f\n",
+           t.sum.decode_time / 1e6,
+           t.sum.decode_time ? (double)t.sum.audio_time / t.sum.decode_time
+                             : 0,
+           t.slowest);
+    printf("  heap: %zu bytes peak, decoder stack: %zu bytes used\n",
+           t.sum.heap.peak, t.sum.stack);
+    if (host_i2s_speed > 0)
+      printf("  underruns: %u\n", t.sum.underruns);
+  }
+  return t.failed > 0 || t.files == 0;
+}
@@ -0,0 +1,57 @@
+// Time of pcm_pack() per frame for each dither mode, for stereo input and for
+// single channel input, which is converted once and duplicated.
+
+#include "pcm.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// A granule of a frame
+#define COUNT 576
+#define ROUNDS 20000
+
+static mad_fixed_t left[COUNT], right[COUNT];
+static uint32_t out[COUNT];
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double run(enum pcm_dither dither, mad_fixed_t gain, bool stereo) {
+  struct pcm_state state = {.dither = dither, .gain = gain};
+  const double start = now();
+  for (int i = 0; i < ROUNDS; ++i)
+    pcm_pack(&state, out, left, stereo ? right : NULL, COUNT);
+  return (now() - start) / ROUNDS / COUNT * 1e9;
+}
+
+int main(void) {
+  srand(1);
+  for (int i = 0; i < COUNT; ++i) {
+    left[i] = (mad_fixed_t)(rand() % (2 * MAD_F_ONE)) - MAD_F_ONE;
+    right[i] = (mad_fixed_t)(rand() % (2 * MAD_F_ONE)) - MAD_F_ONE;
+  }
+
+  static const struct {
+    const char *name;
+    enum pcm_dither dither;
+    mad_fixed_t gain;
+  } modes[] = {
+      {"round", PCM_DITHER_NONE, MAD_F_ONE},
+      {"gain", PCM_DITHER_NONE, MAD_F_ONE / 2},
+      {"tpdf", PCM_DITHER_TPDF, MAD_F_ONE},
+      {"shaped", PCM_DITHER_SHAPED, MAD_F_ONE},
+  };
+  printf("pcm_pack, ns per frame:\n");
+  printf("  %-8s %8s %8s\n", "", "stereo", "mono");
+  for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); ++i) {
+    printf("  %-8s %8.2f %8.2f\n", modes[i].name,
+           run(modes[i].dither, modes[i].gain, true),
+           run(modes[i].dither, modes[i].gain, false));
+  }
+  return 0;
+}
@@ -0,0 +1,207 @@
+// Stand-ins for the SDK functions that aren't tied to a bigger peripheral
+// model: the system timer, Wi-Fi status, UART, random numbers, the stdout
+// hook, GPIOs, I2C and the parameter area in flash.
+
+#include "alloc.h"
+
+#include "espressif/esp_common.h"
+
+#include "esp/gpio.h"
+#include "esp/hwrand.h"
+#include "esp/uart.h"
+#include "i2c/i2c.h"
+#include "stdout_redirect.h"
+#include "sysparam.h"
+
+#include "FreeRTOS.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SYSPARAM_MAX 32
+#define GPIO_COUNT 17
+
+volatile bool host_wifi_connected = true;
+volatile uint32_t host_time_offset;
+const char *volatile host_uart_input;
+void (*volatile host_uart_sink)(char c);
+uint8_t host_wm8731_regs[0x20];
+unsigned int host_sysparam_writes;
+
+static _WriteFunction *write_stdout;
+static volatile bool gpio_output[GPIO_COUNT], gpio_level[GPIO_COUNT];
+
+uint32_t sdk_system_get_time(void) {
+  static struct timespec start;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  if (start.tv_sec == 0 && start.tv_nsec == 0)
+    start = now;
+  return (now.tv_sec - start.tv_sec) * 1000000ULL +
+         (now.tv_nsec - start.tv_nsec) / 1000 + host_time_offset;
+}
+
+uint8_t sdk_wifi_station_get_connect_status(void) {
+  return host_wifi_connected ? STATION_GOT_IP : STATION_CONNECTING;
+}
+
+void uart_set_baud(int uart_num, int bps) {}
+
+void uart_putc(int uart_num, char c) {
+  if (host_uart_sink != NULL)
+    host_uart_sink(c);
+  else
+    putchar(c);
+}
+
+int uart_getc_nowait(int uart_num) {
+  const char *input = host_uart_input;
+  if (input == NULL || *input == '\0')
+    return -1;
+  host_uart_input = input + 1;
+  return (unsigned char)*input;
+}
+
+uint32_t hwrand(void) {
+  static uint32_t state = 1;
+  taskENTER_CRITICAL();
+  state = state * 1103515245 + 12345;
+  const uint32_t r = state;
+  taskEXIT_CRITICAL();
+  return r;
+}
+
+void set_write_stdout(_WriteFunction *f) { write_stdout = f; }
+
+ssize_t host_stdout_write(const void *ptr, size_t len) {
+  if (write_stdout == NULL)
+    return fwrite(ptr, 1, len, stdout);
+  return write_stdout(NULL, 1, ptr, len);
+}
+
+void gpio_enable(uint8_t gpio_num, gpio_direction_t direction) {
+  if (gpio_num < GPIO_COUNT)
+    gpio_output[gpio_num] = direction == GPIO_OUTPUT;
+}
+
+void gpio_write(uint8_t gpio_num, bool set) {
+  if (gpio_num < GPIO_COUNT)
+    gpio_level[gpio_num] = set;
+}
+
+// Inputs float high, outputs read back what was written
+bool gpio_read(uint8_t gpio_num) {
+  return gpio_num >= GPIO_COUNT || !gpio_output[gpio_num] ||
+         gpio_level[gpio_num];
+}
+
+bool host_gpio_driven_low(uint8_t gpio_num) { return !gpio_read(gpio_num); }
+
+int i2c_init(uint8_t bus, uint8_t scl_pin, uint8_t sda_pin, uint32_t freq) {
+  return 0;
+}
+
+// The WM8731 takes the register address in the upper 7 bits of the first
+// byte and a 9 bit value
+int i2c_slave_write(uint8_t bus, uint8_t slave_addr, const uint8_t *data,
+                    const uint8_t *buf, uint32_t len) {
+  if (slave_addr != 0x1a || data == NULL || len != 1)
+    return 1;
+  host_wm8731_regs[(*data >> 1) & 0x1f] = buf[0];
+  return 0;
+}
+
+struct param {
+  char key[32];
+  uint8_t *value;
+  size_t len;
+};
+
+static struct param params[SYSPARAM_MAX];
+static pthread_mutex_t params_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct param *find_param(const char *key, bool create) {
+  struct param *free_param = NULL;
+  for (int i = 0; i < SYSPARAM_MAX; ++i) {
+    if (params[i].value != NULL && strcmp(params[i].key, key) == 0)
+      return &params[i];
+    if (params[i].value == NULL && free_param == NULL)
+      free_param = &params[i];
+  }
+  if (!create || free_param == NULL || strlen(key) >= sizeof(free_param->key))
+    return NULL;
+  strcpy(free_param->key, key);
+  return free_param;
+}
+
+sysparam_status_t sysparam_set_data(const char *key, const uint8_t *value,
+                                    size_t value_len, bool binary) {
+  pthread_mutex_lock(&params_lock);
+  ++host_sysparam_writes;
+  struct param *param = find_param(key, value_len > 0);
+  sysparam_status_t status = SYSPARAM_OK;
+  if (param != NULL) {
+    free(param->value);
+    param->value = NULL;
+    if (value_len > 0) {
+      // keep a terminator, strings are stored without one
+      param->value = malloc(value_len + 1);
+      memcpy(param->value, value, value_len);
+      param->value[value_len] = '\0';
+      param->len = value_len;
+    }
+  } else if (value_len > 0) {
+    status = SYSPARAM_ERR_FULL;
+  }
+  pthread_mutex_unlock(&params_lock);
+  return status;
+}
+
+sysparam_status_t sysparam_set_string(const char *key, const char *value) {
+  return sysparam_set_data(key, (const uint8_t *)value, strlen(value), false);
+}
+
+sysparam_status_t sysparam_get_string(const char *key, char **destptr) {
+  pthread_mutex_lock(&params_lock);
+  struct param *param = find_param(key, false);
+  sysparam_status_t status = SYSPARAM_NOTFOUND;
+  if (param != NULL) {
+    // freed by the firmware
+    *destptr = host_malloc(param->len + 1);
+    memcpy(*destptr, param->value, param->len + 1);
+    status = SYSPARAM_OK;
+  }
+  pthread_mutex_unlock(&params_lock);
+  return status;
+}
+
+sysparam_status_t sysparam_set_int32(const char *key, int32_t value) {
+  return sysparam_set_data(key, (const uint8_t *)&value, sizeof(value), true);
+}
+
+sysparam_status_t sysparam_get_int32(const char *key, int32_t *result) {
+  pthread_mutex_lock(&params_lock);
+  struct param *param = find_param(key, false);
+  sysparam_status_t status = SYSPARAM_NOTFOUND;
+  if (param != NULL && param->len == sizeof(*result)) {
+    memcpy(result, param->value, sizeof(*result));
+    status = SYSPARAM_OK;
+  } else if (param != NULL) {
+    status = SYSPARAM_ERR_BADVALUE;
+  }
+  pthread_mutex_unlock(&params_lock);
+  return status;
+}
+
+void host_sysparam_clear(void) {
+  pthread_mutex_lock(&params_lock);
+  for (int i = 0; i < SYSPARAM_MAX; ++i) {
+    free(params[i].value);
+    params[i].value = NULL;
+  }
+  host_sysparam_writes = 0;
+  pthread_mutex_unlock(&params_lock);
+}
@@ -0,0 +1,28 @@
+#ifndef HOST_FAKE_CODEC_H_
+#define HOST_FAKE_CODEC_H_
+
+// An MP3 codec for the decoder task that plays constant levels instead of
+// decoding. Its frames are MPEG-1 Layer III frames at 128 kbit/s and 44.1
+// kHz, so the stream client finds them like real ones. The first byte after
+// the header is the level of all samples.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FAKE_FRAME_SIZE 417
+#define FAKE_FRAME_SAMPLES 1152
+// Length of a frame at 320 kbit/s
+#define FAKE_FRAME_MAX 1044
+
+extern volatile unsigned int fake_codec_opens;
+// Number of the next opens that fail
+extern volatile unsigned int fake_codec_failing_opens;
+
+// Fills FAKE_FRAME_SIZE bytes with a frame of samples of level << 8
+void fake_codec_frame(uint8_t *frame, int8_t level);
+// Fills a frame of samples of level << 8 at one of the bitrates of MPEG-1
+// Layer III in kbit/s, like a frame of a VBR stream. Returns its length.
+size_t fake_codec_vbr_frame(uint8_t *frame, int8_t level,
+                            unsigned int bitrate);
+
+#endif /* HOST_FAKE_CODEC_H_ */
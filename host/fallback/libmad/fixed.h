@@ -0,0 +1,23 @@
+#ifndef HOST_FALLBACK_LIBMAD_FIXED_H_
+#define HOST_FALLBACK_LIBMAD_FIXED_H_
+
+// The fixed-point format of libmad and its FPM_DEFAULT multiplication, as
+// configured in libmad_config.h
+
+typedef signed int mad_fixed_t;
+
+#define MAD_F_FRACBITS 28
+#define MAD_F(x) ((mad_fixed_t)(x##L))
+#define MAD_F_MIN ((mad_fixed_t)-0x80000000L)
+#define MAD_F_MAX ((mad_fixed_t)+0x7fffffffL)
+#define MAD_F_ONE MAD_F(0x10000000)
+
+#define mad_f_tofixed(x)                                                       \
+  ((mad_fixed_t)((x) * (double)(1L << MAD_F_FRACBITS) + 0.5))
+#define mad_f_todouble(x)                                                      \
+  ((double)((x) / (double)(1L << MAD_F_FRACBITS)))
+
+#define mad_f_mul(x, y)                                                        \
+  ((((x) + (1L << 11)) >> 12) * (((y) + (1L << 15)) >> 16))
+
+#endif /* HOST_FALLBACK_LIBMAD_FIXED_H_ */
@@ -0,0 +1,9 @@
+#ifndef HOST_FALLBACK_LIBMAD_GLOBAL_H_
+#define HOST_FALLBACK_LIBMAD_GLOBAL_H_
+
+// Used instead of the libmad submodule when it isn't checked out, so the
+// modules that only need its fixed-point type can still be built and tested.
+
+#include "libmad_config.h"
+
+#endif /* HOST_FALLBACK_LIBMAD_GLOBAL_H_ */
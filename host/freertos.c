@@ -0,0 +1,320 @@
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
+
+#include "espressif/esp_common.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Host stacks get this on top of the requested depth
+#define STACK_EXTRA (64 * 1024)
+#define STACK_FILL 0xa5
+
+struct host_task {
+  char name[16];
+  TaskFunction_t code;
+  void *param;
+  pthread_t thread;
+  uint8_t *stack;
+  size_t stack_size;
+  volatile bool deleted;
+  // notification value, protected by lock
+  uint32_t notified;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+};
+
+struct host_queue {
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  size_t length, item_size;
+  size_t head, count;
+  uint8_t *items;
+};
+
+static __thread struct host_task *current;
+static pthread_mutex_t critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+void vPortEnterCritical(void) { pthread_mutex_lock(&critical); }
+
+void vPortExitCritical(void) { pthread_mutex_unlock(&critical); }
+
+static struct host_task *task_alloc(const char *name) {
+  struct host_task *task = calloc(1, sizeof(*task));
+  if (task == NULL)
+    return NULL;
+  snprintf(task->name, sizeof(task->name), "%s", name);
+  pthread_mutex_init(&task->lock, NULL);
+  pthread_cond_init(&task->wake, NULL);
+  return task;
+}
+
+// Absolute deadline for a wait of ticks, false if it waits forever
+static bool deadline(TickType_t ticks, struct timespec *ts) {
+  if (ticks == portMAX_DELAY)
+    return false;
+  clock_gettime(CLOCK_REALTIME, ts);
+  const uint64_t ns =
+      ts->tv_nsec + (uint64_t)ticks * portTICK_PERIOD_MS * 1000000;
+  ts->tv_sec += ns / 1000000000;
+  ts->tv_nsec = ns % 1000000000;
+  return true;
+}
+
+// Waits for cond, returns false once the deadline has passed
+static bool wait(pthread_cond_t *cond, pthread_mutex_t *lock, bool timed,
+                 const struct timespec *ts) {
+  if (!timed) {
+    pthread_cond_wait(cond, lock);
+    return true;
+  }
+  return pthread_cond_timedwait(cond, lock, ts) != ETIMEDOUT;
+}
+
+static void *task_main(void *arg) {
+  current = arg;
+  current->code(current->param);
+  // returning from a task function is a bug on FreeRTOS
+  fprintf(stderr, "task %s returned\n", current->name);
+  abort();
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name,
+                       uint16_t stack_depth, void *param,
+                       UBaseType_t priority, TaskHandle_t *handle) {
+  struct host_task *task = task_alloc(name);
+  if (task == NULL)
+    return pdFAIL;
+  task->code = code;
+  task->param = param;
+  task->stack_size = STACK_EXTRA + stack_depth * sizeof(StackType_t) * 2;
+  task->stack = malloc(task->stack_size);
+  if (task->stack == NULL) {
+    free(task);
+    return pdFAIL;
+  }
+  memset(task->stack, STACK_FILL, task->stack_size);
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstack(&attr, task->stack, task->stack_size);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  const int err = pthread_create(&task->thread, &attr, task_main, task);
+  pthread_attr_destroy(&attr);
+  if (err != 0) {
+    free(task->stack);
+    free(task);
+    return pdFAIL;
+  }
+
+  if (handle != NULL)
+    *handle = task;
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (task != NULL && task != current) {
+    fprintf(stderr, "deleting another task isn't supported\n");
+    abort();
+  }
+  // The task structure stays around, so the handle can still be queried.
+  // Its stack is freed by nobody, the thread is still running on it.
+  current->deleted = true;
+  pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks) {
+  if (ticks == 0) {
+    sched_yield();
+    return;
+  }
+  const struct timespec ts = {
+      .tv_sec = ticks * portTICK_PERIOD_MS / 1000,
+      .tv_nsec = ticks * portTICK_PERIOD_MS % 1000 * 1000000L,
+  };
+  nanosleep(&ts, NULL);
+}
+
+void taskYIELD(void) { sched_yield(); }
+
+TickType_t xTaskGetTickCount(void) {
+  return sdk_system_get_time() / 1000 / portTICK_PERIOD_MS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+  // the main thread becomes a task the first time it asks
+  if (current == NULL)
+    current = task_alloc("main");
+  return current;
+}
+
+eTaskState eTaskGetState(TaskHandle_t task) {
+  return task->deleted ? eDeleted : eRunning;
+}
+
+// Bytes at the end of the stack that have never been written
+static size_t stack_unused(TaskHandle_t task) {
+  if (task == NULL || task->stack == NULL)
+    return 0;
+  // the stack grows down, the lowest bytes are the last to be used
+  size_t unused = 0;
+  while (unused < task->stack_size && task->stack[unused] == STACK_FILL)
+    ++unused;
+  return unused;
+}
+
+size_t host_task_stack_used(TaskHandle_t task) {
+  return task != NULL && task->stack != NULL
+             ? task->stack_size - stack_unused(task)
+             : 0;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  return stack_unused(task) / sizeof(StackType_t);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  struct host_task *task = xTaskGetCurrentTaskHandle();
+  struct timespec ts;
+  const bool timed = deadline(ticks, &ts);
+
+  pthread_mutex_lock(&task->lock);
+  while (task->notified == 0 && wait(&task->wake, &task->lock, timed, &ts))
+    ;
+  const uint32_t value = task->notified;
+  if (value > 0)
+    task->notified = clear ? 0 : value - 1;
+  pthread_mutex_unlock(&task->lock);
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  pthread_mutex_lock(&task->lock);
+  ++task->notified;
+  pthread_cond_signal(&task->wake);
+  pthread_mutex_unlock(&task->lock);
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {
+  xTaskNotifyGive(task);
+  if (woken != NULL)
+    *woken = pdTRUE;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+  struct host_queue *queue = calloc(1, sizeof(*queue));
+  if (queue == NULL)
+    return NULL;
+  queue->items = calloc(length, item_size > 0 ? item_size : 1);
+  if (queue->items == NULL) {
+    free(queue);
+    return NULL;
+  }
+  queue->length = length;
+  queue->item_size = item_size;
+  pthread_mutex_init(&queue->lock, NULL);
+  pthread_cond_init(&queue->changed, NULL);
+  return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+  pthread_mutex_destroy(&queue->lock);
+  pthread_cond_destroy(&queue->changed);
+  free(queue->items);
+  free(queue);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+  pthread_mutex_lock(&queue->lock);
+  queue->head = queue->count = 0;
+  pthread_cond_broadcast(&queue->changed);
+  pthread_mutex_unlock(&queue->lock);
+  return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item,
+                      TickType_t ticks) {
+  struct timespec ts;
+  const bool timed = deadline(ticks, &ts);
+
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == queue->length) {
+    if (ticks == 0 || !wait(&queue->changed, &queue->lock, timed, &ts)) {
+      pthread_mutex_unlock(&queue->lock);
+      return pdFAIL;
+    }
+  }
+  const size_t tail = (queue->head + queue->count) % queue->length;
+  if (queue->item_size > 0)
+    memcpy(queue->items + tail * queue->item_size, item, queue->item_size);
+  ++queue->count;
+  pthread_cond_broadcast(&queue->changed);
+  pthread_mutex_unlock(&queue->lock);
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+  struct timespec ts;
+  const bool timed = deadline(ticks, &ts);
+
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == 0) {
+    if (ticks == 0 || !wait(&queue->changed, &queue->lock, timed, &ts)) {
+      pthread_mutex_unlock(&queue->lock);
+      return pdFAIL;
+    }
+  }
+  if (queue->item_size > 0)
+    memcpy(item, queue->items + queue->head * queue->item_size,
+           queue->item_size);
+  queue->head = (queue->head + 1) % queue->length;
+  --queue->count;
+  pthread_cond_broadcast(&queue->changed);
+  pthread_mutex_unlock(&queue->lock);
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  pthread_mutex_lock(&queue->lock);
+  const UBaseType_t count = queue->count;
+  pthread_mutex_unlock(&queue->lock);
+  return count;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item,
+                             BaseType_t *woken) {
+  return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t queue, void *item,
+                                BaseType_t *woken) {
+  return xQueueReceive(queue, item, 0);
+}
+
+BaseType_t xQueueIsQueueFullFromISR(QueueHandle_t queue) {
+  return uxQueueMessagesWaiting(queue) == queue->length;
+}
+
+UBaseType_t uxQueueMessagesWaitingFromISR(QueueHandle_t queue) {
+  return uxQueueMessagesWaiting(queue);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+  // a mutex starts out available
+  SemaphoreHandle_t sem = xQueueCreate(1, 0);
+  if (sem != NULL)
+    xSemaphoreGive(sem);
+  return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) { return xQueueCreate(1, 0); }
@@ -0,0 +1,137 @@
+// Model of the HSPI bus and the 23LC1024 SPI RAM on chip select 2. The real
+// spiram.c runs on top of it, including the quad I/O mode and the swapped
+// SIO2/SIO3 lines of the board. Transactions on chip select 1 go to the LCD
+// model, while GPIO16 is low they go to the touch controller model.
+
+#include "hspi.h"
+#include "hspi_model.h"
+#include "mi0283qt_model.h"
+
+#include "esp/gpio.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define SPIRAM_SIZE (128 * 1024)
+// the HSPI moves at most 16 words per transaction
+#define MAX_TRANSFER 64
+#define TOUCH_CS_GPIO 16
+
+struct hspi_bus_stats host_hspi_stats[3];
+
+static struct {
+  uint8_t memory[SPIRAM_SIZE];
+  uint8_t mode; // mode register, sequential after power-up
+  bool quad;    // the chip is in SQI mode after EQIO
+} spiram = {.mode = 0x40};
+
+// The board connects SIO2 of the ESP8266 to SIO3 of the chip and vice versa,
+// which swaps these bits of every nibble sent in quad mode
+static inline uint32_t swap_sio23(uint32_t x) {
+  return (x & 0x33333333) | ((x & 0x88888888) >> 1) | ((x & 0x44444444) << 1);
+}
+
+static void spiram_transfer(const struct hspi *hspi, bool write, uint8_t *data,
+                            size_t len, uint32_t addr, int cmd_bits,
+                            uint16_t cmd) {
+  const bool quad_bus = hspi->mode == SPI_MODE_QIO;
+
+  if (quad_bus != spiram.quad) {
+    // RSTIO is a byte of ones on all four lines, the chip ignores the rest
+    if (spiram.quad && write && cmd_bits == 0 && len == 1 && data[0] == 0xff)
+      spiram.quad = false;
+    return;
+  }
+
+  if (quad_bus) {
+    // the command is the top byte of the 32 bit address phase
+    addr = swap_sio23(addr);
+    cmd = addr >> 24;
+  }
+  addr &= SPIRAM_SIZE - 1;
+
+  switch (cmd) {
+  case 0x01: // WRMR
+    if (write && len > 0)
+      spiram.mode = data[0];
+    break;
+  case 0x05: // RDMR
+    if (!write && len > 0)
+      data[0] = spiram.mode;
+    break;
+  case 0x38: // EQIO
+    spiram.quad = true;
+    break;
+  case 0x02: // WRITE, sequential mode wraps around at the end
+    for (size_t i = 0; i < len; ++i) {
+      const uint8_t b = quad_bus ? swap_sio23(data[i]) : data[i];
+      spiram.memory[(addr + i) % SPIRAM_SIZE] = b;
+    }
+    break;
+  case 0x03: // READ
+    for (size_t i = 0; i < len; ++i) {
+      const uint8_t b = spiram.memory[(addr + i) % SPIRAM_SIZE];
+      data[i] = quad_bus ? swap_sio23(b) : b;
+    }
+    break;
+  }
+}
+
+// Accounts for a transaction, the command, address and data go out on four
+// lines in QIO mode
+static void account(const struct hspi *hspi, size_t len, int addr_bits,
+                    int cmd_bits, int dummy_cycles) {
+  const unsigned int lines = hspi->mode == SPI_MODE_QIO   ? 4
+                             : hspi->mode == SPI_MODE_DIO ? 2
+                                                          : 1;
+  const uint64_t cycles =
+      (cmd_bits + addr_bits + len * 8) / lines + dummy_cycles;
+  struct hspi_bus_stats *s = &host_hspi_stats[hspi->cs];
+  ++s->transactions;
+  s->bytes += len;
+  s->bus_ns += cycles * hspi->clock_div * 1000 / 80;
+}
+
+int hspi_init(struct hspi *hspi) {
+  if (hspi->mode != SPI_MODE_SPI && hspi->mode != SPI_MODE_DIO &&
+      hspi->mode != SPI_MODE_QIO)
+    return 1;
+  if (hspi->cs < 0 || hspi->cs > 2)
+    return 1;
+  if (hspi->clock_div < 1 || hspi->clock_div > 64)
+    return 1;
+  return 0;
+}
+
+size_t hspi_read(struct hspi *hspi, size_t len, void *data, int addr_bits,
+                 uint32_t addr, int cmd_bits, uint16_t cmd,
+                 int dummy_cycles) {
+  if (len > MAX_TRANSFER)
+    len = MAX_TRANSFER;
+  account(hspi, len, addr_bits, cmd_bits, dummy_cycles);
+
+  memset(data, 0xff, len);
+  if (hspi->cs == 2)
+    spiram_transfer(hspi, false, data, len, addr, cmd_bits, cmd);
+  if (host_gpio_driven_low(TOUCH_CS_GPIO))
+    touch_model_transfer(false, data, len, cmd_bits, cmd, hspi->cs != 0);
+  return len;
+}
+
+size_t hspi_write(struct hspi *hspi, size_t len, const void *data,
+                  int addr_bits, uint32_t addr, int cmd_bits, uint16_t cmd) {
+  if (len > MAX_TRANSFER)
+    len = MAX_TRANSFER;
+  account(hspi, len, addr_bits, cmd_bits, 0);
+
+  uint8_t buf[MAX_TRANSFER];
+  if (len > 0)
+    memcpy(buf, data, len);
+  if (hspi->cs == 1)
+    lcd_model_transfer(cmd, buf, len);
+  if (hspi->cs == 2)
+    spiram_transfer(hspi, true, buf, len, addr, cmd_bits, cmd);
+  if (host_gpio_driven_low(TOUCH_CS_GPIO))
+    touch_model_transfer(true, buf, len, cmd_bits, cmd, hspi->cs != 0);
+  return len;
+}
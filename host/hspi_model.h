@@ -0,0 +1,15 @@
+#ifndef HOST_HSPI_MODEL_H_
+#define HOST_HSPI_MODEL_H_
+
+#include <stdint.h>
+
+// Traffic on the HSPI bus per hardware chip select
+struct hspi_bus_stats {
+  unsigned int transactions;
+  uint64_t bytes;  // data bytes, without command and address
+  uint64_t bus_ns; // time the bus was busy at the configured clock
+};
+
+extern struct hspi_bus_stats host_hspi_stats[3];
+
+#endif /* HOST_HSPI_MODEL_H_ */
@@ -0,0 +1,105 @@
+#include "i2s_dma/i2s_dma.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+
+// The I2S clock is derived from the 160 MHz CPU clock
+#define BASE_FREQ 160000000
+
+struct i2s_regs I2S;
+volatile unsigned int host_i2s_speed = 1;
+void (*volatile host_i2s_sink)(const uint32_t *frames, size_t count);
+
+static i2s_dma_isr_t isr;
+static void *isr_arg;
+static pthread_t thread;
+static volatile bool running;
+static dma_descriptor_t *eof_descriptor;
+static bool eof_pending;
+
+i2s_clock_div_t i2s_get_clock_div(int32_t freq) {
+  i2s_clock_div_t div = {.bclk_div = 1, .clkm_div = 1};
+  int32_t best = -1;
+
+  for (int bclk = 1; bclk < 64; ++bclk) {
+    for (int clkm = 1; clkm < 64; ++clkm) {
+      const int32_t f = BASE_FREQ / (bclk * clkm);
+      const int32_t error = f > freq ? f - freq : freq - f;
+      if (best < 0 || error < best) {
+        best = error;
+        div.bclk_div = bclk;
+        div.clkm_div = clkm;
+      }
+    }
+  }
+  return div;
+}
+
+unsigned int host_i2s_frame_rate(void) {
+  const unsigned int bclk = (I2S.CONF >> I2S_CONF_BCK_DIV_S) & 0x3f;
+  const unsigned int clkm = (I2S.CONF >> I2S_CONF_CLKM_DIV_S) & 0x3f;
+  if (bclk == 0 || clkm == 0)
+    return 0;
+  // a stereo frame is two 16 bit slots
+  return BASE_FREQ / (bclk * clkm) / 32;
+}
+
+static void play(const dma_descriptor_t *descr) {
+  const size_t frames = descr->datalen / sizeof(uint32_t);
+  if (host_i2s_sink != NULL)
+    host_i2s_sink(descr->buf_ptr, frames);
+
+  const unsigned int speed = host_i2s_speed;
+  const unsigned int rate = host_i2s_frame_rate();
+  if (speed == 0 || rate == 0) {
+    sched_yield();
+    return;
+  }
+  const uint64_t ns = (uint64_t)frames * 1000000000 / rate / speed;
+  const struct timespec ts = {.tv_sec = ns / 1000000000,
+                              .tv_nsec = ns % 1000000000};
+  nanosleep(&ts, NULL);
+}
+
+static void *dma_thread(void *arg) {
+  for (dma_descriptor_t *descr = arg; running; descr = descr->next_link_ptr) {
+    play(descr);
+    if (descr->eof) {
+      eof_descriptor = descr;
+      eof_pending = true;
+      isr(isr_arg);
+    }
+  }
+  return NULL;
+}
+
+void i2s_dma_init(i2s_dma_isr_t handler, void *arg, i2s_clock_div_t clock_div,
+                  i2s_pins_t pins) {
+  isr = handler;
+  isr_arg = arg;
+  I2S.CONF = (clock_div.bclk_div << I2S_CONF_BCK_DIV_S) |
+             (clock_div.clkm_div << I2S_CONF_CLKM_DIV_S);
+}
+
+void i2s_dma_start(dma_descriptor_t *descr) {
+  running = true;
+  if (pthread_create(&thread, NULL, dma_thread, descr) != 0) {
+    perror("i2s_dma_start");
+    running = false;
+  }
+}
+
+void i2s_dma_stop(void) {
+  if (!running)
+    return;
+  running = false;
+  pthread_join(thread, NULL);
+}
+
+bool i2s_dma_is_eof_interrupt(void) { return eof_pending; }
+
+dma_descriptor_t *i2s_dma_get_eof_descriptor(void) { return eof_descriptor; }
+
+void i2s_dma_clear_interrupt(void) { eof_pending = false; }
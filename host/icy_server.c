@@ -0,0 +1,230 @@
+#include "icy_server.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// Audio is written in pieces of this size at most
+#define CHUNK 4096
+// A TCP segment of Ethernet size, the unit of losses and of paced writes
+#define SEGMENT 1460
+
+static uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static void update_cpu(struct icy_server *server) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  server->cpu_ns = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Waits up to 100 ms for the socket, returns false once the server stops
+static bool wait_for(struct icy_server *server, int fd, short events) {
+  struct pollfd pfd = {.fd = fd, .events = events};
+  while (!server->stop) {
+    if (poll(&pfd, 1, 100) != 0)
+      return true;
+  }
+  return false;
+}
+
+// Sleeps until the time in us, returns false once the server stops
+static bool pause_until(struct icy_server *server, uint64_t until) {
+  for (uint64_t now = now_us(); now < until && !server->stop; now = now_us()) {
+    const uint64_t us = until - now < 100000 ? until - now : 100000;
+    const struct timespec ts = {.tv_nsec = us * 1000};
+    nanosleep(&ts, NULL);
+  }
+  return !server->stop;
+}
+
+// Returns 0 once all of data is sent, the send timeout lets it check for
+// the server being stopped
+static int send_all(struct icy_server *server, int fd, const void *data,
+                    size_t len) {
+  while (len > 0 && !server->stop) {
+    const ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR))
+      continue;
+    if (n <= 0)
+      return 1;
+    data = (const uint8_t *)data + n;
+    len -= n;
+  }
+  return len > 0;
+}
+
+// Reads the request up to the end of its header, stores the path of its
+// request line
+static int read_request(struct icy_server *server, int fd, char path[256]) {
+  char request[1024];
+  size_t len = 0;
+  while (len < sizeof(request) - 1 && wait_for(server, fd, POLLIN)) {
+    const ssize_t n = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+    if (n <= 0)
+      return 1;
+    len += n;
+    request[len] = '\0';
+    if (strstr(request, "\r\n\r\n") != NULL)
+      return sscanf(request, "%*s %255s", path) != 1;
+  }
+  return 1;
+}
+
+static int send_metadata(struct icy_server *server, int fd) {
+  const char *title =
+      server->title != NULL ? server->title(server, server->pos) : NULL;
+  // a length byte in units of 16 bytes and the padded text
+  uint8_t block[1 + 255 * 16] = {0};
+  if (title != NULL) {
+    const int n = snprintf((char *)block + 1, sizeof(block) - 1,
+                           "StreamTitle='%s';", title);
+    block[0] = (n + 15) / 16;
+  }
+  return send_all(server, fd, block, 1 + block[0] * 16);
+}
+
+// Holds back the next segment for the rate cap and for a loss
+static bool impair(struct icy_server *server, uint64_t start, uint64_t bytes) {
+  if (server->rate > 0 &&
+      !pause_until(server, start + bytes * 1000000 / server->rate))
+    return false;
+  if (server->loss > 0 && rand_r(&server->seed) % 1000 < server->loss) {
+    ++server->lost;
+    return pause_until(server, now_us() + server->rto * 1000ULL);
+  }
+  return true;
+}
+
+// Sends a document with a length, which keeps the connection open
+static int send_page(struct icy_server *server, int fd, const char *type,
+                     const uint8_t *body, size_t len) {
+  char header[256];
+  const int n = snprintf(header, sizeof(header),
+                         "HTTP/1.1 200 OK\r\nContent-Type: %s\r\n"
+                         "Content-Length: %zu\r\n\r\n",
+                         type, len);
+  return send_all(server, fd, header, n) || send_all(server, fd, body, len);
+}
+
+static void serve(struct icy_server *server, int fd) {
+  char path[256];
+  const char *type;
+  do {
+    if (read_request(server, fd, path) ||
+        !pause_until(server, now_us() + server->delay * 1000ULL))
+      return;
+    ++server->requests;
+
+    const uint8_t *body;
+    size_t len;
+    type = server->page != NULL ? server->page(server, path, &body, &len)
+                                : NULL;
+    if (type != NULL && send_page(server, fd, type, body, len))
+      return;
+  } while (type != NULL);
+
+  char header[256];
+  int len = snprintf(header, sizeof(header),
+                     "ICY 200 OK\r\nContent-Type: %s\r\n",
+                     server->content_type);
+  if (server->metaint > 0)
+    len += snprintf(header + len, sizeof(header) - len, "icy-metaint: %d\r\n",
+                    server->metaint);
+  if (server->bitrate > 0)
+    len += snprintf(header + len, sizeof(header) - len, "icy-br: %u\r\n",
+                    server->bitrate);
+  len += snprintf(header + len, sizeof(header) - len, "\r\n");
+  if (send_all(server, fd, header, len))
+    return;
+
+  uint8_t data[CHUNK];
+  uint64_t sent = 0;
+  // audio bytes left until the next metadata block
+  int block = server->metaint;
+  const bool impaired = server->rate > 0 || server->loss > 0;
+  const uint64_t start = now_us();
+  while (!server->stop && (server->length == 0 || sent < server->length)) {
+    size_t n = impaired ? SEGMENT : sizeof(data);
+    if (server->metaint > 0 && n > block)
+      n = block;
+    if (server->length > 0 && n > server->length - sent)
+      n = server->length - sent;
+
+    server->audio(server, server->pos, data, n);
+    if ((impaired && !impair(server, start, sent)) ||
+        send_all(server, fd, data, n))
+      break;
+    server->pos += n;
+    server->sent += n;
+    sent += n;
+    update_cpu(server);
+
+    block -= n;
+    if (server->metaint > 0 && block == 0) {
+      if (send_metadata(server, fd))
+        break;
+      block = server->metaint;
+    }
+  }
+}
+
+static void *server_main(void *arg) {
+  struct icy_server *server = arg;
+  while (wait_for(server, server->listener, POLLIN)) {
+    const int fd = accept(server->listener, NULL, NULL);
+    if (fd < 0)
+      continue;
+    if (server->connections++ > 0)
+      server->pos += server->skip;
+    const struct timeval timeout = {.tv_usec = 100000};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    serve(server, fd);
+    close(fd);
+    update_cpu(server);
+  }
+  return NULL;
+}
+
+int icy_server_start(struct icy_server *server) {
+  server->listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (server->listener < 0)
+    return 1;
+
+  struct sockaddr_in sa = {
+      .sin_family = AF_INET,
+      .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+  };
+  socklen_t len = sizeof(sa);
+  if (bind(server->listener, (struct sockaddr *)&sa, sizeof(sa)) != 0 ||
+      listen(server->listener, 4) != 0 ||
+      getsockname(server->listener, (struct sockaddr *)&sa, &len) != 0) {
+    close(server->listener);
+    return 1;
+  }
+  server->port = ntohs(sa.sin_port);
+
+  server->stop = false;
+  server->seed = 1;
+  if (pthread_create(&server->thread, NULL, server_main, server) != 0) {
+    close(server->listener);
+    return 1;
+  }
+  return 0;
+}
+
+void icy_server_stop(struct icy_server *server) {
+  server->stop = true;
+  pthread_join(server->thread, NULL);
+  close(server->listener);
+}
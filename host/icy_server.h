@@ -0,0 +1,72 @@
+#ifndef HOST_ICY_SERVER_H_
+#define HOST_ICY_SERVER_H_
+
+// A SHOUTcast/Icecast server on the loopback interface for the stream client.
+// It answers every request with an endless live stream, or one of length
+// bytes, with metadata interleaved every metaint bytes of audio. Connections
+// are served one at a time by a thread of the server. With a length, the
+// server drops the connection after every length bytes. Other documents, like
+// the playlists and segments of HLS, can be served by path over a connection
+// that is kept open.
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct icy_server;
+
+// Fills len bytes of audio from position pos of the stream on
+typedef void (*icy_server_audio_fn)(struct icy_server *server, uint64_t pos,
+                                    uint8_t *data, size_t len);
+// Returns the StreamTitle of the metadata block at audio position pos, or
+// NULL to send an empty block
+typedef const char *(*icy_server_title_fn)(struct icy_server *server,
+                                           uint64_t pos);
+// Returns the Content-Type of the document at path and sets its body, or
+// NULL to answer with the stream
+typedef const char *(*icy_server_page_fn)(struct icy_server *server,
+                                          const char *path,
+                                          const uint8_t **body, size_t *len);
+
+struct icy_server {
+  // set before icy_server_start()
+  const char *content_type;
+  int metaint;          // 0 sends no metadata
+  unsigned int bitrate; // kbit/s for icy-br, 0 leaves it out
+  uint64_t length;      // bytes of audio per connection, 0 for no end
+  uint64_t skip;        // bytes the stream moves on between connections
+  icy_server_audio_fn audio;
+  icy_server_title_fn title;
+  icy_server_page_fn page; // NULL serves the stream at every path
+  void *user;
+  // Impairments of the link. Loopback TCP doesn't lose data, so a lost
+  // segment is modeled as what the receiver sees of it: the stream stalls
+  // until the retransmission after rto.
+  unsigned int delay; // ms before the reply
+  unsigned int rate;  // bytes of audio per second, 0 for no cap
+  unsigned int loss;  // lost segments per thousand
+  unsigned int rto;   // ms
+
+  // state, read by the test
+  uint16_t port;
+  volatile unsigned int connections;
+  volatile unsigned int requests;
+  volatile uint64_t sent;     // bytes of audio over all connections
+  volatile uint64_t cpu_ns;   // CPU time of the server thread
+  volatile unsigned int lost; // segments
+  // the stream position continues across connections, like live radio
+  uint64_t pos;
+
+  unsigned int seed; // of the losses
+  int listener;
+  volatile bool stop;
+  pthread_t thread;
+};
+
+// Listens on an ephemeral port of 127.0.0.1, returns 0 on success
+int icy_server_start(struct icy_server *server);
+// Closes the current connection and the listener
+void icy_server_stop(struct icy_server *server);
+
+#endif /* HOST_ICY_SERVER_H_ */
@@ -0,0 +1,45 @@
+#ifndef HOST_FREERTOS_H_
+#define HOST_FREERTOS_H_
+
+// The parts of FreeRTOS the firmware uses, implemented on POSIX threads. Tasks
+// run truly in parallel, which shakes out more races than the single core of
+// the ESP8266 ever would.
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+#define portBASE_TYPE int
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+
+#define portMAX_DELAY 0xffffffffUL
+// esp-open-rtos runs the scheduler at 100 Hz
+#define portTICK_PERIOD_MS 10
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms) / portTICK_PERIOD_MS)
+#define configMINIMAL_STACK_SIZE 256
+
+// Critical sections are a single recursive lock shared by all tasks
+void vPortEnterCritical(void);
+void vPortExitCritical(void);
+#define taskENTER_CRITICAL() vPortEnterCritical()
+#define taskEXIT_CRITICAL() vPortExitCritical()
+#define portENTER_CRITICAL() vPortEnterCritical()
+#define portEXIT_CRITICAL() vPortExitCritical()
+// Interrupt handlers run on threads of their own and take the same lock
+#define taskENTER_CRITICAL_FROM_ISR() (vPortEnterCritical(), 0)
+#define taskEXIT_CRITICAL_FROM_ISR(state) ((void)(state), vPortExitCritical())
+#define portEND_SWITCHING_ISR(woken) ((void)(woken))
+
+// The heap is the size of what the ESP8266 has left after the SDK, the
+// allocations of the firmware are counted against it
+#define HOST_HEAP_SIZE (48 * 1024)
+size_t xPortGetFreeHeapSize(void);
+
+#endif /* HOST_FREERTOS_H_ */
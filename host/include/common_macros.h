@@ -0,0 +1,9 @@
+#ifndef HOST_COMMON_MACROS_H_
+#define HOST_COMMON_MACROS_H_
+
+#include <stddef.h>
+
+// There is no instruction RAM to place code in
+#define IRAM
+
+#endif /* HOST_COMMON_MACROS_H_ */
@@ -0,0 +1,17 @@
+#ifndef HOST_ESP_GPIO_H_
+#define HOST_ESP_GPIO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum { GPIO_INPUT, GPIO_OUTPUT } gpio_direction_t;
+
+void gpio_enable(uint8_t gpio_num, gpio_direction_t direction);
+void gpio_write(uint8_t gpio_num, bool set);
+bool gpio_read(uint8_t gpio_num);
+
+// Whether a pin is an output driven low. GPIO16 selects the touch controller
+// on the HSPI bus this way, see hspi.c.
+bool host_gpio_driven_low(uint8_t gpio_num);
+
+#endif /* HOST_ESP_GPIO_H_ */
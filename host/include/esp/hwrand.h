@@ -0,0 +1,9 @@
+#ifndef HOST_ESP_HWRAND_H_
+#define HOST_ESP_HWRAND_H_
+
+#include <stdint.h>
+
+// Deterministic, so runs can be repeated
+uint32_t hwrand(void);
+
+#endif /* HOST_ESP_HWRAND_H_ */
@@ -0,0 +1,16 @@
+#ifndef HOST_ESP_UART_H_
+#define HOST_ESP_UART_H_
+
+#include <stdint.h>
+
+// UART 0 is standard output, input comes from host_uart_input
+void uart_set_baud(int uart_num, int bps);
+void uart_putc(int uart_num, char c);
+int uart_getc_nowait(int uart_num);
+
+// Characters uart_getc_nowait() returns one after the other, may be NULL
+extern const char *volatile host_uart_input;
+// Gets what is written to UART 0 instead of standard output if set
+extern void (*volatile host_uart_sink)(char c);
+
+#endif /* HOST_ESP_UART_H_ */
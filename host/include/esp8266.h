@@ -0,0 +1,6 @@
+#ifndef HOST_ESP8266_H_
+#define HOST_ESP8266_H_
+
+#include "espressif/esp8266/esp8266.h"
+
+#endif /* HOST_ESP8266_H_ */
@@ -0,0 +1,7 @@
+#ifndef HOST_ESPRESSIF_ESP8266_H_
+#define HOST_ESPRESSIF_ESP8266_H_
+
+// The peripherals are modelled behind their driver interfaces, none of the
+// registers exist on the host
+
+#endif /* HOST_ESPRESSIF_ESP8266_H_ */
@@ -0,0 +1,23 @@
+#ifndef HOST_ESP_COMMON_H_
+#define HOST_ESP_COMMON_H_
+
+// Like the SDK header, this brings the C library basics along
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define STATION_IDLE 0
+#define STATION_CONNECTING 1
+#define STATION_GOT_IP 5
+
+// Microseconds since the start of the program, wraps around like the SDK's
+uint32_t sdk_system_get_time(void);
+uint8_t sdk_wifi_station_get_connect_status(void);
+
+// Whether the simulated station has an IP address, true by default
+extern volatile bool host_wifi_connected;
+// us added to the system time, simulations skip ahead with it
+extern volatile uint32_t host_time_offset;
+
+#endif /* HOST_ESP_COMMON_H_ */
@@ -0,0 +1,17 @@
+#ifndef HOST_I2C_H_
+#define HOST_I2C_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define I2C_FREQ_100K 100000
+
+int i2c_init(uint8_t bus, uint8_t scl_pin, uint8_t sda_pin, uint32_t freq);
+int i2c_slave_write(uint8_t bus, uint8_t slave_addr, const uint8_t *data,
+                    const uint8_t *buf, uint32_t len);
+
+// Last values written to the registers of the device at address 0x1a
+extern uint8_t host_wm8731_regs[0x20];
+
+#endif /* HOST_I2C_H_ */
@@ -0,0 +1,63 @@
+#ifndef HOST_I2S_DMA_H_
+#define HOST_I2S_DMA_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Model of the I2S DMA engine. A thread plays the circular list of blocks at
+// the rate set in I2S.CONF and raises the end of frame interrupt after every
+// block.
+
+typedef struct dma_descriptor {
+  uint32_t blocksize : 12;
+  uint32_t datalen : 12;
+  uint32_t unused : 5;
+  uint32_t sub_sof : 1;
+  uint32_t eof : 1;
+  uint32_t owner : 1;
+  void *buf_ptr;
+  struct dma_descriptor *next_link_ptr;
+} dma_descriptor_t;
+
+typedef struct {
+  int bclk_div;
+  int clkm_div;
+} i2s_clock_div_t;
+
+typedef struct {
+  bool data;
+  bool clock;
+  bool ws;
+} i2s_pins_t;
+
+typedef void (*i2s_dma_isr_t)(void *);
+
+struct i2s_regs {
+  volatile uint32_t CONF;
+};
+extern struct i2s_regs I2S;
+
+#define I2S_CONF_BCK_DIV_M 0x0000003f
+#define I2S_CONF_BCK_DIV_S 22
+#define I2S_CONF_CLKM_DIV_M 0x0000003f
+#define I2S_CONF_CLKM_DIV_S 16
+
+i2s_clock_div_t i2s_get_clock_div(int32_t freq);
+void i2s_dma_init(i2s_dma_isr_t isr, void *arg, i2s_clock_div_t clock_div,
+                  i2s_pins_t pins);
+void i2s_dma_start(dma_descriptor_t *descr);
+void i2s_dma_stop(void);
+bool i2s_dma_is_eof_interrupt(void);
+dma_descriptor_t *i2s_dma_get_eof_descriptor(void);
+void i2s_dma_clear_interrupt(void);
+
+// Playback speed relative to real time, 0 runs as fast as the blocks can be
+// recycled. The output of a free running engine is meaningless.
+extern volatile unsigned int host_i2s_speed;
+// Called with every block that is played, frames are stereo words. May be NULL.
+extern void (*volatile host_i2s_sink)(const uint32_t *frames, size_t count);
+// Frames per second the clock dividers in I2S.CONF result in
+unsigned int host_i2s_frame_rate(void);
+
+#endif /* HOST_I2S_DMA_H_ */
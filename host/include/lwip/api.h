@@ -0,0 +1,89 @@
+#ifndef HOST_LWIP_API_H_
+#define HOST_LWIP_API_H_
+
+// The netconn API on top of BSD sockets. Received data is handed out in
+// netbufs of up to two segments, like lwIP does with chained pbufs.
+
+#include "lwip/ip_addr.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int8_t err_t;
+typedef uint8_t u8_t;
+typedef int8_t s8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_TIMEOUT -3
+#define ERR_VAL -6
+#define ERR_CONN -11
+#define ERR_ABRT -13
+#define ERR_RST -14
+#define ERR_CLSD -15
+#define ERR_ARG -16
+
+#define NETCONN_NOFLAG 0x00
+#define NETCONN_NOCOPY 0x00
+#define NETCONN_COPY 0x01
+#define NETCONN_MORE 0x02
+
+#undef TCP_MSS
+#define TCP_MSS 1460
+#define LWIP_SO_RCVBUF 1
+
+enum netconn_type { NETCONN_TCP = 0x10 };
+
+struct netconn {
+  int socket;
+  int recv_timeout; // ms, 0 waits forever
+  int recv_avail;   // bytes received but not handed out yet
+};
+
+struct netbuf {
+  uint8_t *data;
+  size_t len;
+  size_t span;     // end of the first segment
+  size_t pos, end; // current segment
+};
+
+struct netconn *netconn_new(enum netconn_type type);
+err_t netconn_delete(struct netconn *conn);
+err_t netconn_close(struct netconn *conn);
+err_t netconn_connect(struct netconn *conn, const ip_addr_t *addr, u16_t port);
+err_t netconn_write(struct netconn *conn, const void *data, size_t size,
+                    u8_t flags);
+err_t netconn_recv(struct netconn *conn, struct netbuf **buf);
+void netconn_set_recvtimeout(struct netconn *conn, int timeout);
+void netconn_set_recvbufsize(struct netconn *conn, int size);
+err_t netconn_gethostbyname(const char *name, ip_addr_t *addr);
+
+err_t netbuf_data(struct netbuf *buf, void **data, u16_t *len);
+s8_t netbuf_next(struct netbuf *buf);
+u16_t netbuf_len(struct netbuf *buf);
+u16_t netbuf_copy_partial(struct netbuf *buf, void *data, u16_t len,
+                          u16_t offset);
+void netbuf_delete(struct netbuf *buf);
+
+// Host names the stand-in DNS resolves, everything else fails. Each entry is
+// "name address", e.g. "radio.test 127.0.0.1".
+extern const char *const *volatile host_dns_table;
+// Number of lookups netconn_gethostbyname() was asked for
+extern volatile unsigned int host_dns_lookups;
+// ms each lookup takes
+extern volatile unsigned int host_dns_delay;
+
+// The receive path of all connections. lwIP hands a netbuf over from its
+// mailbox, the stand-in needs a few socket calls for one.
+struct netconn_stats {
+  unsigned int recvs;    // netbufs handed out
+  unsigned int syscalls; // socket calls made by netconn_recv()
+  uint64_t bytes;        // received
+  int recvbuf;           // size last set with netconn_set_recvbufsize()
+};
+
+extern struct netconn_stats host_netconn_stats;
+
+#endif /* HOST_LWIP_API_H_ */
@@ -0,0 +1,15 @@
+#ifndef HOST_LWIP_IP_ADDR_H_
+#define HOST_LWIP_IP_ADDR_H_
+
+#include <stdint.h>
+
+// The address in network byte order, like lwIP's IPv4 addresses
+typedef struct {
+  uint32_t addr;
+} ip_addr_t;
+
+#define IPADDR_STRLEN_MAX 16
+
+char *ipaddr_ntoa_r(const ip_addr_t *addr, char *buf, int buflen);
+
+#endif /* HOST_LWIP_IP_ADDR_H_ */
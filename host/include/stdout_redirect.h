@@ -0,0 +1,15 @@
+#ifndef HOST_STDOUT_REDIRECT_H_
+#define HOST_STDOUT_REDIRECT_H_
+
+#include <sys/types.h>
+
+struct _reent;
+typedef ssize_t _WriteFunction(struct _reent *r, int fd, const void *ptr,
+                               size_t len);
+
+// newlib routes stdout through the function, glibc can't. Host tests call
+// host_stdout_write() to feed output to it.
+void set_write_stdout(_WriteFunction *f);
+ssize_t host_stdout_write(const void *ptr, size_t len);
+
+#endif /* HOST_STDOUT_REDIRECT_H_ */
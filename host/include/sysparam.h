@@ -0,0 +1,33 @@
+#ifndef HOST_SYSPARAM_H_
+#define HOST_SYSPARAM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The parameter area in flash, kept in memory for the life of the process
+
+typedef enum {
+  SYSPARAM_ERR_NOMEM = -6,
+  SYSPARAM_ERR_CORRUPT = -5,
+  SYSPARAM_ERR_IO = -4,
+  SYSPARAM_ERR_FULL = -3,
+  SYSPARAM_ERR_BADVALUE = -2,
+  SYSPARAM_ERR_NOINIT = -1,
+  SYSPARAM_OK = 0,
+  SYSPARAM_NOTFOUND = 1,
+} sysparam_status_t;
+
+sysparam_status_t sysparam_get_string(const char *key, char **destptr);
+sysparam_status_t sysparam_set_string(const char *key, const char *value);
+sysparam_status_t sysparam_get_int32(const char *key, int32_t *result);
+sysparam_status_t sysparam_set_int32(const char *key, int32_t value);
+// Zero length values delete the key
+sysparam_status_t sysparam_set_data(const char *key, const uint8_t *value,
+                                    size_t value_len, bool binary);
+
+// Number of writes to flash since the start
+extern unsigned int host_sysparam_writes;
+void host_sysparam_clear(void);
+
+#endif /* HOST_SYSPARAM_H_ */
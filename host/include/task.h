@@ -0,0 +1,33 @@
+#ifndef HOST_TASK_H_
+#define HOST_TASK_H_
+
+#include "FreeRTOS.h"
+
+struct host_task;
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+typedef enum { eRunning, eReady, eBlocked, eSuspended, eDeleted } eTaskState;
+
+// Host stacks are larger than the depth in words given here, 64 bit code and
+// glibc need more. The high-water mark is reported in words of the host stack.
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name,
+                       uint16_t stack_depth, void *param,
+                       UBaseType_t priority, TaskHandle_t *handle);
+// Only a task can delete itself
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+eTaskState eTaskGetState(TaskHandle_t task);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+void taskYIELD(void);
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+
+// Most stack in bytes task has used so far
+size_t host_task_stack_used(TaskHandle_t task);
+
+#endif /* HOST_TASK_H_ */
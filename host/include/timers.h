@@ -0,0 +1,8 @@
+#ifndef HOST_TIMERS_H_
+#define HOST_TIMERS_H_
+
+#include "FreeRTOS.h"
+
+// Software timers aren't used by the modules built for the host
+
+#endif /* HOST_TIMERS_H_ */
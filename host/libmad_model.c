@@ -0,0 +1,313 @@
+// Model of the parts of libmad that mp3.c relies on: finding the frames, the
+// bit reservoir of Layer III as layer3.c keeps it, and the synthesis through
+// the output callbacks of the pinned fork. There is no Huffman decoding or
+// filter bank. The subband samples are the bytes of the main data of a frame,
+// one after the other, so a frame decoded from the wrong bytes of the
+// reservoir is heard, and seen by a test, as a different level. Only MPEG-1
+// Layer III is modeled, and CRCs are never checked, as with
+// MAD_OPTION_IGNORECRC.
+
+#include "libmad/frame.h"
+#include "libmad/stream.h"
+#include "libmad/synth.h"
+
+#include "mpeg.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+void mad_stream_init(struct mad_stream *stream) {
+  memset(stream, 0, sizeof(*stream));
+}
+
+void mad_stream_finish(struct mad_stream *stream) {
+  free(stream->main_data);
+  stream->main_data = NULL;
+}
+
+void mad_stream_buffer(struct mad_stream *stream, unsigned char const *buffer,
+                       unsigned long length) {
+  stream->buffer = buffer;
+  stream->bufend = buffer + length;
+  stream->this_frame = buffer;
+  stream->next_frame = buffer;
+  stream->sync = 1;
+}
+
+void mad_stream_skip(struct mad_stream *stream, unsigned long length) {
+  stream->skiplen += length;
+}
+
+char const *mad_stream_errorstr(struct mad_stream const *stream) {
+  switch (stream->error) {
+  case MAD_ERROR_BUFLEN:
+    return "input buffer too small (or EOF)";
+  case MAD_ERROR_LOSTSYNC:
+    return "lost synchronization";
+  case MAD_ERROR_BADLAYER:
+    return "reserved header layer value";
+  case MAD_ERROR_BADFRAMELEN:
+    return "bad frame length";
+  case MAD_ERROR_BADDATAPTR:
+    return "bad main_data_begin pointer";
+  case MAD_ERROR_BADPART3LEN:
+    return "bad audio data length";
+  default:
+    return "error";
+  }
+}
+
+static bool is_sync(const unsigned char *p) {
+  return p[0] == 0xff && (p[1] & 0xe0) == 0xe0;
+}
+
+static unsigned int read_bits(const unsigned char *p, unsigned int pos,
+                              unsigned int n) {
+  unsigned int v = 0;
+  for (; n > 0; --n, ++pos)
+    v = v << 1 | ((p[pos >> 3] >> (7 - (pos & 7))) & 1);
+  return v;
+}
+
+// mad_header_decode(): the frame at next_frame, or the next one found after
+// a loss of sync
+static int decode_header(struct mad_header *header, struct mad_stream *stream,
+                         struct mpeg_header *mpeg) {
+  const unsigned char *ptr = stream->next_frame, *end = stream->bufend;
+
+  if (stream->buffer == NULL) {
+    stream->error = MAD_ERROR_BUFPTR;
+    goto fail;
+  }
+  if (stream->skiplen > 0) {
+    if (!stream->sync)
+      ptr = stream->this_frame;
+    if (end - ptr < stream->skiplen) {
+      stream->skiplen -= end - ptr;
+      stream->next_frame = end;
+      stream->error = MAD_ERROR_BUFLEN;
+      goto fail;
+    }
+    ptr += stream->skiplen;
+    stream->skiplen = 0;
+    stream->sync = 1;
+  }
+
+  for (;;) {
+    if (stream->sync) {
+      if (end - ptr < MAD_BUFFER_GUARD) {
+        stream->next_frame = ptr;
+        stream->error = MAD_ERROR_BUFLEN;
+        goto fail;
+      }
+      if (!is_sync(ptr)) {
+        stream->this_frame = ptr;
+        stream->next_frame = ptr + 1;
+        stream->error = MAD_ERROR_LOSTSYNC;
+        goto fail;
+      }
+    } else {
+      while (ptr < end - 1 && !is_sync(ptr))
+        ++ptr;
+      if (end - ptr < MAD_BUFFER_GUARD) {
+        if (end - stream->next_frame >= MAD_BUFFER_GUARD)
+          stream->next_frame = end - MAD_BUFFER_GUARD;
+        stream->error = MAD_ERROR_BUFLEN;
+        goto fail;
+      }
+    }
+
+    stream->this_frame = ptr;
+    stream->next_frame = ptr + 1;
+    if (mpeg_parse_header(ptr, mpeg) != 0 || mpeg->layer != 3 ||
+        mpeg->version != MPEG_VERSION_1 || mpeg->frame_length == 0) {
+      stream->error = MAD_ERROR_BADLAYER;
+      goto fail;
+    }
+    if (mpeg->frame_length + MAD_BUFFER_GUARD > end - ptr) {
+      stream->next_frame = ptr;
+      stream->error = MAD_ERROR_BUFLEN;
+      goto fail;
+    }
+    stream->next_frame = ptr + mpeg->frame_length;
+
+    // without sync, a frame only counts if the next one follows it
+    if (stream->sync || is_sync(stream->next_frame))
+      break;
+    ptr = stream->next_frame = ptr + 1;
+  }
+  stream->sync = 1;
+
+  header->layer = MAD_LAYER_III;
+  header->mode = 3 - (stream->this_frame[3] >> 6);
+  header->bitrate = mpeg->bitrate;
+  header->samplerate = mpeg->sample_rate;
+  return 0;
+
+fail:
+  stream->sync = 0;
+  return -1;
+}
+
+// main_data_begin of the frame at p, or 0 if there is no frame
+static unsigned int peek_main_data_begin(const unsigned char *p) {
+  struct mpeg_header next;
+  if (mpeg_parse_header(p, &next) != 0 || next.layer != 3 ||
+      next.version != MPEG_VERSION_1)
+    return 0;
+  return read_bits(p + MPEG_HEADER_SIZE + (next.protection ? 2 : 0), 0, 9);
+}
+
+// III_decode() without the decoding: finds the main data in the reservoir
+// and this frame, and keeps the reservoir for the next frames exactly like
+// mad_layer_III().
+static int decode_layer3(struct mad_stream *stream, struct mad_frame *frame,
+                         const struct mpeg_header *mpeg) {
+  const unsigned int nch = mpeg->channels;
+  const unsigned char *si = stream->this_frame + MPEG_HEADER_SIZE +
+                            (mpeg->protection ? 2 : 0);
+  const unsigned char *payload = si + (nch == 1 ? 17 : 32);
+  int result = 0;
+
+  if (stream->main_data == NULL) {
+    stream->main_data = malloc(MAD_BUFFER_MDLEN);
+    if (stream->main_data == NULL) {
+      stream->error = MAD_ERROR_NOMEM;
+      return -1;
+    }
+  }
+  if (payload > stream->next_frame) {
+    stream->error = MAD_ERROR_BADFRAMELEN;
+    stream->md_len = 0;
+    return -1;
+  }
+
+  const unsigned int main_data_begin = read_bits(si, 0, 9);
+  const unsigned int side = 9 + (nch == 1 ? 5 : 3) + 4 * nch;
+  unsigned int part2_3_bits = 0;
+  for (unsigned int gr = 0; gr < 2; ++gr) {
+    for (unsigned int ch = 0; ch < nch; ++ch)
+      part2_3_bits += read_bits(si, side + (gr * nch + ch) * 59, 12);
+  }
+
+  unsigned int next_md_begin = peek_main_data_begin(stream->next_frame);
+  const unsigned int frame_space = stream->next_frame - payload;
+  if (next_md_begin > main_data_begin + frame_space)
+    next_md_begin = 0;
+  const unsigned int md_len = main_data_begin + frame_space - next_md_begin;
+
+  const unsigned char *main_data = NULL;
+  unsigned int frame_used = 0;
+  if (main_data_begin == 0) {
+    main_data = payload;
+    stream->md_len = 0;
+    frame_used = md_len;
+  } else if (main_data_begin > stream->md_len) {
+    stream->error = MAD_ERROR_BADDATAPTR;
+    result = -1;
+  } else {
+    main_data = *stream->main_data + stream->md_len - main_data_begin;
+    if (md_len > main_data_begin) {
+      frame_used = md_len - main_data_begin;
+      memcpy(*stream->main_data + stream->md_len, payload, frame_used);
+      stream->md_len += frame_used;
+    }
+  }
+  const unsigned int frame_free = frame_space - frame_used;
+
+  if (result == 0 && part2_3_bits / 8 > md_len) {
+    stream->error = MAD_ERROR_BADPART3LEN;
+    result = -1;
+  }
+  if (result == 0) {
+    // the "decoding": main data byte i is subband sample i of each channel,
+    // and the main data repeats if there are fewer bytes than samples
+    const unsigned int n = part2_3_bits / 8;
+    for (unsigned int ch = 0; ch < 2; ++ch) {
+      for (unsigned int i = 0; i < 36 * 32; ++i) {
+        const signed char x = n > 0 ? main_data[i % n] : 0;
+        frame->sbsample[ch][i / 32][i % 32] = x * (MAD_F_ONE >> 7);
+      }
+    }
+  }
+
+  // preload the reservoir with up to 511 bytes for the next frames
+  if (frame_free >= next_md_begin) {
+    memcpy(*stream->main_data, stream->next_frame - next_md_begin,
+           next_md_begin);
+    stream->md_len = next_md_begin;
+  } else {
+    if (md_len < main_data_begin) {
+      unsigned int extra = main_data_begin - md_len;
+      if (extra + frame_free > next_md_begin)
+        extra = next_md_begin - frame_free;
+      if (extra < stream->md_len) {
+        memmove(*stream->main_data,
+                *stream->main_data + stream->md_len - extra, extra);
+        stream->md_len = extra;
+      }
+    } else {
+      stream->md_len = 0;
+    }
+    memcpy(*stream->main_data + stream->md_len,
+           stream->next_frame - frame_free, frame_free);
+    stream->md_len += frame_free;
+  }
+
+  return result;
+}
+
+void mad_frame_init(struct mad_frame *frame) {
+  memset(frame, 0, sizeof(*frame));
+}
+
+int mad_frame_decode(struct mad_frame *frame, struct mad_stream *stream) {
+  struct mpeg_header mpeg;
+  frame->options = stream->options;
+  if (decode_header(&frame->header, stream, &mpeg) != 0)
+    return -1;
+  if (decode_layer3(stream, frame, &mpeg) != 0) {
+    if (!MAD_RECOVERABLE(stream->error))
+      stream->next_frame = stream->this_frame;
+    return -1;
+  }
+  return 0;
+}
+
+void mad_frame_mute(struct mad_frame *frame) {
+  memset(frame->sbsample, 0, sizeof(frame->sbsample));
+}
+
+void mad_synth_init(struct mad_synth *synth, short *(*get_buffer)(void),
+                    void (*set_format)(unsigned int sample_rate,
+                                       unsigned short channels)) {
+  synth->get_buffer = get_buffer;
+  synth->set_format = set_format;
+  synth->buffer = NULL;
+  synth->pos = 0;
+}
+
+// The fork fills buffers of 64 samples, interleaved for two channels
+void mad_synth_frame(struct mad_synth *synth, struct mad_frame const *frame) {
+  const unsigned int nch = MAD_NCHANNELS(&frame->header);
+  const unsigned int ns = MAD_NSBSAMPLES(&frame->header);
+  synth->set_format(frame->header.samplerate, nch);
+
+  for (unsigned int s = 0; s < ns; ++s) {
+    for (unsigned int sb = 0; sb < 32; ++sb) {
+      for (unsigned int ch = 0; ch < nch; ++ch) {
+        if (synth->buffer == NULL || synth->pos == 64) {
+          synth->buffer = synth->get_buffer();
+          synth->pos = 0;
+        }
+        mad_fixed_t x = frame->sbsample[ch][s][sb];
+        if (x >= MAD_F_ONE)
+          x = MAD_F_ONE - 1;
+        else if (x < -MAD_F_ONE)
+          x = -MAD_F_ONE;
+        synth->buffer[synth->pos++] = x >> (MAD_F_FRACBITS + 1 - 16);
+      }
+    }
+  }
+}
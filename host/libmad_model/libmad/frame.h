@@ -0,0 +1,42 @@
+#ifndef HOST_LIBMAD_MODEL_FRAME_H_
+#define HOST_LIBMAD_MODEL_FRAME_H_
+
+// Frames of the libmad model in libmad_model.c. Only MPEG-1 Layer III is
+// modeled.
+
+#include "libmad/fixed.h"
+#include "stream.h"
+
+enum mad_layer { MAD_LAYER_I = 1, MAD_LAYER_II = 2, MAD_LAYER_III = 3 };
+
+enum mad_mode {
+  MAD_MODE_SINGLE_CHANNEL = 0,
+  MAD_MODE_DUAL_CHANNEL = 1,
+  MAD_MODE_JOINT_STEREO = 2,
+  MAD_MODE_STEREO = 3
+};
+
+struct mad_header {
+  enum mad_layer layer;
+  enum mad_mode mode;
+  unsigned long bitrate;
+  unsigned int samplerate;
+};
+
+struct mad_frame {
+  struct mad_header header;
+  int options;
+  mad_fixed_t sbsample[2][36][32];
+};
+
+#define MAD_NCHANNELS(header) ((header)->mode ? 2 : 1)
+#define MAD_NSBSAMPLES(header)                                                 \
+  ((header)->layer == MAD_LAYER_I ? 12 : 36)
+
+void mad_frame_init(struct mad_frame *frame);
+#define mad_frame_finish(frame) ((void)(frame))
+
+int mad_frame_decode(struct mad_frame *frame, struct mad_stream *stream);
+void mad_frame_mute(struct mad_frame *frame);
+
+#endif /* HOST_LIBMAD_MODEL_FRAME_H_ */
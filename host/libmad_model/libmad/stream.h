@@ -0,0 +1,54 @@
+#ifndef HOST_LIBMAD_MODEL_STREAM_H_
+#define HOST_LIBMAD_MODEL_STREAM_H_
+
+// The stream of the libmad model in libmad_model.c, with the fields and
+// error codes of libmad that mp3.c uses.
+
+#define MAD_BUFFER_GUARD 8
+#define MAD_BUFFER_MDLEN (511 + 2048 + MAD_BUFFER_GUARD)
+
+enum mad_error {
+  MAD_ERROR_NONE = 0x0000,
+  MAD_ERROR_BUFLEN = 0x0001,
+  MAD_ERROR_BUFPTR = 0x0002,
+  MAD_ERROR_NOMEM = 0x0031,
+  MAD_ERROR_LOSTSYNC = 0x0101,
+  MAD_ERROR_BADLAYER = 0x0102,
+  MAD_ERROR_BADFRAMELEN = 0x0231,
+  MAD_ERROR_BADDATAPTR = 0x0235,
+  MAD_ERROR_BADPART3LEN = 0x0236,
+};
+
+#define MAD_RECOVERABLE(error) ((error) & 0xff00)
+
+struct mad_stream {
+  unsigned char const *buffer;
+  unsigned char const *bufend;
+  unsigned long skiplen;
+
+  int sync;
+  unsigned char const *this_frame;
+  unsigned char const *next_frame;
+
+  // the bit reservoir
+  unsigned char (*main_data)[MAD_BUFFER_MDLEN];
+  unsigned int md_len;
+
+  int options;
+  enum mad_error error;
+};
+
+enum { MAD_OPTION_IGNORECRC = 0x0001 };
+
+void mad_stream_init(struct mad_stream *stream);
+void mad_stream_finish(struct mad_stream *stream);
+
+#define mad_stream_options(stream, opts) ((void)((stream)->options = (opts)))
+
+void mad_stream_buffer(struct mad_stream *stream, unsigned char const *buffer,
+                       unsigned long length);
+void mad_stream_skip(struct mad_stream *stream, unsigned long length);
+
+char const *mad_stream_errorstr(struct mad_stream const *stream);
+
+#endif /* HOST_LIBMAD_MODEL_STREAM_H_ */
@@ -0,0 +1,23 @@
+#ifndef HOST_LIBMAD_MODEL_SYNTH_H_
+#define HOST_LIBMAD_MODEL_SYNTH_H_
+
+// The synthesis of the libmad model in libmad_model.c, with the output
+// callbacks of the pinned libmad fork.
+
+#include "frame.h"
+
+struct mad_synth {
+  short *(*get_buffer)(void);
+  void (*set_format)(unsigned int sample_rate, unsigned short channels);
+  short *buffer;
+  unsigned int pos; // samples written to buffer
+};
+
+void mad_synth_init(struct mad_synth *synth, short *(*get_buffer)(void),
+                    void (*set_format)(unsigned int sample_rate,
+                                       unsigned short channels));
+#define mad_synth_finish(synth) ((void)(synth))
+
+void mad_synth_frame(struct mad_synth *synth, struct mad_frame const *frame);
+
+#endif /* HOST_LIBMAD_MODEL_SYNTH_H_ */
@@ -0,0 +1,272 @@
+// Model of the MI0283QT: the registers, window addressing, display memory,
+// vertical scrolling and xy exchange of the HX8347 and the ADS7846 touch
+// controller. Only what the firmware uses is modeled, mirroring by MX and MY
+// and reading back over SPI are not.
+
+#include "mi0283qt_model.h"
+
+#include "espressif/esp_common.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LCD_REGISTER 0x70
+#define LCD_DATA 0x72
+#define REG_GRAM 0x22
+
+static struct {
+  pthread_mutex_t lock;
+  uint8_t regs[256];
+  uint8_t index; // register selected by the last index write
+  uint16_t gram[LCD_MODEL_HEIGHT][LCD_MODEL_WIDTH];
+  // write address in the column and page directions of the window
+  uint16_t column, page;
+  // first byte of a pixel that was split across transactions
+  int pending;
+  struct lcd_model_stats stats;
+} lcd = {.lock = PTHREAD_MUTEX_INITIALIZER, .pending = -1};
+
+static uint16_t reg16(uint8_t hi) {
+  return lcd.regs[hi] << 8 | lcd.regs[hi + 1];
+}
+
+static void write_pixel(uint16_t color) {
+  // with MV set, columns run down the panel and pages across it
+  const bool mv = lcd.regs[0x16] & 0x20;
+  const unsigned int x = mv ? lcd.page : lcd.column;
+  const unsigned int y = mv ? lcd.column : lcd.page;
+  if (x < LCD_MODEL_WIDTH && y < LCD_MODEL_HEIGHT) {
+    lcd.gram[y][x] = color;
+    ++lcd.stats.pixels;
+  } else {
+    ++lcd.stats.clipped;
+  }
+
+  // the address wraps around to the start of the window once it is full
+  if (lcd.column++ == reg16(0x04)) {
+    lcd.column = reg16(0x02);
+    if (lcd.page++ == reg16(0x08))
+      lcd.page = reg16(0x06);
+  }
+}
+
+void lcd_model_transfer(uint16_t start, const uint8_t *data, size_t len) {
+  pthread_mutex_lock(&lcd.lock);
+  lcd.stats.data_bytes += len;
+  if (start == LCD_REGISTER && len > 0) {
+    ++lcd.stats.commands;
+    lcd.index = data[len - 1];
+    lcd.pending = -1;
+    if (lcd.index == REG_GRAM) {
+      lcd.column = reg16(0x02);
+      lcd.page = reg16(0x06);
+    }
+  } else if (start == LCD_DATA && lcd.index == REG_GRAM) {
+    // the first byte of a pixel goes out first, see RGB()
+    for (size_t i = 0; i < len; ++i) {
+      if (lcd.pending < 0) {
+        lcd.pending = data[i];
+      } else {
+        write_pixel(lcd.pending << 8 | data[i]);
+        lcd.pending = -1;
+      }
+    }
+  } else if (start == LCD_DATA && len > 0) {
+    lcd.regs[lcd.index] = data[len - 1];
+  }
+  pthread_mutex_unlock(&lcd.lock);
+}
+
+uint8_t lcd_model_reg(uint8_t index) { return lcd.regs[index]; }
+
+uint16_t lcd_model_gram(int x, int y) { return lcd.gram[y][x]; }
+
+uint16_t lcd_model_pixel(int x, int y) {
+  // the rows between the fixed areas show display memory from the scroll
+  // start on, wrapping around within the area
+  const unsigned int top = reg16(0x0e), height = reg16(0x10);
+  const unsigned int start = reg16(0x14);
+  if ((lcd.regs[0x01] & 0x08) && height > 0 &&
+      top + height <= LCD_MODEL_HEIGHT && y >= top && y < top + height &&
+      start >= top && start < top + height)
+    y = top + (start - top + y - top) % height;
+  return lcd.gram[y][x];
+}
+
+void lcd_model_get_and_reset_stats(struct lcd_model_stats *stats) {
+  pthread_mutex_lock(&lcd.lock);
+  *stats = lcd.stats;
+  memset(&lcd.stats, 0, sizeof(lcd.stats));
+  pthread_mutex_unlock(&lcd.lock);
+}
+
+// A row of the panel as 8 bit RGB
+static void rgb_row(int y, uint8_t *row) {
+  for (int x = 0; x < LCD_MODEL_WIDTH; ++x) {
+    const uint16_t c = lcd_model_pixel(x, y);
+    *row++ = (c >> 11) * 255 / 31;
+    *row++ = (c >> 5 & 0x3f) * 255 / 63;
+    *row++ = (c & 0x1f) * 255 / 31;
+  }
+}
+
+int lcd_model_dump_ppm(const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (f == NULL)
+    return 1;
+  fprintf(f, "P6\n%d %d\n255\n", LCD_MODEL_WIDTH, LCD_MODEL_HEIGHT);
+  for (int y = 0; y < LCD_MODEL_HEIGHT; ++y) {
+    uint8_t row[LCD_MODEL_WIDTH * 3];
+    rgb_row(y, row);
+    fwrite(row, 1, sizeof(row), f);
+  }
+  return fclose(f) != 0;
+}
+
+static uint32_t crc32(uint32_t crc, const uint8_t *p, size_t len) {
+  crc = ~crc;
+  while (len-- > 0) {
+    crc ^= *p++;
+    for (int i = 0; i < 8; ++i)
+      crc = crc >> 1 ^ (0xedb88320 & -(crc & 1));
+  }
+  return ~crc;
+}
+
+static void put32(uint8_t *p, uint32_t x) {
+  p[0] = x >> 24;
+  p[1] = x >> 16;
+  p[2] = x >> 8;
+  p[3] = x;
+}
+
+static void write_chunk(FILE *f, const char *type, const uint8_t *data,
+                        size_t len) {
+  uint8_t buf[8];
+  put32(buf, len);
+  memcpy(buf + 4, type, 4);
+  fwrite(buf, 1, 8, f);
+  fwrite(data, 1, len, f);
+  put32(buf, crc32(crc32(0, (const uint8_t *)type, 4), data, len));
+  fwrite(buf, 1, 4, f);
+}
+
+// The image data is deflated in stored blocks, so no compressor is needed
+int lcd_model_dump_png(const char *path) {
+  enum { ROW = 1 + LCD_MODEL_WIDTH * 3, RAW = ROW * LCD_MODEL_HEIGHT };
+  enum { BLOCK = 65535, BLOCKS = (RAW + BLOCK - 1) / BLOCK };
+  static uint8_t raw[RAW], idat[2 + RAW + BLOCKS * 5 + 4];
+
+  for (int y = 0; y < LCD_MODEL_HEIGHT; ++y) {
+    raw[y * ROW] = 0; // no filter
+    rgb_row(y, raw + y * ROW + 1);
+  }
+
+  uint8_t *p = idat;
+  *p++ = 0x78; // zlib, 32 kB window
+  *p++ = 0x01;
+  for (size_t pos = 0; pos < RAW; pos += BLOCK) {
+    const size_t len = RAW - pos < BLOCK ? RAW - pos : BLOCK;
+    *p++ = pos + len == RAW; // final block flag
+    *p++ = len;
+    *p++ = len >> 8;
+    *p++ = ~len;
+    *p++ = ~len >> 8;
+    memcpy(p, raw + pos, len);
+    p += len;
+  }
+  uint32_t a = 1, b = 0;
+  for (size_t i = 0; i < RAW; ++i) {
+    a = (a + raw[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+  put32(p, b << 16 | a);
+  p += 4;
+
+  FILE *f = fopen(path, "wb");
+  if (f == NULL)
+    return 1;
+  fwrite("\x89PNG\r\n\x1a\n", 1, 8, f);
+  uint8_t ihdr[13] = {0};
+  put32(ihdr, LCD_MODEL_WIDTH);
+  put32(ihdr + 4, LCD_MODEL_HEIGHT);
+  ihdr[8] = 8; // bits per channel
+  ihdr[9] = 2; // RGB
+  write_chunk(f, "IHDR", ihdr, sizeof(ihdr));
+  write_chunk(f, "IDAT", idat, p - idat);
+  write_chunk(f, "IEND", NULL, 0);
+  return fclose(f) != 0;
+}
+
+static struct {
+  pthread_mutex_t lock;
+  const struct touch_event *events;
+  size_t count;
+  uint32_t start; // us
+  uint8_t control; // last control byte
+  struct touch_model_stats stats;
+} touch = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+void touch_model_script(const struct touch_event *events, size_t count) {
+  pthread_mutex_lock(&touch.lock);
+  touch.events = events;
+  touch.count = count;
+  touch.start = sdk_system_get_time();
+  pthread_mutex_unlock(&touch.lock);
+}
+
+void touch_model_get_and_reset_stats(struct touch_model_stats *stats) {
+  pthread_mutex_lock(&touch.lock);
+  *stats = touch.stats;
+  memset(&touch.stats, 0, sizeof(touch.stats));
+  pthread_mutex_unlock(&touch.lock);
+}
+
+static uint16_t raw_position(unsigned int pos, unsigned int size) {
+  return TOUCH_MODEL_RAW_MIN +
+         pos * (TOUCH_MODEL_RAW_MAX - TOUCH_MODEL_RAW_MIN) / (size - 1);
+}
+
+// Result of a conversion of the channel in the control byte
+static uint16_t convert(uint8_t control) {
+  const uint32_t ms = (sdk_system_get_time() - touch.start) / 1000;
+  const struct touch_event *e = NULL;
+  for (size_t i = 0; i < touch.count && touch.events[i].ms <= ms; ++i)
+    e = &touch.events[i];
+  const bool down = e != NULL && e->down;
+
+  switch (control >> 4 & 0x07) {
+  case 5: // X
+    return down ? raw_position(e->x, LCD_MODEL_WIDTH) : 0;
+  case 1: // Y
+    return down ? raw_position(e->y, LCD_MODEL_HEIGHT) : 0;
+  case 3: // Z1, 0 without pressure
+    return down ? 1200 : 0;
+  case 4: // Z2
+    return down ? 2400 : 4095;
+  default:
+    return 0;
+  }
+}
+
+// A control byte starts a conversion, the 12 bit result is clocked out in
+// the next 16 cycles after a busy cycle
+void touch_model_transfer(bool write, uint8_t *data, size_t len, int cmd_bits,
+                          uint16_t cmd, bool conflict) {
+  pthread_mutex_lock(&touch.lock);
+  touch.stats.conflicts += conflict;
+  if (cmd_bits == 8 && (cmd & 0x80)) {
+    touch.control = cmd;
+    ++touch.stats.conversions;
+  } else if (write && len > 0 && (data[len - 1] & 0x80)) {
+    touch.control = data[len - 1];
+    ++touch.stats.conversions;
+  }
+  if (!write && len >= 2) {
+    const uint16_t value = convert(touch.control);
+    data[0] = value >> 5;
+    data[1] = value << 3;
+  }
+  pthread_mutex_unlock(&touch.lock);
+}
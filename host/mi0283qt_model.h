@@ -0,0 +1,59 @@
+#ifndef HOST_MI0283QT_MODEL_H_
+#define HOST_MI0283QT_MODEL_H_
+
+// Model of the MI0283QT adapter on the HSPI bus: the HX8347 LCD controller on
+// hardware chip select 1 and the ADS7846 touch controller, which is selected
+// by driving GPIO16 low.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LCD_MODEL_WIDTH 240
+#define LCD_MODEL_HEIGHT 320
+
+struct lcd_model_stats {
+  unsigned int commands; // register index writes
+  uint64_t data_bytes;   // bytes after the start byte of transactions
+  uint64_t pixels;       // pixels written to GRAM
+  uint64_t clipped;      // pixels of windows reaching beyond the panel
+};
+
+// Register as last written
+uint8_t lcd_model_reg(uint8_t index);
+// Pixel in display memory as RGB565, red in the top bits
+uint16_t lcd_model_gram(int x, int y);
+// Pixel as the panel shows it, after vertical scrolling
+uint16_t lcd_model_pixel(int x, int y);
+// Write what the panel shows as binary PPM or PNG, return 0 on success
+int lcd_model_dump_ppm(const char *path);
+int lcd_model_dump_png(const char *path);
+void lcd_model_get_and_reset_stats(struct lcd_model_stats *stats);
+
+// The touch controller measures the panel as 12 bit values in this range
+#define TOUCH_MODEL_RAW_MIN 200
+#define TOUCH_MODEL_RAW_MAX 3900
+
+// A touch event stays in effect until the next one of the script
+struct touch_event {
+  uint32_t ms; // since the start of the script
+  bool down;
+  uint16_t x, y; // panel coordinates
+};
+
+struct touch_model_stats {
+  unsigned int conversions;
+  // transactions while both GPIO16 and a hardware chip select were active
+  unsigned int conflicts;
+};
+
+// Starts playing a script of touch events, the array must stay valid
+void touch_model_script(const struct touch_event *events, size_t count);
+void touch_model_get_and_reset_stats(struct touch_model_stats *stats);
+
+// Called by the bus model for the transactions addressed to the devices
+void lcd_model_transfer(uint16_t start, const uint8_t *data, size_t len);
+void touch_model_transfer(bool write, uint8_t *data, size_t len, int cmd_bits,
+                          uint16_t cmd, bool conflict);
+
+#endif /* HOST_MI0283QT_MODEL_H_ */
@@ -0,0 +1,182 @@
+// <netinet/tcp.h> has a TCP_MSS of its own, lwIP's has to come last
+#include <netinet/tcp.h>
+
+#include "lwip/api.h"
+#include "lwip/ip_addr.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// lwIP hands out a netbuf per received TCP segment or chain of them
+#define NETBUF_MAX (2 * TCP_MSS)
+
+const char *const *volatile host_dns_table;
+volatile unsigned int host_dns_lookups;
+volatile unsigned int host_dns_delay;
+struct netconn_stats host_netconn_stats;
+
+char *ipaddr_ntoa_r(const ip_addr_t *addr, char *buf, int buflen) {
+  struct in_addr in = {.s_addr = addr->addr};
+  return (char *)inet_ntop(AF_INET, &in, buf, buflen);
+}
+
+err_t netconn_gethostbyname(const char *name, ip_addr_t *addr) {
+  ++host_dns_lookups;
+  // blocks like a lookup that waits for a slow DNS server
+  if (host_dns_delay > 0)
+    usleep(host_dns_delay * 1000);
+
+  const size_t len = strlen(name);
+  const char *const *table = host_dns_table;
+  for (; table != NULL && *table != NULL; ++table) {
+    if (strncmp(*table, name, len) == 0 && (*table)[len] == ' ') {
+      name = *table + len + 1;
+      break;
+    }
+  }
+
+  struct in_addr in;
+  if (inet_pton(AF_INET, name, &in) != 1)
+    return ERR_VAL;
+  addr->addr = in.s_addr;
+  return ERR_OK;
+}
+
+struct netconn *netconn_new(enum netconn_type type) {
+  struct netconn *conn = calloc(1, sizeof(*conn));
+  if (conn == NULL)
+    return NULL;
+  conn->socket = socket(AF_INET, SOCK_STREAM, 0);
+  if (conn->socket < 0) {
+    free(conn);
+    return NULL;
+  }
+  // Segments of the loopback interface's MSS are far bigger than the
+  // receive buffers the stream client asks for, the window then only opens
+  // with delayed ACKs. lwIP's MSS keeps the traffic in Ethernet sized segments.
+  const int mss = TCP_MSS;
+  setsockopt(conn->socket, IPPROTO_TCP, TCP_MAXSEG, &mss, sizeof(mss));
+  return conn;
+}
+
+err_t netconn_delete(struct netconn *conn) {
+  if (conn->socket >= 0)
+    close(conn->socket);
+  free(conn);
+  return ERR_OK;
+}
+
+err_t netconn_close(struct netconn *conn) {
+  shutdown(conn->socket, SHUT_RDWR);
+  return ERR_OK;
+}
+
+err_t netconn_connect(struct netconn *conn, const ip_addr_t *addr,
+                      u16_t port) {
+  struct sockaddr_in sa = {
+      .sin_family = AF_INET,
+      .sin_port = htons(port),
+      .sin_addr.s_addr = addr->addr,
+  };
+  if (connect(conn->socket, (struct sockaddr *)&sa, sizeof(sa)) != 0)
+    return ERR_CONN;
+  return ERR_OK;
+}
+
+err_t netconn_write(struct netconn *conn, const void *data, size_t size,
+                    u8_t flags) {
+  const int more = (flags & NETCONN_MORE) ? MSG_MORE : 0;
+  while (size > 0) {
+    const ssize_t n = send(conn->socket, data, size, MSG_NOSIGNAL | more);
+    if (n < 0)
+      return errno == EPIPE ? ERR_CLSD : ERR_RST;
+    data = (const uint8_t *)data + n;
+    size -= n;
+  }
+  return ERR_OK;
+}
+
+void netconn_set_recvtimeout(struct netconn *conn, int timeout) {
+  conn->recv_timeout = timeout;
+}
+
+// The size is taken as a cap on what is queued, like SO_RCVBUF in lwIP. The
+// kernel doubles the value and has a lower limit, so it's only a rough cap.
+void netconn_set_recvbufsize(struct netconn *conn, int size) {
+  setsockopt(conn->socket, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  host_netconn_stats.recvbuf = size;
+}
+
+err_t netconn_recv(struct netconn *conn, struct netbuf **buf) {
+  struct pollfd pfd = {.fd = conn->socket, .events = POLLIN};
+  const int ready =
+      poll(&pfd, 1, conn->recv_timeout > 0 ? conn->recv_timeout : -1);
+  ++host_netconn_stats.syscalls;
+  if (ready == 0)
+    return ERR_TIMEOUT;
+  if (ready < 0)
+    return ERR_ABRT;
+
+  struct netbuf *nb = calloc(1, sizeof(*nb) + NETBUF_MAX);
+  if (nb == NULL)
+    return ERR_MEM;
+  nb->data = (uint8_t *)(nb + 1);
+
+  const ssize_t n = recv(conn->socket, nb->data, NETBUF_MAX, 0);
+  ++host_netconn_stats.syscalls;
+  if (n <= 0) {
+    free(nb);
+    return n == 0 ? ERR_CLSD : ERR_RST;
+  }
+
+  nb->len = n;
+  nb->span = n > TCP_MSS ? TCP_MSS : n;
+  nb->pos = 0;
+  nb->end = nb->span;
+
+  int avail = 0;
+  ioctl(conn->socket, FIONREAD, &avail);
+  conn->recv_avail = avail;
+  ++host_netconn_stats.syscalls;
+  ++host_netconn_stats.recvs;
+  host_netconn_stats.bytes += n;
+
+  *buf = nb;
+  return ERR_OK;
+}
+
+err_t netbuf_data(struct netbuf *buf, void **data, u16_t *len) {
+  *data = buf->data + buf->pos;
+  *len = buf->end - buf->pos;
+  return ERR_OK;
+}
+
+s8_t netbuf_next(struct netbuf *buf) {
+  if (buf->end >= buf->len)
+    return -1;
+  buf->pos = buf->end;
+  buf->end = buf->len;
+  return 1;
+}
+
+u16_t netbuf_len(struct netbuf *buf) { return buf->len; }
+
+u16_t netbuf_copy_partial(struct netbuf *buf, void *data, u16_t len,
+                          u16_t offset) {
+  if (offset >= buf->len)
+    return 0;
+  if (len > buf->len - offset)
+    len = buf->len - offset;
+  memcpy(data, buf->data + offset, len);
+  return len;
+}
+
+void netbuf_delete(struct netbuf *buf) { free(buf); }
@@ -0,0 +1,34 @@
+#ifndef HOST_TEST_H_
+#define HOST_TEST_H_
+
+// Minimal checks for the host tests. A failed check is reported and counted,
+// the test goes on, main returns test_result().
+
+#include <stdio.h>
+
+static int test_failures;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      ++test_failures;                                                         \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);          \
+    }                                                                          \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                         \
+  do {                                                                         \
+    const long long a_ = (a), b_ = (b);                                        \
+    if (a_ != b_) {                                                            \
+      ++test_failures;                                                         \
+      printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__,       \
+             __LINE__, #a, #b, a_, b_);                                        \
+    }                                                                          \
+  } while (0)
+
+static inline int test_result(const char *name) {
+  printf("%s: %s\n", name, test_failures ? "FAILED" : "ok");
+  return test_failures != 0;
+}
+
+#endif /* HOST_TEST_H_ */
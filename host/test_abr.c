@@ -0,0 +1,150 @@
+// Simulation of the bitrate adaptation for a station with three variants.
+// The FIFO and the connection are modeled second by second: the decoder
+// drains the FIFO at the rate of the playing variant, the network fills it up
+// to the bandwidth, and TCP flow control stops it when the FIFO is full.
+
+#include "abr.h"
+#include "fifo.h"
+#include "stream_client.h"
+#include "test.h"
+
+#include "espressif/esp_common.h"
+
+#include <stdio.h>
+
+#define FIFO_SIZE (128 * 1024)
+// A move reconnects, no data arrives for this many seconds
+#define MOVE_GAP 1
+
+// Bitrate variants like those of an HLS master playlist
+static const struct station station = {
+    "Test",
+    {{"http://radio.test/64", 64},
+     {"http://radio.test/128", 128},
+     {"http://radio.test/192", 192}},
+    NULL,
+};
+
+static size_t fill;
+static uint32_t received;
+
+size_t fifo_fill(void) { return fill; }
+size_t fifo_size(void) { return FIFO_SIZE; }
+uint32_t stream_received(void) { return received; }
+
+struct result {
+  size_t variant; // at the end
+  unsigned int switches;
+  // seconds the FIFO ran empty in the first minute and afterwards
+  unsigned int start_underruns, underruns;
+  unsigned int up_gap; // s between the last two steps up
+};
+
+// Bandwidth in B/s over time, from second start on
+struct phase {
+  unsigned int start;
+  uint32_t bandwidth;
+};
+
+static struct result simulate(const struct phase *phases, size_t count,
+                              unsigned int seconds) {
+  struct result result = {0};
+  fill = FIFO_SIZE / 2;
+  received = 0;
+  size_t variant = abr_start(&station);
+  abr_get_and_reset_switches();
+  unsigned int gap = 0, last_up = 0;
+
+  for (unsigned int t = 0; t < seconds; ++t) {
+    uint32_t bandwidth = 0;
+    for (size_t i = 0; i < count && phases[i].start <= t; ++i)
+      bandwidth = phases[i].bandwidth;
+
+    const size_t drain = station.variants[variant].bitrate * 1000 / 8;
+    size_t in = gap > 0 ? 0 : bandwidth;
+    if (in > FIFO_SIZE - fill + drain)
+      in = FIFO_SIZE - fill + drain;
+    if (gap > 0)
+      --gap;
+    received += in;
+    fill += in;
+    if (fill < drain) {
+      if (t < 60)
+        ++result.start_underruns;
+      else
+        ++result.underruns;
+      fill = 0;
+    } else {
+      fill -= drain;
+    }
+
+    host_time_offset += 1000000;
+    const int next = abr_update();
+    if (next >= 0) {
+      if ((size_t)next > variant) {
+        result.up_gap = t - last_up;
+        last_up = t;
+      }
+      variant = next;
+      gap = MOVE_GAP;
+      ++result.switches;
+    }
+  }
+
+  result.variant = variant;
+  CHECK_EQ(abr_get_and_reset_switches(), result.switches);
+  printf("abr: %u s, %u switches, %u+%u s underrun, ends at %u kbit/s\n",
+         seconds, result.switches, result.start_underruns, result.underruns,
+         station.variants[result.variant].bitrate);
+  return result;
+}
+
+// Plenty of bandwidth, the best variant plays throughout
+static void test_fast(void) {
+  static const struct phase phases[] = {{0, 40000}};
+  const struct result r = simulate(phases, 1, 1800);
+  CHECK_EQ(r.variant, 2);
+  CHECK_EQ(r.switches, 0);
+  CHECK_EQ(r.start_underruns + r.underruns, 0);
+}
+
+// 96 kbit/s only fit the lowest variant. The start at the best one runs
+// the FIFO dry until the first decision has taken effect. After that, the next
+// variant is probed less and less often, finally every HOLD_MAX (320) s.
+static void test_slow(void) {
+  static const struct phase phases[] = {{0, 12000}};
+  const struct result r = simulate(phases, 1, 1800);
+  CHECK_EQ(r.variant, 0);
+  CHECK(r.start_underruns <= 12);
+  CHECK_EQ(r.underruns, 0);
+  CHECK(r.up_gap >= 320);
+}
+
+// The bandwidth drops for ten minutes and recovers
+static void test_dip(void) {
+  static const struct phase phases[] = {{0, 40000}, {300, 10000}, {900, 40000}};
+  const struct result r = simulate(phases, 3, 1800);
+  CHECK_EQ(r.variant, 2);
+  CHECK(r.switches >= 2);
+  CHECK_EQ(r.start_underruns + r.underruns, 0);
+}
+
+// A station with a single variant never moves
+static void test_single(void) {
+  static const struct station single = {
+      "Single", {{"http://radio.test/128", 128}}, NULL};
+  fill = FIFO_SIZE / 8;
+  CHECK_EQ(abr_start(&single), 0);
+  for (int t = 0; t < 100; ++t) {
+    host_time_offset += 1000000;
+    CHECK_EQ(abr_update(), -1);
+  }
+}
+
+int main(void) {
+  test_fast();
+  test_slow();
+  test_dip();
+  test_single();
+  return test_result("test_abr");
+}
@@ -0,0 +1,229 @@
+// The input and output path of the decoders without a decoder: the FIFO on
+// top of the SPI RAM model, and the audio output through the DMA engine
+// model.
+
+#include "audio.h"
+#include "fifo.h"
+#include "test.h"
+#include "wm8731.h"
+
+#include "i2c/i2c.h"
+#include "i2s_dma/i2s_dma.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <string.h>
+
+#define STREAM_SIZE (300 * 1000)
+#define FRAMES 4000
+#define CAPTURE_MAX (4 * FRAMES + 8192)
+
+// The integer dividers of the I2S clock are within 1 % of the sample rates
+static bool near(unsigned int rate, unsigned int expected) {
+  return rate > expected * 99 / 100 && rate < expected * 101 / 100;
+}
+
+static volatile bool producer_done;
+
+static uint8_t pattern(uint32_t pos) { return pos * 7 + (pos >> 11); }
+
+static void producer(void *arg) {
+  uint8_t buf[1000];
+  for (uint32_t pos = 0; pos < STREAM_SIZE; pos += sizeof(buf)) {
+    for (size_t i = 0; i < sizeof(buf); ++i)
+      buf[i] = pattern(pos + i);
+    fifo_enqueue(buf, sizeof(buf));
+  }
+  producer_done = true;
+  vTaskDelete(NULL);
+}
+
+// More than the FIFO holds goes through in odd sizes, the producer blocks
+// while it's full
+static void test_fifo(void) {
+  CHECK_EQ(fifo_init(), 0);
+  CHECK_EQ(fifo_fill(), 0);
+
+  xTaskCreate(producer, "producer", 512, NULL, 3, NULL);
+  uint8_t buf[777];
+  bool intact = true;
+  for (uint32_t pos = 0; pos < STREAM_SIZE; pos += sizeof(buf)) {
+    const size_t n = STREAM_SIZE - pos < sizeof(buf) ? STREAM_SIZE - pos
+                                                     : sizeof(buf);
+    uint8_t peeked[8];
+    fifo_peek(peeked, sizeof(peeked));
+    fifo_dequeue(buf, n);
+    intact &= memcmp(peeked, buf, sizeof(peeked)) == 0;
+    for (size_t i = 0; i < n; ++i)
+      intact &= buf[i] == pattern(pos + i);
+  }
+  CHECK(intact);
+  CHECK(producer_done);
+  CHECK_EQ(fifo_read_count(), STREAM_SIZE);
+  CHECK_EQ(fifo_fill(), 0);
+
+  // a new stream behind a mark, the old one is dropped by the cut
+  const uint8_t old_stream[100] = {1}, new_stream[10] = {2, 3, 4};
+  fifo_enqueue(old_stream, sizeof(old_stream));
+  fifo_mark();
+  fifo_enqueue(new_stream, sizeof(new_stream));
+  fifo_dequeue(buf, 10);
+  fifo_cut();
+  CHECK_EQ(fifo_fill(), sizeof(new_stream));
+  fifo_dequeue(buf, sizeof(new_stream));
+  CHECK(memcmp(buf, new_stream, sizeof(new_stream)) == 0);
+}
+
+static uint32_t frame(int16_t left, int16_t right) {
+  return (uint16_t)left | (uint32_t)(uint16_t)right << 16;
+}
+
+static uint32_t captured[CAPTURE_MAX];
+static volatile size_t capture_len;
+
+static void capture(const uint32_t *frames, size_t count) {
+  for (size_t i = 0; i < count && capture_len < CAPTURE_MAX; ++i) {
+    // only the audio written by the test, the blocks start out silent
+    if (capture_len > 0 || frames[i] != 0)
+      captured[capture_len++] = frames[i];
+  }
+}
+
+// Plays FRAMES frames of a ramp and checks what the DMA engine played
+static void play_ramp(unsigned short channels, unsigned int repeat) {
+  int16_t samples[2 * FRAMES];
+  for (int i = 0; i < FRAMES; ++i) {
+    samples[i * channels] = i + 1;
+    if (channels == 2)
+      samples[i * 2 + 1] = -(i + 1);
+  }
+
+  capture_len = 0;
+  get_and_reset_underrun_counter();
+  audio_write_s16(samples, FRAMES, channels);
+  audio_drain();
+  // the drain leaves silence in every block, so all audio has been played
+  const unsigned int underruns = get_and_reset_underrun_counter();
+  CHECK_EQ(underruns, 0);
+  CHECK(capture_len >= FRAMES * repeat);
+  if (underruns > 0 || capture_len < FRAMES * repeat)
+    return;
+
+  bool in_order = true;
+  for (size_t i = 0; i < FRAMES * repeat; ++i) {
+    const int16_t n = i / repeat + 1;
+    const int16_t right = channels == 2 ? -n : n;
+    in_order &= captured[i] == frame(n, right);
+  }
+  CHECK(in_order);
+}
+
+#ifndef LIBMAD_FIXED_OUTPUT
+// Writes the ramp through the slices libmad asks for
+static void play_ramp_slices(unsigned short channels) {
+  const unsigned int per_slice = 64 / channels;
+  capture_len = 0;
+  get_and_reset_underrun_counter();
+  audio_set_frame_format(44100, channels);
+  const short *last = NULL;
+  int in_dma = 0;
+  for (int i = 0; i < FRAMES; i += per_slice) {
+    short *slice = audio_get_sample_buffer();
+    // stereo slices follow each other in the DMA block
+    in_dma += last != NULL && slice == last + 64;
+    last = slice;
+    for (int j = 0; j < per_slice; ++j) {
+      slice[j * channels] = i + j + 1;
+      if (channels == 2)
+        slice[j * 2 + 1] = -(i + j + 1);
+    }
+  }
+  audio_flush_sample_buffer();
+  audio_drain();
+
+  const size_t frames = FRAMES / per_slice * per_slice;
+  if (channels == 2)
+    CHECK(in_dma > FRAMES / per_slice / 2);
+  else
+    CHECK_EQ(in_dma, 0);
+  CHECK_EQ(get_and_reset_underrun_counter(), 0);
+  CHECK(capture_len >= frames);
+  bool in_order = capture_len >= frames;
+  for (size_t i = 0; in_order && i < frames; ++i) {
+    const int16_t left = i + 1, right = channels == 2 ? -left : left;
+    in_order &= captured[i] == frame(left, right);
+  }
+  CHECK(in_order);
+}
+#endif
+
+// Plays FRAMES frames of a ramp of fixed-point samples, single channel audio
+// is duplicated into both slots
+static void play_fixed_ramp(bool stereo) {
+  static mad_fixed_t left[FRAMES], right[FRAMES];
+  for (int i = 0; i < FRAMES; ++i) {
+    left[i] = (i + 1) * (MAD_F_ONE >> 15);
+    right[i] = -left[i];
+  }
+
+  capture_len = 0;
+  get_and_reset_underrun_counter();
+  audio_write(left, stereo ? right : NULL, FRAMES);
+  audio_drain();
+  CHECK_EQ(get_and_reset_underrun_counter(), 0);
+  CHECK(capture_len >= FRAMES);
+  bool in_order = capture_len >= FRAMES;
+  for (size_t i = 0; in_order && i < FRAMES; ++i) {
+    const int16_t l = i + 1, r = stereo ? -l : l;
+    in_order &= captured[i] == frame(l, r);
+  }
+  CHECK(in_order);
+}
+
+static void test_audio(void) {
+  CHECK_EQ(wm8731_init(), 0);
+  // active, 44.1 kHz in USB mode
+  CHECK_EQ(host_wm8731_regs[0x09], 0x01);
+  CHECK_EQ(host_wm8731_regs[0x08], 0x23);
+
+  // a few times real time, so the writer never falls behind
+  host_i2s_speed = 4;
+  host_i2s_sink = capture;
+  audio_init();
+  CHECK(near(host_i2s_frame_rate(), 44100));
+
+  play_ramp(2, 1);
+  play_ramp(1, 1);
+#ifndef LIBMAD_FIXED_OUTPUT
+  play_ramp_slices(2);
+  play_ramp_slices(1);
+#endif
+
+  // the DAC can't run at 22.05 kHz, every frame is played twice
+  audio_set_format(22050, 2);
+  CHECK(near(host_i2s_frame_rate(), 44100));
+  CHECK_EQ(audio_sample_rate(), 22050);
+  play_ramp(2, 2);
+
+  audio_set_format(48000, 2);
+  CHECK_EQ(host_wm8731_regs[0x08], 0x01);
+  CHECK(near(host_i2s_frame_rate(), 48000));
+  play_ramp(2, 1);
+
+  // single channel audio is clocked like stereo, the I2S frames stay stereo
+  audio_set_format(32000, 1);
+  CHECK(near(host_i2s_frame_rate(), 32000));
+  play_ramp(1, 1);
+  play_fixed_ramp(false);
+  play_fixed_ramp(true);
+
+  host_i2s_sink = NULL;
+  audio_stop();
+}
+
+int main(void) {
+  test_fifo();
+  test_audio();
+  return test_result("test_audio");
+}
@@ -0,0 +1,84 @@
+// The decoder task with a fake codec in place of libmad: switching streams,
+// and a first stream and a switch to a stream no codec can be opened for.
+
+#include "decoder.h"
+#include "fake_codec.h"
+#include "fifo.h"
+#include "test.h"
+#include "wm8731.h"
+
+#include "i2s_dma/i2s_dma.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+// Frames played at full level per stream
+static volatile unsigned int played[4];
+
+static void count(const uint32_t *frames, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    for (int level = 1; level < 4; ++level)
+      played[level] += frames[i] == (uint32_t)(level << 8 | level << 24);
+  }
+}
+
+static void send(uint8_t level, int frames) {
+  uint8_t frame[FAKE_FRAME_SIZE];
+  fake_codec_frame(frame, level);
+  for (int i = 0; i < frames; ++i)
+    fifo_enqueue(frame, sizeof(frame));
+}
+
+static void wait_empty(void) {
+  for (int i = 0; i < 500 && fifo_fill() >= FAKE_FRAME_SIZE; ++i)
+    vTaskDelay(1);
+}
+
+// Starts the next stream like the stream client does: the mark, then the
+// switch, then the data
+static int zap(uint8_t level, int frames) {
+  fifo_mark();
+  const int ret = decoder_switch("audio/mpeg");
+  send(level, frames);
+  return ret;
+}
+
+static void test_failed_switch(void) {
+  CHECK_EQ(fifo_init(), 0);
+  CHECK_EQ(wm8731_init(), 0);
+  host_i2s_speed = 8;
+  host_i2s_sink = count;
+
+  // the first stream can't be decoded, the task skips it and stays around
+  fake_codec_failing_opens = 2;
+  send(1, 40);
+  xTaskCreate(decoder_task, "decode", 2100, "audio/mpeg", 4, NULL);
+  wait_empty();
+  CHECK_EQ(fake_codec_opens, 2);
+  CHECK_EQ(played[1], 0);
+
+  CHECK_EQ(zap(1, 40), 0);
+  wait_empty();
+  CHECK_EQ(fake_codec_opens, 3);
+
+  // neither the codec of the Content-Type nor the probed one opens, the
+  // stream is dropped and the decoder waits for the next one
+  fake_codec_failing_opens = 2;
+  CHECK_EQ(zap(2, 40), 0);
+  wait_empty();
+  CHECK_EQ(fake_codec_opens, 5);
+  CHECK(fifo_fill() < FAKE_FRAME_SIZE * 8);
+
+  played[3] = 0;
+  CHECK_EQ(zap(3, 80), 0);
+  wait_empty();
+  vTaskDelay(10);
+  CHECK_EQ(fake_codec_opens, 6);
+  CHECK(played[1] > 0);
+  CHECK(played[3] > 0);
+}
+
+int main(void) {
+  test_failed_switch();
+  return test_result("test_decoder");
+}
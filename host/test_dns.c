@@ -0,0 +1,74 @@
+// The DNS cache: prefetched hosts are resolved in the background and stay
+// cached until they are used, however many other hosts are looked up.
+
+#include "dns.h"
+#include "test.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "espressif/esp_common.h"
+#include "lwip/api.h"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+
+static const char *const table[] = {
+    "s0.test 10.0.0.1",  "s1.test 10.0.0.2",  "s2.test 10.0.0.3",
+    "o0.test 10.0.1.0",  "o1.test 10.0.1.1",  "o2.test 10.0.1.2",
+    "o3.test 10.0.1.3",  "o4.test 10.0.1.4",  "o5.test 10.0.1.5",
+    "o6.test 10.0.1.6",  "o7.test 10.0.1.7",  "o8.test 10.0.1.8",
+    "o9.test 10.0.1.9",  NULL,
+};
+
+// Looks up count hosts named <prefix><n>.test, a tick apart like real
+// lookups, returns the number of failures
+static int lookup_all(char prefix, int count) {
+  int failures = 0;
+  for (int i = 0; i < count; ++i) {
+    char host[16];
+    ip_addr_t addr;
+    snprintf(host, sizeof(host), "%c%d.test", prefix, i);
+    failures += dns_lookup(host, &addr) != 0;
+    vTaskDelay(1);
+  }
+  return failures;
+}
+
+static void test_pinned(void) {
+  host_dns_table = table;
+  host_wifi_connected = false;
+  CHECK_EQ(dns_init(), 0);
+  dns_prefetch("s0.test");
+  dns_prefetch("s1.test");
+  dns_prefetch("s2.test");
+
+  // the background task resolves them once the station has an address
+  host_wifi_connected = true;
+  for (int i = 0; i < 100 && host_dns_lookups < 3; ++i)
+    vTaskDelay(10);
+  CHECK_EQ(host_dns_lookups, 3);
+
+  // more hosts than the cache holds don't push out the prefetched ones
+  CHECK_EQ(lookup_all('o', 10), 0);
+  CHECK_EQ(host_dns_lookups, 13);
+  ip_addr_t addr;
+  CHECK_EQ(dns_lookup("s1.test", &addr), 0);
+  CHECK_EQ(addr.addr, htonl(0x0a000002));
+  CHECK_EQ(lookup_all('s', 3), 0);
+  CHECK_EQ(host_dns_lookups, 13);
+
+  // once used they age like any other entry
+  CHECK_EQ(lookup_all('o', 10), 0);
+  CHECK_EQ(host_dns_lookups, 23);
+  CHECK_EQ(dns_lookup("s0.test", &addr), 0);
+  CHECK_EQ(host_dns_lookups, 24);
+
+  // unknown hosts fail
+  CHECK(dns_lookup("x.test", &addr) != 0);
+}
+
+int main(void) {
+  test_pinned();
+  return test_result("test_dns");
+}
@@ -0,0 +1,68 @@
+// The endpoint cache: entries age by the server's Date, and unchanged entries
+// don't wear out the flash.
+
+#include "endpoint_cache.h"
+#include "test.h"
+
+#include "sysparam.h"
+
+#include <string.h>
+
+#define PLAYLIST "http://radio.test/listen.pls"
+#define DAY (24 * 60 * 60)
+// Sun, 06 Nov 1994 08:49:37 GMT
+#define DATE 784111777u
+
+static void test_age(void) {
+  host_sysparam_clear();
+
+  char url[64];
+  uint32_t date;
+  CHECK(endpoint_lookup(PLAYLIST, url, sizeof(url), &date) != 0);
+
+  endpoint_store(PLAYLIST, "http://a.test/stream", DATE);
+  CHECK_EQ(host_sysparam_writes, 1);
+  CHECK_EQ(endpoint_lookup(PLAYLIST, url, sizeof(url), &date), 0);
+  CHECK(strcmp(url, "http://a.test/stream") == 0);
+  CHECK_EQ(date, DATE);
+  // a buffer too small for the URL
+  CHECK(endpoint_lookup(PLAYLIST, url, 8, &date) != 0);
+
+  // the same endpoint isn't written again until it's half the maximum age
+  endpoint_store(PLAYLIST, "http://a.test/stream", DATE + DAY);
+  endpoint_store(PLAYLIST, "http://a.test/stream", 0);
+  CHECK_EQ(host_sysparam_writes, 1);
+  endpoint_store(PLAYLIST, "http://a.test/stream", DATE + ENDPOINT_MAX_AGE / 2);
+  CHECK_EQ(host_sysparam_writes, 2);
+  // another endpoint is
+  endpoint_store(PLAYLIST, "http://b.test/stream", DATE + ENDPOINT_MAX_AGE / 2);
+  CHECK_EQ(host_sysparam_writes, 3);
+  CHECK_EQ(endpoint_lookup(PLAYLIST, url, sizeof(url), &date), 0);
+  CHECK(strcmp(url, "http://b.test/stream") == 0);
+
+  // an entry of unknown age gets the age of the next Date
+  endpoint_store(PLAYLIST, "http://c.test/stream", 0);
+  CHECK_EQ(host_sysparam_writes, 4);
+  endpoint_store(PLAYLIST, "http://c.test/stream", 0);
+  CHECK_EQ(host_sysparam_writes, 4);
+  endpoint_store(PLAYLIST, "http://c.test/stream", DATE);
+  CHECK_EQ(host_sysparam_writes, 5);
+
+  endpoint_forget(PLAYLIST);
+  CHECK(endpoint_lookup(PLAYLIST, url, sizeof(url), &date) != 0);
+}
+
+static void test_expiry(void) {
+  CHECK(!endpoint_expired(DATE, DATE + ENDPOINT_MAX_AGE));
+  CHECK(endpoint_expired(DATE, DATE + ENDPOINT_MAX_AGE + 1));
+  // unknown dates and a server clock behind the stored one keep the entry
+  CHECK(!endpoint_expired(0, DATE));
+  CHECK(!endpoint_expired(DATE, 0));
+  CHECK(!endpoint_expired(DATE, DATE - 10 * ENDPOINT_MAX_AGE));
+}
+
+int main(void) {
+  test_age();
+  test_expiry();
+  return test_result("test_endpoint_cache");
+}
@@ -0,0 +1,148 @@
+// The Latin-1 font: decoding of UTF-8 and of the Latin-1 bytes stations
+// still send, the runs of every glyph and the measurements of text.
+
+#include "font.h"
+#include "lcd_font.h"
+#include "test.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define GLYPHS (0x7e - 0x20 + 1 + 0xff - 0xa0 + 1)
+
+// Decodes a whole string into at most max characters, returns the count
+static int decode(const char *str, uint32_t *chars, int max) {
+  const char *end = str + strlen(str);
+  int n = 0;
+  while (str < end && n < max)
+    chars[n++] = font_decode(&str, end);
+  return n;
+}
+
+static void test_decode(void) {
+  uint32_t c[8];
+  CHECK_EQ(decode("Az~", c, 8), 3);
+  CHECK_EQ(c[0], 'A');
+  CHECK_EQ(c[2], '~');
+
+  // two, three and four bytes
+  CHECK_EQ(decode("\xc3\xa4\xe2\x80\x9e\xf0\x9f\x8e\xb5", c, 8), 3);
+  CHECK_EQ(c[0], 0xe4);
+  CHECK_EQ(c[1], 0x201e);
+  CHECK_EQ(c[2], 0x1f3b5);
+
+  // Latin-1, as many stations send it
+  CHECK_EQ(decode("\xe9t\xe9", c, 8), 3);
+  CHECK_EQ(c[0], 0xe9);
+  CHECK_EQ(c[2], 0xe9);
+
+  // a sequence cut off at the end, a stray continuation byte and an
+  // overlong encoding are taken byte by byte
+  CHECK_EQ(decode("\xc3", c, 8), 1);
+  CHECK_EQ(c[0], 0xc3);
+  CHECK_EQ(decode("\xe2\x80", c, 8), 2);
+  CHECK_EQ(c[0], 0xe2);
+  CHECK_EQ(c[1], 0x80);
+  CHECK_EQ(decode("\x80" "a", c, 8), 2);
+  CHECK_EQ(c[0], 0x80);
+  CHECK_EQ(decode("\xc0\xaf", c, 8), 2);
+  CHECK_EQ(c[0], 0xc0);
+  CHECK_EQ(c[1], 0xaf);
+  // a lead byte followed by another lead byte
+  CHECK_EQ(decode("\xc3\xc3\xa4", c, 8), 2);
+  CHECK_EQ(c[0], 0xc3);
+  CHECK_EQ(c[1], 0xe4);
+
+  // the end is respected even inside a sequence
+  const char *str = "\xc3\xa4";
+  CHECK_EQ(font_decode(&str, str + 1), 0xc3);
+}
+
+static void test_glyphs(void) {
+  const struct font_glyph *question = font_glyph(&font_latin1, '?');
+  CHECK(font_glyph(&font_latin1, 0x80) == question);
+  CHECK(font_glyph(&font_latin1, 0x9f) == question);
+  CHECK(font_glyph(&font_latin1, 0x100) == question);
+  CHECK(font_glyph(&font_latin1, 0x1f3b5) == question);
+  CHECK(font_glyph(&font_latin1, 0x201e) == font_glyph(&font_latin1, '"'));
+  CHECK(font_glyph(&font_latin1, 0x2013) == font_glyph(&font_latin1, '-'));
+
+  // the runs of each glyph cover exactly its pixels, and the next glyph
+  // starts right after them
+  bool runs_ok = true, widths_ok = true;
+  for (int i = 0; i < GLYPHS; ++i) {
+    const struct font_glyph *glyph = &font_latin1.glyphs[i];
+    widths_ok &= glyph->width >= 1 && glyph->width <= FONT_MAX_WIDTH;
+    const uint8_t *p = font_latin1.runs + glyph->offset;
+    int pixels = 0;
+    for (; pixels < glyph->width * FONT_LATIN1_HEIGHT; ++p)
+      pixels += (*p >> 4) + (*p & 0x0f);
+    runs_ok &= pixels == glyph->width * FONT_LATIN1_HEIGHT;
+    if (i + 1 < GLYPHS)
+      runs_ok &= font_latin1.runs + font_latin1.glyphs[i + 1].offset == p;
+  }
+  CHECK(runs_ok);
+  CHECK(widths_ok);
+
+  // the ASCII glyphs are the 5x7 font below the two rows of accents, with
+  // the blank columns trimmed. The 5x7 font has an arrow in place of ~.
+  bool ascii_ok = true;
+  for (int c = '!'; c < '~'; ++c) {
+    const uint8_t *fixed = &font[(c - FIRST_CHAR) * FONT_WIDTH];
+    int first = 0, last = FONT_WIDTH - 1;
+    while (fixed[first] == 0)
+      ++first;
+    while (fixed[last] == 0)
+      --last;
+    const struct font_glyph *glyph = font_glyph(&font_latin1, c);
+    uint16_t columns[FONT_MAX_WIDTH];
+    font_columns(&font_latin1, glyph, columns);
+    ascii_ok &= glyph->width == last - first + 1;
+    for (int col = 0; col < glyph->width && ascii_ok; ++col)
+      ascii_ok &= columns[col] == fixed[first + col] << 2;
+    if (!ascii_ok) {
+      printf("glyph of %c differs from the 5x7 font\n", c);
+      break;
+    }
+  }
+  CHECK(ascii_ok);
+
+  // an umlaut is its base letter with dots above
+  uint16_t a[FONT_MAX_WIDTH], ae[FONT_MAX_WIDTH];
+  font_columns(&font_latin1, font_glyph(&font_latin1, 'A'), a);
+  font_columns(&font_latin1, font_glyph(&font_latin1, 0xc4), ae);
+  CHECK_EQ(font_glyph(&font_latin1, 0xc4)->width,
+           font_glyph(&font_latin1, 'A')->width);
+  bool dots = false;
+  for (int col = 0; col < font_glyph(&font_latin1, 'A')->width; ++col) {
+    CHECK_EQ(ae[col] & ~3, a[col]);
+    dots |= ae[col] & 3;
+  }
+  CHECK(dots);
+}
+
+static void test_measure(void) {
+  const char *text = "\xc3\x84rzte";
+  const size_t n = strlen(text);
+  int width = 0;
+  for (const char *c = "\xc4rzte"; *c != '\0'; ++c)
+    width += font_glyph(&font_latin1, (uint8_t)*c)->width + FONT_SPACING;
+  CHECK_EQ(font_width(&font_latin1, text, n, 1), width);
+  CHECK_EQ(font_width(&font_latin1, text, n, 2), 2 * width);
+  CHECK_EQ(font_width(&font_latin1, "", 0, 1), 0);
+
+  CHECK_EQ(font_fit(&font_latin1, text, n, width, 1), n);
+  CHECK_EQ(font_fit(&font_latin1, text, n, width - 1, 1), n - 1);
+  CHECK_EQ(font_fit(&font_latin1, text, n, 2 * width - 1, 2), n - 1);
+  // never in the middle of a character
+  const int umlaut = font_glyph(&font_latin1, 0xc4)->width + FONT_SPACING;
+  CHECK_EQ(font_fit(&font_latin1, text, n, umlaut - 1, 1), 0);
+  CHECK_EQ(font_fit(&font_latin1, text, n, umlaut, 1), 2);
+}
+
+int main(void) {
+  test_decode();
+  test_glyphs();
+  test_measure();
+  return test_result("test_font");
+}
@@ -0,0 +1,173 @@
+// A live HLS stream from a loopback server, through the stream client, the
+// decoder with the fake codec and the I2S output in real time. The media
+// playlist lists two segments of packed audio behind an ID3 tag, and moves on
+// by one each time it is reloaded. The stream client has to fetch each segment
+// once and in order, over the one connection it keeps open, and the decoder
+// has to play them back to back.
+
+#include "audio.h"
+#include "decoder.h"
+#include "dns.h"
+#include "fake_codec.h"
+#include "fifo.h"
+#include "icy_server.h"
+#include "stream_client.h"
+#include "test.h"
+#include "wm8731.h"
+
+#include "i2s_dma/i2s_dma.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "lwip/api.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Segments of different levels, the ones after them are silent
+#define SEGMENTS 3
+// About a second of audio each, the target duration
+#define SEGMENT_FRAMES 38
+#define SEGMENT_SAMPLES (SEGMENT_FRAMES * FAKE_FRAME_SAMPLES)
+// The ID3 tag of packed audio, a header and a frame that isn't read
+#define ID3_SIZE 32
+#define SEGMENT_SIZE (ID3_SIZE + SEGMENT_FRAMES * FAKE_FRAME_SIZE)
+
+static const char *const dns_table[] = {"radio.test 127.0.0.1", NULL};
+
+static uint8_t segments[SEGMENTS + 1][SEGMENT_SIZE];
+static char playlist[256];
+// requests the server answered, by document
+static volatile unsigned int playlist_loads, segment_loads[SEGMENTS + 1],
+    unknown;
+
+// Level of the samples of segment i
+static int level(int i) { return i < SEGMENTS ? 32 * (i + 1) : 0; }
+
+static void make_segments(void) {
+  for (int i = 0; i <= SEGMENTS; ++i) {
+    uint8_t *p = segments[i];
+    memset(p, 0, ID3_SIZE);
+    memcpy(p, "ID3\x04\x00\x00", 6);
+    p[9] = ID3_SIZE - 10; // syncsafe size of what follows the header
+    for (int k = 0; k < SEGMENT_FRAMES; ++k)
+      fake_codec_frame(p + ID3_SIZE + k * FAKE_FRAME_SIZE, level(i));
+  }
+}
+
+// Load n of the playlist lists segments n and n + 1, like a live stream that
+// moves on by a segment in the target duration
+static const char *page(struct icy_server *server, const char *path,
+                        const uint8_t **body, size_t *len) {
+  int i;
+  if (strcmp(path, "/live/index.m3u8") == 0) {
+    const unsigned int first = playlist_loads++;
+    *len = snprintf(playlist, sizeof(playlist),
+                    "#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-TARGETDURATION:1\n"
+                    "#EXT-X-MEDIA-SEQUENCE:%u\n"
+                    "#EXTINF:1.0,\nseg%u.mp3\n#EXTINF:1.0,\nseg%u.mp3\n",
+                    first, first, first + 1);
+    *body = (const uint8_t *)playlist;
+    return "application/vnd.apple.mpegurl";
+  }
+  if (sscanf(path, "/live/seg%d.mp3", &i) == 1 && i >= 0) {
+    if (i > SEGMENTS)
+      i = SEGMENTS;
+    ++segment_loads[i];
+    *body = segments[i];
+    *len = SEGMENT_SIZE;
+    return "audio/mpeg";
+  }
+  ++unknown;
+  *body = NULL;
+  *len = 0;
+  return "text/plain";
+}
+
+// Segments in the order they were heard, and the samples of each at its level
+static volatile int heard[8];
+static volatile size_t heard_count;
+static volatile uint32_t played[SEGMENTS];
+
+static void sink(const uint32_t *frames, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    const int16_t sample = frames[i];
+    for (int s = 0; s < SEGMENTS; ++s) {
+      if (sample != level(s) * 256)
+        continue;
+      ++played[s];
+      if ((heard_count == 0 || heard[heard_count - 1] != s) &&
+          heard_count < sizeof(heard) / sizeof(heard[0]))
+        heard[heard_count++] = s;
+    }
+  }
+}
+
+static void on_up(const char *content_type) {
+  CHECK_EQ(xTaskCreate(decoder_task, "decode", 2100, (void *)content_type, 4,
+                       NULL),
+           pdPASS);
+}
+
+static void on_metadata(enum stream_metadata type, const char *value) {}
+
+// Waits up to ms for the condition, in steps of a tick
+#define WAIT(cond, ms)                                                         \
+  for (int i_ = 0; i_ < (ms) / portTICK_PERIOD_MS && !(cond); ++i_)            \
+  vTaskDelay(1)
+
+static void test_hls(void) {
+  struct icy_server server = {.page = page};
+  make_segments();
+  CHECK_EQ(icy_server_start(&server), 0);
+  char url[64];
+  snprintf(url, sizeof(url), "http://radio.test:%u/live/index.m3u8",
+           server.port);
+
+  struct stream_stats stats;
+  stream_get_and_reset_stats(&stats);
+  get_and_reset_underrun_counter();
+  CHECK_EQ(stream_start(url, on_up, on_metadata), 0);
+
+  // the last segment is only listed after a reload, and followed by silence
+  WAIT(played[2] >= SEGMENT_SAMPLES && segment_loads[SEGMENTS] > 1, 8000);
+  const unsigned int underruns = get_and_reset_underrun_counter();
+  stream_get_and_reset_stats(&stats);
+  stream_stop();
+  icy_server_stop(&server);
+
+  printf("hls: %u playlist loads, %u requests on %u connections, "
+         "%u segments, %u underruns\n",
+         playlist_loads, server.requests, server.connections, stats.segments,
+         underruns);
+  CHECK_EQ(heard_count, SEGMENTS);
+  for (size_t i = 0; i < heard_count; ++i)
+    CHECK_EQ(heard[i], i);
+  // the first segment fades in
+  CHECK(played[0] > SEGMENT_SAMPLES - FAKE_FRAME_SAMPLES);
+  CHECK(played[0] <= SEGMENT_SAMPLES);
+  CHECK_EQ(played[1], SEGMENT_SAMPLES);
+  CHECK_EQ(played[2], SEGMENT_SAMPLES);
+  CHECK_EQ(underruns, 0);
+
+  for (int i = 0; i < SEGMENTS; ++i)
+    CHECK_EQ(segment_loads[i], 1);
+  CHECK_EQ(unknown, 0);
+  CHECK(playlist_loads >= 3);
+  CHECK(stats.segments >= SEGMENTS + 1);
+  CHECK(stats.playlists >= 2);
+  CHECK_EQ(server.connections, 1);
+}
+
+int main(void) {
+  host_dns_table = dns_table;
+  CHECK_EQ(fifo_init(), 0);
+  CHECK_EQ(wm8731_init(), 0);
+  CHECK_EQ(dns_init(), 0);
+  host_i2s_speed = 1;
+  host_i2s_sink = sink;
+
+  test_hls();
+  return test_result("test_hls");
+}
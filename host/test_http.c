@@ -0,0 +1,145 @@
+// The HTTP response parser, fed whole and byte by byte, with malformed chunk
+// framing and with Date headers.
+
+#include "http.h"
+#include "test.h"
+
+#include <string.h>
+#include <time.h>
+
+static char body[256];
+static size_t body_len;
+static struct http_response header;
+
+static bool on_header(const struct http_response *response) {
+  header = *response;
+  return response->status == 200;
+}
+
+static void on_body(const uint8_t *data, size_t len) {
+  if (body_len + len < sizeof(body)) {
+    memcpy(body + body_len, data, len);
+    body_len += len;
+  }
+  body[body_len] = '\0';
+}
+
+// Parses a response in pieces of step bytes, returns the last result
+static enum http_result parse(struct http_parser *parser, const char *data,
+                              size_t step) {
+  http_parser_init(parser, on_header, on_body);
+  body_len = 0;
+  body[0] = '\0';
+  memset(&header, 0, sizeof(header));
+
+  enum http_result result = HTTP_CONTINUE;
+  const size_t len = strlen(data);
+  for (size_t pos = 0; pos < len && result == HTTP_CONTINUE; pos += step) {
+    const size_t n = len - pos < step ? len - pos : step;
+    result = http_parse(parser, (const uint8_t *)data + pos, n);
+  }
+  return result;
+}
+
+static void test_chunked(void) {
+  static const char response[] = "HTTP/1.1 200 OK\r\n"
+                                 "Content-Type: audio/mpeg; charset=x\r\n"
+                                 "Transfer-Encoding: chunked\r\n"
+                                 "icy-metaint: 16000\r\n"
+                                 "\r\n"
+                                 "5\r\nhello\r\n"
+                                 "1;ext=1\r\n \r\n"
+                                 "a\r\n0123456789\r\n"
+                                 "0\r\n"
+                                 "\r\n";
+  struct http_parser parser;
+  for (size_t step = 1; step <= sizeof(response); step += 7) {
+    CHECK_EQ(parse(&parser, response, step), HTTP_DONE);
+    CHECK(strcmp(body, "hello 0123456789") == 0);
+    CHECK(http_reusable(&parser));
+  }
+  CHECK(strcmp(header.content_type, "audio/mpeg") == 0);
+  CHECK_EQ(header.metaint, 16000);
+}
+
+static void test_length(void) {
+  struct http_parser parser;
+  CHECK_EQ(parse(&parser,
+                 "HTTP/1.0 200 OK\r\nContent-Length: 3\r\n\r\nabcdef", 4),
+           HTTP_DONE);
+  CHECK(strcmp(body, "abc") == 0);
+  CHECK(!http_reusable(&parser));
+
+  // a length beyond the range of an int doesn't end the body early
+  CHECK_EQ(parse(&parser,
+                 "HTTP/1.1 200 OK\r\nContent-Length: 2147483648\r\n\r\nabc",
+                 100),
+           HTTP_CONTINUE);
+  CHECK(strcmp(body, "abc") == 0);
+
+  // a redirect stops the parser at the end of the header
+  CHECK_EQ(parse(&parser, "ICY 302 Found\r\nLocation: http://x/\r\n\r\n", 3),
+           HTTP_DONE);
+  CHECK(strcmp(header.location, "http://x/") == 0);
+}
+
+// Chunk sizes of 2 GiB and more used to go negative in an int and the parser
+// never made progress
+static void test_bad_chunks(void) {
+  static const char *const bad[] = {
+      "80000000\r\nabc",
+      "ffffffffffffffff\r\nabc",
+      "1000001\r\nabc",
+      "xyz\r\nabc",
+      "12z\r\nabc",
+  };
+  struct http_parser parser;
+  char response[128];
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+    snprintf(response, sizeof(response),
+             "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n%s",
+             bad[i]);
+    CHECK_EQ(parse(&parser, response, 1), HTTP_ERROR);
+    CHECK_EQ(parse(&parser, response, sizeof(response)), HTTP_ERROR);
+    CHECK_EQ(body_len, 0);
+  }
+}
+
+static uint32_t parse_date(const char *date) {
+  char response[128];
+  struct http_parser parser;
+  snprintf(response, sizeof(response), "HTTP/1.1 200 OK\r\nDate: %s\r\n\r\n",
+           date);
+  parse(&parser, response, sizeof(response));
+  return header.date;
+}
+
+// The Date header against gmtime() across the range of the field
+static void test_date(void) {
+  CHECK_EQ(parse_date("Sun, 06 Nov 1994 08:49:37 GMT"), 784111777);
+  bool match = true;
+  // up to 2106, the parser takes the years that fit in 32 bits whole
+  for (uint64_t t = 0; t < 4291747200ULL; t += 86400 * 17 + 3607) {
+    const time_t time = t;
+    char date[64];
+    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", gmtime(&time));
+    match &= parse_date(date) == t;
+  }
+  CHECK(match);
+
+  // the obsolete formats and malformed dates count as unknown
+  CHECK_EQ(parse_date("Sunday, 06-Nov-94 08:49:37 GMT"), 0);
+  CHECK_EQ(parse_date("Sun Nov  6 08:49:37 1994"), 0);
+  CHECK_EQ(parse_date("Sun, 06 Nox 1994 08:49:37 GMT"), 0);
+  CHECK_EQ(parse_date("Sun, 06 Nov 1994 08:49:37 CET"), 0);
+  CHECK_EQ(parse_date("Sun, 06 Nov 1994 8:49:37 GMT"), 0);
+  CHECK_EQ(parse_date("Sun, 06 Nov 1969 08:49:37 GMT"), 0);
+}
+
+int main(void) {
+  test_chunked();
+  test_length();
+  test_bad_chunks();
+  test_date();
+  return test_result("test_http");
+}
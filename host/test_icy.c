@@ -0,0 +1,229 @@
+// The ICY demuxer fed a synthetic capture in random chunks: the audio comes
+// out intact and the metadata records are the same, wherever the chunk
+// boundaries fall. Metadata blocks of random bytes don't disturb the audio.
+
+#include "icy.h"
+#include "test.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCKS 64
+#define MAX_RECORDS (2 * BLOCKS)
+#define ROUNDS 500
+
+struct record {
+  enum icy_field field;
+  char value[ICY_VALUE_MAX];
+};
+
+// A stream as a server sends it and what the demuxer should make of it
+struct capture {
+  uint8_t data[BLOCKS * (8192 + 1 + 255 * 16)];
+  size_t len;
+  uint8_t audio[BLOCKS * 8192];
+  size_t audio_len;
+  struct record records[MAX_RECORDS];
+  size_t count;
+};
+
+static struct capture capture;
+
+// What came out of the demuxer
+static uint8_t audio[sizeof(capture.audio)];
+static size_t audio_len;
+static struct record records[MAX_RECORDS];
+static size_t count;
+static size_t longest; // longest value handed out
+
+static void on_audio(const uint8_t *data, size_t len) {
+  if (audio_len + len <= sizeof(audio))
+    memcpy(audio + audio_len, data, len);
+  audio_len += len;
+}
+
+static void on_metadata(enum icy_field field, char *value) {
+  if (strlen(value) > longest)
+    longest = strlen(value);
+  if (count < MAX_RECORDS) {
+    records[count].field = field;
+    snprintf(records[count].value, ICY_VALUE_MAX, "%s", value);
+  }
+  ++count;
+}
+
+static void expect(enum icy_field field, const char *value) {
+  struct record *record = &capture.records[capture.count++];
+  record->field = field;
+  snprintf(record->value, ICY_VALUE_MAX, "%.*s", ICY_VALUE_MAX - 1, value);
+}
+
+static void add_metadata(const char *text) {
+  const size_t len = strlen(text);
+  const size_t blocks = (len + 15) / 16;
+  capture.data[capture.len++] = blocks;
+  memset(capture.data + capture.len, 0, blocks * 16);
+  memcpy(capture.data + capture.len, text, len);
+  capture.len += blocks * 16;
+}
+
+// The kinds of metadata blocks servers send, and some they shouldn't
+static void add_block(int kind, int n) {
+  char text[1024], value[512];
+  switch (kind) {
+  case 0:
+    add_metadata("");
+    break;
+  case 1:
+    snprintf(value, sizeof(value), "Artist %d - Title", n);
+    snprintf(text, sizeof(text), "StreamTitle='%s';", value);
+    add_metadata(text);
+    expect(ICY_STREAM_TITLE, value);
+    break;
+  case 2: {
+    // longer than the 64 bytes of the old parser, with a URL
+    char url[64];
+    memset(value, 'a' + n % 26, 200);
+    value[200] = '\0';
+    snprintf(url, sizeof(url), "http://radio.test/%d", n);
+    snprintf(text, sizeof(text), "StreamTitle='%s';StreamUrl='%s';", value,
+             url);
+    add_metadata(text);
+    expect(ICY_STREAM_TITLE, value);
+    expect(ICY_STREAM_URL, url);
+    break;
+  }
+  case 3:
+    add_metadata("StreamTitle='Guns N' Roses - Don't Cry; Live';");
+    expect(ICY_STREAM_TITLE, "Guns N' Roses - Don't Cry; Live");
+    break;
+  case 4:
+    // cut to what fits
+    memset(value, 'A' + n % 26, 400);
+    value[400] = '\0';
+    snprintf(text, sizeof(text), "StreamTitle='%s';", value);
+    add_metadata(text);
+    value[ICY_VALUE_MAX - 1] = '\0';
+    expect(ICY_STREAM_TITLE, value);
+    break;
+  case 5:
+    add_metadata("StreamFoo='x';StreamTitle='after an unknown key';");
+    expect(ICY_STREAM_TITLE, "after an unknown key");
+    break;
+  case 6:
+    // a value without quotes spoils the rest of the block
+    add_metadata("StreamTitle=broken;StreamUrl='ignored';");
+    break;
+  default:
+    // the padding ends the value
+    add_metadata("StreamTitle='no semicolon'");
+    expect(ICY_STREAM_TITLE, "no semicolon");
+    break;
+  }
+}
+
+static void build(int metaint) {
+  capture.len = 0;
+  capture.audio_len = 0;
+  capture.count = 0;
+  for (int n = 0; n < BLOCKS; ++n) {
+    for (int i = 0; i < metaint; ++i)
+      capture.audio[capture.audio_len++] = rand();
+    memcpy(capture.data + capture.len,
+           capture.audio + capture.audio_len - metaint, metaint);
+    capture.len += metaint;
+    add_block(n % 8, n);
+  }
+}
+
+// Chunks are mostly a few bytes or a few segments long
+static size_t chunk_size(void) {
+  return rand() % 2 ? 1 + rand() % 16 : 1 + rand() % 4096;
+}
+
+static void feed(int metaint, bool random_chunks) {
+  struct icy_demuxer icy;
+  icy_init(&icy, metaint, on_audio, on_metadata);
+  audio_len = 0;
+  count = 0;
+  for (size_t pos = 0; pos < capture.len;) {
+    size_t n = random_chunks ? chunk_size() : capture.len;
+    if (n > capture.len - pos)
+      n = capture.len - pos;
+    icy_feed(&icy, capture.data + pos, n);
+    pos += n;
+  }
+}
+
+static bool output_matches(void) {
+  if (audio_len != capture.audio_len ||
+      memcmp(audio, capture.audio, audio_len) != 0 || count != capture.count)
+    return false;
+  for (size_t i = 0; i < count; ++i) {
+    if (records[i].field != capture.records[i].field ||
+        strcmp(records[i].value, capture.records[i].value) != 0)
+      return false;
+  }
+  return true;
+}
+
+static void test_chunks(void) {
+  static const int metaints[] = {1, 7, 16, 1000, 8192};
+  srand(1);
+  for (size_t m = 0; m < sizeof(metaints) / sizeof(metaints[0]); ++m) {
+    build(metaints[m]);
+    feed(metaints[m], false);
+    CHECK(output_matches());
+
+    unsigned int mismatches = 0;
+    for (int round = 0; round < ROUNDS; ++round) {
+      feed(metaints[m], true);
+      mismatches += !output_matches();
+    }
+    CHECK_EQ(mismatches, 0);
+  }
+}
+
+// Random bytes in place of the metadata text
+static void test_garbage(void) {
+  srand(2);
+  const int metaint = 1000;
+  bool intact = true;
+  longest = 0;
+  for (int round = 0; round < ROUNDS; ++round) {
+    build(metaint);
+    // the length bytes stay, everything else in the blocks is random
+    size_t pos = 0;
+    for (int n = 0; n < BLOCKS; ++n) {
+      pos += metaint;
+      const size_t len = capture.data[pos++] * 16;
+      for (size_t i = 0; i < len; ++i)
+        capture.data[pos + i] = rand() % 4 ? rand() : "=';\0"[rand() % 4];
+      pos += len;
+    }
+
+    feed(metaint, true);
+    intact &= audio_len == capture.audio_len &&
+              memcmp(audio, capture.audio, audio_len) == 0;
+  }
+  CHECK(intact);
+  CHECK(longest < ICY_VALUE_MAX);
+}
+
+// Without icy-metaint everything is audio
+static void test_no_metadata(void) {
+  build(100);
+  feed(0, true);
+  CHECK_EQ(audio_len, capture.len);
+  CHECK(memcmp(audio, capture.data, audio_len) == 0);
+  CHECK_EQ(count, 0);
+}
+
+int main(void) {
+  test_chunks();
+  test_garbage();
+  test_no_metadata();
+  return test_result("test_icy");
+}
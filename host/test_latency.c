@@ -0,0 +1,152 @@
+// The buffered time, live delay and output position reported for synthetic
+// streams of known duration, through the FIFO, the decoder with the fake
+// codec and the I2S output in real time. A producer writes the stream in
+// bursts like the stream client and notes when each frame arrived. The stream
+// is CBR at first and then VBR at the same average bitrate, each phase is
+// checked once the rate measurement only covers its frames. All has to be
+// within a DMA block of the truth.
+
+#include "audio.h"
+#include "decoder.h"
+#include "fake_codec.h"
+#include "fifo.h"
+#include "latency.h"
+#include "test.h"
+#include "wm8731.h"
+
+#include "i2s_dma/i2s_dma.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "espressif/esp_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RATE 44100
+// Frames of a DMA block of audio.c, and its duration rounded up
+#define DMA_BLOCK 128
+#define DMA_BLOCK_MS 3
+// Frames of each phase, about 6 s
+#define PHASE 230
+#define FRAMES (2 * PHASE)
+// Frames written at once, longer than the arrival interval of latency.c
+#define BURST 12
+// A burst is written once the FIFO holds less than this
+#define LOW_WATER (BURST * FAKE_FRAME_SIZE)
+// The phase is checked after this many frames of it have been decoded
+#define SETTLED 190
+// Bitrates of the VBR frames in turn, on average 128 kbit/s
+static const unsigned int vbr[] = {96, 160, 64, 192};
+#define CYCLE 4
+#define LEVEL 32
+
+// The stream: where each frame ends in the FIFO and when it arrived
+static uint32_t frame_end[FRAMES];
+static uint32_t arrived[FRAMES];
+static volatile int written;
+
+static uint32_t frame_ms(int frames) {
+  return (uint64_t)frames * FAKE_FRAME_SAMPLES * 1000 / RATE;
+}
+
+static void producer_task(void *arg) {
+  static uint8_t burst[BURST * FAKE_FRAME_MAX];
+  uint32_t pos = fifo_write_count();
+  for (int k = 0; k < FRAMES;) {
+    while (fifo_fill() >= LOW_WATER)
+      vTaskDelay(1);
+    size_t len = 0;
+    const int first = k;
+    for (; k < FRAMES && k - first < BURST; ++k) {
+      len += k < PHASE ? (fake_codec_frame(burst + len, LEVEL), FAKE_FRAME_SIZE)
+                       : fake_codec_vbr_frame(burst + len, LEVEL,
+                                              vbr[k % CYCLE]);
+      frame_end[k] = pos + len;
+    }
+    pos += len;
+    fifo_enqueue(burst, len);
+    const uint32_t time = sdk_system_get_time();
+    latency_arrival(fifo_write_count(), time);
+    for (int i = first; i < k; ++i)
+      arrived[i] = time;
+    written = k;
+  }
+  vTaskDelete(NULL);
+}
+
+// Samples played, from the first one of the stream on
+static volatile uint32_t played;
+
+static void sink(const uint32_t *frames, size_t n) {
+  for (size_t i = 0; i < n; ++i)
+    played += played > 0 || (int16_t)frames[i] != 0;
+}
+
+// Frames of the stream that have been read from the FIFO
+static int frames_read(void) {
+  const uint32_t pos = fifo_read_count();
+  int k = 0;
+  while (k < written && (int32_t)(frame_end[k] - pos) <= 0)
+    ++k;
+  return k;
+}
+
+// Compares what latency_get() reports with the stream, at the starts of
+// cycles of the VBR frames, when the FIFO holds whole cycles
+static void check_phase(const char *name, int start) {
+  int checks = 0, worst_fifo = 0, worst_delay = 0, worst_pos = 0;
+  while (checks < 16) {
+    vTaskDelay(1);
+    const int k = frames_read();
+    if (k < start + SETTLED || k % CYCLE != 0)
+      continue;
+    if (k >= start + PHASE - BURST)
+      break;
+
+    struct latency_stats stats;
+    latency_get(&stats);
+    const uint32_t now = sdk_system_get_time();
+    const uint32_t heard = played;
+    // the decoder may have moved on in the meantime
+    if (frames_read() != k)
+      continue;
+    ++checks;
+
+    const int fifo_time = frame_ms(written - k);
+    const int frame = stats.played / FAKE_FRAME_SAMPLES;
+    const int live_delay = (now - arrived[frame]) / 1000;
+    const int fifo_error = abs((int)stats.fifo_time - fifo_time);
+    const int delay_error = abs((int)stats.live_delay - live_delay);
+    const int pos_error = abs((int)(heard - stats.played));
+    if (fifo_error > worst_fifo)
+      worst_fifo = fifo_error;
+    if (delay_error > worst_delay)
+      worst_delay = delay_error;
+    if (pos_error > worst_pos)
+      worst_pos = pos_error;
+  }
+
+  printf("%s: %d checks, worst errors: buffered time %d ms, live delay %d "
+         "ms, position %d samples\n",
+         name, checks, worst_fifo, worst_delay, worst_pos);
+  CHECK_EQ(checks, 16);
+  CHECK(worst_fifo <= DMA_BLOCK_MS);
+  CHECK(worst_delay <= DMA_BLOCK_MS);
+  CHECK(worst_pos <= DMA_BLOCK);
+}
+
+int main(void) {
+  CHECK_EQ(fifo_init(), 0);
+  CHECK_EQ(wm8731_init(), 0);
+  host_i2s_speed = 1;
+  host_i2s_sink = sink;
+
+  CHECK_EQ(xTaskCreate(producer_task, "producer", 512, NULL, 3, NULL), pdPASS);
+  CHECK_EQ(xTaskCreate(decoder_task, "decode", 2100, "audio/mpeg", 4, NULL),
+           pdPASS);
+  check_phase("CBR", 0);
+  check_phase("VBR", PHASE);
+  return test_result("test_latency");
+}
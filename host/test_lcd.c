@@ -0,0 +1,271 @@
+// The LCD driver against the model of the display and the touch controller
+// on the HSPI bus: what ends up on the panel, and what it cost on the bus.
+
+#include "font.h"
+#include "hspi.h"
+#include "hspi_model.h"
+#include "lcd_font.h"
+#include "mi0283qt.h"
+#include "mi0283qt_model.h"
+#include "test.h"
+
+#include "esp/gpio.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// RGB() takes 6 bit values, the panel keeps 5 bits of red and blue
+static uint16_t rgb565(uint16_t r, uint16_t g, uint16_t b) {
+  return (r >> 1) << 11 | g << 5 | b >> 1;
+}
+
+static bool area_is(int x0, int y0, int x1, int y1, uint16_t color) {
+  for (int y = y0; y <= y1; ++y) {
+    for (int x = x0; x <= x1; ++x) {
+      if (lcd_model_pixel(x, y) != color)
+        return false;
+    }
+  }
+  return true;
+}
+
+static void test_init(void) {
+  CHECK_EQ(lcd_init(), 0);
+  CHECK_EQ(lcd_model_reg(0x16), 0x08);
+  CHECK_EQ(lcd_model_reg(0x28), 0x3c);
+  CHECK_EQ(lcd_model_reg(0x17), 0x05);
+  CHECK(area_is(0, 0, LCD_WIDTH - 1, LCD_HEIGHT - 1, 0xffff));
+}
+
+static void test_rect(void) {
+  lcd_rect(RGB(63, 0, 0), 10, 20, 19, 29);
+  lcd_rect(RGB(0, 42, 0), 0, 0, 0, 0);
+  lcd_rect(RGB(0, 0, 21), LCD_WIDTH - 1, LCD_HEIGHT - 1, LCD_WIDTH - 1,
+           LCD_HEIGHT - 1);
+  CHECK(area_is(10, 20, 19, 29, rgb565(63, 0, 0)));
+  CHECK(area_is(9, 20, 9, 29, 0xffff));
+  CHECK(area_is(10, 30, 19, 30, 0xffff));
+  CHECK_EQ(lcd_model_pixel(0, 0), rgb565(0, 42, 0));
+  CHECK_EQ(lcd_model_pixel(LCD_WIDTH - 1, LCD_HEIGHT - 1), rgb565(0, 0, 21));
+}
+
+// The fixed font is drawn column by column with the xy exchange
+static void test_string(void) {
+  const uint16_t fg = RGB(63, 63, 0), bg = RGB(0, 0, 63);
+  const int end = lcd_stringn_color(30, 40, "Hi!", 3, fg, bg);
+  CHECK_EQ(end, 30 + 3 * (FONT_WIDTH + FONT_MARGIN));
+  CHECK_EQ(lcd_model_reg(0x16), 0x08);
+
+  bool match = true;
+  for (int i = 0; i < 3; ++i) {
+    const uint8_t *columns = &font[("Hi!"[i] - FIRST_CHAR) * FONT_WIDTH];
+    for (int col = 0; col < FONT_WIDTH + FONT_MARGIN; ++col) {
+      for (int row = 0; row < FONT_HEIGHT; ++row) {
+        const bool set = col < FONT_WIDTH && columns[col] & 1 << row;
+        const int x = 30 + i * (FONT_WIDTH + FONT_MARGIN) + col;
+        match &= lcd_model_pixel(x, 40 + row) ==
+                 (set ? rgb565(63, 63, 0) : rgb565(0, 0, 63));
+      }
+    }
+  }
+  CHECK(match);
+}
+
+// A full line is a single window, the glyphs fill whole transactions of 64
+// bytes
+static void test_string_window(void) {
+  const char *line = "0123456789012345678901234567890123456789";
+  struct lcd_stats stats;
+  lcd_get_and_reset_stats(&stats);
+  CHECK_EQ(lcd_stringn_color(0, 300, line, 40, 0xffff, 0), LCD_WIDTH);
+  lcd_get_and_reset_stats(&stats);
+  const int bytes = 40 * (FONT_WIDTH + FONT_MARGIN) * FONT_HEIGHT * 2;
+  // xy exchange on and off, the window and the GRAM write
+  CHECK_EQ(stats.commands, 2 + 8 + 1);
+  CHECK_EQ(stats.transactions, 2 * stats.commands - 1 + (bytes + 63) / 64);
+  CHECK_EQ(stats.data_bytes, 2 * stats.commands - 1 + bytes);
+  // the old renderer took 19 transactions per character
+  CHECK(stats.transactions < 2 * 40);
+}
+
+// Checks a text in the proportional font at x, y against its glyphs
+static bool text_matches(const char *str, int scale, int x, int y,
+                         uint16_t fg, uint16_t bg) {
+  const char *end = str + strlen(str);
+  while (str < end) {
+    const struct font_glyph *glyph =
+        font_glyph(&font_latin1, font_decode(&str, end));
+    uint16_t columns[FONT_MAX_WIDTH] = {0};
+    font_columns(&font_latin1, glyph, columns);
+    for (int col = 0; col < (glyph->width + FONT_SPACING) * scale; ++col) {
+      for (int row = 0; row < FONT_LATIN1_HEIGHT * scale; ++row) {
+        const bool set = col / scale < glyph->width &&
+                         columns[col / scale] & 1 << row / scale;
+        if (lcd_model_pixel(x + col, y + row) != (set ? fg : bg))
+          return false;
+      }
+    }
+    x += (glyph->width + FONT_SPACING) * scale;
+  }
+  return true;
+}
+
+static void test_text(void) {
+  const uint16_t fg = RGB(0, 0, 0), bg = RGB(63, 63, 63);
+  const char *text = "Gr\xc3\xbc\xc3\x9f" "e, \xe9t\xe9";
+  lcd_text(&font_latin1, 1, 5, 60, text, strlen(text), fg, bg);
+  CHECK(text_matches(text, 1, 5, 60, rgb565(0, 0, 0), 0xffff));
+  lcd_text(&font_latin1, 2, 5, 80, text, strlen(text), fg, bg);
+  CHECK(text_matches(text, 2, 5, 80, rgb565(0, 0, 0), 0xffff));
+
+  // a single row of a text, as the marquee draws it
+  lcd_rect(bg, 0, 110, LCD_WIDTH - 1, 110 + FONT_LATIN1_HEIGHT - 1);
+  for (int row = 0; row < FONT_LATIN1_HEIGHT; ++row)
+    lcd_text_row(&font_latin1, 5, 110 + row, text, strlen(text), row, fg, bg);
+  CHECK(text_matches(text, 1, 5, 110, rgb565(0, 0, 0), 0xffff));
+}
+
+// Every glyph of the font, as UTF-8, line by line
+static void test_all_glyphs(void) {
+  const uint16_t fg = RGB(0, 0, 0), bg = RGB(63, 63, 63);
+  char line[128];
+  size_t len = 0;
+  int y = 130;
+  bool match = true;
+  for (uint32_t c = 0x20; c <= 0xff; ++c) {
+    if (c > 0x7e && c < 0xa0)
+      continue;
+    if (c < 0x80) {
+      line[len++] = c;
+    } else {
+      line[len++] = 0xc0 | c >> 6;
+      line[len++] = 0x80 | (c & 0x3f);
+    }
+    if (len < 40 && c < 0xff)
+      continue;
+    line[len] = '\0';
+    CHECK_EQ(lcd_text(&font_latin1, 1, 0, y, line, len, fg, bg),
+             font_width(&font_latin1, line, len, 1));
+    match &= text_matches(line, 1, 0, y, rgb565(0, 0, 0), 0xffff);
+    y += FONT_LATIN1_HEIGHT;
+    len = 0;
+  }
+  CHECK(match);
+}
+
+static void test_scroll(void) {
+  // rows 200..219 scroll, each row gets its own color
+  for (int row = 0; row < 20; ++row)
+    lcd_rect(RGB(row, 0, 0), 0, 200 + row, LCD_WIDTH - 1, 200 + row);
+  lcd_scroll_on(200, LCD_HEIGHT - 220);
+  lcd_scroll(200);
+  CHECK_EQ(lcd_model_pixel(7, 200), rgb565(0, 0, 0));
+  CHECK_EQ(lcd_model_pixel(7, 219), rgb565(19, 0, 0));
+
+  lcd_scroll(205);
+  CHECK_EQ(lcd_model_pixel(7, 200), rgb565(5, 0, 0));
+  CHECK_EQ(lcd_model_pixel(7, 214), rgb565(19, 0, 0));
+  CHECK_EQ(lcd_model_pixel(7, 215), rgb565(0, 0, 0));
+  CHECK_EQ(lcd_model_pixel(7, 219), rgb565(4, 0, 0));
+  // the fixed areas stay put
+  CHECK_EQ(lcd_model_pixel(7, 199), lcd_model_gram(7, 199));
+  CHECK_EQ(lcd_model_pixel(7, 220), lcd_model_gram(7, 220));
+}
+
+// The statistics of the driver agree with what the model saw on the bus
+static void test_stats(void) {
+  struct lcd_stats driver;
+  struct lcd_model_stats model;
+  lcd_get_and_reset_stats(&driver);
+  lcd_model_get_and_reset_stats(&model);
+  memset(&host_hspi_stats[1], 0, sizeof(host_hspi_stats[1]));
+
+  lcd_rect(RGB(1, 2, 3), 0, 0, 99, 99);
+  lcd_stringn_color(0, 0, "stats", 5, RGB(63, 63, 63), RGB(0, 0, 0));
+  lcd_get_and_reset_stats(&driver);
+  lcd_model_get_and_reset_stats(&model);
+  const struct hspi_bus_stats bus = host_hspi_stats[1];
+
+  CHECK_EQ(driver.commands, model.commands);
+  CHECK_EQ(driver.data_bytes, model.data_bytes);
+  CHECK_EQ(driver.transactions, bus.transactions);
+  CHECK_EQ(driver.bus_time, bus.bus_ns / 1000);
+  CHECK_EQ(model.pixels, 100 * 100 + 5 * (FONT_WIDTH + FONT_MARGIN) *
+                                         FONT_HEIGHT);
+  CHECK_EQ(model.clipped, 0);
+  // 64 bytes per transaction at most, 40 MHz
+  CHECK(bus.transactions >= model.data_bytes / 64);
+  printf("lcd: %u commands, %llu data bytes in %u transactions, %llu us\n",
+         model.commands, (unsigned long long)model.data_bytes,
+         bus.transactions, (unsigned long long)bus.bus_ns / 1000);
+}
+
+static uint16_t touch_read(struct hspi *hspi, uint8_t control) {
+  uint8_t data[2];
+  gpio_write(16, false);
+  hspi_read(hspi, sizeof(data), data, 0, 0, 8, control, 0);
+  gpio_write(16, true);
+  return (data[0] << 8 | data[1]) >> 3;
+}
+
+static void test_touch(void) {
+  static const struct touch_event script[] = {
+      {0, true, 0, 0},
+      {100000, false, 0, 0},
+  };
+  struct hspi hspi = {.mode = SPI_MODE_SPI, .cs = 0, .clock_div = 40};
+  CHECK_EQ(hspi_init(&hspi), 0);
+  gpio_enable(16, GPIO_OUTPUT);
+  gpio_write(16, true);
+
+  touch_model_script(script, 1);
+  CHECK_EQ(touch_read(&hspi, 0xd0), TOUCH_MODEL_RAW_MIN);
+  CHECK_EQ(touch_read(&hspi, 0x90), TOUCH_MODEL_RAW_MIN);
+  CHECK(touch_read(&hspi, 0xb0) > 0);
+
+  static const struct touch_event corner[] = {
+      {0, true, LCD_WIDTH - 1, LCD_HEIGHT - 1}};
+  touch_model_script(corner, 1);
+  CHECK_EQ(touch_read(&hspi, 0xd0), TOUCH_MODEL_RAW_MAX);
+  CHECK_EQ(touch_read(&hspi, 0x90), TOUCH_MODEL_RAW_MAX);
+
+  touch_model_script(script + 1, 1);
+  CHECK_EQ(touch_read(&hspi, 0xb0), 0);
+
+  // drawing while the touch controller is selected garbles both
+  struct touch_model_stats stats;
+  touch_model_get_and_reset_stats(&stats);
+  CHECK_EQ(stats.conversions, 6);
+  CHECK_EQ(stats.conflicts, 0);
+  gpio_write(16, false);
+  lcd_rect(RGB(0, 0, 0), 0, 0, 0, 0);
+  gpio_write(16, true);
+  touch_model_get_and_reset_stats(&stats);
+  CHECK(stats.conflicts > 0);
+}
+
+static void test_dump(void) {
+  CHECK_EQ(lcd_model_dump_ppm(BUILD_DIR "/test_lcd.ppm"), 0);
+  CHECK_EQ(lcd_model_dump_png(BUILD_DIR "/test_lcd.png"), 0);
+  FILE *f = fopen(BUILD_DIR "/test_lcd.ppm", "rb");
+  CHECK(f != NULL);
+  if (f != NULL) {
+    fseek(f, 0, SEEK_END);
+    CHECK_EQ(ftell(f), 15 + LCD_WIDTH * LCD_HEIGHT * 3);
+    fclose(f);
+  }
+}
+
+int main(void) {
+  test_init();
+  test_rect();
+  test_string();
+  test_string_window();
+  test_text();
+  test_all_glyphs();
+  test_scroll();
+  test_stats();
+  test_touch();
+  test_dump();
+  return test_result("test_lcd");
+}
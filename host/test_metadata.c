@@ -0,0 +1,68 @@
+// The metadata queue: values are held back until their audio plays, repeats
+// are dropped and long values are cut like by the ICY demuxer.
+
+#include "metadata.h"
+#include "test.h"
+
+#include <string.h>
+
+static unsigned int delivered;
+static enum stream_metadata last_type;
+static char last_value[METADATA_VALUE_MAX + 1];
+
+static void deliver(enum stream_metadata type, const char *value) {
+  ++delivered;
+  last_type = type;
+  strncpy(last_value, value, sizeof(last_value) - 1);
+}
+
+static void test_repeats(void) {
+  CHECK_EQ(metadata_init(), 0);
+
+  // the server repeats the title with every metadata block
+  for (uint32_t pos = 0; pos < 10; ++pos) {
+    metadata_queue(pos * 100, STREAM_ARTIST, "Artist");
+    metadata_queue(pos * 100, STREAM_TITLE, "Title");
+  }
+  metadata_deliver(10000, deliver);
+  CHECK_EQ(delivered, 2);
+
+  // a change of either type is passed on, the other one isn't repeated
+  delivered = 0;
+  metadata_queue(1000, STREAM_ARTIST, "Artist");
+  metadata_queue(1000, STREAM_TITLE, "Next title");
+  metadata_queue(1000, STREAM_URL, "Title");
+  metadata_deliver(999, deliver);
+  CHECK_EQ(delivered, 0);
+  metadata_deliver(1000, deliver);
+  CHECK_EQ(delivered, 2);
+  CHECK_EQ(last_type, STREAM_URL);
+
+  // after a cut the new stream's metadata is passed on even if unchanged
+  delivered = 0;
+  metadata_clear();
+  metadata_queue(2000, STREAM_TITLE, "Next title");
+  metadata_deliver(2000, deliver);
+  CHECK_EQ(delivered, 1);
+}
+
+static void test_long_value(void) {
+  char value[ICY_VALUE_MAX + 10];
+  memset(value, 'x', sizeof(value) - 1);
+  value[sizeof(value) - 1] = '\0';
+
+  delivered = 0;
+  metadata_queue(3000, STREAM_TITLE, value);
+  // the same after the cut is no change
+  value[ICY_VALUE_MAX] = 'y';
+  metadata_queue(3000, STREAM_TITLE, value);
+  metadata_deliver(3000, deliver);
+  CHECK_EQ(delivered, 1);
+  CHECK_EQ(strlen(last_value), ICY_VALUE_MAX - 1);
+}
+
+int main(void) {
+  test_repeats();
+  test_long_value();
+  return test_result("test_metadata");
+}
@@ -0,0 +1,162 @@
+// Resolution of a PLS playlist to mirrors on loopback servers that answer
+// after different delays, and the endpoint cache. The entries are tried in
+// turn until one plays: the first refuses the connection, the second never
+// answers and is given up, the third answers after a while and is cached. The
+// next start goes straight to the cached mirror, and once that is gone the
+// playlist is fetched again and resolved to the mirror after it.
+
+#include "dns.h"
+#include "endpoint_cache.h"
+#include "fifo.h"
+#include "icy_server.h"
+#include "stream_client.h"
+#include "test.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "lwip/api.h"
+#include "sysparam.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define MIRRORS 3
+// ms each mirror takes to answer, the first one longer than the stream
+// client waits for data
+static const unsigned int delays[MIRRORS] = {8000, 300, 100};
+// What the consumer takes out of the FIFO per tick, a frame of the decoder
+#define FRAME 417
+
+static const char *const dns_table[] = {"radio.test 127.0.0.1", NULL};
+
+static struct icy_server mirrors[MIRRORS], playlist_server;
+static char mirror_urls[MIRRORS][64];
+static char pls[512], playlist_url[64];
+
+// Only what the endpoint cache needs from the decoder: it has decoded a frame
+unsigned int decoder_frames(void) { return fifo_read_count() / FRAME; }
+
+static void audio(struct icy_server *server, uint64_t pos, uint8_t *data,
+                  size_t len) {
+  memset(data, 0, len);
+}
+
+static const char *page(struct icy_server *server, const char *path,
+                        const uint8_t **body, size_t *len) {
+  *body = (const uint8_t *)pls;
+  *len = strlen(pls);
+  return "audio/x-scpls";
+}
+
+// audio of a mirror arrived
+static volatile bool playing;
+
+static void on_up(const char *content_type) { playing = true; }
+
+static void on_metadata(enum stream_metadata type, const char *value) {}
+
+// Takes the audio out of the FIFO like the decoder
+static void consumer_task(void *arg) {
+  uint8_t frame[FRAME];
+  for (;;) {
+    vTaskDelay(1);
+    if (fifo_fill() >= sizeof(frame))
+      fifo_dequeue(frame, sizeof(frame));
+  }
+}
+
+// Waits up to ms for the condition, in steps of a tick
+#define WAIT(cond, ms)                                                         \
+  for (int i_ = 0; i_ < (ms) / portTICK_PERIOD_MS && !(cond); ++i_)            \
+  vTaskDelay(1)
+
+// Plays the playlist until the endpoint it resolved to is cached, returns
+// the ms until the first audio arrived
+static unsigned int play(const char *name, char *cached, size_t size) {
+  uint32_t date;
+  struct stream_stats stats;
+  stream_get_and_reset_stats(&stats);
+  playing = false;
+  CHECK_EQ(stream_start(playlist_url, on_up, on_metadata), 0);
+  WAIT(playing, 15000);
+  CHECK(playing);
+  WAIT(endpoint_lookup(playlist_url, cached, size, &date) == 0, 3000);
+  stream_get_and_reset_stats(&stats);
+  stream_stop();
+
+  printf("%-8s first audio after %5u ms, %u playlist requests, mirrors "
+         "connected %u %u %u times, cached %s\n",
+         name, stats.start_latency, playlist_server.requests,
+         mirrors[0].connections, mirrors[1].connections,
+         mirrors[2].connections, cached);
+  return stats.start_latency;
+}
+
+static void test_mirrors(void) {
+  char cached[64] = "";
+
+  // resolved to the first mirror that answers in time
+  unsigned int latency = play("resolve", cached, sizeof(cached));
+  CHECK_EQ(playlist_server.requests, 1);
+  CHECK_EQ(mirrors[0].connections, 1);
+  CHECK_EQ(mirrors[1].connections, 1);
+  CHECK_EQ(mirrors[2].connections, 0);
+  CHECK(strcmp(cached, mirror_urls[1]) == 0);
+  CHECK(latency >= delays[1] + 4000);
+
+  // the next start skips the playlist and the mirrors before
+  latency = play("cached", cached, sizeof(cached));
+  CHECK_EQ(playlist_server.requests, 1);
+  CHECK_EQ(mirrors[0].connections, 1);
+  CHECK_EQ(mirrors[1].connections, 2);
+  CHECK(latency >= delays[1] && latency < delays[1] + 500);
+
+  // a cached mirror that's gone is forgotten, the playlist is resolved again
+  // starting at it
+  icy_server_stop(&mirrors[1]);
+  latency = play("gone", cached, sizeof(cached));
+  CHECK_EQ(playlist_server.requests, 2);
+  CHECK_EQ(mirrors[0].connections, 1);
+  CHECK_EQ(mirrors[2].connections, 1);
+  CHECK(strcmp(cached, mirror_urls[2]) == 0);
+  CHECK(latency >= delays[2] && latency < delays[2] + 500);
+}
+
+int main(void) {
+  host_dns_table = dns_table;
+  host_sysparam_clear();
+  CHECK_EQ(fifo_init(), 0);
+  CHECK_EQ(dns_init(), 0);
+  CHECK_EQ(xTaskCreate(consumer_task, "consumer", 512, NULL, 2, NULL),
+           pdPASS);
+
+  // the first entry is a port nobody listens on
+  int len = snprintf(pls, sizeof(pls),
+                     "[playlist]\nNumberOfEntries=%d\n"
+                     "File1=http://radio.test:1/live\n",
+                     MIRRORS + 1);
+  for (int i = 0; i < MIRRORS; ++i) {
+    mirrors[i] = (struct icy_server){
+        .content_type = "audio/mpeg",
+        .bitrate = 128,
+        .audio = audio,
+        .delay = delays[i],
+    };
+    CHECK_EQ(icy_server_start(&mirrors[i]), 0);
+    snprintf(mirror_urls[i], sizeof(mirror_urls[i]),
+             "http://radio.test:%u/live", mirrors[i].port);
+    len += snprintf(pls + len, sizeof(pls) - len, "File%d=%s\n", i + 2,
+                    mirror_urls[i]);
+  }
+  playlist_server = (struct icy_server){.page = page};
+  CHECK_EQ(icy_server_start(&playlist_server), 0);
+  snprintf(playlist_url, sizeof(playlist_url),
+           "http://radio.test:%u/listen.pls", playlist_server.port);
+
+  test_mirrors();
+  icy_server_stop(&playlist_server);
+  icy_server_stop(&mirrors[0]);
+  icy_server_stop(&mirrors[2]);
+  return test_result("test_mirrors");
+}
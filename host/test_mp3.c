@@ -0,0 +1,186 @@
+// The MP3 decoder on the libmad model: a protected stream that uses the bit
+// reservoir, with damaged frames injected. A damaged frame is skipped and
+// concealed, and the frame after it is played from its own main data or as
+// silence, never from the main data the reservoir kept for the skipped one.
+
+#include "audio.h"
+#include "fifo.h"
+#include "mp3.h"
+#include "mpeg.h"
+#include "test.h"
+#include "wm8731.h"
+
+#include "i2s_dma/i2s_dma.h"
+
+#include <string.h>
+
+// MPEG-1 Layer III, 128 kbit/s, 44.1 kHz, stereo, with CRC
+#define FRAME_LENGTH 417
+#define SI_OFFSET 6
+#define SI_LENGTH 32
+#define PAYLOAD (FRAME_LENGTH - SI_OFFSET - SI_LENGTH)
+#define SAMPLES 1152
+// Frames decoded, and sent, so the decoder never waits for more
+#define FRAMES 48
+#define SENT (FRAMES + 8)
+#define CAPTURE_MAX ((FRAMES + 8) * SAMPLES)
+
+static uint8_t stream[SENT][FRAME_LENGTH];
+// main_data_begin of each frame
+static unsigned int data_begin[SENT];
+
+static uint32_t captured[CAPTURE_MAX];
+static volatile size_t capture_len;
+
+static void capture(const uint32_t *frames, size_t count) {
+  for (size_t i = 0; i < count && capture_len < CAPTURE_MAX; ++i) {
+    if (capture_len > 0 || frames[i] != 0)
+      captured[capture_len++] = frames[i];
+  }
+}
+
+static void put_bits(uint8_t *p, unsigned int *pos, unsigned int n,
+                     unsigned int value) {
+  while (n-- > 0) {
+    const unsigned int bit = (value >> n) & 1;
+    p[*pos >> 3] = (p[*pos >> 3] & ~(0x80 >> (*pos & 7))) |
+                   bit << (7 - (*pos & 7));
+    ++*pos;
+  }
+}
+
+static void set_crc(uint8_t *frame) {
+  uint16_t crc = mpeg_crc16(0xffff, frame + 2, 2);
+  crc = mpeg_crc16(crc, frame + SI_OFFSET, SI_LENGTH);
+  frame[4] = crc >> 8;
+  frame[5] = crc;
+}
+
+// Level of the samples of frame k
+static int level(int k) { return k + 1; }
+
+// Encodes the frames like an encoder with a bit reservoir: the main data of
+// frame k is main_length(k) bytes of its level, packed right behind that of
+// frame k - 1, as far back as main_data_begin reaches
+static void make_stream(void) {
+  memset(stream, 0, sizeof(stream));
+  unsigned int end = 0; // in the main data of all frames
+  for (int k = 0; k < SENT; ++k) {
+    unsigned int begin = end;
+    if (k * PAYLOAD > begin + 511)
+      begin = k * PAYLOAD - 511;
+    unsigned int length = k % 2 ? 450 : 300;
+    if (begin + length > (k + 1) * PAYLOAD)
+      length = (k + 1) * PAYLOAD - begin;
+    data_begin[k] = k * PAYLOAD - begin;
+    for (unsigned int i = begin; i < begin + length; ++i)
+      stream[i / PAYLOAD][SI_OFFSET + SI_LENGTH + i % PAYLOAD] = level(k);
+    end = begin + length;
+
+    uint8_t *frame = stream[k];
+    frame[0] = 0xff;
+    frame[1] = 0xfa;
+    frame[2] = 0x90;
+    frame[3] = 0x00;
+    unsigned int pos = 0;
+    uint8_t *si = frame + SI_OFFSET;
+    put_bits(si, &pos, 9, data_begin[k]);
+    put_bits(si, &pos, 3 + 8, 0); // private bits, scfsi
+    for (int gr = 0; gr < 2; ++gr) {
+      for (int ch = 0; ch < 2; ++ch) {
+        put_bits(si, &pos, 12, length * 2); // part2_3_length
+        put_bits(si, &pos, 59 - 12, 0);
+      }
+    }
+  }
+  for (int k = 0; k < SENT; ++k)
+    set_crc(stream[k]);
+}
+
+// Decodes the first FRAMES frames of the stream, each call of decode_frame()
+// plays one
+static void decode(void) {
+  fifo_enqueue(stream, sizeof(stream));
+  capture_len = 0;
+  get_and_reset_underrun_counter();
+  get_and_reset_bad_frame_counter();
+
+  CHECK_EQ(codec_mp3.open(), 0);
+  for (int k = 0; k < FRAMES; ++k)
+    CHECK_EQ(codec_mp3.decode_frame(), 0);
+  codec_mp3.close();
+  audio_drain();
+  CHECK_EQ(get_and_reset_underrun_counter(), 0);
+
+  // drops the frames left over
+  uint8_t rest[FRAME_LENGTH];
+  for (size_t n; (n = fifo_fill()) > 0;)
+    fifo_dequeue(rest, n < sizeof(rest) ? n : sizeof(rest));
+}
+
+// Level of the played frame k, -1 if its samples differ
+static int played(int k) {
+  const uint32_t first = captured[k * SAMPLES];
+  for (int i = 1; i < SAMPLES; ++i) {
+    if (captured[k * SAMPLES + i] != first)
+      return -1;
+  }
+  const int16_t left = first;
+  return first == (uint32_t)(uint16_t)left * 0x00010001 ? left >> 8 : -1;
+}
+
+static void test_intact(void) {
+  make_stream();
+  decode();
+  CHECK_EQ(get_and_reset_bad_frame_counter(), 0);
+  CHECK(capture_len >= FRAMES * SAMPLES);
+  bool clean = capture_len >= FRAMES * SAMPLES;
+  for (int k = 0; clean && k < FRAMES; ++k)
+    clean &= played(k) == level(k);
+  CHECK(clean);
+}
+
+static void test_damaged(void) {
+  static const int damaged[] = {9, 20, 33};
+  make_stream();
+  for (size_t i = 0; i < sizeof(damaged) / sizeof(damaged[0]); ++i) {
+    // the main data of the next frame starts in the damaged one
+    CHECK(data_begin[damaged[i] + 1] > 0);
+    stream[damaged[i]][5] ^= 0x10;
+  }
+  decode();
+  CHECK_EQ(get_and_reset_bad_frame_counter(), 3);
+
+  // every frame is played, a damaged one as a repeat of the previous frame,
+  // the next one as silence, as its main data starts in the damaged one
+  CHECK(capture_len >= FRAMES * SAMPLES);
+  if (capture_len < FRAMES * SAMPLES)
+    return;
+  int repeated = 0, muted = 0, garbled = 0;
+  for (int k = 0; k < FRAMES; ++k) {
+    const int l = played(k);
+    if (l == level(k))
+      continue;
+    if (l == level(k - 1))
+      ++repeated;
+    else if (l == 0)
+      ++muted;
+    else
+      ++garbled;
+  }
+  CHECK_EQ(garbled, 0);
+  CHECK_EQ(repeated, 3);
+  CHECK_EQ(muted, 3);
+}
+
+int main(void) {
+  CHECK_EQ(fifo_init(), 0);
+  CHECK_EQ(wm8731_init(), 0);
+  host_i2s_speed = 8;
+  host_i2s_sink = capture;
+  audio_init();
+
+  test_intact();
+  test_damaged();
+  return test_result("test_mp3");
+}
@@ -0,0 +1,166 @@
+// The frame checks of the MPEG audio module: the CRC-16 against a bitwise
+// implementation, corruption injected into protected frames and implausible
+// side information of unprotected ones.
+
+#include "mpeg.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// MPEG-1 Layer III, 128 kbit/s, 44.1 kHz, stereo, 417 bytes
+#define FRAME_LENGTH 417
+#define SI_OFFSET 6
+#define SI_LENGTH 32
+
+static uint8_t frame[FRAME_LENGTH];
+
+static uint16_t crc16_bitwise(uint16_t crc, const uint8_t *data, size_t len) {
+  while (len-- > 0) {
+    crc ^= *data++ << 8;
+    for (int i = 0; i < 8; ++i)
+      crc = crc & 0x8000 ? (crc << 1) ^ 0x8005 : crc << 1;
+  }
+  return crc;
+}
+
+static void put_bits(uint8_t *p, unsigned int *pos, unsigned int n,
+                     unsigned int value) {
+  while (n-- > 0) {
+    const unsigned int bit = (value >> n) & 1;
+    p[*pos >> 3] = (p[*pos >> 3] & ~(0x80 >> (*pos & 7))) |
+                   bit << (7 - (*pos & 7));
+    ++*pos;
+  }
+}
+
+// Side information of two granules of two channels with the given values in
+// every granule, long blocks
+static void make_side_info(uint8_t *si, unsigned int part2_3_length,
+                           unsigned int big_values, unsigned int table) {
+  unsigned int pos = 0;
+  memset(si, 0, SI_LENGTH);
+  put_bits(si, &pos, 9, 0);      // main_data_begin
+  put_bits(si, &pos, 3 + 8, 0); // private bits, scfsi
+  for (int gr = 0; gr < 2; ++gr) {
+    for (int ch = 0; ch < 2; ++ch) {
+      put_bits(si, &pos, 12, part2_3_length);
+      put_bits(si, &pos, 9, big_values);
+      put_bits(si, &pos, 8 + 4, 0); // global_gain, scalefac_compress
+      put_bits(si, &pos, 1, 0);     // window_switching_flag
+      for (int i = 0; i < 3; ++i)
+        put_bits(si, &pos, 5, table);
+      put_bits(si, &pos, 7 + 3, 0);
+    }
+  }
+}
+
+// Builds a frame, with a CRC if protected
+static void make_frame(bool protected) {
+  memset(frame, 0, sizeof(frame));
+  frame[0] = 0xff;
+  frame[1] = protected ? 0xfa : 0xfb;
+  frame[2] = 0x90;
+  frame[3] = 0x00;
+  uint8_t *si = frame + (protected ? SI_OFFSET : MPEG_HEADER_SIZE);
+  make_side_info(si, 700, 100, 1);
+  if (protected) {
+    uint16_t crc = mpeg_crc16(0xffff, frame + 2, 2);
+    crc = mpeg_crc16(crc, si, SI_LENGTH);
+    frame[4] = crc >> 8;
+    frame[5] = crc;
+  }
+}
+
+static int check(void) {
+  struct mpeg_header header;
+  if (mpeg_parse_header(frame, &header) != 0)
+    return -1;
+  return mpeg_check_frame(frame, sizeof(frame), &header);
+}
+
+static void test_crc(void) {
+  uint8_t data[256];
+  for (int i = 0; i < 256; ++i)
+    data[i] = i * 37 + 11;
+  bool match = true;
+  for (size_t len = 0; len <= sizeof(data); len += 7)
+    match &= mpeg_crc16(0xffff, data, len) == crc16_bitwise(0xffff, data, len);
+  CHECK(match);
+
+  make_frame(true);
+  struct mpeg_header header;
+  CHECK_EQ(mpeg_parse_header(frame, &header), 0);
+  CHECK(header.protection);
+  CHECK_EQ(header.frame_length, FRAME_LENGTH);
+  CHECK_EQ(check(), 0);
+}
+
+// Every single bit error in the protected bytes and the CRC is caught, and
+// all but about 2^-16 of random corruptions
+static void test_corruption(void) {
+  make_frame(true);
+  uint8_t intact[FRAME_LENGTH];
+  memcpy(intact, frame, sizeof(frame));
+
+  unsigned int missed = 0;
+  for (unsigned int bit = 2 * 8; bit < (SI_OFFSET + SI_LENGTH) * 8; ++bit) {
+    memcpy(frame, intact, sizeof(frame));
+    frame[bit / 8] ^= 0x80 >> (bit % 8);
+    // a flipped header bit may make it another valid header
+    missed += check() == 0;
+  }
+  CHECK_EQ(missed, 0);
+
+  srand(1);
+  missed = 0;
+  for (int i = 0; i < 100000; ++i) {
+    memcpy(frame, intact, sizeof(frame));
+    for (int n = 1 + rand() % 8; n > 0; --n)
+      frame[SI_OFFSET + rand() % SI_LENGTH] ^= 1 + rand() % 255;
+    missed += memcmp(frame, intact, sizeof(frame)) != 0 && check() == 0;
+  }
+  CHECK(missed < 10);
+  printf("mpeg: %u of 100000 random corruptions passed the CRC\n", missed);
+}
+
+// Side information libmad would reject after reading the main data
+static void test_side_info(void) {
+  make_frame(false);
+  CHECK_EQ(check(), 0);
+
+  uint8_t *si = frame + MPEG_HEADER_SIZE;
+  make_side_info(si, 700, 289, 1);
+  CHECK_EQ(check(), 1);
+  make_side_info(si, 700, 100, 4);
+  CHECK_EQ(check(), 1);
+  make_side_info(si, 700, 100, 14);
+  CHECK_EQ(check(), 1);
+  // four granules of 700 bits fit into the 381 bytes of main data, four of
+  // 1000 bits don't
+  make_side_info(si, 1000, 100, 1);
+  CHECK_EQ(check(), 1);
+
+  // window switching with the reserved block type 0
+  make_side_info(si, 700, 100, 1);
+  unsigned int pos = 9 + 3 + 8 + 12 + 9 + 8 + 4;
+  put_bits(si, &pos, 1, 1);
+  put_bits(si, &pos, 2, 0);
+  CHECK_EQ(check(), 1);
+  pos -= 2;
+  put_bits(si, &pos, 2, 2);
+  CHECK_EQ(check(), 0);
+
+  // too little data to tell is left to the decoder
+  struct mpeg_header header;
+  make_side_info(si, 700, 289, 1);
+  mpeg_parse_header(frame, &header);
+  CHECK_EQ(mpeg_check_frame(frame, MPEG_HEADER_SIZE + 8, &header), 0);
+}
+
+int main(void) {
+  test_crc();
+  test_corruption();
+  test_side_info();
+  return test_result("test_mpeg");
+}
@@ -0,0 +1,201 @@
+// The stream client over an impaired link to a loopback ICY server: a delay
+// before the reply, lost segments and bandwidth caps. A consumer drains the
+// FIFO at the bitrate of the stream like the decoder. The statistics of the
+// stream client have to show what the link did, and the receive buffer is
+// sized from the bitrate and the free space in the FIFO.
+
+#include "dns.h"
+#include "fifo.h"
+#include "icy_server.h"
+#include "stream_client.h"
+#include "test.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "lwip/api.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// 128 kbit/s
+#define BITRATE 128
+#define BYTE_RATE (BITRATE * 1000 / 8)
+// The consumer starts after a quarter of a second of audio
+#define PREBUFFER (BYTE_RATE / 4)
+#define DURATION 2000 // ms per scenario
+
+struct scenario {
+  const char *name;
+  unsigned int bitrate;
+  unsigned int delay, rate, loss, rto;
+};
+
+struct result {
+  struct stream_stats stats;
+  unsigned int byte_rate;
+  unsigned int underruns;
+  int recvbuf;
+  unsigned int lost;
+};
+
+static const char *const dns_table[] = {"radio.test 127.0.0.1", NULL};
+
+// The decoder isn't part of the test, so no endpoint is ever stored
+unsigned int decoder_frames(void) { return 0; }
+
+static void audio(struct icy_server *server, uint64_t pos, uint8_t *data,
+                  size_t len) {
+  memset(data, 0, len);
+}
+
+static void on_up(const char *content_type) {}
+
+static void on_metadata(enum stream_metadata type, const char *value) {}
+
+static volatile bool draining, counting;
+static volatile unsigned int underruns;
+
+// Takes the audio out of the FIFO at the byte rate of the stream, once the
+// prebuffer is filled. A tick without enough data is an underrun.
+static void consumer_task(void *arg) {
+  uint8_t data[BYTE_RATE / 100];
+  bool started = false;
+  for (;;) {
+    vTaskDelay(1);
+    if (!draining) {
+      started = false;
+      continue;
+    }
+    if (!started) {
+      started = fifo_fill() >= PREBUFFER;
+      continue;
+    }
+    if (fifo_fill() < sizeof(data)) {
+      underruns += counting;
+      continue;
+    }
+    fifo_dequeue(data, sizeof(data));
+  }
+}
+
+static void flush(void) {
+  uint8_t data[1024];
+  while (fifo_fill() > 0) {
+    const size_t n = fifo_fill() < sizeof(data) ? fifo_fill() : sizeof(data);
+    fifo_dequeue(data, n);
+  }
+}
+
+static void run(const struct scenario *scenario, struct result *result) {
+  struct icy_server server = {
+      .content_type = "audio/mpeg",
+      .bitrate = scenario->bitrate,
+      .audio = audio,
+      .delay = scenario->delay,
+      .rate = scenario->rate,
+      .loss = scenario->loss,
+      .rto = scenario->rto,
+  };
+  CHECK_EQ(icy_server_start(&server), 0);
+  char url[64];
+  snprintf(url, sizeof(url), "http://radio.test:%u/live", server.port);
+
+  struct stream_stats stats;
+  stream_get_and_reset_stats(&stats);
+  underruns = 0;
+  counting = true;
+  draining = true;
+  CHECK_EQ(stream_start(url, on_up, on_metadata), 0);
+  vTaskDelay(DURATION / portTICK_PERIOD_MS);
+
+  stream_get_and_reset_stats(&result->stats);
+  result->byte_rate =
+      (uint64_t)result->stats.received * 1000 / result->stats.interval;
+  result->underruns = underruns;
+  result->recvbuf = host_netconn_stats.recvbuf;
+  result->lost = server.lost;
+
+  // the consumer keeps going until the stream task can't be blocked anymore
+  counting = false;
+  stream_stop();
+  icy_server_stop(&server);
+  draining = false;
+  vTaskDelay(2);
+  flush();
+
+  printf("%-10s %6u B/s, jitter %5u us, longest gap %4u ms, stalled %4u ms, "
+         "%2u lost, recvbuf %5d, queued %5d, %3u underruns, start %3u ms\n",
+         scenario->name, result->byte_rate, result->stats.jitter,
+         result->stats.max_interval, result->stats.stall_time, result->lost,
+         result->recvbuf, result->stats.recvbuf_max, result->underruns,
+         result->stats.start_latency);
+}
+
+// Faster than the stream, the FIFO fills up and the receive buffer shrinks
+// to the minimum of two segments
+static void test_clean(void) {
+  const struct scenario scenario = {"clean", BITRATE};
+  struct result result;
+  run(&scenario, &result);
+  CHECK_EQ(result.underruns, 0);
+  CHECK(result.byte_rate > 2 * BYTE_RATE);
+  CHECK_EQ(result.recvbuf, 2 * TCP_MSS);
+  CHECK_EQ(result.stats.stall_time, 0);
+}
+
+// Twice the bitrate, the receive buffer holds half a second of the stream
+static void test_delay(void) {
+  const struct scenario scenario = {"delay", BITRATE, 300, 2 * BYTE_RATE};
+  struct result result;
+  run(&scenario, &result);
+  CHECK_EQ(result.underruns, 0);
+  CHECK(result.stats.start_latency >= 300 && result.stats.start_latency < 600);
+  CHECK_EQ(result.recvbuf, BYTE_RATE / 2);
+  CHECK(result.byte_rate > BYTE_RATE && result.byte_rate < 3 * BYTE_RATE);
+}
+
+// A high bitrate asks for more than the largest receive buffer
+static void test_high_bitrate(void) {
+  const struct scenario scenario = {"320k", 320, 0, 2 * BYTE_RATE};
+  struct result result;
+  run(&scenario, &result);
+  CHECK_EQ(result.recvbuf, 8 * TCP_MSS);
+}
+
+// Every lost segment stalls the stream for an RTO
+static void test_loss(void) {
+  const struct scenario scenario = {"loss", BITRATE, 0, 2 * BYTE_RATE, 50,
+                                    300};
+  struct result result;
+  run(&scenario, &result);
+  CHECK(result.lost > 0);
+  CHECK(result.stats.max_interval >= 300);
+  CHECK(result.stats.stall_time >= 300 * result.lost * 9 / 10);
+  CHECK(result.stats.jitter > 0);
+}
+
+// Below the bitrate the FIFO runs dry, at about the capped rate
+static void test_cap(void) {
+  const unsigned int rate = BYTE_RATE * 3 / 4;
+  const struct scenario scenario = {"capped", BITRATE, 0, rate};
+  struct result result;
+  run(&scenario, &result);
+  CHECK(result.underruns > 0);
+  CHECK(result.byte_rate > rate * 8 / 10 && result.byte_rate < rate * 12 / 10);
+}
+
+int main(void) {
+  host_dns_table = dns_table;
+  CHECK_EQ(fifo_init(), 0);
+  CHECK_EQ(dns_init(), 0);
+  CHECK_EQ(xTaskCreate(consumer_task, "consumer", 512, NULL, 2, NULL),
+           pdPASS);
+
+  test_clean();
+  test_delay();
+  test_high_bitrate();
+  test_loss();
+  test_cap();
+  return test_result("test_network");
+}
@@ -0,0 +1,122 @@
+// pcm_pack() against the plain conversion of libmad's reference player, and
+// the statistics of its dither.
+
+#include "pcm.h"
+#include "test.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#define COUNT 4096
+#define SCALE_BITS (MAD_F_FRACBITS + 1 - 16)
+
+// scale() of minimad.c: round, clip, quantize
+static int16_t reference(mad_fixed_t sample) {
+  sample += 1L << (MAD_F_FRACBITS - 16);
+  if (sample >= MAD_F_ONE)
+    sample = MAD_F_ONE - 1;
+  else if (sample < -MAD_F_ONE)
+    sample = -MAD_F_ONE;
+  return sample >> SCALE_BITS;
+}
+
+static mad_fixed_t left[COUNT], right[COUNT];
+static uint32_t out[COUNT];
+
+// Samples across the whole range, including overloads and the values around
+// the rounding thresholds
+static void fill(void) {
+  srand(1);
+  for (int i = 0; i < COUNT; ++i) {
+    switch (i % 4) {
+    case 0:
+      left[i] = (mad_fixed_t)(rand() % (4 * MAD_F_ONE)) - 2 * MAD_F_ONE;
+      break;
+    case 1:
+      left[i] = (rand() % 0x10000 - 0x8000) * (1L << SCALE_BITS) +
+                (1L << (SCALE_BITS - 1)) + rand() % 3 - 1;
+      break;
+    case 2:
+      left[i] = MAD_F_ONE - 2 + i % 3;
+      break;
+    default:
+      left[i] = -MAD_F_ONE - 1 + i % 3;
+      break;
+    }
+    right[i] = -left[i] + rand() % 5;
+  }
+}
+
+static int16_t out_left(int i) { return out[i]; }
+static int16_t out_right(int i) { return out[i] >> 16; }
+
+static void test_exact(void) {
+  struct pcm_state state = {.dither = PCM_DITHER_NONE, .gain = MAD_F_ONE};
+  pcm_pack(&state, out, left, right, COUNT);
+  bool exact = true;
+  for (int i = 0; i < COUNT; ++i)
+    exact &= out_left(i) == reference(left[i]) &&
+             out_right(i) == reference(right[i]);
+  CHECK(exact);
+
+  // single channel audio goes to both outputs
+  pcm_pack(&state, out, left, NULL, COUNT);
+  exact = true;
+  for (int i = 0; i < COUNT; ++i)
+    exact &= out_left(i) == reference(left[i]) &&
+             out_right(i) == reference(left[i]);
+  CHECK(exact);
+
+  // gain is applied before rounding
+  state.gain = MAD_F_ONE / 2;
+  pcm_pack(&state, out, left, right, COUNT);
+  exact = true;
+  for (int i = 0; i < COUNT; ++i)
+    exact &= out_left(i) == reference(mad_f_mul(left[i], state.gain)) &&
+             out_right(i) == reference(mad_f_mul(right[i], state.gain));
+  CHECK(exact);
+}
+
+// Silence with TPDF dither comes out as -1, 0 or +1 LSB with probabilities
+// of 1/8, 3/4 and 1/8
+static void test_tpdf(void) {
+  static const mad_fixed_t silence[COUNT];
+  struct pcm_state state = {.dither = PCM_DITHER_TPDF, .gain = MAD_F_ONE};
+  unsigned int counts[3] = {0};
+  bool in_range = true;
+  for (int block = 0; block < 64; ++block) {
+    pcm_pack(&state, out, silence, silence, COUNT);
+    for (int i = 0; i < COUNT; ++i) {
+      const int16_t l = out_left(i), r = out_right(i);
+      in_range &= l >= -1 && l <= 1 && r >= -1 && r <= 1;
+      if (l >= -1 && l <= 1)
+        ++counts[l + 1];
+    }
+  }
+  CHECK(in_range);
+  const unsigned int total = 64 * COUNT;
+  CHECK(counts[0] > total / 8 * 9 / 10 && counts[0] < total / 8 * 11 / 10);
+  CHECK(counts[2] > total / 8 * 9 / 10 && counts[2] < total / 8 * 11 / 10);
+  CHECK(counts[1] > total * 3 / 4 * 95 / 100);
+}
+
+// The dither follows the signal closely and doesn't wrap around at full scale
+static void test_dither_range(enum pcm_dither dither, int max_error) {
+  struct pcm_state state = {.dither = dither, .gain = MAD_F_ONE};
+  pcm_pack(&state, out, left, right, COUNT);
+  bool close = true;
+  for (int i = 0; i < COUNT; ++i) {
+    close &= abs(out_left(i) - reference(left[i])) <= max_error;
+    close &= abs(out_right(i) - reference(right[i])) <= max_error;
+  }
+  CHECK(close);
+}
+
+int main(void) {
+  fill();
+  test_exact();
+  test_tpdf();
+  test_dither_range(PCM_DITHER_TPDF, 1);
+  test_dither_range(PCM_DITHER_SHAPED, 4);
+  return test_result("test_pcm");
+}
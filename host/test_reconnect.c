@@ -0,0 +1,146 @@
+// Reconnects of the stream client to a loopback ICY server that drops the
+// connection after every DROP bytes, with the decoder, the fake codec and the
+// I2S output at twice real time. The stream moves on while the client is
+// away, so each new connection starts within a frame. The decoder has to keep
+// playing from the FIFO through every gap, and the statistics have to count
+// the reconnects, their gaps and the bytes dropped to resume at a frame.
+
+#include "audio.h"
+#include "decoder.h"
+#include "dns.h"
+#include "fake_codec.h"
+#include "fifo.h"
+#include "icy_server.h"
+#include "stream_client.h"
+#include "test.h"
+#include "wm8731.h"
+
+#include "i2s_dma/i2s_dma.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "lwip/api.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define LEVEL 64
+#define DROP (40 * 1024)
+// What the live stream moves on between connections, not a whole frame
+#define SKIP 1000
+#define SPEED 2
+#define DURATION 4000 // ms
+
+static const char *const dns_table[] = {"radio.test 127.0.0.1", NULL};
+
+static uint8_t frame[FAKE_FRAME_SIZE];
+
+static void audio(struct icy_server *server, uint64_t pos, uint8_t *data,
+                  size_t len) {
+  for (size_t i = 0; i < len; ++i)
+    data[i] = frame[(pos + i) % FAKE_FRAME_SIZE];
+}
+
+static const char *title(struct icy_server *server, uint64_t pos) {
+  return "A - Station";
+}
+
+// Samples played since the station was first heard, and those of them that
+// weren't at its level
+static volatile uint32_t played, dropouts;
+
+static void sink(const uint32_t *frames, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    const int16_t sample = frames[i];
+    if (played == 0 && sample != LEVEL * 256)
+      continue;
+    ++played;
+    dropouts += sample != LEVEL * 256;
+  }
+}
+
+static void on_up(const char *content_type) {
+  CHECK_EQ(xTaskCreate(decoder_task, "decode", 2100, "audio/mpeg", 4, NULL),
+           pdPASS);
+}
+
+static void on_metadata(enum stream_metadata type, const char *value) {}
+
+// Bytes of the first reconnects the client has to drop until a frame starts
+static unsigned int resync_bytes(unsigned int reconnects) {
+  unsigned int bytes = 0;
+  for (unsigned int i = 1; i <= reconnects; ++i) {
+    const uint64_t pos = (uint64_t)i * (DROP + SKIP);
+    bytes += (FAKE_FRAME_SIZE - pos % FAKE_FRAME_SIZE) % FAKE_FRAME_SIZE;
+  }
+  return bytes;
+}
+
+static void test_reconnect(void) {
+  struct icy_server server = {
+      .content_type = "audio/mpeg",
+      .metaint = 16000,
+      .bitrate = 128,
+      .length = DROP,
+      .skip = SKIP,
+      .audio = audio,
+      .title = title,
+  };
+  fake_codec_frame(frame, LEVEL);
+  CHECK_EQ(icy_server_start(&server), 0);
+  char url[64];
+  snprintf(url, sizeof(url), "http://radio.test:%u/live", server.port);
+
+  struct stream_stats stats;
+  stream_get_and_reset_stats(&stats);
+  CHECK_EQ(stream_start(url, on_up, on_metadata), 0);
+  for (int i = 0; i < 2000 && played == 0; ++i)
+    vTaskDelay(1);
+  CHECK(played > 0);
+  get_and_reset_underrun_counter();
+
+  // the lowest fill of the FIFO seen while the decoder plays
+  size_t min_fill = SIZE_MAX;
+  for (int i = 0; i < DURATION / portTICK_PERIOD_MS; ++i) {
+    vTaskDelay(1);
+    const size_t fill = fifo_fill();
+    if (fill < min_fill)
+      min_fill = fill;
+  }
+  const unsigned int underruns = get_and_reset_underrun_counter();
+  stream_get_and_reset_stats(&stats);
+  const unsigned int connections = server.connections;
+  stream_stop();
+  icy_server_stop(&server);
+
+  printf("reconnect: %u connections, %u reconnects, gap %u ms, resync %u "
+         "bytes, lowest FIFO fill %zu, %u underruns, %u dropouts\n",
+         connections, stats.reconnects, stats.gap_time, stats.resync_bytes,
+         min_fill, underruns, dropouts);
+  CHECK(stats.reconnects >= 4);
+  // counted when the connection is lost, before the next one is made
+  CHECK(stats.reconnects + 1 == connections ||
+        stats.reconnects == connections);
+  // the first delay is between a half and a whole BACKOFF_MIN
+  CHECK(stats.gap_time >= 250 * (stats.reconnects - 1));
+  CHECK(stats.gap_time < 1000 * stats.reconnects);
+  // the last reconnect may not have reached the audio yet
+  CHECK(stats.resync_bytes == resync_bytes(stats.reconnects) ||
+        stats.resync_bytes == resync_bytes(stats.reconnects - 1));
+  CHECK(min_fill > 0);
+  CHECK_EQ(underruns, 0);
+  CHECK_EQ(dropouts, 0);
+}
+
+int main(void) {
+  host_dns_table = dns_table;
+  CHECK_EQ(fifo_init(), 0);
+  CHECK_EQ(wm8731_init(), 0);
+  CHECK_EQ(dns_init(), 0);
+  host_i2s_speed = SPEED;
+  host_i2s_sink = sink;
+
+  test_reconnect();
+  return test_result("test_reconnect");
+}
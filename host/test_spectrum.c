@@ -0,0 +1,53 @@
+// The levels of the spectrum are copied whole while the decoder keeps
+// publishing them, and the copy gives up instead of spinning.
+
+#include "spectrum.h"
+#include "test.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <stdbool.h>
+
+#define READS 200000
+
+static volatile bool done;
+
+// Publishes levels that are either all 0 or all the same higher level
+static void writer(void *arg) {
+  uint32_t sums[SPECTRUM_SUBBANDS];
+  for (int i = 0; i < SPECTRUM_SUBBANDS; ++i)
+    sums[i] = 1 << 16;
+  while (!done) {
+    spectrum_update(sums, 1);
+    spectrum_clear();
+  }
+  vTaskDelete(NULL);
+}
+
+static void test_consistent(void) {
+  uint8_t levels[SPECTRUM_BANDS];
+  spectrum_clear();
+  CHECK(spectrum_get(levels));
+  for (int band = 0; band < SPECTRUM_BANDS; ++band)
+    CHECK_EQ(levels[band], 0);
+
+  xTaskCreate(writer, "writer", 256, NULL, 4, NULL);
+  unsigned int copies = 0, torn = 0;
+  for (int i = 0; i < READS; ++i) {
+    if (!spectrum_get(levels))
+      continue;
+    ++copies;
+    for (int band = 1; band < SPECTRUM_BANDS; ++band)
+      torn += levels[band] != levels[0];
+  }
+  done = true;
+  CHECK(copies > 0);
+  CHECK_EQ(torn, 0);
+  printf("spectrum: %u of %u copies succeeded\n", copies, READS);
+}
+
+int main(void) {
+  test_consistent();
+  return test_result("test_spectrum");
+}
@@ -0,0 +1,159 @@
+// The stream client against an ICY server on the loopback interface: the
+// audio reaches the FIFO intact, the titles arrive with the audio they belong
+// to, and what the ingest of a MB costs in netbufs, socket calls, copies and
+// CPU time.
+
+#include "dns.h"
+#include "fifo.h"
+#include "icy_server.h"
+#include "stream_client.h"
+#include "test.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "lwip/api.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define METAINT 16000
+// The title changes every this many metadata blocks
+#define TITLE_BLOCKS 8
+#define TOTAL (4 << 20)
+#define CHUNK 4096
+
+static const char *const dns_table[] = {"radio.test 127.0.0.1", NULL};
+
+// The decoder isn't part of the test, so no endpoint is ever stored
+unsigned int decoder_frames(void) { return 0; }
+
+static uint8_t pattern(uint64_t pos) { return pos % 251; }
+
+static void audio(struct icy_server *server, uint64_t pos, uint8_t *data,
+                  size_t len) {
+  for (size_t i = 0; i < len; ++i)
+    data[i] = pattern(pos + i);
+}
+
+static unsigned int song(uint64_t pos) {
+  return (pos / METAINT - 1) / TITLE_BLOCKS;
+}
+
+static const char *title(struct icy_server *server, uint64_t pos) {
+  static char text[32];
+  snprintf(text, sizeof(text), "Artist - Song %u", song(pos));
+  return text;
+}
+
+static unsigned int titles;
+static bool titles_match = true;
+
+static void on_up(const char *content_type) {
+  CHECK(content_type != NULL && strcmp(content_type, "audio/mpeg") == 0);
+}
+
+// Each title is delivered once the consumer read up to the block that
+// carried it first, within a read of that
+static void on_metadata(enum stream_metadata type, const char *value) {
+  const uint32_t pos = (uint32_t)((TITLE_BLOCKS * titles + 1) * METAINT);
+  const uint32_t read = fifo_read_count();
+  if (type == STREAM_ARTIST) {
+    titles_match &= strcmp(value, "Artist") == 0;
+    return;
+  }
+  char expected[32];
+  snprintf(expected, sizeof(expected), "Song %u", titles++);
+  titles_match &= strcmp(value, expected) == 0 && read >= pos &&
+                  read - pos < CHUNK;
+}
+
+static volatile bool done;
+static bool audio_match = true;
+// taken once the consumer read TOTAL bytes
+static uint64_t start_ns, process_ns, consumer_ns;
+static struct netconn_stats net;
+static struct stream_stats stats;
+static uint32_t copied;
+
+static uint64_t cpu_ns(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Plays the part of the decoder. It checks the first TOTAL bytes, then keeps
+// draining the FIFO, so the stream task never blocks on it.
+static void consumer_task(void *arg) {
+  const uint64_t start = cpu_ns(CLOCK_THREAD_CPUTIME_ID);
+  uint8_t data[CHUNK];
+  for (uint32_t pos = 0; pos < TOTAL; pos += sizeof(data)) {
+    fifo_dequeue(data, sizeof(data));
+    for (size_t i = 0; i < sizeof(data); ++i)
+      audio_match &= data[i] == pattern(pos + i);
+    stream_poll_metadata();
+  }
+  process_ns = cpu_ns(CLOCK_PROCESS_CPUTIME_ID) - start_ns;
+  consumer_ns = cpu_ns(CLOCK_THREAD_CPUTIME_ID) - start;
+  net = host_netconn_stats;
+  copied = fifo_write_count();
+  stream_get_and_reset_stats(&stats);
+  done = true;
+
+  for (;;)
+    fifo_dequeue(data, sizeof(data));
+}
+
+static void test_ingest(void) {
+  struct icy_server server = {
+      .content_type = "audio/mpeg",
+      .metaint = METAINT,
+      .bitrate = 128,
+      .audio = audio,
+      .title = title,
+  };
+  CHECK_EQ(icy_server_start(&server), 0);
+  char url[64];
+  snprintf(url, sizeof(url), "http://radio.test:%u/live", server.port);
+
+  stream_get_and_reset_stats(&stats);
+  memset(&host_netconn_stats, 0, sizeof(host_netconn_stats));
+  start_ns = cpu_ns(CLOCK_PROCESS_CPUTIME_ID);
+  CHECK_EQ(stream_start(url, on_up, on_metadata), 0);
+  CHECK_EQ(xTaskCreate(consumer_task, "consumer", 512, NULL, 2, NULL),
+           pdPASS);
+  for (int i = 0; i < 3000 && !done; ++i)
+    vTaskDelay(10);
+  CHECK(done);
+  const uint64_t server_ns = server.cpu_ns;
+  icy_server_stop(&server);
+  stream_stop();
+
+  CHECK(audio_match);
+  CHECK(titles_match);
+  CHECK_EQ(titles, song(TOTAL / METAINT * METAINT) + 1);
+  CHECK_EQ(server.connections, 1);
+  CHECK_EQ(stats.reconnects, 0);
+  // the audio is copied once, from the netbufs into the FIFO
+  CHECK(copied <= stats.received);
+  CHECK(stats.buffers <= net.recvs);
+  // the old path read 64 bytes at a time
+  CHECK(stats.received / stats.buffers >= 1024);
+
+  // the stream task is what's left of the process's time
+  const double mb = stats.received / (double)(1 << 20);
+  const uint64_t stream_ns = process_ns - consumer_ns - server_ns;
+  printf("stream: %.1f MB, per MB: %.0f netbufs, %.0f spans, %.0f socket "
+         "calls, %.2f copies, %.2f ms CPU\n",
+         mb, stats.buffers / mb, stats.spans / mb, net.syscalls / mb,
+         copied / (double)stats.received, stream_ns / 1e6 / mb);
+}
+
+int main(void) {
+  host_dns_table = dns_table;
+  CHECK_EQ(fifo_init(), 0);
+  CHECK_EQ(dns_init(), 0);
+  test_ingest();
+  return test_result("test_stream");
+}
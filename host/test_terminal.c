@@ -0,0 +1,227 @@
+// The log ring of the terminal on the display model. Output of a task and of
+// an interrupt handler has to come out on the UART whole and in order, and
+// output that doesn't fit while the display is busy has to be dropped whole
+// and counted. A printf() of the decode task is timed through the ring, and
+// as it was before, drawn to the display in the calling task.
+
+#include "lcd_font.h"
+#include "mi0283qt.h"
+#include "terminal.h"
+#include "test.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "esp/uart.h"
+#include "espressif/esp_common.h"
+#include "stdout_redirect.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// Of src/terminal.c
+#define LOG_SIZE 2048
+#define Y_START (LCD_HEIGHT * 3 / 4)
+// Lines each writer writes, and at once before it sleeps for a tick
+#define LINES 200
+#define BURST 8
+// Messages written while the display is busy, each a line of MESSAGE bytes
+#define MESSAGES 100
+#define MESSAGE 32
+#define TIMED 50
+
+// What the render task wrote to the UART
+static char uart[16 * 1024];
+static volatile size_t uart_len;
+
+static void uart_sink(char c) {
+  if (c != '\r' && uart_len < sizeof(uart))
+    uart[uart_len++] = c;
+}
+
+// Waits up to ms for the condition, in steps of a tick
+#define WAIT(cond, ms)                                                         \
+  for (int i_ = 0; i_ < (ms) / portTICK_PERIOD_MS && !(cond); ++i_)            \
+  vTaskDelay(1)
+
+// printf() to the stdout hook, which glibc can't call
+static void term_printf(const char *format, ...) {
+  char line[64];
+  va_list ap;
+  va_start(ap, format);
+  const int n = vsnprintf(line, sizeof(line), format, ap);
+  va_end(ap);
+  host_stdout_write(line, n);
+}
+
+static volatile int writers_done;
+
+static void writer_task(void *arg) {
+  for (int i = 0; i < LINES; ++i) {
+    term_printf("task %03d\n", i);
+    if (i % BURST == BURST - 1)
+      vTaskDelay(1);
+  }
+  ++writers_done;
+  vTaskDelete(NULL);
+}
+
+// An interrupt handler on a thread of its own, like those of the stand-ins
+static void isr_task(void *arg) {
+  char line[16];
+  for (int i = 0; i < LINES; ++i) {
+    const int n = snprintf(line, sizeof(line), "isr %03d\n", i);
+    term_write_from_isr(line, n);
+    if (i % BURST == BURST - 1)
+      vTaskDelay(1);
+  }
+  ++writers_done;
+  vTaskDelete(NULL);
+}
+
+// Splits the UART output into lines, returns their number
+static int uart_lines(char **lines, int max) {
+  static char copy[sizeof(uart) + 1];
+  memcpy(copy, uart, uart_len);
+  copy[uart_len] = '\0';
+  int count = 0;
+  for (char *save, *line = strtok_r(copy, "\n", &save);
+       line != NULL && count < max; line = strtok_r(NULL, "\n", &save))
+    lines[count++] = line;
+  return count;
+}
+
+static void test_order(void) {
+  uart_len = 0;
+  CHECK_EQ(xTaskCreate(writer_task, "writer", 512, NULL, 4, NULL), pdPASS);
+  CHECK_EQ(xTaskCreate(isr_task, "isr", 512, NULL, 5, NULL), pdPASS);
+  WAIT(writers_done == 2 && uart_len == LINES * strlen("task 000\nisr 000\n"),
+       5000);
+
+  // the lines of each writer in order, none torn or dropped
+  static char *lines[2 * LINES + 1];
+  const int count = uart_lines(lines, 2 * LINES + 1);
+  int task_next = 0, isr_next = 0, other = 0;
+  for (int i = 0; i < count; ++i) {
+    int n;
+    char end;
+    if (sscanf(lines[i], "task %d%c", &n, &end) == 1 && n == task_next)
+      ++task_next;
+    else if (sscanf(lines[i], "isr %d%c", &n, &end) == 1 && n == isr_next)
+      ++isr_next;
+    else
+      ++other;
+  }
+  printf("order: %d lines of the task, %d of the handler, %d others\n",
+         task_next, isr_next, other);
+  CHECK_EQ(task_next, LINES);
+  CHECK_EQ(isr_next, LINES);
+  CHECK_EQ(other, 0);
+}
+
+// While the display is held by someone else, the render task can't move the
+// tail of the ring past what it took, so exactly a ring full of the messages
+// fits and the rest is dropped
+static void test_overflow(void) {
+  uart_len = 0;
+  lcd_lock();
+  for (int i = 0; i < MESSAGES; ++i)
+    term_printf("message %02d %*s\n", i, MESSAGE - 12, "-");
+  lcd_unlock();
+
+  const int kept = LOG_SIZE / MESSAGE;
+  const int dropped = MESSAGES - kept;
+  char note[32];
+  snprintf(note, sizeof(note), "[%d dropped]", dropped);
+  WAIT(memmem(uart, uart_len, note, strlen(note)) != NULL, 2000);
+
+  static char *lines[MESSAGES + 2];
+  const int count = uart_lines(lines, MESSAGES + 2);
+  printf("overflow: %d of %d messages kept, then %s\n",
+         count > 0 ? count - 1 : 0, MESSAGES,
+         count > 0 ? lines[count - 1] : "nothing");
+  CHECK_EQ(count, kept + 1);
+  bool ordered = count == kept + 1;
+  for (int i = 0; ordered && i < kept; ++i) {
+    int n;
+    ordered = sscanf(lines[i], "message %d", &n) == 1 && n == i &&
+              strlen(lines[i]) == MESSAGE - 1;
+  }
+  CHECK(ordered);
+  CHECK(count > 0 && strcmp(lines[count - 1], note) == 0);
+  // counted once, the render task reported and reset it
+  CHECK_EQ(term_get_and_reset_dropped(), 0);
+}
+
+// A decoding error as mp3.c prints it
+#define ERROR_FORMAT "decoding error: %s (0x%04x)\n"
+#define ERROR_TEXT "bad main_data_begin pointer"
+
+static volatile uint32_t max_printf; // us
+
+static void decode_task(void *arg) {
+  for (int i = 0; i < TIMED; ++i) {
+    const uint32_t start = sdk_system_get_time();
+    term_printf(ERROR_FORMAT, ERROR_TEXT, 0x0235);
+    const uint32_t time = sdk_system_get_time() - start;
+    if (time > max_printf)
+      max_printf = time;
+    vTaskDelay(2);
+  }
+  ++writers_done;
+  vTaskDelete(NULL);
+}
+
+// The printf() as the decode task sees it, through the ring and drawn in the
+// task like before the ring: the line and the rest of it cleared, the time
+// the host takes plus what the bus needs at the clock of the display
+static void test_printf_time(void) {
+  writers_done = 0;
+  max_printf = 0;
+  term_get_and_reset_max_write_time();
+  CHECK_EQ(xTaskCreate(decode_task, "decode", 512, NULL, 4, NULL), pdPASS);
+  WAIT(writers_done == 1, 5000);
+  CHECK_EQ(writers_done, 1);
+  const uint32_t max_write = term_get_and_reset_max_write_time();
+  // until the render task has drawn the output
+  vTaskDelay(100 / portTICK_PERIOD_MS);
+
+  char line[64];
+  const int n = snprintf(line, sizeof(line), ERROR_FORMAT, ERROR_TEXT, 0x0235);
+  struct lcd_stats stats;
+  uint32_t before = 0;
+  for (int i = 0; i < TIMED; ++i) {
+    lcd_get_and_reset_stats(&stats);
+    const uint32_t start = sdk_system_get_time();
+    lcd_lock();
+    const int x = lcd_stringn(0, Y_START, line, n - 1);
+    lcd_rect(RGB(0, 0, 0), x, Y_START, LCD_WIDTH - 1,
+             Y_START + FONT_HEIGHT + FONT_MARGIN - 1);
+    lcd_unlock();
+    const uint32_t time = sdk_system_get_time() - start;
+    lcd_get_and_reset_stats(&stats);
+    if (time + stats.bus_time > before)
+      before = time + stats.bus_time;
+  }
+
+  printf("printf of the decode task: %u us through the ring (write hook %u "
+         "us), %u us drawn in the task\n",
+         max_printf, max_write, before);
+  CHECK(max_write <= max_printf);
+  // the formatting takes as long as before, scheduling on the host adds to it
+  CHECK(max_printf < before);
+  CHECK(max_write * 10 < before);
+}
+
+int main(void) {
+  CHECK_EQ(lcd_init(), 0);
+  host_uart_sink = uart_sink;
+  term_init();
+
+  test_order();
+  test_overflow();
+  test_printf_time();
+  host_uart_sink = NULL;
+  return test_result("test_terminal");
+}
@@ -0,0 +1,307 @@
+// The widgets of the player screen on the display model: what they draw, and
+// what an update costs on the SPI bus while the playback moves the buffer
+// bar, the meters and the spectrum, or the marquee scrolls a long title.
+
+#include "mi0283qt.h"
+#include "mi0283qt_model.h"
+#include "test.h"
+#include "ui.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// As in main.c, about 3 ms of SPI transfers
+#define BUDGET 8192
+#define BANDS 16
+#define UPDATES 300
+
+// The layout of main.c
+static struct ui_widget station_label, artist_label, title_marquee;
+static char title[64];
+static struct ui_widget buffer_label, buffer_bar;
+static struct ui_widget left_label, left_meter, right_label, right_meter;
+static struct ui_widget station_list;
+static struct ui_widget spectrum_bars;
+
+static const char *const stations[] = {
+    "Radio Eins", "Deutschlandfunk", "FluxFM", "Bayern 3", "Ö1", "SWR3",
+};
+#define STATIONS (sizeof(stations) / sizeof(stations[0]))
+
+static const char *station_name(size_t index) { return stations[index]; }
+
+// RGB() takes 6 bit values, the panel keeps 5 bits of red and blue
+static uint16_t rgb565(uint16_t r, uint16_t g, uint16_t b) {
+  return (r >> 1) << 11 | g << 5 | b >> 1;
+}
+
+static bool area_is(int x0, int y0, int x1, int y1, uint16_t color) {
+  for (int y = y0; y <= y1; ++y) {
+    for (int x = x0; x <= x1; ++x) {
+      if (lcd_model_pixel(x, y) != color)
+        return false;
+    }
+  }
+  return true;
+}
+
+static void setup(void) {
+  const uint16_t white = RGB(63, 63, 63), black = RGB(0, 0, 0);
+  const uint16_t grey = RGB(24, 24, 24), green = RGB(0, 48, 0);
+  const uint16_t red = RGB(63, 0, 0);
+
+  ui_label_init(&station_label, 4, 2, 232, white, black);
+  ui_label_scale(&station_label, 2);
+  ui_label_init(&artist_label, 4, 26, 232, white, black);
+  ui_marquee_init(&title_marquee, 4, 38, 232, title, sizeof(title), white,
+                  black);
+  ui_label_init(&buffer_label, 4, 52, 42, white, black);
+  ui_bar_init(&buffer_bar, 48, 52, 188, 7, white, grey);
+  ui_label_init(&left_label, 4, 66, 42, white, black);
+  ui_meter_init(&left_meter, 48, 66, 188, 7, green, red, grey);
+  ui_label_init(&right_label, 4, 78, 42, white, black);
+  ui_meter_init(&right_meter, 48, 78, 188, 7, green, red, grey);
+  ui_list_init(&station_list, 4, 100, 232, station_name, STATIONS, white,
+               black);
+  ui_spectrum_init(&spectrum_bars, 4, 196, 232, 40, BANDS, green, black);
+
+  struct ui_widget *const widgets[] = {
+      &station_label, &artist_label, &title_marquee, &buffer_label,
+      &buffer_bar,    &left_label,   &left_meter,    &right_label,
+      &right_meter,   &station_list,  &spectrum_bars,
+  };
+  for (size_t i = 0; i < sizeof(widgets) / sizeof(widgets[0]); ++i)
+    CHECK_EQ(ui_add(widgets[i]), 0);
+
+  ui_label_set(&station_label, stations[0]);
+  ui_label_set(&buffer_label, "Buffer");
+  ui_label_set(&left_label, "L");
+  ui_label_set(&right_label, "R");
+  ui_marquee_set(&title_marquee, "Title");
+}
+
+struct cost {
+  unsigned int pixels; // as ui_update() counted them
+  struct lcd_model_stats model;
+  struct lcd_stats driver;
+};
+
+static struct cost update(void) {
+  struct cost cost;
+  lcd_model_get_and_reset_stats(&cost.model);
+  lcd_get_and_reset_stats(&cost.driver);
+  cost.pixels = ui_update(BUDGET);
+  lcd_model_get_and_reset_stats(&cost.model);
+  lcd_get_and_reset_stats(&cost.driver);
+  // the budget has to account for every pixel that went out
+  CHECK_EQ(cost.pixels, cost.model.pixels);
+  CHECK_EQ(cost.model.clipped, 0);
+  return cost;
+}
+
+// The first updates draw the whole screen, in slices of about the budget
+static void test_first(void) {
+  // the largest widget may start just below the budget
+  const unsigned int largest = 232 * STATIONS * UI_LINE_HEIGHT;
+  uint64_t bytes = 0;
+  int updates = 0;
+  for (struct cost cost = update(); cost.pixels > 0; cost = update()) {
+    CHECK(cost.pixels < BUDGET + largest);
+    bytes += cost.driver.data_bytes;
+    ++updates;
+  }
+  printf("first screen: %d updates, %llu SPI bytes\n", updates,
+         (unsigned long long)bytes);
+  CHECK(updates > 1);
+
+  // nothing changed, nothing is sent
+  const struct cost idle = update();
+  CHECK_EQ(idle.driver.transactions, 0);
+
+  const uint16_t white = rgb565(63, 63, 63), grey = rgb565(24, 24, 24);
+  CHECK(area_is(48, 52, 235, 58, grey));
+  // the selected station is inverted
+  CHECK_EQ(lcd_model_pixel(235, 100), white);
+  CHECK_EQ(lcd_model_pixel(235, 100 + UI_LINE_HEIGHT), 0);
+  CHECK(area_is(4, 196, 4 + BANDS * 14 - 1, 235, 0));
+}
+
+// Each change draws just what it touched
+static void test_changes(void) {
+  const uint16_t white = rgb565(63, 63, 63), grey = rgb565(24, 24, 24);
+  const uint16_t green = rgb565(0, 48, 0), red = rgb565(63, 0, 0);
+
+  // a fifth of the buffer: 37 columns
+  ui_bar_set(&buffer_bar, 20, 100);
+  struct cost cost = update();
+  CHECK_EQ(cost.pixels, 37 * 7);
+  CHECK(area_is(48, 52, 48 + 36, 58, white));
+  CHECK(area_is(48 + 37, 52, 235, 58, grey));
+  printf("buffer bar +37 columns: %u pixels, %u SPI bytes\n", cost.pixels,
+         cost.driver.data_bytes);
+
+  // a column more
+  ui_bar_set(&buffer_bar, 38, 188);
+  cost = update();
+  CHECK_EQ(cost.pixels, 7);
+
+  // the meter turns red above 3/4
+  ui_bar_set(&left_meter, 9, 10);
+  cost = update();
+  CHECK_EQ(cost.pixels, 169 * 7);
+  CHECK_EQ(lcd_model_pixel(48 + 140, 66), green);
+  CHECK_EQ(lcd_model_pixel(48 + 141, 66), red);
+  CHECK_EQ(lcd_model_pixel(48 + 169, 66), grey);
+
+  // two rows of the list
+  ui_list_select(&station_list, 3);
+  cost = update();
+  CHECK_EQ(cost.pixels, 232 * 4 * UI_LINE_HEIGHT);
+  CHECK_EQ(lcd_model_pixel(235, 100), 0);
+  CHECK_EQ(lcd_model_pixel(235, 100 + 3 * UI_LINE_HEIGHT), white);
+  printf("station list selection: %u pixels, %u SPI bytes\n", cost.pixels,
+         cost.driver.data_bytes);
+
+  // a label, the same text again costs nothing
+  ui_label_set(&artist_label, "Artist");
+  cost = update();
+  CHECK_EQ(cost.pixels, 232 * UI_LINE_HEIGHT);
+  ui_label_set(&artist_label, "Artist");
+  cost = update();
+  CHECK_EQ(cost.pixels, 0);
+}
+
+// Playback at 10 updates per second: the buffer level wanders, the meters
+// and the spectrum follow the music
+static void test_playback(void) {
+  srand(1);
+  int fill = 50, left = 0, right = 0;
+  uint8_t levels[BANDS] = {0};
+  uint64_t bytes = 0, pixels = 0;
+  uint32_t max_bytes = 0, max_bus = 0;
+
+  for (int i = 0; i < UPDATES; ++i) {
+    fill = fill + rand() % 3 - 1;
+    fill = fill < 0 ? 0 : fill > 100 ? 100 : fill;
+    left = abs(left * 3 / 4 + rand() % 8192 - 4096);
+    right = abs(right * 3 / 4 + rand() % 8192 - 4096);
+    for (int band = 0; band < BANDS; ++band) {
+      const int level = levels[band] + rand() % 9 - 4;
+      levels[band] = level < 0 ? 0 : level > 32 ? 32 : level;
+    }
+    ui_bar_set(&buffer_bar, fill, 100);
+    ui_bar_set(&left_meter, left, INT16_MAX);
+    ui_bar_set(&right_meter, right, INT16_MAX);
+    ui_spectrum_set(&spectrum_bars, levels, 32);
+
+    const struct cost cost = update();
+    CHECK(cost.pixels < BUDGET + 232 * 40);
+    bytes += cost.driver.data_bytes;
+    pixels += cost.pixels;
+    if (cost.driver.data_bytes > max_bytes)
+      max_bytes = cost.driver.data_bytes;
+    if (cost.driver.bus_time > max_bus)
+      max_bus = cost.driver.bus_time;
+  }
+
+  const uint32_t screen = LCD_WIDTH * LCD_HEIGHT * 2;
+  printf("playback: %llu pixels, %llu SPI bytes per update on average, "
+         "%u bytes and %u us at most, the whole screen is %u bytes\n",
+         (unsigned long long)(pixels / UPDATES),
+         (unsigned long long)(bytes / UPDATES), max_bytes, max_bus, screen);
+  CHECK(bytes / UPDATES < screen / 20);
+  // a budget of 8192 pixels is about 3 ms at 40 MHz
+  CHECK(max_bus < 5000);
+}
+
+// Length of the first line of text in width pixels, broken after the last
+// space that fits like the marquee does
+static size_t first_line(const char *text, int width) {
+  const size_t fit = font_fit(&font_latin1, text, strlen(text), width, 1);
+  size_t len = fit;
+  while (text[fit] != '\0' && len > 0 && text[len] != ' ')
+    --len;
+  return len > 0 ? len : fit;
+}
+
+// Draws a line of a marquee as reference outside of the scroll area
+static void reference(int y, const char *line, size_t n) {
+  const uint16_t white = RGB(63, 63, 63), black = RGB(0, 0, 0);
+  const int end = lcd_text(&font_latin1, 1, 4, y, line, n, white, black);
+  lcd_rect(black, end, y, 235, y + UI_LINE_HEIGHT - 1);
+}
+
+// The band of the marquee after step rows of the line from next_y scrolled
+// in below the one from y
+static bool band_matches(int step, int y, int next_y) {
+  for (int row = 0; row < UI_LINE_HEIGHT; ++row) {
+    const int from = row < UI_LINE_HEIGHT - step
+                         ? y + row + step
+                         : next_y + row - (UI_LINE_HEIGHT - step);
+    for (int x = 4; x < 236; ++x) {
+      if (lcd_model_pixel(x, 38 + row) != lcd_model_pixel(x, from))
+        return false;
+    }
+  }
+  return true;
+}
+
+// A long title is drawn once, then each update scrolls the band by a row and
+// sends just that row
+static void test_marquee(void) {
+  const char *text =
+      "Die \xc3\x84rzte - Schrei nach Liebe (Live im Stadion, 1998)";
+  const size_t len1 = first_line(text, 232);
+  const char *line2 = text + len1 + 1;
+  CHECK(len1 < strlen(text));
+  CHECK_EQ(first_line(line2, 232), strlen(line2));
+  reference(280, text, len1);
+  reference(300, line2, strlen(line2));
+
+  ui_marquee_set(&title_marquee, text);
+  struct cost cost = update();
+  CHECK_EQ(cost.pixels, 232 * UI_LINE_HEIGHT);
+  CHECK(band_matches(0, 280, 300));
+  CHECK(!band_matches(0, 300, 280));
+
+  // it rests on the first line
+  for (int i = 0; i < UI_MARQUEE_PAUSE; ++i) {
+    cost = update();
+    CHECK_EQ(cost.driver.transactions, 0);
+  }
+
+  uint32_t bytes = 0;
+  for (int step = 1; step <= UI_LINE_HEIGHT; ++step) {
+    cost = update();
+    CHECK_EQ(cost.pixels, 232);
+    bytes += cost.driver.data_bytes;
+    if (step < UI_LINE_HEIGHT)
+      CHECK(band_matches(step, 280, 300));
+  }
+  CHECK(band_matches(0, 300, 280));
+  CHECK_EQ(lcd_model_reg(0x15), 38);
+  printf("marquee: %u SPI bytes per row scrolled in, %u to draw the line\n",
+         bytes / UI_LINE_HEIGHT, 232 * UI_LINE_HEIGHT * 2);
+  CHECK(bytes / UI_LINE_HEIGHT < 232 * 2 + 64);
+
+  // and after a pause back to the first line
+  for (int i = 0; i < UI_MARQUEE_PAUSE + UI_LINE_HEIGHT; ++i)
+    update();
+  CHECK(band_matches(0, 280, 300));
+
+  // the widgets around the band stay put
+  CHECK_EQ(lcd_model_pixel(235, 100 + 3 * UI_LINE_HEIGHT),
+           rgb565(63, 63, 63));
+}
+
+int main(void) {
+  CHECK_EQ(lcd_init(), 0);
+  setup();
+  test_first();
+  test_changes();
+  test_playback();
+  test_marquee();
+  CHECK_EQ(lcd_model_dump_png(BUILD_DIR "/test_ui.png"), 0);
+  return test_result("test_ui");
+}
@@ -0,0 +1,212 @@
+// Zapping between two stations on loopback ICY servers, through the stream
+// client, the decoder with the fake codec and the I2S output in real time.
+// Each switch has to reach the new station within a second, without a step
+// in the output that would click and without the old station coming back.
+// With a slow DNS server, a switch to a prefetched host name has to skip the
+// lookup that a switch to any other one waits for.
+
+#include "decoder.h"
+#include "dns.h"
+#include "fake_codec.h"
+#include "fifo.h"
+#include "icy_server.h"
+#include "stream_client.h"
+#include "test.h"
+#include "wm8731.h"
+
+#include "i2s_dma/i2s_dma.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "espressif/esp_common.h"
+#include "lwip/api.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RATE 44100
+#define ZAPS 4
+// Largest step between two samples that doesn't count as a click, the fades
+// take about 8 per sample from full level
+#define MAX_STEP 64
+// ms each lookup of the slow DNS server takes
+#define DNS_DELAY 500
+
+struct station {
+  struct icy_server server;
+  int8_t level;
+  uint8_t frame[FAKE_FRAME_SIZE];
+  char url[64];
+};
+
+// a.test and b.test are prefetched, c.test and d.test aren't
+static const char *const dns_table[] = {
+    "radio.test 127.0.0.1", "a.test 127.0.0.1", "b.test 127.0.0.1",
+    "c.test 127.0.0.1",     "d.test 127.0.0.1", NULL,
+};
+
+// The stations play constant levels of opposite sign
+static struct station stations[2] = {{.level = 64}, {.level = -64}};
+
+static void audio(struct icy_server *server, uint64_t pos, uint8_t *data,
+                  size_t len) {
+  const struct station *station = server->user;
+  for (size_t i = 0; i < len; ++i)
+    data[i] = station->frame[(pos + i) % FAKE_FRAME_SIZE];
+}
+
+static const char *title(struct icy_server *server, uint64_t pos) {
+  return server->user == &stations[0] ? "A - Station" : "B - Station";
+}
+
+// What the sink heard, frames count from the start of the output
+static volatile uint32_t played;
+static volatile int16_t last;
+static volatile int max_step;
+// sign of the station switched to, the frame it was first heard at and
+// whether the old one was heard again after that
+static volatile int target;
+static volatile uint32_t first_new, full_new;
+static volatile bool old_again;
+
+static int sign(int16_t sample) { return (sample > 0) - (sample < 0); }
+
+static void sink(const uint32_t *frames, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    const int16_t sample = frames[i];
+    if (abs(sample - last) > max_step)
+      max_step = abs(sample - last);
+    last = sample;
+
+    if (target != 0 && sign(sample) == target) {
+      if (first_new == 0)
+        first_new = played;
+      if (full_new == 0 && abs(sample) == abs(stations[0].level * 256))
+        full_new = played;
+    } else if (first_new != 0 && sign(sample) == -target) {
+      old_again = true;
+    }
+    ++played;
+  }
+}
+
+static void on_up(const char *content_type) {
+  // only the first stream starts the decoder, it's switched over afterwards
+  if (decoder_switch(content_type) == 0)
+    return;
+  CHECK_EQ(xTaskCreate(decoder_task, "decode", 2100, "audio/mpeg", 4, NULL),
+           pdPASS);
+}
+
+static void on_metadata(enum stream_metadata type, const char *value) {}
+
+static void start_station(struct station *station) {
+  station->server = (struct icy_server){
+      .content_type = "audio/mpeg",
+      .metaint = 16000,
+      .bitrate = 128,
+      .audio = audio,
+      .title = title,
+      .user = station,
+  };
+  fake_codec_frame(station->frame, station->level);
+  CHECK_EQ(icy_server_start(&station->server), 0);
+  snprintf(station->url, sizeof(station->url), "http://radio.test:%u/live",
+           station->server.port);
+}
+
+// Waits up to ms for the condition, in steps of a tick
+#define WAIT(cond, ms)                                                         \
+  for (int i_ = 0; i_ < (ms) / portTICK_PERIOD_MS && !(cond); ++i_)            \
+  vTaskDelay(1)
+
+// Switches to the station at url, returns the ms until it was first heard
+static unsigned int zap(const struct station *next, const char *url) {
+  max_step = 0;
+  first_new = 0;
+  full_new = 0;
+  old_again = false;
+  const uint32_t start = played;
+  target = sign(next->level);
+  CHECK_EQ(stream_switch(url), 0);
+
+  WAIT(full_new != 0, 3000);
+  CHECK(full_new != 0);
+  // and a while of the new station
+  const uint32_t heard = played;
+  WAIT(played - heard > RATE / 2, 2000);
+  target = 0;
+
+  const unsigned int latency = (first_new - start) * 1000ULL / RATE;
+  const unsigned int full = (full_new - start) * 1000ULL / RATE;
+  printf("%s: new station after %u ms, at full level after %u ms, "
+         "largest step %d\n",
+         url, latency, full, max_step);
+  CHECK(max_step <= MAX_STEP);
+  CHECK(!old_again);
+  return latency;
+}
+
+static void test_zap(void) {
+  for (int i = 0; i < ZAPS; ++i)
+    CHECK(zap(&stations[(i + 1) % 2], stations[(i + 1) % 2].url) < 1000);
+}
+
+// The DNS server takes DNS_DELAY for every lookup from here on
+static void test_slow_dns(void) {
+  // every switch goes to the other station, half of them to hosts that
+  // weren't prefetched
+  static const char hosts[] = "dabc";
+  char url[64];
+  unsigned int cold = 0, prefetched = 0;
+  for (int i = 0; i < 4; ++i) {
+    const struct station *next = &stations[(i + 1) % 2];
+    snprintf(url, sizeof(url), "http://%c.test:%u/live", hosts[i],
+             next->server.port);
+    const unsigned int lookups = host_dns_lookups;
+    const unsigned int latency = zap(next, url);
+    if (hosts[i] == 'c' || hosts[i] == 'd') {
+      cold += latency;
+    } else {
+      prefetched += latency;
+      CHECK_EQ(host_dns_lookups, lookups);
+    }
+  }
+  cold /= 2;
+  prefetched /= 2;
+  printf("slow DNS: new station after %u ms without prefetch, %u ms with it\n",
+         cold, prefetched);
+  CHECK(cold >= DNS_DELAY);
+  CHECK(prefetched + DNS_DELAY / 2 < cold);
+  CHECK(prefetched < 1000);
+}
+
+int main(void) {
+  host_dns_table = dns_table;
+  CHECK_EQ(fifo_init(), 0);
+  CHECK_EQ(wm8731_init(), 0);
+  // the hosts of the station list are prefetched before there is a network,
+  // like at boot
+  host_wifi_connected = false;
+  CHECK_EQ(dns_init(), 0);
+  dns_prefetch("a.test");
+  dns_prefetch("b.test");
+  host_wifi_connected = true;
+  host_i2s_speed = 1;
+  host_i2s_sink = sink;
+
+  start_station(&stations[0]);
+  start_station(&stations[1]);
+  CHECK_EQ(stream_start(stations[0].url, on_up, on_metadata), 0);
+  WAIT(played > RATE && last == stations[0].level * 256, 5000);
+  CHECK_EQ(last, stations[0].level * 256);
+  test_zap();
+  host_dns_delay = DNS_DELAY;
+  test_slow_dns();
+  stream_stop();
+  icy_server_stop(&stations[0].server);
+  icy_server_stop(&stations[1].server);
+  return test_result("test_zap");
+}
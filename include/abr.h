@@ -0,0 +1,17 @@
+#ifndef ABR_H_
+#define ABR_H_
+
+#include "station.h"
+
+// Picks the bitrate variant of a station the connection can sustain. The
+// decisions are based on the trend of the FIFO fill and the throughput of the
+// stream. Returns the variant to start with.
+size_t abr_start(const struct station *station);
+
+// Called about once a second while the station plays. Returns the variant to
+// move the stream to or -1 to stay with the current one.
+int abr_update(void);
+
+unsigned int abr_get_and_reset_switches(void);
+
+#endif /* ABR_H_ */
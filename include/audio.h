@@ -0,0 +1,67 @@
+#ifndef AUDIO_H_
+#define AUDIO_H_
+
+#include "pcm.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void audio_init(void);
+void audio_stop(void);
+
+// Configures I2S and the DAC for the given stream format. Sample rates the DAC
+// cannot run at are doubled or quadrupled by repeating samples.
+void audio_set_format(unsigned int sample_rate, unsigned short channels);
+
+// Write nsamples per channel to the output. These calls block until there is
+// room in the DMA queue. right is NULL for single channel audio.
+void audio_write(mad_fixed_t const *left, mad_fixed_t const *right,
+                 unsigned int nsamples);
+void audio_write_s16(const int16_t *samples, unsigned int nsamples,
+                     unsigned short channels);
+
+#ifndef LIBMAD_FIXED_OUTPUT
+// Output callbacks for the synthesis of the pinned libmad fork. It asks for
+// 128 bytes of 16 bit samples at a time, that is 32 interleaved frames of
+// stereo or 64 samples of single channel audio. Stereo slices lie in the DMA
+// blocks, so the samples aren't copied again. A slice is committed to the
+// output when the next one is asked for or when it is flushed.
+short *audio_get_sample_buffer(void);
+void audio_set_frame_format(unsigned int sample_rate, unsigned short channels);
+void audio_flush_sample_buffer(void);
+#endif
+
+// Ramps the output volume up from silence or down to silence within ms.
+// The volume stays muted after a fade out until the next fade in.
+void audio_fade(bool in, unsigned int ms);
+bool audio_fading(void);
+// Writes silence until all DMA blocks have been replaced, so no stale audio
+// is repeated while nothing else is written.
+void audio_drain(void);
+
+// Dither and gain only apply to fixed-point samples passed to audio_write().
+void audio_set_dither(enum pcm_dither dither);
+void audio_set_gain(mad_fixed_t gain);
+
+unsigned int get_and_reset_underrun_counter(void);
+// Number of samples per channel written since the last call
+unsigned int get_and_reset_written_counter(void);
+// Time in microseconds spent waiting for a free DMA block since the last call
+uint32_t get_and_reset_wait_time(void);
+unsigned int audio_sample_rate(void);
+// Samples per channel written since the start, it wraps around
+uint32_t audio_written(void);
+// Samples per channel that have been written but not played yet
+unsigned int audio_queued(void);
+// Highest sample magnitudes per channel written since the last call
+void audio_get_and_reset_peak(uint16_t *left, uint16_t *right);
+
+// Test builds checksum all output samples
+#if defined(TEST_MP3) && !defined(AUDIO_CHECKSUM)
+#define AUDIO_CHECKSUM
+#endif
+#ifdef AUDIO_CHECKSUM
+uint32_t audio_checksum(void);
+#endif
+
+#endif /* AUDIO_H_ */
@@ -0,0 +1,25 @@
+#ifndef CODEC_H_
+#define CODEC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A decoder backend. Backends pull the encoded stream from the FIFO and push
+// the decoded samples to the audio output, configuring the output format via
+// audio_set_format() whenever it changes.
+struct codec {
+  const char *name;
+  // Returns true if the backend can decode the stream. It is either called
+  // with the Content-Type advertised by the server (data is NULL) or with the
+  // first len bytes of the stream (content_type is NULL).
+  bool (*probe)(const char *content_type, const uint8_t *data, size_t len);
+  // Allocates the decoder state. Returns 0 on success.
+  int (*open)(void);
+  // Decodes the next frame and writes its samples to the audio output.
+  // Returns 0 on success.
+  int (*decode_frame)(void);
+  void (*close)(void);
+};
+
+#endif /* CODEC_H_ */
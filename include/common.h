@@ -1,8 +1,12 @@
 #ifndef COMMON_H_
 #define COMMON_H_
 
+#include <stddef.h>
+
 #define ARRAY_SIZE(x) ((sizeof(x)) / (sizeof((x)[0])))
 
 static inline int min(int a, int b) { return (a < b) ? a : b; }
+// For lengths that may not fit into an int
+static inline size_t min_size(size_t a, size_t b) { return (a < b) ? a : b; }
 
 #endif /* COMMON_H_ */
@@ -0,0 +1,29 @@
+#ifndef DECODER_H_
+#define DECODER_H_
+
+#include <stdint.h>
+
+struct decoder_stats {
+  unsigned int frames;     // decoded frames
+  uint32_t decode_time;    // us spent decoding, not waiting for the output
+  uint32_t audio_time;     // us of audio produced
+  unsigned int stack_free; // lowest amount of free stack space in words
+};
+
+// Picks a codec for the buffered stream and decodes it. arg is the
+// Content-Type of the stream, which may be NULL.
+void decoder_task(void *arg);
+
+// Switches the running decoder over to a new stream, which has been buffered
+// in the FIFO behind a mark set with fifo_mark(). The old stream is faded out
+// and the new one faded in. Returns 1 if the decoder isn't running.
+int decoder_switch(const char *content_type);
+
+// Number of frames decoded since the start, it wraps around
+unsigned int decoder_frames(void);
+
+// Fills in the statistics since the last call. The ratio of audio_time and
+// decode_time is the realtime factor of the decoder.
+void decoder_get_and_reset_stats(struct decoder_stats *stats);
+
+#endif /* DECODER_H_ */
@@ -0,0 +1,20 @@
+#ifndef DNS_H_
+#define DNS_H_
+
+#include "lwip/ip_addr.h"
+
+// Cached addresses are used for this long before they are looked up again
+#define DNS_TTL_MS (10 * 60 * 1000)
+
+// Starts the background task that resolves all prefetched host names once the
+// station has an IP address and refreshes them before they expire.
+int dns_init(void);
+
+// Adds a host name to the set that is kept resolved in the background
+void dns_prefetch(const char *host);
+
+// Returns the address of host from the cache, or looks it up and caches it.
+// A stale address is returned if the lookup fails. Returns 0 on success.
+int dns_lookup(const char *host, ip_addr_t *addr);
+
+#endif /* DNS_H_ */
@@ -0,0 +1,26 @@
+#ifndef ENDPOINT_CACHE_H_
+#define ENDPOINT_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Cached endpoints are used for this many seconds of server time before the
+// playlist is fetched again
+#define ENDPOINT_MAX_AGE (7 * 24 * 60 * 60)
+
+// Looks up the stream URL a playlist resolved to before and the server's Date
+// when it was stored, 0 if unknown. Returns 0 if an entry was found.
+int endpoint_lookup(const char *playlist_url, char *url, size_t size,
+                    uint32_t *date);
+// Returns true if an entry stored at the server's Date stored has expired at
+// the Date now. Entries of unknown age are kept.
+bool endpoint_expired(uint32_t stored, uint32_t now);
+// Remembers the stream URL a playlist resolved to in flash, along with the
+// server's Date. An unchanged entry is only rewritten once it's half as old as
+// ENDPOINT_MAX_AGE.
+void endpoint_store(const char *playlist_url, const char *url, uint32_t date);
+// Drops the entry of a playlist whose stream URL stopped working
+void endpoint_forget(const char *playlist_url);
+
+#endif /* ENDPOINT_CACHE_H_ */
@@ -2,10 +2,22 @@
 #define INCLUDE_FIFO_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 int fifo_init(void);
 void fifo_enqueue(const void *data, size_t len);
 void fifo_dequeue(void *data, size_t len);
+// Copies the next len bytes without removing them. Blocks until they are
+// available.
+void fifo_peek(void *data, size_t len);
+// Marks the current write position. fifo_cut() drops all data that was
+// written before, which lets a new stream be buffered behind the old one.
+void fifo_mark(void);
+void fifo_cut(void);
+// Total number of bytes written to and read from the FIFO. They wrap around
+// and identify positions in the buffered stream.
+uint32_t fifo_write_count(void);
+uint32_t fifo_read_count(void);
 size_t fifo_fill(void);
 size_t fifo_free(void);
 size_t fifo_size(void);
@@ -0,0 +1,51 @@
+#ifndef FONT_H_
+#define FONT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Rows of the glyphs of font_latin1. The two rows at the top hold the
+// accents of capitals, the one at the bottom cedillas, so they also separate
+// the lines.
+#define FONT_LATIN1_HEIGHT 10
+// Columns of the widest glyph
+#define FONT_MAX_WIDTH 8
+// Blank columns after each glyph
+#define FONT_SPACING 1
+
+struct font_glyph {
+  uint16_t offset; // of the first run
+  uint8_t width;   // columns
+};
+
+// Proportional font covering U+0020 to U+007E and U+00A0 to U+00FF. The
+// glyphs are run-length encoded, each byte holds a background run in the
+// upper and a foreground run in the lower nibble, column by column from the
+// left, top to bottom.
+struct font {
+  uint8_t height;
+  const struct font_glyph *glyphs;
+  const uint8_t *runs;
+};
+
+extern const struct font font_latin1;
+
+// Decodes the next character of the text up to end and advances *str past
+// it. Bytes that aren't valid UTF-8 are taken as Latin-1, which is what a lot
+// of stations still send.
+uint32_t font_decode(const char **str, const char *end);
+// Returns the glyph of a character, those the font doesn't cover are shown as
+// a question mark
+const struct font_glyph *font_glyph(const struct font *font, uint32_t c);
+// Decodes the columns of a glyph into bit masks, bit 0 is the top row
+void font_columns(const struct font *font, const struct font_glyph *glyph,
+                  uint16_t *columns);
+// Returns the width in pixels of n bytes of text at scale times the size of
+// the font, including the spacing after the last glyph
+int font_width(const struct font *font, const char *str, size_t n, int scale);
+// Returns how many of the n bytes of text fit into width pixels, always
+// ending on a character boundary
+size_t font_fit(const struct font *font, const char *str, size_t n, int width,
+                int scale);
+
+#endif /* FONT_H_ */
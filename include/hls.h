@@ -0,0 +1,52 @@
+#ifndef HLS_H_
+#define HLS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Segments beyond this are dropped from the start of a playlist, which keeps
+// the ones closest to the live edge
+#define HLS_MAX_ENTRIES 6
+// Longest URI that is kept, longer ones are skipped
+#define HLS_URI_MAX 192
+
+// Incremental parser for HLS playlists. A media playlist lists the segments
+// of a stream, a master playlist lists variants of the stream at different
+// bitrates. Plain M3U playlists only contain URIs. PLS playlists are parsed
+// into the same entries as plain M3U playlists.
+struct hls_playlist {
+  bool master;
+  bool pls; // the playlist started with a [playlist] section
+  bool end;                     // no more segments will be added
+  unsigned int target_duration; // s, 0 for plain M3U playlists
+  uint32_t sequence;            // media sequence number of the first entry
+  size_t count;
+  struct {
+    char uri[HLS_URI_MAX];
+    unsigned int bandwidth; // bit/s, variants of a master playlist only
+  } entries[HLS_MAX_ENTRIES];
+
+  // line parser
+  char line[HLS_URI_MAX];
+  size_t line_len;
+  bool overflow; // the current line is too long
+  unsigned int bandwidth;
+};
+
+void hls_playlist_init(struct hls_playlist *playlist);
+void hls_playlist_feed(struct hls_playlist *playlist, const uint8_t *data,
+                       size_t len);
+// Processes a last line without line feed
+void hls_playlist_finish(struct hls_playlist *playlist);
+
+// Returns true if the playlist has HLS tags, false for a plain M3U playlist
+static inline bool hls_is_hls(const struct hls_playlist *playlist) {
+  return playlist->master || playlist->target_duration > 0;
+}
+
+// Resolves uri relative to the absolute http:// URL base into url. Returns 0
+// on success.
+int hls_resolve(const char *base, const char *uri, char *url, size_t size);
+
+#endif /* HLS_H_ */
@@ -0,0 +1,74 @@
+#ifndef HTTP_H_
+#define HTTP_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest header line that is kept, longer lines are truncated
+#define HTTP_LINE_MAX 256
+// Larger chunks are taken as a malformed response, no stream needs them
+#define HTTP_CHUNK_MAX (16UL * 1024 * 1024)
+
+struct http_response {
+  int status;
+  char content_type[32]; // without parameters, empty if not advertised
+  char location[HTTP_LINE_MAX];
+  int metaint;          // icy-metaint, -1 if the stream carries no metadata
+  unsigned int bitrate; // icy-br in kbit/s, 0 if unknown
+  long content_length;  // -1 if the body isn't length-delimited
+  uint32_t date; // Date in seconds since the epoch, 0 if missing or malformed
+  bool chunked;
+  bool keep_alive; // the connection can be used for another request
+};
+
+// Called once the response header is complete. Returns false to stop parsing,
+// e.g. when the response is a redirect.
+typedef bool (*http_header_cb)(const struct http_response *response);
+typedef void (*http_body_cb)(const uint8_t *data, size_t len);
+
+enum http_result {
+  HTTP_CONTINUE, // more data is expected
+  HTTP_DONE,     // the body ended or the header callback stopped parsing
+  HTTP_ERROR,    // malformed response
+};
+
+// Incremental HTTP/1.x response parser with a fixed memory footprint. Data can
+// be fed in pieces of any size, the header is parsed line by line and a
+// chunked body is decoded before it's passed on.
+struct http_parser {
+  enum {
+    HTTP_STATUS,
+    HTTP_HEADER,
+    HTTP_BODY,
+    HTTP_CHUNK_SIZE,
+    HTTP_CHUNK_DATA,
+    HTTP_TRAILER,
+    HTTP_END, // the whole response has been received
+  } state;
+  http_header_cb header_cb;
+  http_body_cb body_cb;
+  size_t chunk_remaining;
+  long body_remaining; // -1 if the body ends with the connection
+  char line[HTTP_LINE_MAX];
+  size_t line_len;
+  struct http_response response;
+};
+
+void http_parser_init(struct http_parser *parser, http_header_cb header,
+                      http_body_cb body);
+enum http_result http_parse(struct http_parser *parser, const uint8_t *data,
+                            size_t len);
+
+// Returns true if the response ended cleanly and the connection can be used
+// for the next request
+static inline bool http_reusable(const struct http_parser *parser) {
+  return parser->state == HTTP_END && parser->response.keep_alive;
+}
+
+// Splits an http:// or https:// URL or an absolute path into its components.
+// host, port and secure are left untouched for a path. Returns 0 on success.
+int http_parse_url(const char *url, char *host, size_t host_size,
+                   uint16_t *port, bool *secure, const char **path);
+
+#endif /* HTTP_H_ */
@@ -0,0 +1,38 @@
+#ifndef ICY_H_
+#define ICY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest metadata value that is passed on, longer values are truncated
+#define ICY_VALUE_MAX 256
+
+enum icy_field { ICY_STREAM_TITLE, ICY_STREAM_URL };
+
+typedef void (*icy_audio_cb)(const uint8_t *data, size_t len);
+// value points into the demuxer and may be modified by the callback
+typedef void (*icy_metadata_cb)(enum icy_field field, char *value);
+
+// Incremental demuxer for SHOUTcast/Icecast streams with interleaved metadata.
+// Input can be fed in chunks of any size, audio data is passed on in place and
+// metadata records are reported once they are complete.
+struct icy_demuxer {
+  icy_audio_cb audio_cb;
+  icy_metadata_cb metadata_cb;
+  int metaint; // -1 if the stream carries no metadata
+  enum { ICY_AUDIO, ICY_LENGTH, ICY_META } state;
+  int remaining; // bytes left in the current audio or metadata block
+
+  // metadata parser
+  enum { ICY_KEY, ICY_OPEN, ICY_VALUE, ICY_QUOTE, ICY_SKIP } meta_state;
+  char key[16];
+  size_t key_len;
+  char value[ICY_VALUE_MAX];
+  size_t value_len;
+};
+
+void icy_init(struct icy_demuxer *icy, int metaint, icy_audio_cb audio,
+              icy_metadata_cb metadata);
+void icy_feed(struct icy_demuxer *icy, const uint8_t *data, size_t len);
+
+#endif /* ICY_H_ */
@@ -0,0 +1,28 @@
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <stdint.h>
+
+struct latency_stats {
+  unsigned int fifo_time;   // ms of audio in the FIFO
+  unsigned int output_time; // ms of audio in the DMA ring
+  // ms from the arrival of the audio from the network, when the stream client
+  // writes it to the FIFO, until it plays
+  unsigned int live_delay;
+  unsigned int byte_rate; // B/s of the stream as decoded, 0 until known
+  uint32_t played;        // samples per channel played so far, wraps around
+};
+
+// Notes that the audio up to FIFO position pos arrived from the network at
+// time (us). Called by the stream client after writing it to the FIFO.
+void latency_arrival(uint32_t pos, uint32_t time);
+// Called by the decoder after every frame. Notes where the frame ends in the
+// FIFO and in the output, and measures the rate of the stream from the FIFO
+// bytes consumed per sample, which also works for VBR streams.
+void latency_decoded(void);
+// Restarts the rate measurement, e.g. after a stream switch cut the FIFO
+void latency_reset(void);
+
+void latency_get(struct latency_stats *stats);
+
+#endif /* LATENCY_H_ */
@@ -0,0 +1,29 @@
+#ifndef METADATA_H_
+#define METADATA_H_
+
+#include "icy.h"
+#include "stream_client.h"
+
+#include <stdint.h>
+
+// Metadata that arrives while this many records are waiting replaces the
+// oldest one
+#define METADATA_QUEUE_SIZE 4
+// Longer values are truncated, like by the ICY demuxer
+#define METADATA_VALUE_MAX ICY_VALUE_MAX
+
+// Holds the metadata of a stream back until its audio plays. The records are
+// tagged with the FIFO position of the audio they belong to.
+int metadata_init(void);
+// Queues metadata for the audio from FIFO position pos on, see
+// fifo_write_count(). A value that is the same as the last one of its type is
+// dropped, servers repeat the title with every metadata block.
+void metadata_queue(uint32_t pos, enum stream_metadata type, const char *value);
+// Drops all queued records, for a stream that is cut off. The next value of
+// each type is queued even if it is unchanged.
+void metadata_clear(void);
+// Passes all records up to FIFO position pos to cb, in order. cb is called
+// without holding any lock, so it may take its time.
+void metadata_deliver(uint32_t pos, stream_metadata_cb cb);
+
+#endif /* METADATA_H_ */
@@ -1,6 +1,8 @@
 #ifndef _MI0283QT_H_
 #define _MI0283QT_H_
 
+#include "font.h"
+
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -12,11 +14,22 @@
 static inline uint16_t RGB(uint16_t r, uint16_t g, uint16_t b) {
   // g2 g1 g0 b5 b4 b3 b2 b1   r5 r4 r3 r2 r1 g5 g4 g3
 
-  return ((g & 0x07) << 15) | ((b & 0x3e) << 7) | ((r & 0x3e) << 2) |
+  return ((g & 0x07) << 13) | ((b & 0x3e) << 7) | ((r & 0x3e) << 2) |
          ((g & 0x38) >> 3);
 }
 
+struct lcd_stats {
+  unsigned int commands;     // register writes, including the GRAM write
+  unsigned int transactions; // SPI transactions
+  uint32_t data_bytes;       // bytes after the start byte of transactions
+  uint32_t bus_time;         // us the bus was busy, estimated from the clock
+};
+
 int lcd_init(void);
+// Serializes drawing of several tasks, a sequence of calls that sets up a
+// drawing area and fills it must not be interrupted by another one
+void lcd_lock(void);
+void lcd_unlock(void);
 void lcd_set_area(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
 void lcd_write_pixels(size_t count, const uint16_t *pixels);
 void lcd_rect(uint16_t color, uint16_t x0, uint16_t y0, uint16_t x1,
@@ -25,7 +38,25 @@ void lcd_fill(uint16_t color);
 void lcd_xy_exchange(bool exchange);
 int lcd_string(int x, int y, const char *str);
 int lcd_stringn(int x, int y, const char *str, size_t n);
+// Draws up to n characters in a single window, returns the x coordinate
+// after the last one. Characters that don't fit on the line are dropped.
+int lcd_stringn_color(int x, int y, const char *str, size_t n, uint16_t fg,
+                      uint16_t bg);
+// Draws n bytes of UTF-8 text in a proportional font at scale times its
+// size in a single window, returns the x coordinate after the last glyph.
+// Glyphs that don't fit on the line are dropped.
+int lcd_text(const struct font *font, int scale, int x, int y,
+             const char *str, size_t n, uint16_t fg, uint16_t bg);
+// Draws a single row of pixels of the text at y, row counts from the top of
+// the glyphs
+int lcd_text_row(const struct font *font, int x, int y, const char *str,
+                 size_t n, int row, uint16_t fg, uint16_t bg);
+// The rows between the fixed areas scroll as a whole, there is only one such
+// area
 void lcd_scroll_on(uint16_t top_fixed, uint16_t bottom_fixed);
+// lines is the row of display memory shown at the top of the scroll area
 void lcd_scroll(uint16_t lines);
 
+void lcd_get_and_reset_stats(struct lcd_stats *stats);
+
 #endif
@@ -1,9 +1,16 @@
 #ifndef MP3_H_
 #define MP3_H_
 
-#include <stdint.h>
+#include "codec.h"
 
-void mp3_task(void *arg);
-unsigned int get_and_reset_underrun_counter(void);
+#include <stdbool.h>
+
+extern const struct codec codec_mp3;
+
+// Decodes stereo streams as mono, which roughly halves the synthesis cost.
+// Mono streams are always synthesized for a single channel only.
+void mp3_set_mono(bool enable);
+
+unsigned int get_and_reset_bad_frame_counter(void);
 
 #endif /* MP3_H_ */
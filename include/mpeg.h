@@ -0,0 +1,33 @@
+#ifndef MPEG_H_
+#define MPEG_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MPEG_HEADER_SIZE 4
+
+enum mpeg_version { MPEG_VERSION_1, MPEG_VERSION_2, MPEG_VERSION_2_5 };
+
+struct mpeg_header {
+  enum mpeg_version version;
+  unsigned int layer; // 1..3
+  bool protection;    // a CRC-16 follows the header
+  unsigned int bitrate;     // bit/s, 0 for free format
+  unsigned int sample_rate; // Hz
+  unsigned int channels;
+  size_t frame_length; // bytes including the header, 0 if unknown
+};
+
+// Parses and validates the 4 byte frame header at p. Returns 0 on success.
+int mpeg_parse_header(const uint8_t *p, struct mpeg_header *header);
+
+// Checks the CRC-16 of a protected frame and the plausibility of the Layer III
+// side information. Only the header, CRC and side information need to be
+// present in the len bytes at p. Returns 0 if the frame looks intact.
+int mpeg_check_frame(const uint8_t *p, size_t len,
+                     const struct mpeg_header *header);
+
+uint16_t mpeg_crc16(uint16_t crc, const uint8_t *data, size_t len);
+
+#endif /* MPEG_H_ */
@@ -0,0 +1,32 @@
+#ifndef PCM_H_
+#define PCM_H_
+
+#include "common_macros.h" // for IRAM
+#include "libmad/global.h"
+
+#include "libmad/fixed.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum pcm_dither {
+  PCM_DITHER_NONE,   // plain rounding
+  PCM_DITHER_TPDF,   // triangular PDF dither, +/- 1 LSB
+  PCM_DITHER_SHAPED, // TPDF dither with noise shaping
+};
+
+struct pcm_state {
+  enum pcm_dither dither;
+  mad_fixed_t gain; // MAD_F_ONE is unity
+  uint32_t random;
+  mad_fixed_t error[2][3]; // quantization error history per channel
+};
+
+// Converts n samples per channel to 16 bit and writes them to dst, one stereo
+// frame (L/R) per word. Gain, dither, rounding and clipping are applied in a
+// single pass. right may be NULL for single channel audio, in which case every
+// sample is converted once and written to both outputs.
+void pcm_pack(struct pcm_state *state, uint32_t *dst, const mad_fixed_t *left,
+              const mad_fixed_t *right, size_t n) IRAM;
+
+#endif /* PCM_H_ */
@@ -0,0 +1,27 @@
+#ifndef SPECTRUM_H_
+#define SPECTRUM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Bands of the spectrum, roughly a third of an octave wide at the top and a
+// single subband at the bottom
+#define SPECTRUM_BANDS 8
+// Levels are 0..SPECTRUM_LEVELS in steps of 3 dB
+#define SPECTRUM_LEVELS 16
+// Subbands of the MPEG audio filter bank
+#define SPECTRUM_SUBBANDS 32
+
+// Publishes the spectrum of a decoded frame. sums holds the magnitudes of
+// the samples of each subband added up, in units of 2^-16 of full scale, over
+// count samples per subband. The levels fall by a step per frame at most, so
+// short peaks remain visible. Only called by the decoder task.
+void spectrum_update(const uint32_t *sums, unsigned int count);
+// Lets the levels drop to 0, e.g. when decoding stops
+void spectrum_clear(void);
+// Copies the current levels without blocking the decoder. A copy that was
+// interrupted by an update is retried a few times. Returns false if all tries
+// were interrupted, levels is left as it was then.
+bool spectrum_get(uint8_t *levels);
+
+#endif /* SPECTRUM_H_ */
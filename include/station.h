@@ -0,0 +1,31 @@
+#ifndef STATION_H_
+#define STATION_H_
+
+#include <stddef.h>
+
+#define STATION_MAX_VARIANTS 4
+
+struct station_variant {
+  const char *url;
+  unsigned int bitrate; // kbit/s, 0 if unknown
+};
+
+struct station {
+  const char *name;
+  // The same program at different bitrates, in ascending order. All of them
+  // have to use the same format. Unused entries have a NULL URL.
+  struct station_variant variants[STATION_MAX_VARIANTS];
+  // used if the server doesn't advertise a Content-Type, may be NULL
+  const char *content_type;
+};
+
+extern const struct station stations[];
+extern const size_t station_count;
+
+size_t station_variant_count(const struct station *station);
+
+// Hands the host names of all stations to the DNS cache, so switching
+// stations doesn't wait for a lookup.
+void stations_prefetch(void);
+
+#endif /* STATION_H_ */
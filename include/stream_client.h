@@ -1,13 +1,58 @@
 #ifndef STREAM_CLIENT_H_
 #define STREAM_CLIENT_H_
 
-enum stream_metadata { STREAM_ARTIST, STREAM_TITLE };
+#include <stdint.h>
 
-typedef void (*stream_up_cb)(void);
+enum stream_metadata { STREAM_ARTIST, STREAM_TITLE, STREAM_URL };
+
+struct stream_stats {
+  unsigned int received; // bytes
+  unsigned int buffers;  // netbufs received from lwIP
+  unsigned int spans;    // contiguous pieces of data within the netbufs
+  unsigned int reconnects;
+  unsigned int gap_time; // ms from losing a connection until audio resumed
+  // bytes dropped to resume at a frame header on new connections
+  unsigned int resync_bytes;
+  // ms from stream_start() or stream_switch() until the first audio data
+  // arrived, only reported once
+  unsigned int start_latency;
+
+  unsigned int interval;     // ms covered by these stats
+  unsigned int jitter;       // us, smoothed deviation of buffer arrival times
+  unsigned int max_interval; // ms, longest time between two buffers
+  unsigned int stall_time;   // ms spent in gaps of more than 200 ms
+  int recvbuf_max;           // most bytes queued in lwIP, 0 if not available
+  unsigned int stack_free;   // lowest amount of free stack space in words
+  unsigned int segments;     // HLS segments fetched
+  unsigned int playlists;    // HLS playlist reloads
+};
+
+// Called when a new stream starts, for the first connection and after
+// stream_switch(), but not after reconnects. content_type is NULL if the
+// server did not advertise one.
+typedef void (*stream_up_cb)(const char *content_type);
 typedef void (*stream_metadata_cb)(enum stream_metadata type, const char *);
 
-int stream_start(const char *host, const char *path, stream_up_cb up,
-                 stream_metadata_cb meta);
+// Plays the stream at an http:// URL, redirects are followed. The URL may
+// also point to an M3U or HLS playlist. meta is only called from
+// stream_poll_metadata().
+int stream_start(const char *url, stream_up_cb on_up, stream_metadata_cb meta);
+// Connects to another stream while the old one keeps playing from the FIFO.
+// Once audio of the new stream arrives, the FIFO is marked and on_up is
+// called, which has to cut the decoder over with decoder_switch(). The stream
+// task copies url once it takes on the switch, until then it has to stay.
+int stream_switch(const char *url);
+// Moves to another URL of the same program, e.g. a variant with a different
+// bitrate in the same format. The FIFO isn't cut, the new connection's audio
+// is appended from its first frame header on like after a reconnect.
+int stream_move(const char *url);
+// Calls the metadata callback for the metadata whose audio the decoder has
+// reached. Meant to be called periodically from the UI, so the stream task
+// never waits for the display.
+void stream_poll_metadata(void);
+// Returns the number of bytes received since the start, it wraps around
+uint32_t stream_received(void);
 void stream_stop(void);
+void stream_get_and_reset_stats(struct stream_stats *stats);
 
 #endif /* STREAM_CLIENT_H_ */
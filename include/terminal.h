@@ -1,6 +1,22 @@
 #ifndef _TERMINAL_H_
 #define _TERMINAL_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
+// Routes stdout into a log ring, which a background task renders to the LCD
+// and copies to the UART. Writing never waits for the display.
 void term_init(void);
+// Writes to the log ring from an interrupt handler, in constant time. Output
+// that doesn't fit is dropped and counted like that of printf().
+void term_write_from_isr(const char *str, size_t len);
+
+// Messages dropped because the log ring was full
+unsigned int term_get_and_reset_dropped(void);
+// Longest time in us a write to stdout took, the part of a printf() that
+// depends on the terminal. The formatting before it is up to the caller.
+uint32_t term_get_and_reset_max_write_time(void);
+// Lowest amount of free stack space of the render task in words
+unsigned int term_get_stack_free(void);
 
 #endif
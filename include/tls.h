@@ -0,0 +1,35 @@
+#ifndef TLS_H_
+#define TLS_H_
+
+#include "lwip/api.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Returned by tls_read() if no data arrived within the receive timeout of the
+// connection
+#define TLS_TIMEOUT (-1)
+
+struct tls_stats {
+  unsigned int handshakes; // full handshakes
+  unsigned int resumed;    // abbreviated handshakes resuming a session
+  uint32_t handshake_time; // ms, last full handshake
+  uint32_t resumed_time;   // ms, last resumed handshake
+  uint32_t min_free_heap;  // bytes, lowest free heap seen during TLS
+};
+
+// Performs the TLS handshake on a connected netconn. The session of the last
+// connection to the same host is resumed if the server allows it. Returns 0
+// on success. Only a single TLS connection can be open at a time.
+int tls_connect(struct netconn *conn, const char *host);
+// Returns 0 if all data was sent
+int tls_write(const void *data, size_t len);
+// Returns the number of bytes read, 0 once the server closed the connection,
+// TLS_TIMEOUT or another negative value on errors.
+int tls_read(void *data, size_t len);
+// Releases the record buffers, the session is kept for resumption
+void tls_close(void);
+
+void tls_get_and_reset_stats(struct tls_stats *stats);
+
+#endif /* TLS_H_ */
@@ -0,0 +1,26 @@
+#ifndef TS_H_
+#define TS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TS_PACKET_SIZE 188
+
+typedef void (*ts_payload_cb)(const uint8_t *data, size_t len);
+
+// Incremental MPEG transport stream demuxer. It follows the PAT and PMT to
+// the first MPEG audio elementary stream and passes its payload on without
+// the PES headers.
+struct ts_demuxer {
+  ts_payload_cb payload_cb;
+  uint8_t packet[TS_PACKET_SIZE]; // a packet split across input chunks
+  size_t packet_len;
+  uint16_t pmt_pid;   // 0 until the PAT has been seen
+  uint16_t audio_pid; // 0 until the PMT has been seen
+  uint8_t stream_type;
+};
+
+void ts_init(struct ts_demuxer *ts, ts_payload_cb payload);
+void ts_feed(struct ts_demuxer *ts, const uint8_t *data, size_t len);
+
+#endif /* TS_H_ */
@@ -0,0 +1,119 @@
+#ifndef UI_H_
+#define UI_H_
+
+#include "font.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Widgets beyond this are not drawn
+#define UI_MAX_WIDGETS 16
+// Bytes of UTF-8 text a label keeps
+#define UI_TEXT_MAX 63
+// Height of a line of text in pixels, the text is drawn in font_latin1
+#define UI_LINE_HEIGHT FONT_LATIN1_HEIGHT
+// Updates a marquee rests on each line before the next one scrolls in
+#define UI_MARQUEE_PAUSE 20
+// Bars of a spectrum
+#define UI_SPECTRUM_MAX 16
+
+// Returns the text of item index of a list
+typedef const char *(*ui_item_cb)(size_t index);
+
+enum ui_type { UI_LABEL, UI_BAR, UI_METER, UI_LIST, UI_MARQUEE, UI_SPECTRUM };
+
+// Retained-mode widget. The widgets remember what they show and which part
+// of it changed, only that part is drawn again. All functions have to be
+// called from the same task.
+struct ui_widget {
+  enum ui_type type;
+  uint16_t x, y, width, height;
+  uint16_t fg, bg;
+  uint8_t scale; // of the text
+
+  // area that has to be drawn again, relative to the widget, empty if
+  // dirty_x0 > dirty_x1
+  uint16_t dirty_x0, dirty_y0, dirty_x1, dirty_y1;
+
+  union {
+    struct {
+      char text[UI_TEXT_MAX + 1];
+    } label;
+    // bars and meters fill the part left of filled with fg, meters switch to
+    // warn above 3/4 of their width
+    struct {
+      uint16_t filled;
+      uint16_t warn;
+    } bar;
+    struct {
+      ui_item_cb item;
+      size_t count;
+      size_t selected;
+    } list;
+    // text that doesn't fit is broken into lines, which scroll in one after
+    // another
+    struct {
+      char *text; // buffer of the caller
+      size_t size;
+      size_t pos;  // start of the line shown
+      size_t next; // start of the line that scrolls in next
+      uint16_t step; // rows of the next line that have scrolled in
+      uint16_t wait; // updates before the next line scrolls in
+    } marquee;
+    // vertical bars side by side, their heights in pixels
+    struct {
+      uint8_t count;
+      uint8_t height[UI_SPECTRUM_MAX];
+      uint8_t drawn[UI_SPECTRUM_MAX];
+    } spectrum;
+  };
+};
+
+void ui_label_init(struct ui_widget *w, uint16_t x, uint16_t y,
+                   uint16_t width, uint16_t fg, uint16_t bg);
+void ui_label_set(struct ui_widget *w, const char *text);
+// Draws the text of a label at scale times the size of the font
+void ui_label_scale(struct ui_widget *w, uint8_t scale);
+
+void ui_bar_init(struct ui_widget *w, uint16_t x, uint16_t y, uint16_t width,
+                 uint16_t height, uint16_t fg, uint16_t bg);
+void ui_meter_init(struct ui_widget *w, uint16_t x, uint16_t y,
+                   uint16_t width, uint16_t height, uint16_t fg, uint16_t warn,
+                   uint16_t bg);
+// Sets the level of a bar or meter to value out of max
+void ui_bar_set(struct ui_widget *w, uint32_t value, uint32_t max);
+
+// The list shows count items, one per line, the selected one inverted
+void ui_list_init(struct ui_widget *w, uint16_t x, uint16_t y,
+                  uint16_t width, ui_item_cb item, size_t count,
+                  uint16_t fg, uint16_t bg);
+void ui_list_select(struct ui_widget *w, size_t index);
+
+// The marquee takes the hardware scroll area of the display, which spans
+// whole rows. There can only be one and nothing else may share its rows. A
+// new text is drawn once, after that each update scrolls the band by a
+// single row and draws just the row that comes in at the bottom. text is a
+// buffer of size bytes that is kept by the widget.
+void ui_marquee_init(struct ui_widget *w, uint16_t x, uint16_t y,
+                     uint16_t width, char *text, size_t size, uint16_t fg,
+                     uint16_t bg);
+void ui_marquee_set(struct ui_widget *w, const char *text);
+
+// The spectrum shows count bars that grow upwards from the bottom. Only the
+// part of each bar between its old and new height is drawn.
+void ui_spectrum_init(struct ui_widget *w, uint16_t x, uint16_t y,
+                      uint16_t width, uint16_t height, uint8_t count,
+                      uint16_t fg, uint16_t bg);
+// Sets the bars to count levels out of max
+void ui_spectrum_set(struct ui_widget *w, const uint8_t *levels, uint8_t max);
+
+// Adds a widget to the screen, it's drawn completely on the next update
+int ui_add(struct ui_widget *w);
+
+// Draws the changed parts of the widgets. The work is capped at about
+// budget pixels, the rest is left for the next call. Returns the number of
+// pixels drawn.
+unsigned int ui_update(unsigned int budget);
+
+#endif /* UI_H_ */
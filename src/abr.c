@@ -0,0 +1,129 @@
+#include "abr.h"
+#include "fifo.h"
+#include "stream_client.h"
+
+#include "espressif/esp_common.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Seconds after a switch before the next decision, the reconnect itself
+// drains the FIFO a bit
+#define SETTLE_TIME 10
+// Seconds the FIFO has to stay nearly full before stepping up. The time is
+// doubled if a step up is followed by a step down within PROBE_TIME seconds,
+// so a variant that doesn't work out isn't tried over and over again.
+#define HOLD_MIN 20
+#define HOLD_MAX 320
+#define PROBE_TIME 60
+
+static const struct station *station;
+static size_t variant_count;
+static size_t variant;
+
+static uint32_t last_received;
+static uint32_t last_time; // us
+static size_t last_fill;
+static uint32_t throughput; // B/s, smoothed
+static int32_t trend;       // B/s, smoothed change of the FIFO fill
+
+static unsigned int settle;   // s until the next decision
+static unsigned int full;     // s the FIFO has been nearly full
+static unsigned int hold;     // s the FIFO has to be full before stepping up
+static unsigned int since_up; // s since the last step up
+static unsigned int switches;
+
+size_t abr_start(const struct station *s) {
+  station = s;
+  variant_count = station_variant_count(s);
+  // start with the best quality, weak connections step down quickly
+  variant = variant_count - 1;
+
+  last_received = stream_received();
+  last_time = sdk_system_get_time();
+  last_fill = fifo_fill();
+  throughput = 0;
+  trend = 0;
+  settle = SETTLE_TIME;
+  full = 0;
+  hold = HOLD_MIN;
+  since_up = PROBE_TIME;
+  return variant;
+}
+
+// Returns the rate of a variant in B/s
+static uint32_t byte_rate(size_t v) {
+  return station->variants[v].bitrate * 1000 / 8;
+}
+
+static int move_to(size_t v) {
+  printf("Moving to %u kbit/s\n", station->variants[v].bitrate);
+  variant = v;
+  settle = SETTLE_TIME;
+  full = 0;
+  ++switches;
+  return v;
+}
+
+int abr_update(void) {
+  if (station == NULL)
+    return -1;
+
+  const uint32_t now = sdk_system_get_time();
+  const uint32_t received = stream_received();
+  const size_t fill = fifo_fill();
+  const uint32_t elapsed = (now - last_time) / 1000;
+  if (elapsed == 0)
+    return -1;
+
+  const uint32_t rate = (received - last_received) * 1000 / elapsed;
+  throughput += ((int32_t)rate - (int32_t)throughput) / 4;
+  const int32_t change =
+      ((int32_t)fill - (int32_t)last_fill) * 1000 / (int32_t)elapsed;
+  trend += (change - trend) / 4;
+
+  last_received = received;
+  last_time = now;
+  last_fill = fill;
+
+  if (variant_count < 2)
+    return -1;
+  // a step up that held for a while resets the hold time
+  if (since_up < PROBE_TIME && ++since_up == PROBE_TIME)
+    hold = HOLD_MIN;
+  if (settle > 0) {
+    --settle;
+    return -1;
+  }
+
+  // Step down when the FIFO runs low and keeps draining. The variant is
+  // picked by the measured throughput with some headroom.
+  if (fill < fifo_size() / 4 && trend < 0 && variant > 0) {
+    size_t v = variant - 1;
+    while (v > 0 && byte_rate(v) > throughput * 3 / 4)
+      --v;
+    if (since_up < PROBE_TIME && hold < HOLD_MAX)
+      hold *= 2;
+    since_up = PROBE_TIME;
+    return move_to(v);
+  }
+
+  // Flow control caps the throughput at the bitrate of the stream once the
+  // FIFO is full, so a full FIFO is the only sign of spare bandwidth.
+  if (fill >= fifo_size() * 7 / 8) {
+    if (++full >= hold && variant + 1 < variant_count) {
+      since_up = 0;
+      return move_to(variant + 1);
+    }
+  } else {
+    full = 0;
+  }
+
+  return -1;
+}
+
+unsigned int abr_get_and_reset_switches(void) {
+  const unsigned int s = switches;
+  switches = 0;
+  return s;
+}
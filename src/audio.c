@@ -0,0 +1,405 @@
+#include "audio.h"
+#include "common.h"
+#include "wm8731.h"
+
+#include "espressif/esp_common.h"
+#include "i2s_dma/i2s_dma.h"
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "task.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define DMA_BUFFER_SIZE 512
+#define DMA_QUEUE_SIZE 6
+#define DMA_BUFFER_FRAMES (DMA_BUFFER_SIZE / sizeof(uint32_t))
+
+// Circular list of descriptors
+static dma_descriptor_t dma_block_list[DMA_QUEUE_SIZE];
+
+// Array of buffers for circular list of descriptors. Every 32 bit word holds
+// one stereo frame of two 16 bit samples.
+static uint32_t dma_buffer[DMA_QUEUE_SIZE][DMA_BUFFER_FRAMES];
+
+// Queue of empty DMA blocks
+static QueueHandle_t dma_queue = NULL;
+
+// Block currently being filled and the write position within it in frames
+static uint32_t *curr_dma_buf = NULL;
+static size_t curr_dma_pos = 0;
+#ifndef LIBMAD_FIXED_OUTPUT
+// Slice of the current block handed out to libmad and not committed yet
+static uint32_t *dma_slice = NULL;
+#endif
+
+static unsigned int underrun_counter = 0;
+static unsigned int written_counter = 0;
+// Samples per channel written since the start, wraps around
+static uint32_t written_total = 0;
+// Highest magnitude per channel since the last call of audio_get_and_reset_peak
+static uint16_t peak[2];
+static uint32_t wait_time = 0; // us
+static unsigned int last_sample_rate = 44100;
+
+#ifdef AUDIO_CHECKSUM
+// Checksum of all output samples, to verify that decoding a known stream still
+// yields the same result
+static uint32_t checksum = 0;
+#endif
+
+static struct pcm_state pcm = {.dither = PCM_DITHER_NONE, .gain = MAD_F_ONE};
+
+// Every input frame is repeated this many times on the output
+static unsigned int upsample = 1;
+
+// Output volume during a fade, changed by fade_step every frame
+#define FADE_ONE (1L << 16)
+static int32_t fade_gain = FADE_ONE;
+static int32_t fade_step = 0;
+
+/**
+ * Create a circular list of DMA descriptors
+ */
+static inline void init_descriptors_list() {
+  memset(dma_buffer, 0, sizeof(dma_buffer));
+
+  for (int i = 0; i < DMA_QUEUE_SIZE; i++) {
+    dma_block_list[i].owner = 1;
+    dma_block_list[i].eof = 1;
+    dma_block_list[i].sub_sof = 0;
+    dma_block_list[i].unused = 0;
+    dma_block_list[i].buf_ptr = dma_buffer[i];
+    dma_block_list[i].datalen = DMA_BUFFER_SIZE;
+    dma_block_list[i].blocksize = DMA_BUFFER_SIZE;
+    if (i == (DMA_QUEUE_SIZE - 1)) {
+      dma_block_list[i].next_link_ptr = &dma_block_list[0];
+    } else {
+      dma_block_list[i].next_link_ptr = &dma_block_list[i + 1];
+    }
+  }
+
+  // The queue depth is one smaller than the amount of buffers we have,
+  // because there's always a buffer that is being used by the DMA subsystem
+  // *right now* and we don't want to be able to write to that simultaneously
+  dma_queue = xQueueCreate(DMA_QUEUE_SIZE - 1, sizeof(uint32_t *));
+  if (dma_queue == NULL) {
+    printf("Queue creation failed\n");
+  }
+}
+
+// DMA interrupt handler. It is called each time a DMA block is finished
+// processing.
+static void dma_isr_handler(void *args) {
+  portBASE_TYPE task_awoken = pdFALSE;
+
+  if (i2s_dma_is_eof_interrupt()) {
+    dma_descriptor_t *descr = i2s_dma_get_eof_descriptor();
+
+    if (xQueueIsQueueFullFromISR(dma_queue)) {
+      // List of empty blocks is full. Sender don't send data fast enough.
+      ++underrun_counter;
+      // Discard top of the queue
+      int dummy;
+      xQueueReceiveFromISR(dma_queue, &dummy, &task_awoken);
+    }
+    // Push the processed buffer to the queue so sender can refill it.
+    xQueueSendFromISR(dma_queue, (void *)(&descr->buf_ptr), &task_awoken);
+  }
+  i2s_dma_clear_interrupt();
+
+  portEND_SWITCHING_ISR(task_awoken);
+}
+
+void audio_init(void) {
+  i2s_clock_div_t clock_div = i2s_get_clock_div(44100 * 2 * 16);
+  i2s_pins_t i2s_pins = {.data = true, .clock = true, .ws = true};
+  i2s_dma_init(dma_isr_handler, NULL, clock_div, i2s_pins);
+  init_descriptors_list();
+  i2s_dma_start(dma_block_list);
+}
+
+void audio_stop(void) {
+  i2s_dma_stop();
+  vQueueDelete(dma_queue);
+  dma_queue = NULL;
+  curr_dma_buf = NULL;
+  curr_dma_pos = 0;
+#ifndef LIBMAD_FIXED_OUTPUT
+  dma_slice = NULL;
+#endif
+}
+
+unsigned int get_and_reset_underrun_counter() {
+  unsigned int underruns = underrun_counter;
+  underrun_counter = 0;
+  return underruns;
+}
+
+unsigned int get_and_reset_written_counter() {
+  unsigned int written = written_counter;
+  written_counter = 0;
+  return written;
+}
+
+uint32_t get_and_reset_wait_time() {
+  uint32_t wait = wait_time;
+  wait_time = 0;
+  return wait;
+}
+
+unsigned int audio_sample_rate(void) { return last_sample_rate; }
+
+uint32_t audio_written(void) { return written_total; }
+
+void audio_get_and_reset_peak(uint16_t *left, uint16_t *right) {
+  *left = peak[0];
+  *right = peak[1];
+  peak[0] = peak[1] = 0;
+}
+
+unsigned int audio_queued(void) {
+  if (dma_queue == NULL)
+    return 0;
+
+  // Blocks that aren't in the queue of empty ones hold audio, except for the
+  // one being filled, which holds curr_dma_pos frames. The block the DMA
+  // engine is playing counts half on average.
+  const unsigned int full =
+      DMA_QUEUE_SIZE - 1 - uxQueueMessagesWaiting(dma_queue);
+  unsigned int frames = full * DMA_BUFFER_FRAMES + DMA_BUFFER_FRAMES / 2;
+  if (curr_dma_buf != NULL)
+    frames -= DMA_BUFFER_FRAMES - curr_dma_pos;
+  return frames / upsample;
+}
+
+#ifdef AUDIO_CHECKSUM
+uint32_t audio_checksum(void) { return checksum; }
+#endif
+
+void audio_set_format(unsigned int sample_rate, unsigned short channels) {
+  if (sample_rate != last_sample_rate) {
+    printf("new sample rate: %u kHz\n", sample_rate);
+    last_sample_rate = sample_rate;
+
+    for (upsample = 1; upsample <= 4; upsample *= 2) {
+      if (wm8731_set_sample_rate(sample_rate * upsample) == 0)
+        break;
+    }
+    if (upsample > 4) {
+      printf("unsupported sample rate\n");
+      upsample = 1;
+    }
+
+    // TODO: it's cleaner to clear the DMA queue and start over
+    // The DMA blocks always hold interleaved stereo frames, single channel
+    // audio is duplicated into both slots.
+    i2s_clock_div_t clock_div =
+        i2s_get_clock_div(sample_rate * upsample * 2 * 16);
+    // the masks are unshifted, like everywhere in the SDK register headers
+    const uint32_t div_mask = I2S_CONF_BCK_DIV_M << I2S_CONF_BCK_DIV_S |
+                              I2S_CONF_CLKM_DIV_M << I2S_CONF_CLKM_DIV_S;
+    uint32_t i2s_conf = I2S.CONF & ~div_mask;
+    i2s_conf |= (clock_div.bclk_div << I2S_CONF_BCK_DIV_S) |
+                (clock_div.clkm_div << I2S_CONF_CLKM_DIV_S);
+    I2S.CONF = i2s_conf;
+  }
+}
+
+void audio_fade(bool in, unsigned int ms) {
+  const int32_t frames = last_sample_rate * ms / 1000;
+  const int32_t step = frames > 0 ? FADE_ONE / frames : FADE_ONE;
+  fade_step = in ? step : -(step > 0 ? step : 1);
+}
+
+bool audio_fading(void) { return fade_step != 0; }
+
+void audio_set_dither(enum pcm_dither dither) { pcm.dither = dither; }
+
+void audio_set_gain(mad_fixed_t gain) { pcm.gain = gain; }
+
+// Returns the next free frame of the current DMA block and the number of input
+// frames that still fit into it. Blocks until a DMA block is available.
+static uint32_t *reserve(size_t *nframes) {
+  while (1) {
+    if (curr_dma_buf == NULL) {
+      // Get a free block from the DMA queue. This call will suspend the task
+      // until a free block is available in the queue.
+      const uint32_t start = sdk_system_get_time();
+      xQueueReceive(dma_queue, &curr_dma_buf, portMAX_DELAY);
+      wait_time += sdk_system_get_time() - start;
+    }
+
+    *nframes = (DMA_BUFFER_FRAMES - curr_dma_pos) / upsample;
+    if (*nframes > 0)
+      return curr_dma_buf + curr_dma_pos;
+
+    // The sample rate changed in the middle of a block and the remainder is
+    // too short for a single repeated frame. Leave it as it is.
+    curr_dma_buf = NULL;
+    curr_dma_pos = 0;
+  }
+}
+
+static inline int16_t fade_sample(int16_t sample, int32_t gain) {
+  return (sample * gain) >> 16;
+}
+
+// Applies the volume ramp of a fade to n frames at dst
+static void fade(uint32_t *dst, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    dst[i] = (uint16_t)fade_sample(dst[i], fade_gain) |
+             (uint32_t)(uint16_t)fade_sample(dst[i] >> 16, fade_gain) << 16;
+
+    fade_gain += fade_step;
+    if (fade_gain <= 0 || fade_gain >= FADE_ONE) {
+      fade_gain = fade_gain <= 0 ? 0 : FADE_ONE;
+      fade_step = 0;
+    }
+  }
+}
+
+// Repeats the n frames at dst to fill n * upsample frames and marks them as
+// used.
+static void commit(uint32_t *dst, size_t n) {
+  if (fade_step != 0 || fade_gain != FADE_ONE)
+    fade(dst, n);
+
+#ifdef AUDIO_CHECKSUM
+  for (size_t i = 0; i < n; ++i)
+    checksum = ((checksum << 5) | (checksum >> 27)) ^ dst[i];
+#endif
+
+  written_counter += n;
+  written_total += n;
+
+  // every fourth frame is enough for a level meter
+  for (size_t i = 0; i < n; i += 4) {
+    const int16_t left = dst[i], right = dst[i] >> 16;
+    const uint16_t l = left < 0 ? -left : left;
+    const uint16_t r = right < 0 ? -right : right;
+    if (l > peak[0])
+      peak[0] = l;
+    if (r > peak[1])
+      peak[1] = r;
+  }
+
+  if (upsample > 1) {
+    for (size_t i = n; i-- > 0;) {
+      for (unsigned int j = 0; j < upsample; ++j)
+        dst[i * upsample + j] = dst[i];
+    }
+  }
+
+  curr_dma_pos += n * upsample;
+
+  // DMA buffer full
+  if (curr_dma_pos >= DMA_BUFFER_FRAMES) {
+    curr_dma_buf = NULL;
+    curr_dma_pos = 0;
+  }
+}
+
+void audio_write(mad_fixed_t const *left, mad_fixed_t const *right,
+                 unsigned int nsamples) {
+  while (nsamples > 0) {
+    size_t n;
+    uint32_t *dst = reserve(&n);
+    if (n > nsamples)
+      n = nsamples;
+
+    pcm_pack(&pcm, dst, left, right, n);
+    commit(dst, n);
+
+    left += n;
+    if (right != NULL)
+      right += n;
+    nsamples -= n;
+  }
+}
+
+void audio_write_s16(const int16_t *samples, unsigned int nsamples,
+                     unsigned short channels) {
+  while (nsamples > 0) {
+    size_t n;
+    uint32_t *dst = reserve(&n);
+    if (n > nsamples)
+      n = nsamples;
+
+    if (channels == 1) {
+      for (size_t i = 0; i < n; ++i)
+        dst[i] = 0x00010001UL * (uint16_t)samples[i];
+    } else {
+      memcpy(dst, samples, n * sizeof(uint32_t));
+    }
+    commit(dst, n);
+
+    samples += n * channels;
+    nsamples -= n;
+  }
+}
+
+#ifndef LIBMAD_FIXED_OUTPUT
+// Frames of a slice of stereo samples
+#define SLICE_FRAMES 32
+
+// Slice of 16 bit samples handed out to libmad, and its channel count. Stereo
+// slices are handed out straight from the current DMA block, the buffer only
+// takes single channel audio, which has to be duplicated, and slices that
+// don't fit into the rest of a block.
+static int16_t sample_buffer[2 * SLICE_FRAMES];
+static unsigned short sample_buffer_channels = 2;
+static bool sample_buffer_used = false;
+
+short *audio_get_sample_buffer(void) {
+  audio_flush_sample_buffer();
+  if (sample_buffer_channels == 2) {
+    size_t n;
+    uint32_t *dst = reserve(&n);
+    if (n >= SLICE_FRAMES) {
+      dma_slice = dst;
+      return (short *)dst;
+    }
+  }
+  sample_buffer_used = true;
+  return sample_buffer;
+}
+
+void audio_set_frame_format(unsigned int sample_rate, unsigned short channels) {
+  // a pending slice still holds samples in the previous layout, and it was
+  // reserved for the previous upsampling
+  if (channels != sample_buffer_channels || sample_rate != last_sample_rate) {
+    audio_flush_sample_buffer();
+    sample_buffer_channels = channels;
+  }
+  audio_set_format(sample_rate, channels);
+}
+
+void audio_flush_sample_buffer(void) {
+  if (dma_slice != NULL) {
+    uint32_t *dst = dma_slice;
+    dma_slice = NULL;
+    commit(dst, SLICE_FRAMES);
+    return;
+  }
+  if (!sample_buffer_used)
+    return;
+  sample_buffer_used = false;
+  audio_write_s16(sample_buffer,
+                  ARRAY_SIZE(sample_buffer) / sample_buffer_channels,
+                  sample_buffer_channels);
+}
+#endif
+
+void audio_drain(void) {
+  for (size_t left = DMA_QUEUE_SIZE * DMA_BUFFER_FRAMES; left > 0;) {
+    size_t n;
+    uint32_t *dst = reserve(&n);
+    if (n * upsample > left)
+      n = (left + upsample - 1) / upsample;
+    memset(dst, 0, n * sizeof(uint32_t));
+    commit(dst, n);
+    left -= min(left, n * upsample);
+  }
+}
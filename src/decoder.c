@@ -0,0 +1,168 @@
+#include "decoder.h"
+#include "audio.h"
+#include "common.h"
+#include "fifo.h"
+#include "latency.h"
+#include "mp3.h"
+
+#include "espressif/esp_common.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PROBE_SIZE 2048
+// Bytes dropped at a time while no codec can decode the stream
+#define SKIP_SIZE 256
+// Length of the fade out and fade in when switching streams
+#define FADE_MS 50
+
+static TaskHandle_t handle = NULL;
+// Content-Type of the stream to switch to, set by decoder_switch()
+static const char *volatile switch_content_type;
+static volatile bool switch_requested = false;
+static unsigned int frame_counter = 0;
+// frames decoded since the start, it isn't reset with the stats
+static volatile unsigned int total_frames = 0;
+static uint32_t decode_time = 0;
+
+static const struct codec *const codecs[] = {
+    &codec_mp3,
+};
+
+static const struct codec *find_codec(const char *content_type) {
+  if (content_type != NULL) {
+    for (int i = 0; i < ARRAY_SIZE(codecs); ++i) {
+      if (codecs[i]->probe(content_type, NULL, 0))
+        return codecs[i];
+    }
+    printf("unknown content type %s, probing stream\n", content_type);
+  }
+
+  uint8_t *head = malloc(PROBE_SIZE);
+  if (head == NULL)
+    return NULL;
+
+  const struct codec *codec = NULL;
+  fifo_peek(head, PROBE_SIZE);
+  for (int i = 0; i < ARRAY_SIZE(codecs) && codec == NULL; ++i) {
+    if (codecs[i]->probe(NULL, head, PROBE_SIZE))
+      codec = codecs[i];
+  }
+
+  free(head);
+  return codec;
+}
+
+// Picks and opens a codec for the stream at the start of the FIFO
+static const struct codec *open_codec(const char *content_type) {
+  const struct codec *codec = find_codec(content_type);
+  if (codec == NULL) {
+    printf("no decoder for stream\n");
+    return NULL;
+  }
+
+  printf("decoding %s\n", codec->name);
+  if (codec->open()) {
+    printf("opening %s decoder failed\n", codec->name);
+    return NULL;
+  }
+
+  return codec;
+}
+
+// Opens the codec named by the Content-Type or, if it can't be opened, the
+// one found by probing the stream
+static const struct codec *open_stream(const char *content_type) {
+  const struct codec *codec = open_codec(content_type);
+  if (codec == NULL && content_type != NULL)
+    codec = open_codec(NULL);
+  return codec;
+}
+
+// Continues to decode the old stream while fading out, then drops the rest of
+// it from the FIFO and starts decoding the new stream behind the mark.
+static const struct codec *switch_stream(const struct codec *codec) {
+  if (codec != NULL) {
+    audio_fade(false, FADE_MS);
+    while (audio_fading()) {
+      if (codec->decode_frame() != 0)
+        break;
+    }
+    codec->close();
+  }
+
+  audio_drain();
+  fifo_cut();
+  latency_reset();
+  switch_requested = false;
+
+  codec = open_stream(switch_content_type);
+  audio_fade(true, FADE_MS);
+  return codec;
+}
+
+// Drops the stream nothing can decode, so the stream client isn't blocked
+// and the next switch finds its mark
+static void skip_stream(void) {
+  uint8_t buf[SKIP_SIZE];
+  fifo_dequeue(buf, sizeof(buf));
+}
+
+void decoder_task(void *arg) {
+  handle = xTaskGetCurrentTaskHandle();
+
+  // a stream nothing can decode is skipped like after a switch, so the task
+  // stays around for the next one
+  const struct codec *codec = open_stream(arg);
+  audio_init();
+  while (1) {
+    if (switch_requested)
+      codec = switch_stream(codec);
+    if (codec == NULL) {
+      skip_stream();
+      continue;
+    }
+
+    const uint32_t start = sdk_system_get_time();
+    if (codec->decode_frame() != 0)
+      break;
+    decode_time += sdk_system_get_time() - start;
+    ++frame_counter;
+    ++total_frames;
+    latency_decoded();
+  }
+  audio_stop();
+  codec->close();
+
+  handle = NULL;
+  vTaskDelete(NULL);
+}
+
+int decoder_switch(const char *content_type) {
+  if (handle == NULL)
+    return 1;
+
+  switch_content_type = content_type;
+  switch_requested = true;
+  return 0;
+}
+
+unsigned int decoder_frames(void) { return total_frames; }
+
+void decoder_get_and_reset_stats(struct decoder_stats *stats) {
+  stats->frames = frame_counter;
+  frame_counter = 0;
+
+  const uint32_t wait_time = get_and_reset_wait_time();
+  stats->decode_time = decode_time > wait_time ? decode_time - wait_time : 0;
+  decode_time = 0;
+
+  stats->audio_time = (uint64_t)get_and_reset_written_counter() * 1000000 /
+                      audio_sample_rate();
+
+  stats->stack_free = handle != NULL ? uxTaskGetStackHighWaterMark(handle) : 0;
+}
@@ -0,0 +1,159 @@
+#include "dns.h"
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+#include "lwip/api.h"
+
+#include "espressif/esp_common.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define DNS_CACHE_SIZE 8
+// How often the background task checks for entries that are about to expire
+#define DNS_REFRESH_MS (60 * 1000)
+
+struct dns_entry {
+  char host[64];
+  ip_addr_t addr;
+  bool resolved;
+  TickType_t expires;
+  TickType_t used; // for replacing the least recently used entry
+  bool pinned;     // prefetched and not looked up yet
+};
+
+static struct dns_entry cache[DNS_CACHE_SIZE];
+static SemaphoreHandle_t mtx;
+
+static inline TickType_t ms_to_ticks(uint32_t ms) {
+  return ms / portTICK_PERIOD_MS;
+}
+
+static inline bool expired(const struct dns_entry *entry, TickType_t margin) {
+  return (int32_t)(entry->expires - xTaskGetTickCount()) < (int32_t)margin;
+}
+
+// Free entries are replaced first, then the least recently used ones. A
+// prefetched entry is only replaced before its first use if all are pinned,
+// lookups of other hosts would otherwise push out the stations' hosts.
+static bool replace_first(const struct dns_entry *a,
+                          const struct dns_entry *b) {
+  const int rank_a = a->host[0] == '\0' ? 0 : a->pinned ? 2 : 1;
+  const int rank_b = b->host[0] == '\0' ? 0 : b->pinned ? 2 : 1;
+  if (rank_a != rank_b)
+    return rank_a < rank_b;
+  return (int32_t)(a->used - b->used) < 0;
+}
+
+// Returns the entry for host or a free or replaced one with an empty host
+// name. Must be called with the mutex held.
+static struct dns_entry *find_entry(const char *host) {
+  struct dns_entry *oldest = &cache[0];
+
+  for (int i = 0; i < DNS_CACHE_SIZE; ++i) {
+    if (strcmp(cache[i].host, host) == 0)
+      return &cache[i];
+    if (replace_first(&cache[i], oldest))
+      oldest = &cache[i];
+  }
+
+  if (strlen(host) >= sizeof(oldest->host))
+    return NULL;
+  memset(oldest, 0, sizeof(*oldest));
+  strcpy(oldest->host, host);
+  oldest->used = xTaskGetTickCount();
+  return oldest;
+}
+
+// Resolves host without holding the mutex, the lookup can take seconds. The
+// result is cached and stored in addr. Returns 0 on success.
+static int resolve(const char *host, ip_addr_t *result) {
+  ip_addr_t addr;
+  const err_t err = netconn_gethostbyname(host, &addr);
+  if (err != ERR_OK) {
+    printf("DNS lookup for %s failed err=%d\n", host, err);
+    return 1;
+  }
+
+  char addr_str[IPADDR_STRLEN_MAX];
+  printf("%s is %s\n", host, ipaddr_ntoa_r(&addr, addr_str, sizeof(addr_str)));
+
+  xSemaphoreTake(mtx, portMAX_DELAY);
+  struct dns_entry *entry = find_entry(host);
+  if (entry != NULL) {
+    entry->addr = addr;
+    entry->resolved = true;
+    entry->expires = xTaskGetTickCount() + ms_to_ticks(DNS_TTL_MS);
+  }
+  xSemaphoreGive(mtx);
+
+  if (result != NULL)
+    *result = addr;
+  return 0;
+}
+
+static void dns_task(void *arg) {
+  while (sdk_wifi_station_get_connect_status() != STATION_GOT_IP) {
+    vTaskDelay(100 / portTICK_PERIOD_MS);
+  }
+
+  while (1) {
+    for (int i = 0; i < DNS_CACHE_SIZE; ++i) {
+      char host[sizeof(cache[i].host)];
+
+      // refresh entries that would expire before the next round
+      xSemaphoreTake(mtx, portMAX_DELAY);
+      strcpy(host, cache[i].host);
+      const bool refresh =
+          !cache[i].resolved || expired(&cache[i], ms_to_ticks(DNS_REFRESH_MS));
+      xSemaphoreGive(mtx);
+
+      if (host[0] != '\0' && refresh)
+        resolve(host, NULL);
+    }
+    vTaskDelay(ms_to_ticks(DNS_REFRESH_MS));
+  }
+}
+
+int dns_init(void) {
+  mtx = xSemaphoreCreateMutex();
+  if (mtx == NULL)
+    return 1;
+
+  // the lookup and printf() of the result need more than 256 words
+  if (xTaskCreate(dns_task, "dns", 512, NULL, 2, NULL) != pdPASS)
+    return 1;
+
+  return 0;
+}
+
+void dns_prefetch(const char *host) {
+  xSemaphoreTake(mtx, portMAX_DELAY);
+  struct dns_entry *entry = find_entry(host);
+  if (entry != NULL)
+    entry->pinned = true;
+  xSemaphoreGive(mtx);
+}
+
+int dns_lookup(const char *host, ip_addr_t *addr) {
+  xSemaphoreTake(mtx, portMAX_DELAY);
+  struct dns_entry *entry = find_entry(host);
+  const bool stale = entry != NULL && entry->resolved;
+  const bool hit = stale && !expired(entry, 0);
+  if (stale)
+    *addr = entry->addr;
+  if (hit)
+    entry->used = xTaskGetTickCount();
+  if (entry != NULL)
+    entry->pinned = false;
+  xSemaphoreGive(mtx);
+
+  if (hit || resolve(host, addr) == 0)
+    return 0;
+
+  // fall back to the stale address, the server probably didn't move
+  return stale ? 0 : 1;
+}
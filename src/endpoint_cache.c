@@ -0,0 +1,87 @@
+#include "endpoint_cache.h"
+
+#include "sysparam.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The keys are derived from an FNV-1a hash of the playlist URL, which is too
+// long for a key
+static void make_key(const char *playlist_url, char *key) {
+  uint32_t hash = 2166136261u;
+  for (const char *p = playlist_url; *p != '\0'; ++p)
+    hash = (hash ^ (uint8_t)*p) * 16777619u;
+  sprintf(key, "ep_%08x", hash);
+}
+
+// The value is the server's Date at the time it was stored and the URL.
+// Returns the value to be freed, with date and url filled in, or NULL.
+static char *read_entry(const char *key, uint32_t *date, const char **url) {
+  char *value;
+  if (sysparam_get_string(key, &value) != SYSPARAM_OK)
+    return NULL;
+
+  char *end;
+  *date = strtoul(value, &end, 10);
+  if (*end != ' ') {
+    free(value);
+    return NULL;
+  }
+  *url = end + 1;
+  return value;
+}
+
+int endpoint_lookup(const char *playlist_url, char *url, size_t size,
+                    uint32_t *date) {
+  char key[12];
+  make_key(playlist_url, key);
+
+  const char *stored_url;
+  char *value = read_entry(key, date, &stored_url);
+  if (value == NULL)
+    return 1;
+
+  const int ret = strlen(stored_url) >= size;
+  if (ret == 0)
+    strcpy(url, stored_url);
+  free(value);
+  return ret;
+}
+
+bool endpoint_expired(uint32_t stored, uint32_t now) {
+  return stored != 0 && now != 0 &&
+         (int32_t)(now - stored) > ENDPOINT_MAX_AGE;
+}
+
+void endpoint_store(const char *playlist_url, const char *url, uint32_t date) {
+  char key[12];
+  make_key(playlist_url, key);
+
+  // the flash wears out, unchanged entries are only renewed now and then
+  uint32_t stored = 0;
+  const char *stored_url;
+  char *old = read_entry(key, &stored, &stored_url);
+  const bool renew =
+      date != 0 &&
+      (stored == 0 || (int32_t)(date - stored) >= ENDPOINT_MAX_AGE / 2);
+  const bool unchanged = old != NULL && strcmp(stored_url, url) == 0 && !renew;
+  free(old);
+  if (unchanged)
+    return;
+
+  char *value = malloc(strlen(url) + 16);
+  if (value == NULL)
+    return;
+  sprintf(value, "%u %s", (unsigned int)date, url);
+  if (sysparam_set_string(key, value) != SYSPARAM_OK)
+    printf("Failed to store endpoint\n");
+  free(value);
+}
+
+void endpoint_forget(const char *playlist_url) {
+  char key[12];
+  make_key(playlist_url, key);
+  // zero length values delete the key
+  sysparam_set_data(key, NULL, 0, false);
+}
@@ -5,11 +5,19 @@
 #include "semphr.h"
 #include "task.h"
 
+#include <stdbool.h>
+
 #define FIFO_SIZE SPIRAM_SIZE
 
 static uint32_t write_pos = 0;
 static uint32_t read_pos = 0;
 static uint32_t fill = 0;
+// Total number of bytes written and read, these wrap around
+static uint32_t write_count = 0;
+static uint32_t read_count = 0;
+// write_count at the time fifo_mark() was called
+static uint32_t mark;
+static bool mark_set = false;
 
 static SemaphoreHandle_t mtx;
 static TaskHandle_t producer_waiting = NULL;
@@ -38,9 +46,17 @@ static inline size_t fifo_enqueue_internal(const void *const data,
     xSemaphoreTake(mtx, portMAX_DELAY);
   }
 
-  size_t written = spiram_write(write_pos, data, len);
-  write_pos = (write_pos + written) % FIFO_SIZE;
+  // Transfer the whole chunk while holding the mutex, the SPI RAM driver
+  // splits it up into transactions of up to 64 bytes.
+  size_t written = 0;
+  while (written < len) {
+    const size_t n = spiram_write(write_pos, (const uint8_t *)data + written,
+                                  len - written);
+    write_pos = (write_pos + n) % FIFO_SIZE;
+    written += n;
+  }
   fill += written;
+  write_count += written;
 
   if (consumer_waiting != NULL) {
     xTaskNotifyGive(consumer_waiting);
@@ -73,9 +89,14 @@ static inline size_t fifo_dequeue_internal(void *const data,
     xSemaphoreTake(mtx, portMAX_DELAY);
   }
 
-  size_t read = spiram_read(read_pos, data, len);
-  read_pos = (read_pos + read) % FIFO_SIZE;
+  size_t read = 0;
+  while (read < len) {
+    const size_t n = spiram_read(read_pos, (uint8_t *)data + read, len - read);
+    read_pos = (read_pos + n) % FIFO_SIZE;
+    read += n;
+  }
   fill -= read;
+  read_count += read;
 
   if (producer_waiting != NULL) {
     xTaskNotifyGive(producer_waiting);
@@ -96,6 +117,56 @@ void fifo_dequeue(void *data, size_t len) {
   }
 }
 
+void fifo_peek(void *data, size_t len) {
+  uint8_t *byte_buf = data;
+
+  xSemaphoreTake(mtx, portMAX_DELAY);
+
+  while (len > fill) {
+    consumer_waiting = xTaskGetCurrentTaskHandle();
+    xSemaphoreGive(mtx);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    xSemaphoreTake(mtx, portMAX_DELAY);
+  }
+
+  uint32_t pos = read_pos;
+  while (len > 0) {
+    const size_t read = spiram_read(pos, byte_buf, len);
+    pos = (pos + read) % FIFO_SIZE;
+    byte_buf += read;
+    len -= read;
+  }
+
+  xSemaphoreGive(mtx);
+}
+
+void fifo_mark(void) {
+  xSemaphoreTake(mtx, portMAX_DELAY);
+  mark = write_count;
+  mark_set = true;
+  xSemaphoreGive(mtx);
+}
+
+void fifo_cut(void) {
+  xSemaphoreTake(mtx, portMAX_DELAY);
+
+  // The consumer may already have read past the mark if the FIFO ran empty
+  const int32_t skip = mark - read_count;
+  if (mark_set && skip > 0) {
+    read_pos = (read_pos + skip) % FIFO_SIZE;
+    fill -= skip;
+    read_count += skip;
+
+    if (producer_waiting != NULL) {
+      xTaskNotifyGive(producer_waiting);
+      producer_waiting = NULL;
+    }
+  }
+  mark_set = false;
+
+  xSemaphoreGive(mtx);
+}
+
 size_t fifo_fill(void) {
   uint32_t ret;
   xSemaphoreTake(mtx, portMAX_DELAY);
@@ -104,6 +175,22 @@ size_t fifo_fill(void) {
   return ret;
 }
 
+uint32_t fifo_write_count(void) {
+  uint32_t ret;
+  xSemaphoreTake(mtx, portMAX_DELAY);
+  ret = write_count;
+  xSemaphoreGive(mtx);
+  return ret;
+}
+
+uint32_t fifo_read_count(void) {
+  uint32_t ret;
+  xSemaphoreTake(mtx, portMAX_DELAY);
+  ret = read_count;
+  xSemaphoreGive(mtx);
+  return ret;
+}
+
 size_t fifo_free(void) { return FIFO_SIZE - fifo_fill(); }
 
 size_t fifo_size(void) { return FIFO_SIZE; }
@@ -0,0 +1,107 @@
+#include "font.h"
+
+#include <stdbool.h>
+
+// Glyphs of the printable ASCII characters come first, followed by those of
+// the Latin-1 supplement
+#define ASCII_FIRST 0x20
+#define ASCII_LAST 0x7e
+#define LATIN1_FIRST 0xa0
+#define LATIN1_LAST 0xff
+
+static inline bool continuation(const uint8_t *p, const uint8_t *end,
+                                int count) {
+  if (end - p < count)
+    return false;
+  for (int i = 0; i < count; ++i) {
+    if ((p[i] & 0xc0) != 0x80)
+      return false;
+  }
+  return true;
+}
+
+uint32_t font_decode(const char **str, const char *end) {
+  const uint8_t *p = (const uint8_t *)*str;
+  const uint8_t *e = (const uint8_t *)end;
+  uint32_t c = *p++;
+
+  if (c >= 0xc2 && c < 0xe0 && continuation(p, e, 1)) {
+    c = (c & 0x1f) << 6 | (p[0] & 0x3f);
+    p += 1;
+  } else if (c >= 0xe0 && c < 0xf0 && continuation(p, e, 2)) {
+    c = (c & 0x0f) << 12 | (p[0] & 0x3f) << 6 | (p[1] & 0x3f);
+    p += 2;
+  } else if (c >= 0xf0 && c < 0xf5 && continuation(p, e, 3)) {
+    c = (c & 0x07) << 18 | (p[0] & 0x3f) << 12 | (p[1] & 0x3f) << 6 |
+        (p[2] & 0x3f);
+    p += 3;
+  }
+
+  *str = (const char *)p;
+  return c;
+}
+
+// Maps the typographic punctuation that is common in titles to ASCII
+static uint32_t substitute(uint32_t c) {
+  switch (c) {
+  case 0x2018: // single quotation marks
+  case 0x2019:
+  case 0x201a:
+    return '\'';
+  case 0x201c: // double quotation marks
+  case 0x201d:
+  case 0x201e:
+    return '"';
+  case 0x2010: // hyphen and dashes
+  case 0x2013:
+  case 0x2014:
+    return '-';
+  default:
+    return '?';
+  }
+}
+
+const struct font_glyph *font_glyph(const struct font *font, uint32_t c) {
+  if (c >= ASCII_FIRST && c <= ASCII_LAST)
+    return &font->glyphs[c - ASCII_FIRST];
+  if (c >= LATIN1_FIRST && c <= LATIN1_LAST)
+    return &font->glyphs[c - LATIN1_FIRST + ASCII_LAST - ASCII_FIRST + 1];
+  return &font->glyphs[substitute(c) - ASCII_FIRST];
+}
+
+void font_columns(const struct font *font, const struct font_glyph *glyph,
+                  uint16_t *columns) {
+  const uint8_t *p = font->runs + glyph->offset;
+  const int pixels = glyph->width * font->height;
+
+  for (int col = 0; col < glyph->width; ++col)
+    columns[col] = 0;
+  for (int pos = 0; pos < pixels; ++p) {
+    pos += *p >> 4;
+    for (int n = *p & 0x0f; n > 0; --n, ++pos)
+      columns[pos / font->height] |= 1 << (pos % font->height);
+  }
+}
+
+int font_width(const struct font *font, const char *str, size_t n,
+               int scale) {
+  const char *end = str + n;
+  int width = 0;
+  while (str < end)
+    width += font_glyph(font, font_decode(&str, end))->width + FONT_SPACING;
+  return width * scale;
+}
+
+size_t font_fit(const struct font *font, const char *str, size_t n, int width,
+                int scale) {
+  const char *start = str, *end = str + n;
+  while (str < end) {
+    const char *next = str;
+    const struct font_glyph *glyph = font_glyph(font, font_decode(&next, end));
+    width -= (glyph->width + FONT_SPACING) * scale;
+    if (width < 0)
+      break;
+    str = next;
+  }
+  return str - start;
+}
@@ -0,0 +1,458 @@
+// Generated from the 5x7 font in lcd_font.c. The accented letters combine
+// a base letter with a mark, the other Latin-1 characters are drawn by
+// hand. Each glyph is a sequence of bytes with a background run in the
+// upper and a foreground run in the lower nibble, column by column from
+// the left, top to bottom.
+
+#include "font.h"
+
+static const uint8_t runs[] = {
+    // U+0020 space
+    0xf0, 0xf0,
+    // U+0021 !
+    0x25, 0x11, 0x10,
+    // U+0022 "
+    0x23, 0xf0, 0x23, 0x50,
+    // U+0023 #
+    0x41, 0x11, 0x57, 0x51, 0x11, 0x57, 0x51, 0x11, 0x30,
+    // U+0024 $
+    0x41, 0x21, 0x51, 0x11, 0x11, 0x47, 0x41, 0x11, 0x11, 0x51, 0x21, 0x30,
+    // U+0025 %
+    0x22, 0x31, 0x42, 0x21, 0x81, 0x81, 0x22, 0x41, 0x32, 0x10,
+    // U+0026 &
+    0x32, 0x12, 0x41, 0x21, 0x21, 0x31, 0x11, 0x11, 0x11, 0x41, 0x31, 0x81,
+    0x11, 0x10,
+    // U+0027 '
+    0x21, 0x11, 0x72, 0x60,
+    // U+0028 (
+    0x43, 0x61, 0x31, 0x41, 0x51, 0x10,
+    // U+0029 )
+    0x21, 0x51, 0x41, 0x31, 0x63, 0x30,
+    // U+002A *
+    0x51, 0x71, 0x11, 0x11, 0x63, 0x61, 0x11, 0x11, 0x71, 0x40,
+    // U+002B +
+    0x51, 0x91, 0x75, 0x71, 0x91, 0x40,
+    // U+002C ,
+    0x61, 0x11, 0x72, 0x20,
+    // U+002D -
+    0x51, 0x91, 0x91, 0x91, 0x91, 0x40,
+    // U+002E .
+    0x72, 0x82, 0x10,
+    // U+002F /
+    0x71, 0x81, 0x81, 0x81, 0x81, 0x60,
+    // U+0030 0
+    0x35, 0x41, 0x31, 0x11, 0x31, 0x21, 0x21, 0x31, 0x11, 0x31, 0x45, 0x20,
+    // U+0031 1
+    0x31, 0x41, 0x37, 0x91, 0x10,
+    // U+0032 2
+    0x31, 0x41, 0x31, 0x42, 0x31, 0x31, 0x11, 0x31, 0x21, 0x21, 0x42, 0x31,
+    0x10,
+    // U+0033 3
+    0x21, 0x41, 0x41, 0x51, 0x31, 0x11, 0x31, 0x32, 0x11, 0x21, 0x31, 0x32,
+    0x20,
+    // U+0034 4
+    0x52, 0x71, 0x11, 0x61, 0x21, 0x57, 0x71, 0x30,
+    // U+0035 5
+    0x23, 0x21, 0x41, 0x11, 0x31, 0x31, 0x11, 0x31, 0x31, 0x11, 0x31, 0x31,
+    0x23, 0x20,
+    // U+0036 6
+    0x44, 0x51, 0x11, 0x21, 0x31, 0x21, 0x21, 0x31, 0x21, 0x21, 0x72, 0x20,
+    // U+0037 7
+    0x21, 0x91, 0x33, 0x31, 0x21, 0x61, 0x11, 0x72, 0x60,
+    // U+0038 8
+    0x32, 0x12, 0x41, 0x21, 0x21, 0x31, 0x21, 0x21, 0x31, 0x21, 0x21, 0x42,
+    0x12, 0x20,
+    // U+0039 9
+    0x32, 0x71, 0x21, 0x21, 0x31, 0x21, 0x21, 0x31, 0x21, 0x11, 0x54, 0x30,
+    // U+003A :
+    0x32, 0x12, 0x52, 0x12, 0x20,
+    // U+003B ;
+    0x32, 0x11, 0x11, 0x42, 0x12, 0x20,
+    // U+003C <
+    0x51, 0x81, 0x11, 0x61, 0x31, 0x41, 0x51, 0x10,
+    // U+003D =
+    0x41, 0x11, 0x71, 0x11, 0x71, 0x11, 0x71, 0x11, 0x71, 0x11, 0x30,
+    // U+003E >
+    0x21, 0x51, 0x41, 0x31, 0x61, 0x11, 0x81, 0x40,
+    // U+003F ?
+    0x31, 0x81, 0x91, 0x31, 0x11, 0x31, 0x21, 0x72, 0x50,
+    // U+0040 @
+    0x31, 0x22, 0x41, 0x21, 0x21, 0x31, 0x24, 0x31, 0x51, 0x45, 0x20,
+    // U+0041 A
+    0x36, 0x31, 0x31, 0x51, 0x31, 0x51, 0x31, 0x66, 0x10,
+    // U+0042 B
+    0x27, 0x31, 0x21, 0x21, 0x31, 0x21, 0x21, 0x31, 0x21, 0x21, 0x42, 0x12,
+    0x20,
+    // U+0043 C
+    0x35, 0x41, 0x51, 0x31, 0x51, 0x31, 0x51, 0x41, 0x31, 0x20,
+    // U+0044 D
+    0x27, 0x31, 0x51, 0x31, 0x51, 0x41, 0x31, 0x63, 0x30,
+    // U+0045 E
+    0x27, 0x31, 0x21, 0x21, 0x31, 0x21, 0x21, 0x31, 0x21, 0x21, 0x31, 0x51,
+    0x10,
+    // U+0046 F
+    0x27, 0x31, 0x21, 0x61, 0x21, 0x61, 0x91, 0x70,
+    // U+0047 G
+    0x35, 0x41, 0x51, 0x31, 0x51, 0x31, 0x31, 0x11, 0x41, 0x22, 0x20,
+    // U+0048 H
+    0x27, 0x61, 0x91, 0x91, 0x67, 0x10,
+    // U+0049 I
+    0x21, 0x51, 0x37, 0x31, 0x51, 0x10,
+    // U+004A J
+    0x71, 0xa1, 0x31, 0x51, 0x36, 0x41, 0x70,
+    // U+004B K
+    0x27, 0x61, 0x81, 0x11, 0x61, 0x31, 0x41, 0x51, 0x10,
+    // U+004C L
+    0x27, 0x91, 0x91, 0x91, 0x91, 0x10,
+    // U+004D M
+    0x27, 0x41, 0xa1, 0x81, 0x87, 0x10,
+    // U+004E N
+    0x27, 0x51, 0xa1, 0xa1, 0x57, 0x10,
+    // U+004F O
+    0x35, 0x41, 0x51, 0x31, 0x51, 0x31, 0x51, 0x45, 0x20,
+    // U+0050 P
+    0x27, 0x31, 0x21, 0x61, 0x21, 0x61, 0x21, 0x72, 0x50,
+    // U+0051 Q
+    0x35, 0x41, 0x51, 0x31, 0x31, 0x11, 0x31, 0x41, 0x54, 0x11, 0x10,
+    // U+0052 R
+    0x27, 0x31, 0x21, 0x61, 0x22, 0x51, 0x21, 0x11, 0x52, 0x31, 0x10,
+    // U+0053 S
+    0x32, 0x31, 0x31, 0x21, 0x21, 0x31, 0x21, 0x21, 0x31, 0x21, 0x21, 0x31,
+    0x32, 0x20,
+    // U+0054 T
+    0x21, 0x91, 0x97, 0x31, 0x91, 0x70,
+    // U+0055 U
+    0x26, 0xa1, 0x91, 0x91, 0x36, 0x20,
+    // U+0056 V
+    0x25, 0xa1, 0xa1, 0x81, 0x45, 0x30,
+    // U+0057 W
+    0x27, 0x81, 0x72, 0xa1, 0x47, 0x10,
+    // U+0058 X
+    0x22, 0x32, 0x51, 0x11, 0x81, 0x81, 0x11, 0x52, 0x32, 0x10,
+    // U+0059 Y
+    0x22, 0xa1, 0xa4, 0x51, 0x72, 0x60,
+    // U+005A Z
+    0x21, 0x42, 0x31, 0x31, 0x11, 0x31, 0x21, 0x21, 0x31, 0x11, 0x31, 0x32,
+    0x41, 0x10,
+    // U+005B [
+    0x27, 0x31, 0x51, 0x31, 0x51, 0x10,
+    // U+005C backslash
+    0x31, 0xa1, 0xa1, 0xa1, 0xa1, 0x20,
+    // U+005D ]
+    0x21, 0x51, 0x31, 0x51, 0x37, 0x10,
+    // U+005E ^
+    0x41, 0x81, 0x81, 0xa1, 0xa1, 0x50,
+    // U+005F _
+    0x81, 0x91, 0x91, 0x91, 0x91, 0x10,
+    // U+0060 `
+    0x21, 0xa1, 0xa1, 0x50,
+    // U+0061 a
+    0x71, 0x61, 0x11, 0x11, 0x51, 0x11, 0x11, 0x51, 0x11, 0x11, 0x64, 0x10,
+    // U+0062 b
+    0x27, 0x61, 0x21, 0x51, 0x31, 0x51, 0x31, 0x63, 0x20,
+    // U+0063 c
+    0x53, 0x61, 0x31, 0x51, 0x31, 0x51, 0x31, 0x81, 0x20,
+    // U+0064 d
+    0x53, 0x61, 0x31, 0x51, 0x31, 0x61, 0x21, 0x37, 0x10,
+    // U+0065 e
+    0x53, 0x61, 0x11, 0x11, 0x51, 0x11, 0x11, 0x51, 0x11, 0x11, 0x62, 0x30,
+    // U+0066 f
+    0x51, 0x76, 0x31, 0x21, 0x61, 0xa1, 0x60,
+    // U+0067 g
+    0x51, 0x81, 0x11, 0x71, 0x11, 0x11, 0x51, 0x11, 0x11, 0x54, 0x20,
+    // U+0068 h
+    0x27, 0x61, 0x81, 0x91, 0xa4, 0x10,
+    // U+0069 i
+    0x41, 0x31, 0x31, 0x15, 0x91, 0x10,
+    // U+006A j
+    0x71, 0xa1, 0x51, 0x31, 0x31, 0x14, 0x20,
+    // U+006B k
+    0x27, 0x71, 0x81, 0x11, 0x61, 0x31, 0x10,
+    // U+006C l
+    0x21, 0x51, 0x37, 0x91, 0x10,
+    // U+006D m
+    0x45, 0x51, 0xa2, 0x71, 0xa4, 0x10,
+    // U+006E n
+    0x45, 0x61, 0x81, 0x91, 0xa4, 0x10,
+    // U+006F o
+    0x53, 0x61, 0x31, 0x51, 0x31, 0x51, 0x31, 0x63, 0x20,
+    // U+0070 p
+    0x45, 0x51, 0x11, 0x71, 0x11, 0x71, 0x11, 0x81, 0x40,
+    // U+0071 q
+    0x51, 0x81, 0x11, 0x71, 0x11, 0x82, 0x75, 0x10,
+    // U+0072 r
+    0x45, 0x61, 0x81, 0x91, 0xa1, 0x40,
+    // U+0073 s
+    0x51, 0x21, 0x51, 0x11, 0x11, 0x51, 0x11, 0x11, 0x51, 0x11, 0x11, 0x81,
+    0x20,
+    // U+0074 t
+    0x41, 0x76, 0x61, 0x31, 0x91, 0x81, 0x20,
+    // U+0075 u
+    0x44, 0xa1, 0x91, 0x81, 0x65, 0x10,
+    // U+0076 v
+    0x43, 0xa1, 0xa1, 0x81, 0x63, 0x30,
+    // U+0077 w
+    0x44, 0xa1, 0x72, 0xa1, 0x54, 0x20,
+    // U+0078 x
+    0x41, 0x31, 0x61, 0x11, 0x81, 0x81, 0x11, 0x61, 0x31, 0x10,
+    // U+0079 y
+    0x42, 0xa1, 0x11, 0x71, 0x11, 0x71, 0x11, 0x54, 0x20,
+    // U+007A z
+    0x41, 0x31, 0x51, 0x22, 0x51, 0x11, 0x11, 0x52, 0x21, 0x51, 0x31, 0x10,
+    // U+007B {
+    0x51, 0x72, 0x12, 0x41, 0x51, 0x10,
+    // U+007C |
+    0x27, 0x10,
+    // U+007D }
+    0x21, 0x51, 0x42, 0x12, 0x71, 0x40,
+    // U+007E ~
+    0x51, 0x81, 0x91, 0xa1, 0x81, 0x50,
+    // U+00A0 no-break space
+    0xf0, 0xf0,
+    // U+00A1 ¡
+    0x21, 0x15, 0x10,
+    // U+00A2 ¢
+    0x43, 0x61, 0x31, 0x47, 0x41, 0x31, 0x20,
+    // U+00A3 £
+    0x51, 0x21, 0x46, 0x31, 0x21, 0x21, 0x31, 0x51, 0x41, 0x31, 0x20,
+    // U+00A4 ¤
+    0x31, 0x31, 0x63, 0x71, 0x11, 0x73, 0x61, 0x31, 0x20,
+    // U+00A5 ¥
+    0x01, 0x21, 0x11, 0x51, 0x11, 0x11, 0x65, 0x41, 0x11, 0x11, 0x41, 0x21,
+    0x11, 0x40,
+    // U+00A6 ¦
+    0x23, 0x13, 0x10,
+    // U+00A7 §
+    0x11, 0x12, 0x51, 0x11, 0x21, 0x21, 0x11, 0x11, 0x31, 0x11, 0x11, 0x21,
+    0x21, 0x11, 0x52, 0x11, 0x20,
+    // U+00A8 ¨
+    0x01, 0xf0, 0x41, 0x90,
+    // U+00A9 ©
+    0x35, 0x41, 0x21, 0x21, 0x31, 0x11, 0x11, 0x11, 0x31, 0x51, 0x45, 0x20,
+    // U+00AA ª
+    0x01, 0x13, 0x11, 0x31, 0x11, 0x11, 0x11, 0x35, 0x11, 0x30,
+    // U+00AB «
+    0x51, 0x81, 0x11, 0x61, 0x11, 0x11, 0x61, 0x11, 0x61, 0x31, 0x20,
+    // U+00AC ¬
+    0x51, 0x91, 0x91, 0x91, 0x93, 0x20,
+    // U+00AD soft hyphen
+    0x51, 0x91, 0x91, 0x40,
+    // U+00AE ®
+    0x35, 0x41, 0x11, 0x11, 0x11, 0x31, 0x12, 0x12, 0x31, 0x51, 0x45, 0x20,
+    // U+00AF ¯
+    0x01, 0x91, 0x91, 0x91, 0x91, 0x90,
+    // U+00B0 °
+    0x12, 0x71, 0x21, 0x61, 0x21, 0x72, 0x70,
+    // U+00B1 ±
+    0x41, 0x31, 0x51, 0x31, 0x35, 0x11, 0x51, 0x31, 0x51, 0x31, 0x10,
+    // U+00B2 ²
+    0x01, 0x22, 0x51, 0x11, 0x11, 0x61, 0x21, 0x50,
+    // U+00B3 ³
+    0x01, 0x31, 0x51, 0x11, 0x11, 0x61, 0x11, 0x60,
+    // U+00B4 ´
+    0x11, 0x81, 0x90,
+    // U+00B5 µ
+    0x46, 0x81, 0x91, 0x81, 0x65, 0x10,
+    // U+00B6 ¶
+    0x12, 0x74, 0x61, 0x26, 0x13, 0x71, 0x90,
+    // U+00B7 ·
+    0x51, 0x40,
+    // U+00B8 ¸
+    0x91, 0x91,
+    // U+00B9 ¹
+    0x11, 0x85, 0x50,
+    // U+00BA º
+    0x11, 0x21, 0x51, 0x11, 0x11, 0x61, 0x21, 0x50,
+    // U+00BB »
+    0x31, 0x31, 0x61, 0x11, 0x61, 0x11, 0x11, 0x61, 0x11, 0x81, 0x40,
+    // U+00BC ¼
+    0x11, 0x41, 0x34, 0x11, 0x81, 0x81, 0x81, 0x22, 0x41, 0x21, 0x11, 0x91,
+    0x74, 0x20,
+    // U+00BD ½
+    0x11, 0x41, 0x34, 0x11, 0x81, 0x81, 0x81, 0x11, 0x21, 0x31, 0x21, 0x12,
+    0x71, 0x11, 0x20,
+    // U+00BE ¾
+    0x01, 0x31, 0x11, 0x31, 0x11, 0x12, 0x51, 0x12, 0x81, 0x81, 0x22, 0x41,
+    0x21, 0x11, 0x91, 0x74, 0x20,
+    // U+00BF ¿
+    0x71, 0xa1, 0x31, 0x11, 0x31, 0x61, 0x21, 0x72, 0x20,
+    // U+00C0 À
+    0x36, 0x11, 0x11, 0x31, 0x42, 0x31, 0x51, 0x31, 0x66, 0x10,
+    // U+00C1 Á
+    0x36, 0x31, 0x31, 0x42, 0x31, 0x31, 0x11, 0x31, 0x66, 0x10,
+    // U+00C2 Â
+    0x36, 0x22, 0x31, 0x31, 0x11, 0x31, 0x42, 0x31, 0x66, 0x10,
+    // U+00C3 Ã
+    0x11, 0x16, 0x11, 0x11, 0x31, 0x42, 0x31, 0x42, 0x31, 0x31, 0x26, 0x10,
+    // U+00C4 Ä
+    0x36, 0x11, 0x11, 0x31, 0x51, 0x31, 0x31, 0x11, 0x31, 0x66, 0x10,
+    // U+00C5 Å
+    0x36, 0x22, 0x31, 0x31, 0x11, 0x31, 0x42, 0x31, 0x66, 0x10,
+    // U+00C6 Æ
+    0x45, 0x41, 0x21, 0x51, 0x31, 0x57, 0x31, 0x22, 0x11, 0x31, 0x21, 0x21,
+    0x31, 0x51, 0x10,
+    // U+00C7 Ç
+    0x35, 0x41, 0x51, 0x31, 0x52, 0x21, 0x52, 0x31, 0x31, 0x20,
+    // U+00C8 È
+    0x27, 0x11, 0x11, 0x21, 0x21, 0x22, 0x21, 0x21, 0x31, 0x21, 0x21, 0x31,
+    0x51, 0x10,
+    // U+00C9 É
+    0x27, 0x31, 0x21, 0x21, 0x22, 0x21, 0x21, 0x11, 0x11, 0x21, 0x21, 0x31,
+    0x51, 0x10,
+    // U+00CA Ê
+    0x27, 0x22, 0x21, 0x21, 0x11, 0x11, 0x21, 0x21, 0x22, 0x21, 0x21, 0x31,
+    0x51, 0x10,
+    // U+00CB Ë
+    0x27, 0x11, 0x11, 0x21, 0x21, 0x31, 0x21, 0x21, 0x11, 0x11, 0x21, 0x21,
+    0x31, 0x51, 0x10,
+    // U+00CC Ì
+    0x01, 0x11, 0x51, 0x28, 0x31, 0x51, 0x10,
+    // U+00CD Í
+    0x21, 0x51, 0x28, 0x11, 0x11, 0x51, 0x10,
+    // U+00CE Î
+    0x12, 0x51, 0x11, 0x17, 0x22, 0x51, 0x10,
+    // U+00CF Ï
+    0x01, 0x11, 0x51, 0x37, 0x11, 0x11, 0x51, 0x10,
+    // U+00D0 Ð
+    0x27, 0x31, 0x21, 0x21, 0x31, 0x21, 0x21, 0x41, 0x31, 0x63, 0x30,
+    // U+00D1 Ñ
+    0x18, 0x11, 0x31, 0x61, 0x31, 0x51, 0x41, 0x31, 0x17, 0x10,
+    // U+00D2 Ò
+    0x35, 0x21, 0x11, 0x51, 0x22, 0x51, 0x31, 0x51, 0x45, 0x20,
+    // U+00D3 Ó
+    0x35, 0x41, 0x51, 0x22, 0x51, 0x11, 0x11, 0x51, 0x45, 0x20,
+    // U+00D4 Ô
+    0x35, 0x32, 0x51, 0x11, 0x11, 0x51, 0x22, 0x51, 0x45, 0x20,
+    // U+00D5 Õ
+    0x11, 0x15, 0x21, 0x11, 0x51, 0x22, 0x51, 0x22, 0x51, 0x11, 0x25, 0x20,
+    // U+00D6 Ö
+    0x35, 0x21, 0x11, 0x51, 0x31, 0x51, 0x11, 0x11, 0x51, 0x45, 0x20,
+    // U+00D7 ×
+    0x31, 0x31, 0x61, 0x11, 0x81, 0x81, 0x11, 0x61, 0x31, 0x20,
+    // U+00D8 Ø
+    0x35, 0x41, 0x42, 0x31, 0x13, 0x11, 0x32, 0x41, 0x45, 0x20,
+    // U+00D9 Ù
+    0x26, 0x21, 0x71, 0x21, 0x61, 0x91, 0x36, 0x20,
+    // U+00DA Ú
+    0x26, 0xa1, 0x21, 0x61, 0x11, 0x71, 0x36, 0x20,
+    // U+00DB Û
+    0x26, 0x31, 0x61, 0x11, 0x71, 0x21, 0x61, 0x36, 0x20,
+    // U+00DC Ü
+    0x26, 0x21, 0x71, 0x91, 0x11, 0x71, 0x36, 0x20,
+    // U+00DD Ý
+    0x22, 0xa1, 0x61, 0x34, 0x11, 0x31, 0x72, 0x60,
+    // U+00DE Þ
+    0x27, 0x41, 0x21, 0x61, 0x21, 0x61, 0x21, 0x72, 0x40,
+    // U+00DF ß
+    0x36, 0x31, 0x91, 0x21, 0x21, 0x42, 0x11, 0x11, 0x81, 0x20,
+    // U+00E0 à
+    0x71, 0x41, 0x11, 0x11, 0x11, 0x42, 0x11, 0x11, 0x51, 0x11, 0x11, 0x64,
+    0x10,
+    // U+00E1 á
+    0x71, 0x61, 0x11, 0x11, 0x42, 0x11, 0x11, 0x31, 0x11, 0x11, 0x11, 0x64,
+    0x10,
+    // U+00E2 â
+    0x71, 0x52, 0x11, 0x11, 0x31, 0x11, 0x11, 0x11, 0x42, 0x11, 0x11, 0x64,
+    0x10,
+    // U+00E3 ã
+    0x31, 0x31, 0x41, 0x11, 0x11, 0x11, 0x42, 0x11, 0x11, 0x42, 0x11, 0x11,
+    0x31, 0x24, 0x10,
+    // U+00E4 ä
+    0x71, 0x41, 0x11, 0x11, 0x11, 0x51, 0x11, 0x11, 0x31, 0x11, 0x11, 0x11,
+    0x64, 0x10,
+    // U+00E5 å
+    0x71, 0x52, 0x11, 0x11, 0x31, 0x11, 0x11, 0x11, 0x42, 0x11, 0x11, 0x64,
+    0x10,
+    // U+00E6 æ
+    0x71, 0x61, 0x11, 0x11, 0x51, 0x11, 0x11, 0x63, 0x61, 0x11, 0x11, 0x51,
+    0x11, 0x11, 0x62, 0x11, 0x10,
+    // U+00E7 ç
+    0x53, 0x61, 0x31, 0x51, 0x32, 0x41, 0x32, 0x71, 0x20,
+    // U+00E8 è
+    0x53, 0x41, 0x11, 0x11, 0x11, 0x42, 0x11, 0x11, 0x51, 0x11, 0x11, 0x62,
+    0x30,
+    // U+00E9 é
+    0x53, 0x61, 0x11, 0x11, 0x42, 0x11, 0x11, 0x31, 0x11, 0x11, 0x11, 0x62,
+    0x30,
+    // U+00EA ê
+    0x53, 0x52, 0x11, 0x11, 0x31, 0x11, 0x11, 0x11, 0x42, 0x11, 0x11, 0x62,
+    0x30,
+    // U+00EB ë
+    0x53, 0x41, 0x11, 0x11, 0x11, 0x51, 0x11, 0x11, 0x31, 0x11, 0x11, 0x11,
+    0x62, 0x30,
+    // U+00EC ì
+    0x21, 0x11, 0x31, 0x46, 0x91, 0x10,
+    // U+00ED í
+    0x41, 0x31, 0x46, 0x31, 0x51, 0x10,
+    // U+00EE î
+    0x32, 0x31, 0x31, 0x15, 0x41, 0x41, 0x10,
+    // U+00EF ï
+    0x21, 0x11, 0x31, 0x55, 0x31, 0x51, 0x10,
+    // U+00F0 ð
+    0x71, 0x41, 0x11, 0x11, 0x11, 0x41, 0x21, 0x11, 0x31, 0x11, 0x11, 0x11,
+    0x63, 0x20,
+    // U+00F1 ñ
+    0x36, 0x31, 0x21, 0x72, 0x82, 0x71, 0x24, 0x10,
+    // U+00F2 ò
+    0x53, 0x41, 0x11, 0x31, 0x42, 0x31, 0x51, 0x31, 0x63, 0x20,
+    // U+00F3 ó
+    0x53, 0x61, 0x31, 0x42, 0x31, 0x31, 0x11, 0x31, 0x63, 0x20,
+    // U+00F4 ô
+    0x53, 0x52, 0x31, 0x31, 0x11, 0x31, 0x42, 0x31, 0x63, 0x20,
+    // U+00F5 õ
+    0x31, 0x13, 0x41, 0x11, 0x31, 0x42, 0x31, 0x42, 0x31, 0x31, 0x23, 0x20,
+    // U+00F6 ö
+    0x53, 0x41, 0x11, 0x31, 0x51, 0x31, 0x31, 0x11, 0x31, 0x63, 0x20,
+    // U+00F7 ÷
+    0x51, 0x91, 0x71, 0x11, 0x11, 0x71, 0x91, 0x40,
+    // U+00F8 ø
+    0x53, 0x61, 0x22, 0x51, 0x11, 0x11, 0x52, 0x21, 0x63, 0x20,
+    // U+00F9 ù
+    0x44, 0x41, 0x51, 0x41, 0x41, 0x81, 0x65, 0x10,
+    // U+00FA ú
+    0x44, 0xa1, 0x41, 0x41, 0x31, 0x41, 0x65, 0x10,
+    // U+00FB û
+    0x44, 0x51, 0x41, 0x31, 0x51, 0x41, 0x31, 0x65, 0x10,
+    // U+00FC ü
+    0x44, 0x41, 0x51, 0x91, 0x31, 0x41, 0x65, 0x10,
+    // U+00FD ý
+    0x42, 0xa1, 0x11, 0x41, 0x21, 0x11, 0x31, 0x31, 0x11, 0x54, 0x20,
+    // U+00FE þ
+    0x28, 0x41, 0x21, 0x61, 0x21, 0x61, 0x21, 0x72, 0x30,
+    // U+00FF ÿ
+    0x42, 0x61, 0x31, 0x11, 0x71, 0x11, 0x31, 0x31, 0x11, 0x54, 0x20,
+};
+
+static const struct font_glyph glyphs[] = {
+    {0, 3}, {2, 1}, {5, 3}, {9, 5}, {18, 5}, {30, 5}, {40, 5}, {54, 2},
+    {58, 3}, {64, 3}, {70, 5}, {80, 5}, {86, 2}, {90, 5}, {96, 2}, {99, 5},
+    {105, 5}, {117, 3}, {122, 5}, {135, 5}, {148, 5}, {156, 5}, {170, 5},
+    {182, 5}, {191, 5}, {205, 5}, {217, 2}, {222, 2}, {228, 4}, {236, 5},
+    {247, 4}, {255, 5}, {264, 5}, {275, 5}, {284, 5}, {297, 5}, {307, 5},
+    {316, 5}, {329, 5}, {337, 5}, {348, 5}, {354, 3}, {360, 5}, {367, 5},
+    {376, 5}, {382, 5}, {388, 5}, {394, 5}, {403, 5}, {412, 5}, {423, 5},
+    {434, 5}, {448, 5}, {454, 5}, {460, 5}, {466, 5}, {472, 5}, {482, 5},
+    {488, 5}, {502, 3}, {508, 5}, {514, 3}, {520, 5}, {526, 5}, {532, 3},
+    {536, 5}, {548, 5}, {557, 5}, {566, 5}, {575, 5}, {587, 5}, {594, 5},
+    {605, 5}, {611, 3}, {617, 4}, {624, 4}, {631, 3}, {636, 5}, {642, 5},
+    {648, 5}, {657, 5}, {666, 5}, {674, 5}, {680, 5}, {693, 5}, {700, 5},
+    {706, 5}, {712, 5}, {718, 5}, {728, 5}, {737, 5}, {749, 3}, {755, 1},
+    {757, 3}, {763, 5}, {769, 3}, {771, 1}, {774, 4}, {781, 5}, {792, 5},
+    {801, 5}, {815, 1}, {818, 5}, {835, 3}, {839, 5}, {851, 3}, {861, 5},
+    {872, 5}, {878, 3}, {882, 5}, {894, 5}, {900, 4}, {907, 5}, {918, 3},
+    {926, 3}, {934, 2}, {937, 5}, {943, 5}, {950, 1}, {952, 2}, {954, 2},
+    {957, 3}, {965, 5}, {976, 8}, {990, 7}, {1005, 8}, {1022, 5}, {1031, 5},
+    {1041, 5}, {1051, 5}, {1061, 5}, {1073, 5}, {1084, 5}, {1094, 7},
+    {1109, 5}, {1119, 5}, {1133, 5}, {1147, 5}, {1161, 5}, {1176, 3},
+    {1183, 3}, {1190, 3}, {1197, 3}, {1205, 5}, {1216, 5}, {1226, 5},
+    {1236, 5}, {1246, 5}, {1256, 5}, {1268, 5}, {1279, 5}, {1289, 5},
+    {1299, 5}, {1307, 5}, {1315, 5}, {1324, 5}, {1332, 5}, {1340, 5},
+    {1349, 5}, {1359, 5}, {1372, 5}, {1385, 5}, {1398, 5}, {1413, 5},
+    {1427, 5}, {1440, 7}, {1457, 5}, {1466, 5}, {1479, 5}, {1492, 5},
+    {1505, 5}, {1519, 3}, {1525, 3}, {1531, 3}, {1538, 3}, {1545, 5},
+    {1559, 5}, {1567, 5}, {1577, 5}, {1587, 5}, {1597, 5}, {1609, 5},
+    {1620, 5}, {1628, 5}, {1638, 5}, {1646, 5}, {1654, 5}, {1663, 5},
+    {1671, 5}, {1682, 5}, {1691, 5},
+};
+
+const struct font font_latin1 = {FONT_LATIN1_HEIGHT, glyphs, runs};
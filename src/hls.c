@@ -0,0 +1,118 @@
+#include "hls.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+void hls_playlist_init(struct hls_playlist *playlist) {
+  memset(playlist, 0, sizeof(*playlist));
+}
+
+// Returns the value of tag if line starts with it, NULL otherwise
+static const char *tag_value(const char *line, const char *tag) {
+  const size_t len = strlen(tag);
+  return strncmp(line, tag, len) == 0 ? line + len : NULL;
+}
+
+static void add_entry(struct hls_playlist *playlist, const char *uri) {
+  if (playlist->count == HLS_MAX_ENTRIES) {
+    memmove(&playlist->entries[0], &playlist->entries[1],
+            sizeof(playlist->entries[0]) * (HLS_MAX_ENTRIES - 1));
+    --playlist->count;
+    ++playlist->sequence;
+  }
+
+  strcpy(playlist->entries[playlist->count].uri, uri);
+  playlist->entries[playlist->count].bandwidth = playlist->bandwidth;
+  ++playlist->count;
+  playlist->bandwidth = 0;
+}
+
+// Picks the URIs out of the FileN= keys of a PLS playlist, the titles and
+// lengths are of no use
+static void parse_pls_line(struct hls_playlist *playlist, char *line) {
+  if (strncasecmp(line, "File", 4) != 0)
+    return;
+  char *value = line + 4;
+  while (*value >= '0' && *value <= '9')
+    ++value;
+  if (value > line + 4 && *value == '=')
+    add_entry(playlist, value + 1);
+}
+
+static void parse_line(struct hls_playlist *playlist, char *line) {
+  const size_t len = strlen(line);
+  if (len > 0 && line[len - 1] == '\r')
+    line[len - 1] = '\0';
+
+  const char *value;
+  if (line[0] == '\0') {
+    return;
+  } else if (playlist->pls) {
+    parse_pls_line(playlist, line);
+  } else if (strcasecmp(line, "[playlist]") == 0) {
+    playlist->pls = true;
+  } else if (line[0] != '#') {
+    add_entry(playlist, line);
+  } else if ((value = tag_value(line, "#EXT-X-TARGETDURATION:")) != NULL) {
+    playlist->target_duration = atoi(value);
+  } else if ((value = tag_value(line, "#EXT-X-MEDIA-SEQUENCE:")) != NULL) {
+    playlist->sequence = strtoul(value, NULL, 10);
+  } else if (tag_value(line, "#EXT-X-ENDLIST") != NULL) {
+    playlist->end = true;
+  } else if ((value = tag_value(line, "#EXT-X-STREAM-INF:")) != NULL) {
+    // the variant URI follows on the next line
+    playlist->master = true;
+    const char *bandwidth = strstr(value, "BANDWIDTH=");
+    if (bandwidth != NULL)
+      playlist->bandwidth = strtoul(bandwidth + 10, NULL, 10);
+  }
+}
+
+void hls_playlist_feed(struct hls_playlist *playlist, const uint8_t *data,
+                       size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    if (data[i] == '\n') {
+      playlist->line[playlist->line_len] = '\0';
+      if (!playlist->overflow)
+        parse_line(playlist, playlist->line);
+      playlist->line_len = 0;
+      playlist->overflow = false;
+    } else if (playlist->line_len < sizeof(playlist->line) - 1) {
+      playlist->line[playlist->line_len++] = data[i];
+    } else {
+      playlist->overflow = true;
+    }
+  }
+}
+
+void hls_playlist_finish(struct hls_playlist *playlist) {
+  if (playlist->line_len > 0)
+    hls_playlist_feed(playlist, (const uint8_t *)"\n", 1);
+}
+
+int hls_resolve(const char *base, const char *uri, char *url, size_t size) {
+  size_t prefix_len;
+
+  if (strncmp(uri, "http://", 7) == 0 || strncmp(uri, "https://", 8) == 0) {
+    prefix_len = 0;
+  } else if (uri[0] == '/') {
+    // keep scheme and authority of the base
+    const char *authority = strstr(base, "://");
+    if (authority == NULL)
+      return 1;
+    authority += 3;
+    prefix_len = authority + strcspn(authority, "/") - base;
+  } else {
+    // replace the last path segment of the base, ignoring the query
+    prefix_len = strcspn(base, "?");
+    while (prefix_len > 0 && base[prefix_len - 1] != '/')
+      --prefix_len;
+  }
+
+  if (prefix_len + strlen(uri) >= size)
+    return 1;
+  memcpy(url, base, prefix_len);
+  strcpy(url + prefix_len, uri);
+  return 0;
+}
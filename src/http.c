@@ -0,0 +1,284 @@
+#include "http.h"
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+void http_parser_init(struct http_parser *parser, http_header_cb header,
+                      http_body_cb body) {
+  memset(parser, 0, sizeof(*parser));
+  parser->state = HTTP_STATUS;
+  parser->header_cb = header;
+  parser->body_cb = body;
+  parser->response.metaint = -1;
+  parser->response.content_length = -1;
+}
+
+// Appends data to the current line until a line feed is found. Returns the
+// number of bytes consumed and sets *complete once the line is terminated.
+// The line is stored without "\r\n".
+static size_t collect_line(struct http_parser *parser, const uint8_t *data,
+                           size_t len, bool *complete) {
+  const uint8_t *end = memchr(data, '\n', len);
+  const size_t n = end != NULL ? end - data : len;
+  const size_t copy = min(n, sizeof(parser->line) - 1 - parser->line_len);
+
+  memcpy(parser->line + parser->line_len, data, copy);
+  parser->line_len += copy;
+
+  *complete = end != NULL;
+  if (*complete) {
+    if (parser->line_len > 0 && parser->line[parser->line_len - 1] == '\r')
+      --parser->line_len;
+    parser->line[parser->line_len] = '\0';
+    return n + 1;
+  }
+  return n;
+}
+
+// Copies value up to the first ';' or space, which strips parameters like
+// the charset from the Content-Type.
+static void copy_token(char *dst, size_t size, const char *value) {
+  size_t len = strcspn(value, "; ");
+  if (len >= size)
+    len = size - 1;
+  memcpy(dst, value, len);
+  dst[len] = '\0';
+}
+
+// Returns the value of the n decimal digits at p, -1 if there are others
+static int parse_digits(const char *p, int n) {
+  int value = 0;
+  for (int i = 0; i < n; ++i) {
+    if (p[i] < '0' || p[i] > '9')
+      return -1;
+    value = value * 10 + p[i] - '0';
+  }
+  return value;
+}
+
+// Parses an IMF-fixdate like "Sun, 06 Nov 1994 08:49:37 GMT" into seconds
+// since the epoch. The obsolete date formats give 0 like a malformed date.
+static uint32_t parse_date(const char *value) {
+  static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  // ", 06 Nov 1994 08:49:37 GMT"
+  const char *p = strchr(value, ',');
+  if (p == NULL || strlen(p) < 26 || p[1] != ' ' || p[4] != ' ' ||
+      p[8] != ' ' || p[13] != ' ' || p[16] != ':' || p[19] != ':' ||
+      strncmp(p + 22, " GMT", 4) != 0)
+    return 0;
+
+  int month = 0;
+  while (month < 12 && strncmp(months + 3 * month, p + 5, 3) != 0)
+    ++month;
+  const int day = parse_digits(p + 2, 2), year = parse_digits(p + 9, 4);
+  const int hour = parse_digits(p + 14, 2), min = parse_digits(p + 17, 2),
+            sec = parse_digits(p + 20, 2);
+  if (month == 12 || day < 1 || day > 31 || year < 1970 || year > 2105 ||
+      hour < 0 || hour > 23 || min < 0 || min > 59 || sec < 0 || sec > 60)
+    return 0;
+
+  // days since 1970-01-01 in a calendar whose years start in March, so the
+  // leap day comes last
+  const int y = year - (month < 2);
+  const int m = (month + 10) % 12;
+  const uint32_t days = 365 * (y - 1969) + y / 4 - y / 100 + y / 400 -
+                        (1969 / 4 - 1969 / 100 + 1969 / 400) +
+                        (153 * m + 2) / 5 + day - 1 - 306;
+  return days * 86400 + hour * 3600 + min * 60 + sec;
+}
+
+static void parse_header_line(struct http_response *response, char *line) {
+  char *value = strchr(line, ':');
+  if (value == NULL)
+    return;
+  *value++ = '\0';
+  while (*value == ' ' || *value == '\t')
+    ++value;
+
+  if (strcasecmp(line, "Content-Type") == 0) {
+    copy_token(response->content_type, sizeof(response->content_type), value);
+  } else if (strcasecmp(line, "Location") == 0) {
+    strncpy(response->location, value, sizeof(response->location) - 1);
+  } else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+    // chunked is always the last transfer coding
+    const size_t len = strlen(value);
+    response->chunked =
+        len >= 7 && strcasecmp(value + len - 7, "chunked") == 0;
+  } else if (strcasecmp(line, "Content-Length") == 0) {
+    response->content_length = atol(value);
+  } else if (strcasecmp(line, "Connection") == 0) {
+    if (strcasecmp(value, "close") == 0)
+      response->keep_alive = false;
+    else if (strcasecmp(value, "keep-alive") == 0)
+      response->keep_alive = true;
+  } else if (strcasecmp(line, "Date") == 0) {
+    response->date = parse_date(value);
+  } else if (strcasecmp(line, "icy-metaint") == 0) {
+    response->metaint = atoi(value);
+  } else if (strcasecmp(line, "icy-br") == 0) {
+    // some servers send a list like "128,128"
+    response->bitrate = atoi(value);
+  }
+}
+
+// Handles a complete line of the header or the chunk framing. Returns
+// HTTP_CONTINUE if parsing goes on.
+static enum http_result parse_line(struct http_parser *parser) {
+  char *line = parser->line;
+  parser->line_len = 0;
+
+  switch (parser->state) {
+  case HTTP_STATUS: {
+    // "HTTP/1.1 200 OK", SHOUTcast servers reply with "ICY 200 OK"
+    const char *status = strchr(line, ' ');
+    if (status == NULL || (strncmp(line, "HTTP/", 5) != 0 &&
+                           strncmp(line, "ICY ", 4) != 0)) {
+      printf("invalid reply status: %s\n", line);
+      return HTTP_ERROR;
+    }
+    parser->response.status = atoi(status + 1);
+    // connections are persistent by default since HTTP/1.1
+    parser->response.keep_alive = strncmp(line, "HTTP/1.1", 8) == 0;
+    parser->state = HTTP_HEADER;
+    break;
+  }
+  case HTTP_HEADER:
+    if (*line != '\0') {
+      parse_header_line(&parser->response, line);
+      break;
+    }
+    // an interim response like "100 Continue" is followed by the real one
+    if (parser->response.status / 100 == 1) {
+      http_parser_init(parser, parser->header_cb, parser->body_cb);
+      break;
+    }
+    if (!parser->header_cb(&parser->response))
+      return HTTP_DONE;
+    if (parser->response.chunked) {
+      parser->state = HTTP_CHUNK_SIZE;
+      break;
+    }
+    parser->body_remaining = parser->response.content_length;
+    parser->state = parser->body_remaining != 0 ? HTTP_BODY : HTTP_END;
+    if (parser->state == HTTP_END)
+      return HTTP_DONE;
+    break;
+  case HTTP_CHUNK_SIZE: {
+    // the CRLF that terminates the previous chunk
+    if (*line == '\0')
+      break;
+    char *end;
+    const unsigned long size = strtoul(line, &end, 16);
+    // chunk extensions follow after a ';'
+    if (end == line || (*end != '\0' && *end != ';' && *end != ' ') ||
+        size > HTTP_CHUNK_MAX) {
+      printf("invalid chunk size: %s\n", line);
+      return HTTP_ERROR;
+    }
+    parser->chunk_remaining = size;
+    parser->state =
+        parser->chunk_remaining > 0 ? HTTP_CHUNK_DATA : HTTP_TRAILER;
+    break;
+  }
+  case HTTP_TRAILER:
+    if (*line == '\0') {
+      parser->state = HTTP_END;
+      return HTTP_DONE;
+    }
+    break;
+  default:
+    break;
+  }
+
+  return HTTP_CONTINUE;
+}
+
+enum http_result http_parse(struct http_parser *parser, const uint8_t *data,
+                            size_t len) {
+  while (len > 0) {
+    size_t n;
+
+    switch (parser->state) {
+    case HTTP_BODY:
+      if (parser->body_remaining < 0) {
+        parser->body_cb(data, len);
+        return HTTP_CONTINUE;
+      }
+      n = min_size(len, parser->body_remaining);
+      parser->body_cb(data, n);
+      parser->body_remaining -= n;
+      if (parser->body_remaining == 0) {
+        parser->state = HTTP_END;
+        return HTTP_DONE;
+      }
+      break;
+    case HTTP_END:
+      // more data than announced, the connection can't be reused
+      parser->response.keep_alive = false;
+      return HTTP_DONE;
+    case HTTP_CHUNK_DATA:
+      n = min_size(len, parser->chunk_remaining);
+      parser->body_cb(data, n);
+      parser->chunk_remaining -= n;
+      if (parser->chunk_remaining == 0)
+        parser->state = HTTP_CHUNK_SIZE;
+      break;
+    default: {
+      bool complete;
+      n = collect_line(parser, data, len, &complete);
+      if (complete) {
+        const enum http_result result = parse_line(parser);
+        if (result != HTTP_CONTINUE)
+          return result;
+      }
+      break;
+    }
+    }
+
+    data += n;
+    len -= n;
+  }
+
+  return HTTP_CONTINUE;
+}
+
+int http_parse_url(const char *url, char *host, size_t host_size,
+                   uint16_t *port, bool *secure, const char **path) {
+  if (url[0] == '/') {
+    *path = url;
+    return 0;
+  }
+
+  if (strncasecmp(url, "http://", 7) == 0) {
+    *secure = false;
+    url += 7;
+  } else if (strncasecmp(url, "https://", 8) == 0) {
+    *secure = true;
+    url += 8;
+  } else {
+    return 1;
+  }
+
+  const size_t host_len = strcspn(url, ":/");
+  if (host_len == 0 || host_len >= host_size)
+    return 1;
+  memcpy(host, url, host_len);
+  host[host_len] = '\0';
+  url += host_len;
+
+  *port = *secure ? 443 : 80;
+  if (*url == ':') {
+    char *end;
+    const unsigned long p = strtoul(url + 1, &end, 10);
+    if (p == 0 || p > 65535)
+      return 1;
+    *port = p;
+    url = end;
+  }
+
+  *path = *url == '/' ? url : "/";
+  return 0;
+}
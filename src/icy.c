@@ -0,0 +1,123 @@
+#include "icy.h"
+#include "common.h"
+
+#include <string.h>
+
+void icy_init(struct icy_demuxer *icy, int metaint, icy_audio_cb audio,
+              icy_metadata_cb metadata) {
+  memset(icy, 0, sizeof(*icy));
+  icy->audio_cb = audio;
+  icy->metadata_cb = metadata;
+  icy->metaint = metaint;
+  icy->state = ICY_AUDIO;
+  icy->remaining = metaint;
+  icy->meta_state = ICY_KEY;
+}
+
+static void append(char *buf, size_t *len, size_t size, char c) {
+  if (*len < size - 1)
+    buf[(*len)++] = c;
+}
+
+static void emit_value(struct icy_demuxer *icy) {
+  icy->key[icy->key_len] = '\0';
+  icy->value[icy->value_len] = '\0';
+
+  if (strcmp(icy->key, "StreamTitle") == 0)
+    icy->metadata_cb(ICY_STREAM_TITLE, icy->value);
+  else if (strcmp(icy->key, "StreamUrl") == 0)
+    icy->metadata_cb(ICY_STREAM_URL, icy->value);
+}
+
+// Metadata is a sequence of Key='value'; records padded with zero bytes.
+// Values may contain single quotes, only "';" terminates them.
+static void parse_metadata(struct icy_demuxer *icy, const uint8_t *data,
+                           size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    const char c = data[i];
+
+    switch (icy->meta_state) {
+    case ICY_KEY:
+      if (c == '=')
+        icy->meta_state = ICY_OPEN;
+      else if (c != '\0')
+        append(icy->key, &icy->key_len, sizeof(icy->key), c);
+      break;
+    case ICY_OPEN:
+      icy->meta_state = c == '\'' ? ICY_VALUE : ICY_SKIP;
+      icy->value_len = 0;
+      break;
+    case ICY_QUOTE:
+      if (c == ';' || c == '\0') {
+        emit_value(icy);
+        icy->meta_state = ICY_KEY;
+        icy->key_len = 0;
+        break;
+      }
+      // the quote was part of the value
+      append(icy->value, &icy->value_len, sizeof(icy->value), '\'');
+      icy->meta_state = ICY_VALUE;
+      // fall through
+    case ICY_VALUE:
+      if (c == '\'')
+        icy->meta_state = ICY_QUOTE;
+      else
+        append(icy->value, &icy->value_len, sizeof(icy->value), c);
+      break;
+    case ICY_SKIP:
+      // malformed record, ignore the rest of the block
+      break;
+    }
+  }
+}
+
+// Called at the end of every metadata block. Records never span blocks.
+static void finish_metadata(struct icy_demuxer *icy) {
+  if (icy->meta_state == ICY_QUOTE)
+    emit_value(icy);
+  icy->meta_state = ICY_KEY;
+  icy->key_len = 0;
+}
+
+void icy_feed(struct icy_demuxer *icy, const uint8_t *data, size_t len) {
+  if (icy->metaint <= 0) {
+    icy->audio_cb(data, len);
+    return;
+  }
+
+  while (len > 0) {
+    size_t n = 1;
+    switch (icy->state) {
+    case ICY_AUDIO:
+      n = min(len, icy->remaining);
+      icy->audio_cb(data, n);
+      icy->remaining -= n;
+      if (icy->remaining == 0)
+        icy->state = ICY_LENGTH;
+      break;
+    case ICY_LENGTH:
+      // the first byte after a block of audio data is the length of the
+      // following metadata in units of 16 bytes
+      icy->remaining = 16 * data[0];
+      if (icy->remaining > 0) {
+        icy->state = ICY_META;
+      } else {
+        icy->state = ICY_AUDIO;
+        icy->remaining = icy->metaint;
+      }
+      break;
+    case ICY_META:
+      n = min(len, icy->remaining);
+      parse_metadata(icy, data, n);
+      icy->remaining -= n;
+      if (icy->remaining == 0) {
+        finish_metadata(icy);
+        icy->state = ICY_AUDIO;
+        icy->remaining = icy->metaint;
+      }
+      break;
+    }
+    data += n;
+    len -= n;
+  }
+}
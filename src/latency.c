@@ -0,0 +1,152 @@
+#include "latency.h"
+#include "audio.h"
+#include "fifo.h"
+
+#include "espressif/esp_common.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Arrival times are kept for one position per interval, which covers about
+// 16 s of buffered audio
+#define ARRIVAL_COUNT 64
+#define ARRIVAL_INTERVAL 250000 // us
+// The stream rate is measured over the last few intervals, so frames of
+// different sizes in VBR streams average out
+#define RATE_INTERVAL 1000000 // us
+#define RATE_INTERVALS 4
+// The DMA ring holds less than a frame, the last few frames decoded cover
+// every sample that is still queued
+#define FRAME_COUNT 4
+
+struct arrival {
+  uint32_t pos;  // FIFO write count
+  uint32_t time; // us
+};
+
+static struct arrival arrivals[ARRIVAL_COUNT];
+static size_t newest;
+static size_t arrival_count;
+
+// A point of the stream in the FIFO and in the output
+struct stream_point {
+  uint32_t pos;     // FIFO read count
+  uint32_t samples; // audio_written()
+};
+
+// the ends of the frames decoded last
+static struct stream_point frames[FRAME_COUNT];
+static size_t newest_frame;
+static size_t frame_count;
+
+// the starts of the last intervals of the rate measurement
+static struct stream_point marks[RATE_INTERVALS + 1];
+static size_t newest_mark;
+static size_t mark_count;
+static uint32_t rate_time; // us, start of the current interval
+static unsigned int byte_rate;
+
+void latency_arrival(uint32_t pos, uint32_t time) {
+  taskENTER_CRITICAL();
+  if (arrival_count > 0 && time - arrivals[newest].time < ARRIVAL_INTERVAL) {
+    // the chunk arrived within the interval of the newest entry
+    arrivals[newest].pos = pos;
+  } else {
+    newest = (newest + 1) % ARRIVAL_COUNT;
+    arrivals[newest].pos = pos;
+    arrivals[newest].time = time;
+    if (arrival_count < ARRIVAL_COUNT)
+      ++arrival_count;
+  }
+  taskEXIT_CRITICAL();
+}
+
+void latency_decoded(void) {
+  const uint32_t now = sdk_system_get_time();
+  const uint32_t pos = fifo_read_count();
+  const uint32_t samples = audio_written();
+
+  taskENTER_CRITICAL();
+  newest_frame = (newest_frame + 1) % FRAME_COUNT;
+  frames[newest_frame].pos = pos;
+  frames[newest_frame].samples = samples;
+  if (frame_count < FRAME_COUNT)
+    ++frame_count;
+  taskEXIT_CRITICAL();
+
+  if (mark_count > 0 && now - rate_time < RATE_INTERVAL)
+    return;
+
+  rate_time = now;
+  newest_mark = (newest_mark + 1) % (RATE_INTERVALS + 1);
+  marks[newest_mark].pos = pos;
+  marks[newest_mark].samples = samples;
+  if (mark_count < RATE_INTERVALS + 1)
+    ++mark_count;
+
+  const struct stream_point *oldest =
+      &marks[(newest_mark + RATE_INTERVALS + 2 - mark_count) %
+             (RATE_INTERVALS + 1)];
+  if (samples != oldest->samples)
+    byte_rate = (uint64_t)(pos - oldest->pos) * audio_sample_rate() /
+                (samples - oldest->samples);
+}
+
+void latency_reset(void) {
+  mark_count = 0;
+  byte_rate = 0;
+  taskENTER_CRITICAL();
+  frame_count = 0;
+  taskEXIT_CRITICAL();
+}
+
+// Returns the FIFO position where the frame with output sample played ends,
+// or the read position if it isn't known
+static uint32_t frame_pos(uint32_t played) {
+  uint32_t pos = fifo_read_count();
+  taskENTER_CRITICAL();
+  for (size_t i = 0; i < frame_count; ++i) {
+    const struct stream_point *f =
+        &frames[(newest_frame + FRAME_COUNT - i) % FRAME_COUNT];
+    if ((int32_t)(f->samples - played) <= 0)
+      break;
+    pos = f->pos;
+  }
+  taskEXIT_CRITICAL();
+  return pos;
+}
+
+// Returns the time the audio at FIFO position pos arrived, or the oldest
+// time known if it arrived earlier
+static uint32_t arrival_time(uint32_t pos, uint32_t now) {
+  uint32_t time = now;
+  taskENTER_CRITICAL();
+  for (size_t i = 0; i < arrival_count; ++i) {
+    const struct arrival *a =
+        &arrivals[(newest + ARRIVAL_COUNT - i) % ARRIVAL_COUNT];
+    // the positions wrap around
+    if ((int32_t)(a->pos - pos) < 0)
+      break;
+    time = a->time;
+  }
+  taskEXIT_CRITICAL();
+  return time;
+}
+
+void latency_get(struct latency_stats *stats) {
+  const uint32_t now = sdk_system_get_time();
+  const unsigned int sample_rate = audio_sample_rate();
+  const unsigned int queued = audio_queued();
+
+  stats->byte_rate = byte_rate;
+  stats->fifo_time =
+      byte_rate > 0 ? (uint64_t)fifo_fill() * 1000 / byte_rate : 0;
+  stats->output_time = queued * 1000 / sample_rate;
+  stats->played = audio_written() - queued;
+  // a frame plays once all of it arrived
+  stats->live_delay =
+      (now - arrival_time(frame_pos(stats->played), now)) / 1000;
+}
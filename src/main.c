@@ -1,8 +1,19 @@
+#include "abr.h"
+#include "audio.h"
+#include "common.h"
+#include "decoder.h"
+#include "dns.h"
 #include "fifo.h"
+#include "latency.h"
+#include "metadata.h"
 #include "mi0283qt.h"
 #include "mp3.h"
+#include "spectrum.h"
+#include "station.h"
 #include "stream_client.h"
 #include "terminal.h"
+#include "tls.h"
+#include "ui.h"
 #include "wm8731.h"
 
 #include "esp/hwrand.h"
@@ -19,35 +30,200 @@
 #include <stdio.h>
 #include <string.h>
 
+// Pixels the UI may draw per update, about 3 ms of SPI transfers
+#define UI_BUDGET 8192
+
+static const struct station *station = &stations[0];
+
+static struct ui_widget station_label, artist_label, title_marquee;
+static char title[METADATA_VALUE_MAX];
+static struct ui_widget buffer_label, buffer_bar;
+static struct ui_widget left_label, left_meter, right_label, right_meter;
+static struct ui_widget station_list;
+static struct ui_widget spectrum_bars;
+
+static const char *station_name(size_t index) { return stations[index].name; }
+
+static void ui_setup(void) {
+  const uint16_t white = RGB(63, 63, 63), black = RGB(0, 0, 0);
+  const uint16_t grey = RGB(24, 24, 24), green = RGB(0, 48, 0);
+  const uint16_t red = RGB(63, 0, 0);
+
+  ui_label_init(&station_label, 4, 2, 232, white, black);
+  ui_label_scale(&station_label, 2);
+  ui_label_init(&artist_label, 4, 26, 232, white, black);
+  ui_marquee_init(&title_marquee, 4, 38, 232, title, sizeof(title), white,
+                  black);
+  ui_label_init(&buffer_label, 4, 52, 42, white, black);
+  ui_bar_init(&buffer_bar, 48, 52, 188, 7, white, grey);
+  ui_label_init(&left_label, 4, 66, 42, white, black);
+  ui_meter_init(&left_meter, 48, 66, 188, 7, green, red, grey);
+  ui_label_init(&right_label, 4, 78, 42, white, black);
+  ui_meter_init(&right_meter, 48, 78, 188, 7, green, red, grey);
+  ui_list_init(&station_list, 4, 100, 232, station_name, station_count, white,
+               black);
+  ui_spectrum_init(&spectrum_bars, 4, 196, 232, 40, SPECTRUM_BANDS, green,
+                   black);
+
+  struct ui_widget *const widgets[] = {
+      &station_label, &artist_label, &title_marquee, &buffer_label,
+      &buffer_bar,    &left_label,   &left_meter,    &right_label,
+      &right_meter,   &station_list,  &spectrum_bars,
+  };
+  for (int i = 0; i < ARRAY_SIZE(widgets); ++i)
+    ui_add(widgets[i]);
+
+  ui_label_set(&station_label, station->name);
+  ui_label_set(&buffer_label, "Buffer");
+  ui_label_set(&left_label, "L");
+  ui_label_set(&right_label, "R");
+  ui_list_select(&station_list, station - stations);
+}
+
+// Updates the widgets that follow the playback
+static void ui_refresh(void) {
+  ui_bar_set(&buffer_bar, fifo_fill(), fifo_size());
+
+  uint16_t left, right;
+  audio_get_and_reset_peak(&left, &right);
+  ui_bar_set(&left_meter, left, INT16_MAX);
+  ui_bar_set(&right_meter, right, INT16_MAX);
+
+  // the bars stay as they are if the levels were busy
+  uint8_t levels[SPECTRUM_BANDS];
+  if (spectrum_get(levels))
+    ui_spectrum_set(&spectrum_bars, levels, SPECTRUM_LEVELS);
+
+  ui_update(UI_BUDGET);
+}
+
+#if !defined(TEST_MP3)
+// Keys 1 to 9 on the serial console switch stations
+static void handle_input(void) {
+  const int c = uart_getc_nowait(0);
+  if (c < '1' || c >= '1' + (int)station_count)
+    return;
+
+  station = &stations[c - '1'];
+  printf("Switching to %s\n", station->name);
+  ui_label_set(&station_label, station->name);
+  ui_label_set(&artist_label, "");
+  ui_marquee_set(&title_marquee, "");
+  ui_list_select(&station_list, station - stations);
+  if (stream_switch(station->variants[abr_start(station)].url))
+    printf("Failed to switch stations!\n");
+}
+
+// Moves the stream to another bitrate variant if the connection calls for it
+static void adapt_bitrate(void) {
+  const int variant = abr_update();
+  if (variant >= 0 && stream_move(station->variants[variant].url))
+    printf("Failed to move stream!\n");
+}
+#endif
+
 void ui_task(void *p) {
+  ui_setup();
   for (int i = 0;; ++i) {
-#if 0
-    printf("free heap: %u\nfifo: %u/%u\nunderruns: %u\n\n",
+#if !defined(TEST_MP3)
+    handle_input();
+    stream_poll_metadata();
+    if (i % 10 == 0)
+      adapt_bitrate();
+#endif
+    ui_refresh();
+    vTaskDelay(100 / portTICK_PERIOD_MS);
+    if (i % 20 != 0)
+      continue;
+
+#if defined(PRINT_STATS) || defined(TEST_MP3)
+    struct decoder_stats stats;
+    decoder_get_and_reset_stats(&stats);
+    printf("free heap: %u\nfifo: %u/%u\nunderruns: %u\nbad frames: %u\n",
            xPortGetFreeHeapSize(), fifo_fill(), fifo_size(),
-           get_and_reset_underrun_counter());
+           get_and_reset_underrun_counter(),
+           get_and_reset_bad_frame_counter());
+    printf("frames: %u\nrealtime: %u%%\nstack free: %u\n", stats.frames,
+           stats.decode_time ? 100 * stats.audio_time / stats.decode_time : 0,
+           stats.stack_free);
+    struct lcd_stats lcd;
+    lcd_get_and_reset_stats(&lcd);
+    printf("lcd: %u commands, %u bytes in %u transactions\nlcd bus: %u ms\n",
+           lcd.commands, lcd.data_bytes, lcd.transactions,
+           lcd.bus_time / 1000);
+#if defined(TEST_MP3)
+    printf("checksum: %08x\n", audio_checksum());
+#else
+    struct stream_stats net;
+    stream_get_and_reset_stats(&net);
+    printf("received: %u bytes in %u buffers/%u spans\n", net.received,
+           net.buffers, net.spans);
+    printf("throughput: %u B/s\njitter: %u us\nmax interval: %u ms\n",
+           net.interval ? net.received * 1000 / net.interval : 0, net.jitter,
+           net.max_interval);
+    printf("stalls: %u ms\nrecvbuf: %d\nstream stack free: %u\n",
+           net.stall_time, net.recvbuf_max, net.stack_free);
+    if (net.segments || net.playlists)
+      printf("segments: %u\nplaylists: %u\n", net.segments, net.playlists);
+    printf("reconnects: %u\ngap: %u ms\nresync: %u bytes\n", net.reconnects,
+           net.gap_time, net.resync_bytes);
+    printf("bitrate switches: %u\n", abr_get_and_reset_switches());
+    if (net.start_latency)
+      printf("start latency: %u ms\n", net.start_latency);
+    struct latency_stats latency;
+    latency_get(&latency);
+    printf("buffered: %u+%u ms at %u B/s\nlive delay: %u ms\n",
+           latency.fifo_time, latency.output_time, latency.byte_rate,
+           latency.live_delay);
+    printf("max stdout write: %u us\nlog dropped: %u\nterm stack free: %u\n",
+           term_get_and_reset_max_write_time(), term_get_and_reset_dropped(),
+           term_get_stack_free());
+#if defined(STREAM_TLS)
+    struct tls_stats tls;
+    tls_get_and_reset_stats(&tls);
+    if (tls.handshakes || tls.resumed)
+      printf("handshakes: %u (%u ms)\nresumed: %u (%u ms)\n"
+             "tls min heap: %u\n",
+             tls.handshakes, tls.handshake_time, tls.resumed,
+             tls.resumed_time, tls.min_free_heap);
+#endif
+#endif
+    printf("\n");
 #endif
-    vTaskDelay(2000 / portTICK_PERIOD_MS);
   }
 
   vTaskDelete(NULL);
 }
 
-static void stream_up(void) {
-  if (xTaskCreate(mp3_task, "decode", 2100, NULL, 4, NULL) != pdPASS) {
-    printf("Failed to create mp3 task!\n");
+static void stream_up(const char *content_type) {
+  if (content_type == NULL)
+    content_type = station->content_type;
+  // only the first stream starts the decoder, it's switched over afterwards
+  if (decoder_switch(content_type) == 0)
+    return;
+  if (xTaskCreate(decoder_task, "decode", 2100, (void *)content_type, 4,
+                  NULL) != pdPASS) {
+    printf("Failed to create decoder task!\n");
   }
 }
 
+#if !defined(TEST_MP3)
 static void stream_metadata(enum stream_metadata type, const char *s) {
   switch (type) {
   case STREAM_ARTIST:
     printf("Artist: %s\n", s);
+    ui_label_set(&artist_label, s);
     break;
   case STREAM_TITLE:
     printf("Title: %s\n", s);
+    ui_marquee_set(&title_marquee, s);
+    break;
+  case STREAM_URL:
+    printf("URL: %s\n", s);
     break;
   }
 }
+#endif
 
 void user_init(void) {
   int ret;
@@ -79,13 +255,26 @@ void user_init(void) {
   sdk_wifi_set_opmode(STATION_MODE);
   sdk_wifi_station_set_config(&config);
 
-  if (stream_start("r.ezbt.me", "/antenne", stream_up, stream_metadata)) {
+#if defined(TEST_MP3)
+  // decode the embedded file, no network needed
+  stream_up("audio/mpeg");
+#else
+  if ((ret = dns_init())) {
+    printf("dns_init failed (%d)\n", ret);
+    goto fail;
+  }
+  stations_prefetch();
+
+  printf("Playing %s\n", station->name);
+  if (stream_start(station->variants[abr_start(station)].url, stream_up,
+                   stream_metadata)) {
     printf("Failed to create stream task!\n");
     goto fail;
   }
+#endif
 
-  if (xTaskCreate(ui_task, "UI", configMINIMAL_STACK_SIZE, NULL, 1, NULL) !=
-      pdPASS) {
+  // the stats and metadata callbacks use printf, the widgets draw text
+  if (xTaskCreate(ui_task, "UI", 512, NULL, 1, NULL) != pdPASS) {
     printf("Failed to create UI task!\n");
     goto fail;
   }
@@ -0,0 +1,91 @@
+#include "metadata.h"
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+struct metadata_record {
+  uint32_t pos;
+  enum stream_metadata type;
+  char value[METADATA_VALUE_MAX];
+};
+
+static struct metadata_record queue[METADATA_QUEUE_SIZE];
+static size_t head;
+static size_t count;
+static SemaphoreHandle_t mtx;
+
+// Hash of the last value queued per type, 0 if there was none. Keeping the
+// values themselves would take another record per type.
+static uint32_t last_hash[STREAM_URL + 1];
+
+int metadata_init(void) {
+  mtx = xSemaphoreCreateMutex();
+  memset(last_hash, 0, sizeof(last_hash));
+  return mtx == NULL;
+}
+
+// FNV-1a of the part of the value that is kept, never 0
+static uint32_t hash(const char *value) {
+  uint32_t h = 0x811c9dc5;
+  for (size_t i = 0; value[i] != '\0' && i < METADATA_VALUE_MAX - 1; ++i)
+    h = (h ^ (uint8_t)value[i]) * 0x01000193;
+  return h != 0 ? h : 1;
+}
+
+void metadata_queue(uint32_t pos, enum stream_metadata type,
+                    const char *value) {
+  const uint32_t h = hash(value);
+  xSemaphoreTake(mtx, portMAX_DELAY);
+
+  if (h == last_hash[type]) {
+    xSemaphoreGive(mtx);
+    return;
+  }
+  last_hash[type] = h;
+
+  // the oldest record would be outdated by the time it's delivered anyway
+  if (count == METADATA_QUEUE_SIZE) {
+    head = (head + 1) % METADATA_QUEUE_SIZE;
+    --count;
+  }
+
+  struct metadata_record *record = &queue[(head + count) % METADATA_QUEUE_SIZE];
+  record->pos = pos;
+  record->type = type;
+  strncpy(record->value, value, sizeof(record->value) - 1);
+  record->value[sizeof(record->value) - 1] = '\0';
+  ++count;
+
+  xSemaphoreGive(mtx);
+}
+
+void metadata_clear(void) {
+  xSemaphoreTake(mtx, portMAX_DELAY);
+  count = 0;
+  memset(last_hash, 0, sizeof(last_hash));
+  xSemaphoreGive(mtx);
+}
+
+void metadata_deliver(uint32_t pos, stream_metadata_cb cb) {
+  for (;;) {
+    struct metadata_record record;
+
+    xSemaphoreTake(mtx, portMAX_DELAY);
+    // the positions wrap around
+    const bool due = count > 0 && (int32_t)(pos - queue[head].pos) >= 0;
+    if (due) {
+      record = queue[head];
+      head = (head + 1) % METADATA_QUEUE_SIZE;
+      --count;
+    }
+    xSemaphoreGive(mtx);
+
+    if (!due)
+      return;
+    cb(record.type, record.value);
+  }
+}
@@ -1,8 +1,10 @@
 #include "mi0283qt.h"
 #include "FreeRTOS.h"
 #include "common.h"
+#include "font.h"
 #include "hspi.h"
 #include "lcd_font.h"
+#include "semphr.h"
 #include "task.h"
 #include <string.h>
 
@@ -10,9 +12,29 @@
 #define LCD_DATA ((0x72) | (LCD_ID << 2))
 #define LCD_REGISTER ((0x70) | (LCD_ID << 2))
 
+// Rendered glyphs are cached for this many character and color combinations
+#define GLYPH_CACHE_SIZE 16
+#define COL_WIDTH (FONT_WIDTH + FONT_MARGIN)
+#define GLYPH_PIXELS (COL_WIDTH * FONT_HEIGHT)
+
 static struct hspi hspi;
+static SemaphoreHandle_t mtx;
+// 64 bytes, the most a single SPI transaction can carry
 static uint16_t pixel_buffer[32];
 
+struct glyph {
+  char c; // 0 if the entry is unused
+  uint16_t fg, bg;
+  // column by column from the left, top to bottom, including the margin
+  uint16_t pixels[GLYPH_PIXELS];
+};
+
+static struct glyph glyph_cache[GLYPH_CACHE_SIZE];
+
+static struct lcd_stats stats;
+// Bits clocked out since the last reset, the bus time is derived from them
+static uint64_t bus_bits;
+
 struct init_step {
   enum {
     STEP_TYPE_CMD,
@@ -69,20 +91,32 @@ static const struct init_step init_steps[] = {
     {STEP_TYPE_CMD, .cmd = {0x28, 0x3C}},
     {STEP_TYPE_DELAY, .delay_ms = 5}};
 
+// Sends a single SPI transaction and accounts for it. Every transaction
+// starts with a byte that selects register or data.
+static inline size_t transfer(size_t len, const void *data, uint16_t start) {
+  len = hspi_write(&hspi, len, data, 0, 0, 8, start);
+  ++stats.transactions;
+  stats.data_bytes += len;
+  bus_bits += (1 + len) * 8;
+  return len;
+}
+
 static inline void wr_cmd(uint8_t cmd, uint8_t data) {
-  hspi_write(&hspi, 1, &cmd, 0, 0, 8, LCD_REGISTER);
-  hspi_write(&hspi, 1, &data, 0, 0, 8, LCD_DATA);
+  ++stats.commands;
+  transfer(1, &cmd, LCD_REGISTER);
+  transfer(1, &data, LCD_DATA);
 }
 
 static inline void wr_sram(void) {
   const uint8_t cmd = 0x22; // SRAM Write Control
-  hspi_write(&hspi, 1, &cmd, 0, 0, 8, LCD_REGISTER);
+  ++stats.commands;
+  transfer(1, &cmd, LCD_REGISTER);
 }
 
 static inline void wr_pixels(size_t count, const uint16_t *pixels) {
   size_t rem_bytes = count * sizeof(pixels[0]);
   while (rem_bytes > 0)
-    rem_bytes -= hspi_write(&hspi, rem_bytes, pixels, 0, 0, 8, LCD_DATA);
+    rem_bytes -= transfer(rem_bytes, pixels, LCD_DATA);
 }
 
 int lcd_init() {
@@ -92,6 +126,10 @@ int lcd_init() {
   if (hspi_init(&hspi))
     return 1;
 
+  mtx = xSemaphoreCreateMutex();
+  if (mtx == NULL)
+    return 1;
+
   TickType_t ticks;
   for (int i = 0; i < ARRAY_SIZE(init_steps); ++i) {
     const struct init_step step = init_steps[i];
@@ -114,6 +152,10 @@ int lcd_init() {
   return 0;
 }
 
+void lcd_lock(void) { xSemaphoreTake(mtx, portMAX_DELAY); }
+
+void lcd_unlock(void) { xSemaphoreGive(mtx); }
+
 // sets the drawing area to [x0,x1] x [y0,y1]
 // note that x1 and y1 are included
 void lcd_set_area(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
@@ -143,7 +185,7 @@ void lcd_rect(uint16_t color, uint16_t x0, uint16_t y0, uint16_t x1,
 
   size_t rem_bytes = (x1 - x0 + 1) * (y1 - y0 + 1) * sizeof(pixel_buffer[0]);
   while (rem_bytes > 0)
-    rem_bytes -= hspi_write(&hspi, rem_bytes, pixel_buffer, 0, 0, 8, LCD_DATA);
+    rem_bytes -= transfer(rem_bytes, pixel_buffer, LCD_DATA);
 }
 
 void lcd_fill(uint16_t color) {
@@ -163,44 +205,194 @@ int lcd_string(int x, int y, const char *str) {
 }
 
 int lcd_stringn(int x, int y, const char *str, size_t n) {
+  return lcd_stringn_color(x, y, str, n, RGB(63, 63, 63), RGB(0, 0, 0));
+}
+
+static inline bool printable(char c) {
+  return c >= FIRST_CHAR && c < FIRST_CHAR + CHAR_COUNT;
+}
+
+// Returns the pixels of a character in the given colors, rendering them into
+// the cache if necessary
+static const uint16_t *glyph_pixels(char c, uint16_t fg, uint16_t bg) {
+  struct glyph *glyph = &glyph_cache[(c + fg + bg) % GLYPH_CACHE_SIZE];
+  if (glyph->c == c && glyph->fg == fg && glyph->bg == bg)
+    return glyph->pixels;
+
+  glyph->c = c;
+  glyph->fg = fg;
+  glyph->bg = bg;
+  uint16_t *p = glyph->pixels;
+  for (int col = 0; col < FONT_WIDTH; ++col) {
+    const uint8_t col_byte = font[(c - FIRST_CHAR) * FONT_WIDTH + col];
+    for (int line = 0; line < FONT_HEIGHT; ++line)
+      *p++ = col_byte & (1 << line) ? fg : bg;
+  }
+  // horizontal margin
+  for (int i = 0; i < FONT_MARGIN * FONT_HEIGHT; ++i)
+    *p++ = bg;
+
+  return glyph->pixels;
+}
+
+int lcd_stringn_color(int x, int y, const char *str, size_t n, uint16_t fg,
+                      uint16_t bg) {
+  // non-printable characters are skipped, the rest is clipped at the edge
+  size_t count = 0;
+  for (size_t i = 0; i < n; ++i)
+    count += printable(str[i]);
+  if (x >= LCD_WIDTH)
+    return x;
+  if (x + count * COL_WIDTH > LCD_WIDTH)
+    count = (LCD_WIDTH - x) / COL_WIDTH;
+  if (count == 0)
+    return x;
+
+  // The whole run is drawn into a single window, x & y are flipped because
+  // of the xy exchange, so the glyphs are written column by column.
   lcd_xy_exchange(true);
-  for (size_t i = 0; i < n; ++i, ++str) {
-    // jump over non-printable characters
-    if (*str < FIRST_CHAR || *str >= FIRST_CHAR + CHAR_COUNT)
-      continue;
+  lcd_set_area(y, x, y + FONT_HEIGHT - 1, x + count * COL_WIDTH - 1);
+  wr_sram();
 
-    // x & y need to be flipped, because we enable xy exchange
-    lcd_set_area(y, x, y + FONT_HEIGHT - 1, x + FONT_WIDTH + FONT_MARGIN - 1);
-    wr_sram();
-
-    int buf_pos = 0;
-    for (int col = 0; col < FONT_WIDTH; ++col) {
-      uint8_t col_byte = font[(*str - FIRST_CHAR) * FONT_WIDTH + col];
-      for (int line = 0; line < FONT_HEIGHT; ++line) {
-        if (col_byte & (1 << line))
-          pixel_buffer[buf_pos] = RGB(63, 63, 63);
-        else
-          pixel_buffer[buf_pos] = RGB(0, 0, 0);
-        ++buf_pos;
-      }
+  size_t buf_pos = 0;
+  for (size_t drawn = 0; drawn < count; ++str) {
+    if (!printable(*str))
+      continue;
 
-      if (buf_pos + FONT_HEIGHT > ARRAY_SIZE(pixel_buffer)) {
+    // the glyphs are packed into full SPI transactions
+    const uint16_t *pixels = glyph_pixels(*str, fg, bg);
+    for (size_t left = GLYPH_PIXELS; left > 0;) {
+      const size_t len = min(left, ARRAY_SIZE(pixel_buffer) - buf_pos);
+      memcpy(pixel_buffer + buf_pos, pixels, len * sizeof(pixels[0]));
+      buf_pos += len;
+      pixels += len;
+      left -= len;
+      if (buf_pos == ARRAY_SIZE(pixel_buffer)) {
         wr_pixels(buf_pos, pixel_buffer);
         buf_pos = 0;
       }
     }
+    ++drawn;
+  }
+  if (buf_pos > 0)
+    wr_pixels(buf_pos, pixel_buffer);
 
-    // draw horizontal margin
-    for (int line = FONT_HEIGHT - 1; line >= 0; --line)
-      pixel_buffer[buf_pos++] = RGB(0, 0, 0);
+  lcd_xy_exchange(false);
+  return x + count * COL_WIDTH;
+}
 
-    // write remaining pixel data
-    wr_pixels(buf_pos, pixel_buffer);
+// Pixels collected for the next SPI transaction of a text
+static size_t run_pos;
+
+// Appends count pixels of a color to the current window
+static void emit(uint16_t color, size_t count) {
+  while (count > 0) {
+    const size_t n = min(count, ARRAY_SIZE(pixel_buffer) - run_pos);
+    for (size_t i = 0; i < n; ++i)
+      pixel_buffer[run_pos + i] = color;
+    run_pos += n;
+    count -= n;
+    if (run_pos == ARRAY_SIZE(pixel_buffer)) {
+      wr_pixels(run_pos, pixel_buffer);
+      run_pos = 0;
+    }
+  }
+}
+
+static void emit_flush(void) {
+  if (run_pos > 0)
+    wr_pixels(run_pos, pixel_buffer);
+  run_pos = 0;
+}
 
-    x += (FONT_WIDTH + FONT_MARGIN);
+// Emits a column of a glyph, given as bit mask, as runs of scale times the
+// size
+static void emit_column(uint16_t column, int height, int scale, uint16_t fg,
+                        uint16_t bg) {
+  for (int row = 0; row < height;) {
+    const bool set = column & (1 << row);
+    int len = 1;
+    while (row + len < height && !(column & (1 << (row + len))) == !set)
+      ++len;
+    emit(set ? fg : bg, len * scale);
+    row += len;
   }
+}
+
+int lcd_text(const struct font *font, int scale, int x, int y,
+             const char *str, size_t n, uint16_t fg, uint16_t bg) {
+  if (x >= LCD_WIDTH)
+    return x;
+  n = font_fit(font, str, n, LCD_WIDTH - x, scale);
+  const int width = font_width(font, str, n, scale);
+  if (width == 0)
+    return x;
+
+  // a single window written column by column like lcd_stringn_color()
+  const int height = font->height * scale;
+  lcd_xy_exchange(true);
+  lcd_set_area(y, x, y + height - 1, x + width - 1);
+  wr_sram();
+
+  const char *end = str + n;
+  while (str < end) {
+    const struct font_glyph *glyph = font_glyph(font, font_decode(&str, end));
+    if (scale == 1) {
+      // the runs of the glyph go out as they are
+      const uint8_t *p = font->runs + glyph->offset;
+      for (int left = glyph->width * font->height; left > 0; ++p) {
+        emit(bg, *p >> 4);
+        emit(fg, *p & 0x0f);
+        left -= (*p >> 4) + (*p & 0x0f);
+      }
+    } else {
+      uint16_t columns[FONT_MAX_WIDTH];
+      font_columns(font, glyph, columns);
+      for (int col = 0; col < glyph->width * scale; ++col)
+        emit_column(columns[col / scale], font->height, scale, fg, bg);
+    }
+    emit(bg, FONT_SPACING * scale * height);
+  }
+  emit_flush();
+
   lcd_xy_exchange(false);
-  return x;
+  return x + width;
+}
+
+int lcd_text_row(const struct font *font, int x, int y, const char *str,
+                 size_t n, int row, uint16_t fg, uint16_t bg) {
+  if (x >= LCD_WIDTH)
+    return x;
+  n = font_fit(font, str, n, LCD_WIDTH - x, 1);
+  const int width = font_width(font, str, n, 1);
+  if (width == 0)
+    return x;
+
+  lcd_set_area(x, y, x + width - 1, y);
+  wr_sram();
+
+  const char *end = str + n;
+  while (str < end) {
+    const struct font_glyph *glyph = font_glyph(font, font_decode(&str, end));
+    uint16_t columns[FONT_MAX_WIDTH];
+    font_columns(font, glyph, columns);
+    for (int col = 0; col < glyph->width; ++col)
+      emit(columns[col] & (1 << row) ? fg : bg, 1);
+    emit(bg, FONT_SPACING);
+  }
+  emit_flush();
+
+  return x + width;
+}
+
+void lcd_get_and_reset_stats(struct lcd_stats *s) {
+  lcd_lock();
+  *s = stats;
+  // the HSPI runs at 80 MHz / clock_div
+  s->bus_time = bus_bits * hspi.clock_div / 80;
+  memset(&stats, 0, sizeof(stats));
+  bus_bits = 0;
+  lcd_unlock();
 }
 
 void lcd_scroll_on(uint16_t top_fixed, uint16_t bottom_fixed) {
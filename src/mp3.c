@@ -1,8 +1,9 @@
 #include "mp3.h"
+#include "audio.h"
+#include "common.h"
 #include "fifo.h"
-#include "wm8731.h"
-
-#include "i2s_dma/i2s_dma.h"
+#include "mpeg.h"
+#include "spectrum.h"
 
 #include "libmad/global.h"
 
@@ -10,124 +11,40 @@
 #include "libmad/stream.h"
 #include "libmad/synth.h"
 
-#include "FreeRTOS.h"
-#include "queue.h"
-#include "task.h"
-
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+
+struct mp3_decoder {
+  struct mad_stream stream;
+  struct mad_frame frame;
+  struct mad_synth synth;
+  // true while libmad is locked onto the frame boundaries
+  bool synced;
+  // true once frame holds decoded samples that can be repeated
+  bool have_frame;
+  // Maximum MP3 frame size + MAD_BUFFER_GUARD
+  // http://www.mars.org/pipermail/mad-dev/2002-January/000428.html
+  unsigned char buffer[1441 + 8];
+};
 
-#define DMA_BUFFER_SIZE 512
-#define DMA_QUEUE_SIZE 6
-
-// Circular list of descriptors
-static dma_descriptor_t dma_block_list[DMA_QUEUE_SIZE];
-
-// Array of buffers for circular list of descriptors
-static uint8_t dma_buffer[DMA_QUEUE_SIZE][DMA_BUFFER_SIZE];
-
-// Queue of empty DMA blocks
-static QueueHandle_t dma_queue;
-
-static unsigned int underrun_counter = 0;
-
-static short *get_sample_buffer() {
-  static const size_t sample_buffer_size = 128;
-  static uint8_t *curr_dma_buf = NULL;
-  static size_t curr_dma_pos = 0;
-
-  if (curr_dma_buf == NULL) {
-    // Get a free block from the DMA queue. This call will suspend the task
-    // until a free block is available in the queue.
-    xQueueReceive(dma_queue, &curr_dma_buf, portMAX_DELAY);
-  }
-
-  short *buffer = (short *)(curr_dma_buf + curr_dma_pos);
-  curr_dma_pos += sample_buffer_size;
-
-  // DMA buffer full
-  if (curr_dma_pos >= DMA_BUFFER_SIZE) {
-    curr_dma_buf = NULL;
-    curr_dma_pos = 0;
-  }
-
-  return buffer;
-}
-
-/**
- * Create a circular list of DMA descriptors
- */
-static inline void init_descriptors_list() {
-  memset(dma_buffer, 0, DMA_QUEUE_SIZE * DMA_BUFFER_SIZE);
-
-  for (int i = 0; i < DMA_QUEUE_SIZE; i++) {
-    dma_block_list[i].owner = 1;
-    dma_block_list[i].eof = 1;
-    dma_block_list[i].sub_sof = 0;
-    dma_block_list[i].unused = 0;
-    dma_block_list[i].buf_ptr = dma_buffer[i];
-    dma_block_list[i].datalen = DMA_BUFFER_SIZE;
-    dma_block_list[i].blocksize = DMA_BUFFER_SIZE;
-    if (i == (DMA_QUEUE_SIZE - 1)) {
-      dma_block_list[i].next_link_ptr = &dma_block_list[0];
-    } else {
-      dma_block_list[i].next_link_ptr = &dma_block_list[i + 1];
-    }
-  }
-
-  // The queue depth is one smaller than the amount of buffers we have,
-  // because there's always a buffer that is being used by the DMA subsystem
-  // *right now* and we don't want to be able to write to that simultaneously
-  dma_queue = xQueueCreate(DMA_QUEUE_SIZE - 1, sizeof(uint8_t *));
-  if (dma_queue == NULL) {
-    printf("Queue creation failed\n");
-  }
-}
-
-// DMA interrupt handler. It is called each time a DMA block is finished
-// processing.
-static void dma_isr_handler(void *args) {
-  portBASE_TYPE task_awoken = pdFALSE;
-
-  if (i2s_dma_is_eof_interrupt()) {
-    dma_descriptor_t *descr = i2s_dma_get_eof_descriptor();
-
-    if (xQueueIsQueueFullFromISR(dma_queue)) {
-      // List of empty blocks is full. Sender don't send data fast enough.
-      ++underrun_counter;
-      // Discard top of the queue
-      int dummy;
-      xQueueReceiveFromISR(dma_queue, &dummy, &task_awoken);
-    }
-    // Push the processed buffer to the queue so sender can refill it.
-    xQueueSendFromISR(dma_queue, (void *)(&descr->buf_ptr), &task_awoken);
-  }
-  i2s_dma_clear_interrupt();
-
-  portEND_SWITCHING_ISR(task_awoken);
-}
+// Allocated while the decoder is open, so the memory is available to other
+// codecs otherwise.
+static struct mp3_decoder *mp3;
 
-unsigned int get_and_reset_underrun_counter() {
-  unsigned int underruns = underrun_counter;
-  underrun_counter = 0;
-  return underruns;
-}
+static unsigned int bad_frame_counter = 0;
 
-void set_frame_format(unsigned int sample_rate, unsigned short channels) {
-  static unsigned int last_sample_rate = 44100;
-  if (sample_rate != last_sample_rate) {
-    printf("new sample rate: %u kHz\n", sample_rate);
-    last_sample_rate = sample_rate;
+// Downmix stereo streams to mono
+static bool mono = false;
 
-    wm8731_set_sample_rate(sample_rate);
+void mp3_set_mono(bool enable) { mono = enable; }
 
-    // TODO: it's cleaner to clear the DMA queue and start over
-    i2s_clock_div_t clock_div = i2s_get_clock_div(sample_rate * channels * 16);
-    uint32_t i2s_conf = I2S.CONF & ~(I2S_CONF_BCK_DIV_M | I2S_CONF_CLKM_DIV_M);
-    i2s_conf |= (clock_div.bclk_div << I2S_CONF_BCK_DIV_S) |
-                (clock_div.clkm_div << I2S_CONF_CLKM_DIV_S);
-    I2S.CONF = i2s_conf;
-  }
+unsigned int get_and_reset_bad_frame_counter() {
+  unsigned int bad_frames = bad_frame_counter;
+  bad_frame_counter = 0;
+  return bad_frames;
 }
 
 /*
@@ -138,9 +55,8 @@ void set_frame_format(unsigned int sample_rate, unsigned short channels) {
  * time, we are finished decoding.
  */
 static void input(struct mad_stream *stream) {
-  // Maximum MP3 frame size + MAD_BUFFER_GUARD
-  // http://www.mars.org/pipermail/mad-dev/2002-January/000428.html
-  static unsigned char buffer[1441 + 8];
+  unsigned char *const buffer = mp3->buffer;
+  const size_t buffer_size = sizeof(mp3->buffer);
 
   size_t rem = stream->bufend - stream->next_frame;
   memmove(buffer, stream->next_frame, rem);
@@ -150,24 +66,21 @@ static void input(struct mad_stream *stream) {
   extern const unsigned int test_mp3_len;
   static unsigned int test_mp3_pos = 0;
 
-  unsigned int buf_free = sizeof buffer;
+  // loop over the embedded file endlessly
+  unsigned char *dst = buffer + rem;
+  unsigned int buf_free = buffer_size - rem;
   while (buf_free > 0) {
-    unsigned int file_remaining = test_mp3_len - test_mp3_pos;
-    if (file_remaining > buf_free) {
-      memcpy(buffer, test_mp3 + test_mp3_pos, buf_free);
-      test_mp3_pos += buf_free;
-      buf_free = 0;
-    } else {
-      memcpy(buffer, test_mp3 + test_mp3_pos, file_remaining);
-      buf_free -= file_remaining;
-      test_mp3_pos = 0;
-    }
+    unsigned int n = min(buf_free, test_mp3_len - test_mp3_pos);
+    memcpy(dst, test_mp3 + test_mp3_pos, n);
+    dst += n;
+    buf_free -= n;
+    test_mp3_pos = (test_mp3_pos + n) % test_mp3_len;
   }
 #else
-  fifo_dequeue(buffer + rem, sizeof(buffer) - rem);
+  fifo_dequeue(buffer + rem, buffer_size - rem);
 #endif
 
-  mad_stream_buffer(stream, buffer, sizeof(buffer));
+  mad_stream_buffer(stream, buffer, buffer_size);
 }
 
 /*
@@ -182,47 +95,185 @@ static void error(struct mad_stream *stream, struct mad_frame *frame) {
 }
 
 /*
- * This is the function called by main() above to perform all the decoding.
- * It instantiates a decoder object and configures it with the input,
- * output, and error callback functions above. A single call to
- * mad_decoder_run() continues until a callback function returns
- * MAD_FLOW_STOP (to stop decoding) or MAD_FLOW_BREAK (to stop decoding and
- * signal an error).
+ * Validates the frame at stream->next_frame before it is handed to libmad.
+ * Damaged frames (bad CRC or implausible side information) are skipped, so
+ * their main data is never Huffman decoded and synthesized. Returns true if
+ * the frame was skipped.
+ */
+static bool skip_damaged_frame(struct mad_stream *stream) {
+  const unsigned char *p = stream->next_frame;
+  const size_t len = stream->bufend - p;
+  struct mpeg_header header;
+
+  if (stream->skiplen > 0 || len < MPEG_HEADER_SIZE ||
+      mpeg_parse_header(p, &header) != 0 || header.frame_length == 0)
+    return false; // let libmad sort it out
+
+  if (mpeg_check_frame(p, len, &header) == 0)
+    return false;
+
+  if (header.frame_length <= len)
+    stream->next_frame += header.frame_length;
+  else
+    mad_stream_skip(stream, header.frame_length);
+
+  // The bit reservoir holds the main data libmad kept for the skipped frame.
+  // The next frame would take those bytes for its own, so it is emptied and
+  // libmad reports a bad main_data_begin instead.
+  stream->md_len = 0;
+
+  return true;
+}
+
+/*
+ * Mixes both channels of a frame in the subband domain, so the synthesis
+ * filter bank, the most expensive part of decoding, only runs for a single
+ * channel. As the filter bank is linear, the result is the same as mixing the
+ * synthesized output.
+ */
+static void downmix(struct mad_frame *frame) {
+  const unsigned int ns = MAD_NSBSAMPLES(&frame->header);
+  for (unsigned int s = 0; s < ns; ++s) {
+    mad_fixed_t *left = frame->sbsample[0][s];
+    const mad_fixed_t *right = frame->sbsample[1][s];
+    for (unsigned int sb = 0; sb < 32; ++sb)
+      left[sb] = (left[sb] >> 1) + (right[sb] >> 1);
+  }
+  frame->header.mode = MAD_MODE_SINGLE_CHANNEL;
+}
+
+/*
+ * Adds up the magnitudes of the subband samples for the spectrum display.
+ * The filter bank has already split the signal into 32 equal bands, so this
+ * is all it takes, no transform of the output is needed.
  */
-void mp3_task(void *arg) {
-  static struct mad_stream stream;
-  static struct mad_frame frame;
-  static struct mad_synth synth;
+static void measure_subbands(const struct mad_frame *frame) {
+  uint32_t sums[SPECTRUM_SUBBANDS] = {0};
+  const unsigned int ns = MAD_NSBSAMPLES(&frame->header);
+  const unsigned int nch = MAD_NCHANNELS(&frame->header);
+
+  for (unsigned int ch = 0; ch < nch; ++ch) {
+    for (unsigned int s = 0; s < ns; ++s) {
+      const mad_fixed_t *sample = frame->sbsample[ch][s];
+      for (unsigned int sb = 0; sb < SPECTRUM_SUBBANDS; ++sb) {
+        const mad_fixed_t x = sample[sb];
+        sums[sb] += (uint32_t)(x < 0 ? -x : x) >> (MAD_F_FRACBITS - 16);
+      }
+    }
+  }
+  spectrum_update(sums, ns * nch);
+}
+
+static bool mp3_probe(const char *content_type, const uint8_t *data,
+                      size_t len) {
+  if (content_type != NULL) {
+    return strcasecmp(content_type, "audio/mpeg") == 0 ||
+           strcasecmp(content_type, "audio/mp3") == 0 ||
+           strcasecmp(content_type, "audio/mpeg3") == 0;
+  }
+
+  // look for two consecutive frame headers
+  struct mpeg_header header, next;
+  for (size_t i = 0; i + MPEG_HEADER_SIZE <= len; ++i) {
+    if (mpeg_parse_header(data + i, &header) != 0 || header.frame_length == 0)
+      continue;
+    size_t j = i + header.frame_length;
+    if (j + MPEG_HEADER_SIZE <= len && mpeg_parse_header(data + j, &next) == 0)
+      return true;
+  }
+
+  return false;
+}
+
+static int mp3_open(void) {
+  mp3 = malloc(sizeof(*mp3));
+  if (mp3 == NULL)
+    return 1;
 
   printf("MAD: Decoder start.\n");
 
-  mad_stream_init(&stream);
-  mad_frame_init(&frame);
-  mad_synth_init(&synth, get_sample_buffer, set_frame_format);
+  mad_stream_init(&mp3->stream);
+  // CRCs are verified by skip_damaged_frame() before decoding
+  mad_stream_options(&mp3->stream, MAD_OPTION_IGNORECRC);
+  mad_frame_init(&mp3->frame);
+#ifdef LIBMAD_FIXED_OUTPUT
+  mad_synth_init(&mp3->synth, audio_write, audio_set_format);
+#else
+  mad_synth_init(&mp3->synth, audio_get_sample_buffer, audio_set_frame_format);
+#endif
+  mp3->synced = false;
+  mp3->have_frame = false;
+
+  input(&mp3->stream);
 
-  i2s_clock_div_t clock_div = i2s_get_clock_div(44100 * 2 * 16);
-  i2s_pins_t i2s_pins = {.data = true, .clock = true, .ws = true};
-  i2s_dma_init(dma_isr_handler, NULL, clock_div, i2s_pins);
-  init_descriptors_list();
-  i2s_dma_start(dma_block_list);
+  return 0;
+}
+
+static int mp3_decode_frame(void) {
+  struct mad_stream *stream = &mp3->stream;
+  struct mad_frame *frame = &mp3->frame;
 
   while (1) {
-    input(&stream);
-    while (1) {
-      int r = mad_frame_decode(&frame, &stream);
-      if (r == -1) {
-        if (!MAD_RECOVERABLE(stream.error)) {
-          break; // we're most likely out of buffer and need to call input()
-                 // again
-        }
-        error(&stream, &frame);
+    if (mp3->synced && skip_damaged_frame(stream)) {
+      ++bad_frame_counter;
+      // conceal the damaged frame by repeating the previous one, but only
+      // once in a row to avoid a buzzing loop on a garbled stream
+      if (mp3->have_frame) {
+        mp3->have_frame = false;
+        mad_synth_frame(&mp3->synth, frame);
+        return 0;
+      }
+      continue;
+    }
+
+    int r = mad_frame_decode(frame, stream);
+    if (r == -1) {
+      if (!MAD_RECOVERABLE(stream->error)) {
+        // we're most likely out of buffer and need to call input() again
+        input(stream);
         continue;
       }
-      mad_synth_frame(&synth, &frame);
+      if (stream->error == MAD_ERROR_BADDATAPTR) {
+        // the main data starts in a frame that was skipped or not received,
+        // the frame is played as silence to keep the timing
+        mp3->synced = true;
+        mp3->have_frame = false;
+        mad_frame_mute(frame);
+        if (mono)
+          frame->header.mode = MAD_MODE_SINGLE_CHANNEL;
+        mad_synth_frame(&mp3->synth, frame);
+        return 0;
+      }
+      mp3->synced = false;
+      error(stream, frame);
+      continue;
     }
+    mp3->synced = true;
+    mp3->have_frame = true;
+    if (mono && frame->header.mode != MAD_MODE_SINGLE_CHANNEL)
+      downmix(frame);
+    measure_subbands(frame);
+    mad_synth_frame(&mp3->synth, frame);
+    return 0;
   }
+}
 
-  i2s_dma_stop();
-  vQueueDelete(dma_queue);
-  vTaskDelete(NULL);
+static void mp3_close(void) {
+#ifndef LIBMAD_FIXED_OUTPUT
+  audio_flush_sample_buffer();
+#endif
+  spectrum_clear();
+  mad_synth_finish(&mp3->synth);
+  mad_frame_finish(&mp3->frame);
+  mad_stream_finish(&mp3->stream);
+  free(mp3);
+  mp3 = NULL;
 }
+
+const struct codec codec_mp3 = {
+    .name = "MP3",
+    .probe = mp3_probe,
+    .open = mp3_open,
+    .decode_frame = mp3_decode_frame,
+    .close = mp3_close,
+};
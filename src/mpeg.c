@@ -0,0 +1,210 @@
+#include "mpeg.h"
+
+#define LAYER_III_MAX_BIG_VALUES 288
+
+// MPEG audio CRC-16: polynomial 0x8005, MSB first
+static const uint16_t crc16_table[256] = {
+    0x0000, 0x8005, 0x800f, 0x000a, 0x801b, 0x001e, 0x0014, 0x8011,
+    0x8033, 0x0036, 0x003c, 0x8039, 0x0028, 0x802d, 0x8027, 0x0022,
+    0x8063, 0x0066, 0x006c, 0x8069, 0x0078, 0x807d, 0x8077, 0x0072,
+    0x0050, 0x8055, 0x805f, 0x005a, 0x804b, 0x004e, 0x0044, 0x8041,
+    0x80c3, 0x00c6, 0x00cc, 0x80c9, 0x00d8, 0x80dd, 0x80d7, 0x00d2,
+    0x00f0, 0x80f5, 0x80ff, 0x00fa, 0x80eb, 0x00ee, 0x00e4, 0x80e1,
+    0x00a0, 0x80a5, 0x80af, 0x00aa, 0x80bb, 0x00be, 0x00b4, 0x80b1,
+    0x8093, 0x0096, 0x009c, 0x8099, 0x0088, 0x808d, 0x8087, 0x0082,
+    0x8183, 0x0186, 0x018c, 0x8189, 0x0198, 0x819d, 0x8197, 0x0192,
+    0x01b0, 0x81b5, 0x81bf, 0x01ba, 0x81ab, 0x01ae, 0x01a4, 0x81a1,
+    0x01e0, 0x81e5, 0x81ef, 0x01ea, 0x81fb, 0x01fe, 0x01f4, 0x81f1,
+    0x81d3, 0x01d6, 0x01dc, 0x81d9, 0x01c8, 0x81cd, 0x81c7, 0x01c2,
+    0x0140, 0x8145, 0x814f, 0x014a, 0x815b, 0x015e, 0x0154, 0x8151,
+    0x8173, 0x0176, 0x017c, 0x8179, 0x0168, 0x816d, 0x8167, 0x0162,
+    0x8123, 0x0126, 0x012c, 0x8129, 0x0138, 0x813d, 0x8137, 0x0132,
+    0x0110, 0x8115, 0x811f, 0x011a, 0x810b, 0x010e, 0x0104, 0x8101,
+    0x8303, 0x0306, 0x030c, 0x8309, 0x0318, 0x831d, 0x8317, 0x0312,
+    0x0330, 0x8335, 0x833f, 0x033a, 0x832b, 0x032e, 0x0324, 0x8321,
+    0x0360, 0x8365, 0x836f, 0x036a, 0x837b, 0x037e, 0x0374, 0x8371,
+    0x8353, 0x0356, 0x035c, 0x8359, 0x0348, 0x834d, 0x8347, 0x0342,
+    0x03c0, 0x83c5, 0x83cf, 0x03ca, 0x83db, 0x03de, 0x03d4, 0x83d1,
+    0x83f3, 0x03f6, 0x03fc, 0x83f9, 0x03e8, 0x83ed, 0x83e7, 0x03e2,
+    0x83a3, 0x03a6, 0x03ac, 0x83a9, 0x03b8, 0x83bd, 0x83b7, 0x03b2,
+    0x0390, 0x8395, 0x839f, 0x039a, 0x838b, 0x038e, 0x0384, 0x8381,
+    0x0280, 0x8285, 0x828f, 0x028a, 0x829b, 0x029e, 0x0294, 0x8291,
+    0x82b3, 0x02b6, 0x02bc, 0x82b9, 0x02a8, 0x82ad, 0x82a7, 0x02a2,
+    0x82e3, 0x02e6, 0x02ec, 0x82e9, 0x02f8, 0x82fd, 0x82f7, 0x02f2,
+    0x02d0, 0x82d5, 0x82df, 0x02da, 0x82cb, 0x02ce, 0x02c4, 0x82c1,
+    0x8243, 0x0246, 0x024c, 0x8249, 0x0258, 0x825d, 0x8257, 0x0252,
+    0x0270, 0x8275, 0x827f, 0x027a, 0x826b, 0x026e, 0x0264, 0x8261,
+    0x0220, 0x8225, 0x822f, 0x022a, 0x823b, 0x023e, 0x0234, 0x8231,
+    0x8213, 0x0216, 0x021c, 0x8219, 0x0208, 0x820d, 0x8207, 0x0202,
+};
+
+// in kbit/s, indexed by [MPEG-1 ? layer - 1 : 3 + (layer == 1 ? 0 : 1)]
+static const uint16_t bitrates[5][15] = {
+    {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+    {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+    {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320},
+    {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+    {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+};
+
+static const uint16_t sample_rates[3] = {44100, 48000, 32000};
+
+struct bit_reader {
+  const uint8_t *p;
+  unsigned int pos;
+};
+
+static unsigned int read_bits(struct bit_reader *r, unsigned int n) {
+  unsigned int v = 0;
+  while (n-- > 0) {
+    v = (v << 1) | ((r->p[r->pos >> 3] >> (7 - (r->pos & 7))) & 1);
+    ++r->pos;
+  }
+  return v;
+}
+
+uint16_t mpeg_crc16(uint16_t crc, const uint8_t *data, size_t len) {
+  while (len-- > 0)
+    crc = (crc << 8) ^ crc16_table[(crc >> 8) ^ *data++];
+  return crc;
+}
+
+int mpeg_parse_header(const uint8_t *p, struct mpeg_header *header) {
+  if (p[0] != 0xff || (p[1] & 0xe0) != 0xe0)
+    return 1;
+
+  switch ((p[1] >> 3) & 0x03) {
+  case 0:
+    header->version = MPEG_VERSION_2_5;
+    break;
+  case 2:
+    header->version = MPEG_VERSION_2;
+    break;
+  case 3:
+    header->version = MPEG_VERSION_1;
+    break;
+  default:
+    return 1;
+  }
+
+  header->layer = 4 - ((p[1] >> 1) & 0x03);
+  if (header->layer == 4)
+    return 1;
+  header->protection = !(p[1] & 0x01);
+
+  const unsigned int bitrate_index = p[2] >> 4;
+  const unsigned int sample_rate_index = (p[2] >> 2) & 0x03;
+  const unsigned int padding = (p[2] >> 1) & 0x01;
+  if (bitrate_index == 15 || sample_rate_index == 3 || (p[3] & 0x03) == 2)
+    return 1;
+
+  const unsigned int table = header->version == MPEG_VERSION_1
+                                 ? header->layer - 1
+                                 : (header->layer == 1 ? 3 : 4);
+  header->bitrate = bitrates[table][bitrate_index] * 1000;
+
+  header->sample_rate = sample_rates[sample_rate_index];
+  if (header->version == MPEG_VERSION_2)
+    header->sample_rate /= 2;
+  else if (header->version == MPEG_VERSION_2_5)
+    header->sample_rate /= 4;
+
+  header->channels = (p[3] >> 6) == 3 ? 1 : 2;
+
+  if (header->bitrate == 0) {
+    header->frame_length = 0;
+  } else if (header->layer == 1) {
+    header->frame_length =
+        (12 * header->bitrate / header->sample_rate + padding) * 4;
+  } else {
+    const unsigned int factor =
+        (header->layer == 3 && header->version != MPEG_VERSION_1) ? 72 : 144;
+    header->frame_length =
+        factor * header->bitrate / header->sample_rate + padding;
+  }
+
+  return 0;
+}
+
+static size_t side_info_length(const struct mpeg_header *header) {
+  if (header->version == MPEG_VERSION_1)
+    return header->channels == 1 ? 17 : 32;
+  return header->channels == 1 ? 9 : 17;
+}
+
+// Rejects side information that libmad would only refuse after reading the
+// main data: out of range big_values, reserved block types and the unused
+// Huffman tables 4 and 14. The sum of part2_3_length must fit into the bit
+// reservoir plus the main data of this frame.
+static int check_side_info(const uint8_t *si, size_t main_data_length,
+                           const struct mpeg_header *header) {
+  const bool lsf = header->version != MPEG_VERSION_1;
+  const unsigned int granules = lsf ? 1 : 2;
+  struct bit_reader r = {si, 0};
+
+  const unsigned int main_data_begin = read_bits(&r, lsf ? 8 : 9);
+  if (lsf)
+    read_bits(&r, header->channels == 1 ? 1 : 2); // private bits
+  else
+    read_bits(&r, (header->channels == 1 ? 5 : 3) + 4 * header->channels);
+
+  unsigned long part2_3_bits = 0;
+  for (unsigned int gr = 0; gr < granules; ++gr) {
+    for (unsigned int ch = 0; ch < header->channels; ++ch) {
+      part2_3_bits += read_bits(&r, 12);
+      if (read_bits(&r, 9) > LAYER_III_MAX_BIG_VALUES)
+        return 1;
+      read_bits(&r, 8 + (lsf ? 9 : 4)); // global_gain, scalefac_compress
+
+      unsigned int tables;
+      if (read_bits(&r, 1)) { // window_switching_flag
+        if (read_bits(&r, 2) == 0) // block_type
+          return 1;
+        read_bits(&r, 1); // mixed_block_flag
+        tables = 2;
+      } else {
+        tables = 3;
+      }
+      for (unsigned int i = 0; i < tables; ++i) {
+        const unsigned int table_select = read_bits(&r, 5);
+        if (table_select == 4 || table_select == 14)
+          return 1;
+      }
+      read_bits(&r, tables == 2 ? 9 : 7); // subblock_gain or region counts
+      read_bits(&r, lsf ? 2 : 3);
+    }
+  }
+
+  if (part2_3_bits > 8 * (main_data_begin + main_data_length))
+    return 1;
+
+  return 0;
+}
+
+int mpeg_check_frame(const uint8_t *p, size_t len,
+                     const struct mpeg_header *header) {
+  if (header->layer != 3)
+    return 0;
+
+  const size_t si_offset = MPEG_HEADER_SIZE + (header->protection ? 2 : 0);
+  const size_t si_length = side_info_length(header);
+  if (len < si_offset + si_length)
+    return 0; // not enough data to tell, leave it to the decoder
+
+  if (header->protection) {
+    uint16_t crc = mpeg_crc16(0xffff, p + 2, 2);
+    crc = mpeg_crc16(crc, p + si_offset, si_length);
+    if (crc != ((p[4] << 8) | p[5]))
+      return 1;
+  }
+
+  size_t main_data_length = 0;
+  if (header->frame_length > si_offset + si_length)
+    main_data_length = header->frame_length - si_offset - si_length;
+  else if (header->frame_length != 0)
+    return 1;
+  else
+    main_data_length = 2048; // free format, length unknown
+
+  return check_side_info(p + si_offset, main_data_length, header);
+}
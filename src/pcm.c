@@ -0,0 +1,118 @@
+#include "pcm.h"
+
+#include <stdbool.h>
+
+#define OUTPUT_BITS 16
+#define SCALE_BITS (MAD_F_FRACBITS + 1 - OUTPUT_BITS)
+#define ROUNDING (1L << (SCALE_BITS - 1))
+#define SAMPLE_MIN (-MAD_F_ONE)
+#define SAMPLE_MAX (MAD_F_ONE - 1)
+
+// 32-bit linear congruential generator
+static inline uint32_t prng(uint32_t state) {
+  return state * 0x0019660dUL + 0x3c6ef35fUL;
+}
+
+static inline mad_fixed_t clip(mad_fixed_t sample) {
+  if (sample > SAMPLE_MAX)
+    return SAMPLE_MAX;
+  if (sample < SAMPLE_MIN)
+    return SAMPLE_MIN;
+  return sample;
+}
+
+static inline int16_t round_sample(mad_fixed_t sample) {
+  return clip(sample + ROUNDING) >> SCALE_BITS;
+}
+
+// The difference of two consecutive uniform random values yields triangular
+// (TPDF) dither with an amplitude of +/- 1 LSB of the output.
+static inline int16_t dither_sample(struct pcm_state *state,
+                                    mad_fixed_t *error, mad_fixed_t sample,
+                                    bool shaped) {
+  static const mad_fixed_t mask = (1L << SCALE_BITS) - 1;
+
+  if (shaped) {
+    // three tap error feedback, e[n-1] - e[n-2] / 2 + e[n-3] / 2, moves
+    // noise towards the top of the band
+    sample += error[0] - error[1] + error[2];
+    error[2] = error[1];
+    error[1] = error[0] / 2;
+  }
+
+  // clip before computing the error, so overloads don't feed back
+  sample = clip(sample);
+
+  // the low bits of an LCG repeat with short periods, the high ones are used
+  const uint32_t random = prng(state->random);
+  mad_fixed_t output = sample + ROUNDING +
+                       (mad_fixed_t)(random >> (32 - SCALE_BITS)) -
+                       (mad_fixed_t)(state->random >> (32 - SCALE_BITS));
+  state->random = random;
+
+  output = clip(output) & ~mask;
+  if (shaped)
+    error[0] = sample - output;
+
+  return output >> SCALE_BITS;
+}
+
+// Packs a left and a right sample into one 32 bit word as expected by I2S
+static inline uint32_t frame(int16_t left, int16_t right) {
+  return (uint16_t)left | ((uint32_t)(uint16_t)right << 16);
+}
+
+static inline mad_fixed_t scale(mad_fixed_t sample, mad_fixed_t gain) {
+  return gain == MAD_F_ONE ? sample : mad_f_mul(sample, gain);
+}
+
+// Single channel input is converted once and duplicated with a single word
+// store per frame.
+static void pack_mono(struct pcm_state *state, uint32_t *dst,
+                      const mad_fixed_t *samples, size_t n) {
+  const mad_fixed_t gain = state->gain;
+  const bool shaped = state->dither == PCM_DITHER_SHAPED;
+
+  if (state->dither == PCM_DITHER_NONE && gain == MAD_F_ONE) {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = 0x00010001UL * (uint16_t)round_sample(samples[i]);
+    return;
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    const mad_fixed_t sample = scale(samples[i], gain);
+    int16_t s;
+    if (state->dither == PCM_DITHER_NONE)
+      s = round_sample(sample);
+    else
+      s = dither_sample(state, state->error[0], sample, shaped);
+    dst[i] = 0x00010001UL * (uint16_t)s;
+  }
+}
+
+void pcm_pack(struct pcm_state *state, uint32_t *dst, const mad_fixed_t *left,
+              const mad_fixed_t *right, size_t n) {
+  if (right == NULL) {
+    pack_mono(state, dst, left, n);
+    return;
+  }
+
+  const mad_fixed_t gain = state->gain;
+  const bool shaped = state->dither == PCM_DITHER_SHAPED;
+
+  if (state->dither == PCM_DITHER_NONE && gain == MAD_F_ONE) {
+    for (size_t i = 0; i < n; ++i)
+      dst[i] = frame(round_sample(left[i]), round_sample(right[i]));
+    return;
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    const mad_fixed_t l = scale(left[i], gain), r = scale(right[i], gain);
+    if (state->dither == PCM_DITHER_NONE) {
+      dst[i] = frame(round_sample(l), round_sample(r));
+    } else {
+      dst[i] = frame(dither_sample(state, state->error[0], l, shaped),
+                     dither_sample(state, state->error[1], r, shaped));
+    }
+  }
+}
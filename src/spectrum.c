@@ -0,0 +1,84 @@
+#include "spectrum.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <string.h>
+
+// Level 0 is 48 dB below a full scale sine, as mean magnitude in units of
+// 2^-16 of full scale that is about 2^7.5
+#define FLOOR_STEPS 15
+
+// Copies that keep getting interrupted by updates are given up after this
+// many tries
+#define GET_TRIES 4
+
+// Subband after the last one of each band
+static const uint8_t band_end[SPECTRUM_BANDS] = {1, 2, 3, 5, 8, 12, 18, 32};
+
+// Odd while the decoder task is writing levels
+static volatile uint32_t sequence;
+static uint8_t levels[SPECTRUM_BANDS];
+
+// Returns the level of a mean magnitude, half steps of log2 give 3 dB each
+static uint8_t level(uint32_t mean) {
+  if (mean == 0)
+    return 0;
+  const int bits = 31 - __builtin_clz(mean);
+  const int half = bits > 0 ? (mean >> (bits - 1)) & 1 : 0;
+  const int steps = 2 * bits + half - FLOOR_STEPS;
+  if (steps < 0)
+    return 0;
+  return steps < SPECTRUM_LEVELS ? steps : SPECTRUM_LEVELS;
+}
+
+static void publish(const uint8_t *next) {
+  ++sequence;
+  __sync_synchronize();
+  memcpy(levels, next, sizeof(levels));
+  __sync_synchronize();
+  ++sequence;
+}
+
+void spectrum_update(const uint32_t *sums, unsigned int count) {
+  if (count == 0)
+    return;
+
+  uint8_t next[SPECTRUM_BANDS];
+  unsigned int sb = 0;
+
+  for (int band = 0; band < SPECTRUM_BANDS; ++band) {
+    const unsigned int first = sb;
+    uint32_t sum = 0;
+    for (; sb < band_end[band]; ++sb)
+      sum += sums[sb] / count;
+    const uint8_t l = level(sum / (sb - first));
+    next[band] = l + 1 < levels[band] ? levels[band] - 1 : l;
+  }
+  publish(next);
+}
+
+void spectrum_clear(void) {
+  const uint8_t next[SPECTRUM_BANDS] = {0};
+  publish(next);
+}
+
+bool spectrum_get(uint8_t *out) {
+  for (int i = 0; i < GET_TRIES; ++i) {
+    const uint32_t start = sequence;
+    if (start & 1) {
+      // the decoder was preempted in the middle of an update
+      taskYIELD();
+      continue;
+    }
+    uint8_t copy[SPECTRUM_BANDS];
+    __sync_synchronize();
+    memcpy(copy, levels, sizeof(copy));
+    __sync_synchronize();
+    if (sequence == start) {
+      memcpy(out, copy, sizeof(copy));
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,34 @@
+#include "station.h"
+#include "common.h"
+#include "dns.h"
+#include "http.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+const struct station stations[] = {
+    {"Antenne", {{"http://r.ezbt.me/antenne", 0}}, NULL},
+};
+
+const size_t station_count = ARRAY_SIZE(stations);
+
+size_t station_variant_count(const struct station *station) {
+  size_t count = 0;
+  while (count < STATION_MAX_VARIANTS && station->variants[count].url != NULL)
+    ++count;
+  return count;
+}
+
+void stations_prefetch(void) {
+  for (size_t i = 0; i < station_count; ++i) {
+    for (size_t j = 0; j < station_variant_count(&stations[i]); ++j) {
+      char host[64];
+      uint16_t port;
+      bool secure;
+      const char *path;
+      if (http_parse_url(stations[i].variants[j].url, host, sizeof(host),
+                         &port, &secure, &path) == 0)
+        dns_prefetch(host);
+    }
+  }
+}
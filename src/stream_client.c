@@ -1,316 +1,966 @@
 #include "stream_client.h"
 #include "common.h"
+#include "decoder.h"
+#include "dns.h"
+#include "endpoint_cache.h"
 #include "fifo.h"
+#include "hls.h"
+#include "http.h"
+#include "icy.h"
+#include "latency.h"
+#include "metadata.h"
+#include "mpeg.h"
+#include "tls.h"
+#include "ts.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
 
-#include "lwip/netdb.h"
-
-#include "lwip/dns.h"
-#include "lwip/sockets.h"
-#include "lwip/sys.h"
+#include "lwip/api.h"
+#include "lwip/ip_addr.h"
 
+#include "esp/hwrand.h"
 #include "espressif/esp_common.h"
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
-
-static const char *stream_host;
-static const char *stream_path;
+#include <strings.h>
+
+// Delay range between reconnect attempts in ms
+#define BACKOFF_MIN 500
+#define BACKOFF_MAX 32000
+// Give up looking for an MPEG frame header after a reconnect after this many
+// bytes and pass the data on as it is. The stream may not be MPEG audio.
+#define RESYNC_LIMIT 8192
+// Seconds without data after which a connection is considered dead
+#define STALL_TIMEOUT 5
+#define MAX_REDIRECTS 5
+// Bounds of the lwIP receive buffer per connection in bytes
+#define RECVBUF_MIN (2 * TCP_MSS)
+#define RECVBUF_MAX (8 * TCP_MSS)
+// Gaps between received buffers longer than this count as stalls, in us
+#define STALL_THRESHOLD 200000
+// Playback of a live HLS stream starts this many segments from the end
+#define HLS_LIVE_SEGMENTS 3
+// Stack of the stream task in words, the TLS handshake needs a lot more
+#ifdef STREAM_TLS
+#define STREAM_STACK_SIZE 2048
+#else
+#define STREAM_STACK_SIZE 512
+#endif
+
+// URL requested by stream_start(), stream_switch() or stream_move()
+static const char *volatile stream_url;
+// Copy of stream_url taken when the stream task takes on a request. Playlist
+// endpoints are cached under it, the UI may already request the next URL.
+static char task_url[HTTP_LINE_MAX];
 static stream_up_cb up_cb;
 static stream_metadata_cb metadata_cb;
 static bool stop;
 static TaskHandle_t handle;
-
-static ssize_t send_http_request(int sock, const char *host, const char *path) {
-  const char *req[] = {"GET ", path, " HTTP/1.0\r\nHost: ", host,
+static char content_type[32];
+// up_cb has been called, it's only called for the first connection
+static bool up;
+// audio data has been received on the current connection
+static bool receiving;
+// the decoder has to be resynchronized to the audio of a new connection
+static bool resync;
+// switching to stream_url has been requested
+static volatile bool zap;
+// a new stream is being connected, it's buffered behind the old one
+static bool zapping;
+// the requested switch goes to another variant of the same program, its
+// audio continues in the FIFO like after a reconnect
+static volatile bool moving;
+static size_t resync_skipped;
+static uint32_t lost_time;  // us
+static uint32_t start_time; // us, 0 once the first audio data arrived
+
+// Server the request currently goes to, changed by redirects
+static char host[64];
+static uint16_t port;
+static bool secure; // the server is reached over TLS
+static char path[HTTP_LINE_MAX];
+// the server redirected us to the location in host, port and path
+static bool redirect;
+
+static struct http_parser http;
+static struct icy_demuxer icy;
+
+// Connection that is kept open between requests to the same server
+static struct netconn *conn;
+static char conn_host[sizeof(host)];
+static uint16_t conn_port;
+static bool conn_secure;
+
+// What the body of the current response is handed to
+static enum { BODY_STREAM, BODY_PLAYLIST, BODY_SEGMENT } body_type;
+
+// HLS state
+static struct hls_playlist playlist;
+static struct ts_demuxer ts;
+// URL of the media playlist, segment URIs are relative to it
+static char playlist_url[HTTP_LINE_MAX];
+static char segment_url[HTTP_LINE_MAX];
+static bool hls;
+// bytes of an ID3 tag still to be skipped at the start of a segment
+static size_t id3_skip;
+static bool segment_start;
+static bool segment_ts; // the segment is an MPEG transport stream
+
+// Entry of a PLS or M3U playlist that is tried first, the one that worked last
+static size_t mirror;
+// segment_url holds a playlist entry, which is cached once it plays
+static bool resolving;
+// segment_url holds the cached endpoint, stored at the server's cached_date
+static bool cached;
+static uint32_t cached_date;
+// segment_url is stored once the decoder has decoded a frame from beyond
+// store_pos, the FIFO position where the stream starts
+static bool store_pending;
+static bool store_reached; // the decoder has read past store_pos
+static uint32_t store_pos;
+static unsigned int store_frames; // decoder_frames() when store_pos was passed
+static uint32_t store_date;       // the server's Date, 0 if unknown
+
+static struct stream_stats stats;
+// bytes received since the start, wraps around
+static uint32_t total_received;
+static uint32_t stats_time; // us, last reset of the stats
+// bitrate advertised by the server in kbit/s, 0 if unknown
+static unsigned int bitrate;
+// us, arrival of the last buffer and smoothed interval between buffers
+static uint32_t last_arrival;
+static uint32_t avg_interval;
+
+#ifdef STREAM_TLS
+// Decrypted data is read into this buffer, mbedtls doesn't hand out its
+// record buffer
+static uint8_t tls_buf[1024];
+#endif
+
+static inline uint16_t default_port(void) { return secure ? 443 : 80; }
+
+static err_t send_http_request(void) {
+  // the port is only part of the Host header if it isn't the default one
+  char port_str[8] = "";
+  if (port != default_port())
+    snprintf(port_str, sizeof(port_str), ":%u", port);
+
+  const char *req[] = {"GET ",
+                       path,
+                       " HTTP/1.1\r\nHost: ",
+                       host,
+                       port_str,
                        "\r\nIcy-MetaData: 1\r\n\r\n"};
 
-  ssize_t written_total = 0;
   for (int i = 0; i < ARRAY_SIZE(req); ++i) {
-    const size_t len = strlen(req[i]);
-    const ssize_t written = write(sock, req[i], len);
+#ifdef STREAM_TLS
+    if (conn_secure) {
+      if (tls_write(req[i], strlen(req[i])))
+        return ERR_CONN;
+      continue;
+    }
+#endif
+    const u8_t flags =
+        NETCONN_COPY | (i + 1 < ARRAY_SIZE(req) ? NETCONN_MORE : 0);
+    const err_t err = netconn_write(conn, req[i], strlen(req[i]), flags);
+    if (err != ERR_OK)
+      return err;
+  }
 
-    written_total += written;
+  return ERR_OK;
+}
 
-    if (len != written)
-      return -1;
+// Sets the server and path of the next request from an absolute URL or, for
+// redirects, an absolute path on the current server. Returns 0 on success.
+static int set_location(const char *url) {
+  const char *p;
+  if (http_parse_url(url, host, sizeof(host), &port, &secure, &p)) {
+    printf("unsupported URL: %s\n", url);
+    return 1;
+  }
+#ifndef STREAM_TLS
+  if (secure) {
+    printf("HTTPS not supported: %s\n", url);
+    return 1;
+  }
+#endif
+  if (strlen(p) >= sizeof(path)) {
+    printf("path too long\n");
+    return 1;
+  }
+  strcpy(path, p);
+  return 0;
+}
+
+// Returns the offset of the first MPEG frame header in data that is followed
+// by another valid header, or len if there is none.
+static size_t find_frame(const uint8_t *data, size_t len) {
+  struct mpeg_header h, next;
+
+  for (size_t i = 0; i + MPEG_HEADER_SIZE <= len; ++i) {
+    if (mpeg_parse_header(data + i, &h) != 0)
+      continue;
+    const size_t n = i + h.frame_length;
+    // the following header is not part of this span, accept the frame
+    if (h.frame_length == 0 || n + MPEG_HEADER_SIZE > len)
+      return i;
+    if (mpeg_parse_header(data + n, &next) == 0 &&
+        next.sample_rate == h.sample_rate)
+      return i;
   }
 
-  return written_total;
+  return len;
 }
 
-// Parses the HTTP reply. Returns 0 on success.
-// Parses the metadata interval as advertised by the server via the
-// 'icy-metaint' header attribute. The result is written into the variable
-// pointed to by metaint. If the attribute cannot be found, the variable is set
-// to -1. metaint may be set to NULL. The payload read after the header is
-// enqueued into the FIFO and the length of said payload is written into the
-// variable pointed to by metapos.
-static int read_header(int socket, int *metaint, int *metapos) {
-  int ret = 1;
-  static const size_t buffer_size = 2048;
-  char *buffer = malloc(buffer_size);
-  if (buffer == NULL) {
-    printf("allocating header buffer failed\n");
-    goto out;
+// Stores the endpoint a playlist resolved to once it plays. The decoder may
+// still be fading out the old stream, only frames decoded after it read past
+// the start of the new one count.
+static void confirm_endpoint(void) {
+  if (!store_pending)
+    return;
+  if (!store_reached) {
+    store_reached = (int32_t)(fifo_read_count() - store_pos) > 0;
+    store_frames = decoder_frames();
+  } else if (decoder_frames() != store_frames) {
+    endpoint_store(task_url, segment_url, store_date);
+    store_pending = false;
+  }
+}
+
+static void receive_audio(const uint8_t *data, size_t len) {
+  receiving = true;
+
+  if (resync && !hls) {
+    // The new connection starts at an arbitrary position in the stream.
+    // Dropping everything up to the first frame header keeps the decoder from
+    // being fed a partial frame after the last complete one of the old
+    // connection.
+    size_t skip = find_frame(data, len);
+    if (resync_skipped + skip >= RESYNC_LIMIT)
+      skip = 0;
+    resync_skipped += skip;
+    stats.resync_bytes += skip;
+    data += skip;
+    len -= skip;
+    if (len == 0)
+      return;
+
+    resync = false;
+    resync_skipped = 0;
+    if (!zapping)
+      stats.gap_time += (sdk_system_get_time() - lost_time) / 1000;
   }
-  memset(buffer, 0, buffer_size);
 
-  int n = read(socket, buffer, buffer_size - 1);
-  if (n <= 0) {
-    printf("receiving header lines failed\n");
-    goto free_buffer;
+  if (!up || zapping) {
+    // After a switch, the decoder plays the old stream up to here, then cuts
+    // over. After a reconnect the decoder is still running.
+    if (up) {
+      // metadata of the old stream would be delivered after the cut
+      metadata_clear();
+      fifo_mark();
+    }
+    up = true;
+    zapping = false;
+    up_cb(content_type[0] != '\0' ? content_type : NULL);
   }
 
-  char *header_end = strstr(buffer, "\r\n\r\n");
-  if (header_end == NULL) {
-    printf("header too long\n");
-    goto free_buffer;
+  if (start_time != 0) {
+    stats.start_latency = (sdk_system_get_time() - start_time) / 1000;
+    start_time = 0;
   }
-  header_end[2] = '\0';
-  header_end += 4;
 
-  const char *status_code_pos = strchr(buffer, ' ');
-  if (status_code_pos == NULL || strncmp(status_code_pos + 1, "200", 3) != 0) {
-    *strstr(buffer, "\r\n") = '\0';
-    printf("invalid reply status: %s\n", buffer);
-    goto free_buffer;
+  // A full FIFO holds up the next receive, the wait isn't a gap of the
+  // network and doesn't count towards the arrival statistics.
+  const uint32_t enqueue_start = sdk_system_get_time();
+  fifo_enqueue(data, len);
+  latency_arrival(fifo_write_count(), last_arrival);
+  last_arrival += sdk_system_get_time() - enqueue_start;
+  confirm_endpoint();
+}
+
+// Size of the ID3 tag that starts an HLS segment of packed audio, 0 if there
+// is none.
+static size_t id3_size(const uint8_t *data, size_t len) {
+  if (len < 10 || memcmp(data, "ID3", 3) != 0)
+    return 0;
+
+  // syncsafe integer, 7 bits per byte, plus the header and maybe a footer
+  const size_t size = (data[6] & 0x7f) << 21 | (data[7] & 0x7f) << 14 |
+                      (data[8] & 0x7f) << 7 | (data[9] & 0x7f);
+  return size + 10 + (data[5] & 0x10 ? 10 : 0);
+}
+
+// Segments are either MPEG transport streams or packed audio with an ID3 tag
+static void receive_segment(const uint8_t *data, size_t len) {
+  if (segment_start) {
+    segment_start = false;
+    id3_skip = id3_size(data, len);
+    segment_ts = data[0] == 0x47;
+    ts_init(&ts, receive_audio);
   }
 
-  puts(buffer);
+  const size_t skip = min(len, id3_skip);
+  id3_skip -= skip;
+  data += skip;
+  len -= skip;
+  if (len == 0)
+    return;
+
+  if (segment_ts)
+    ts_feed(&ts, data, len);
+  else
+    receive_audio(data, len);
+}
 
-  if (metaint != NULL) {
-    const char *metaint_pos = strstr(buffer, "icy-metaint:");
-    if (metaint_pos != NULL && metaint_pos < header_end) {
-      char *line_end = strstr(metaint_pos, "\r\n");
-      *line_end = '\0';
-      *metaint = atoi(metaint_pos + 12);
-    } else {
-      *metaint = -1;
+static void receive_body(const uint8_t *data, size_t len) {
+  switch (body_type) {
+  case BODY_STREAM:
+    icy_feed(&icy, data, len);
+    break;
+  case BODY_PLAYLIST:
+    hls_playlist_feed(&playlist, data, len);
+    break;
+  case BODY_SEGMENT:
+    receive_segment(data, len);
+    break;
+  }
+}
+
+// StreamTitle is split into artist and title at the first " - ". Titles
+// without an artist are reported with an empty artist. The metadata is
+// queued until the audio that follows it plays.
+static void receive_metadata(enum icy_field field, char *value) {
+  const uint32_t pos = fifo_write_count();
+  switch (field) {
+  case ICY_STREAM_TITLE: {
+    char *sep = strstr(value, " - ");
+    if (sep == NULL) {
+      metadata_queue(pos, STREAM_ARTIST, "");
+      metadata_queue(pos, STREAM_TITLE, value);
+      break;
     }
+    *sep = '\0';
+    metadata_queue(pos, STREAM_ARTIST, value);
+    metadata_queue(pos, STREAM_TITLE, sep + 3);
+    break;
+  }
+  case ICY_STREAM_URL:
+    metadata_queue(pos, STREAM_URL, value);
+    break;
   }
+}
 
-  int header_len = header_end - buffer;
-  fifo_enqueue(header_end, n - header_len);
-  if (metapos != NULL)
-    *metapos = n - header_len;
+static bool has_suffix(const char *s, const char *suffix) {
+  const size_t len = strcspn(s, "?");
+  const size_t suffix_len = strlen(suffix);
+  return len >= suffix_len &&
+         strncasecmp(s + len - suffix_len, suffix, suffix_len) == 0;
+}
 
-  ret = 0;
+// Some servers send playlists as text/plain or application/octet-stream, so
+// the extension of the path counts unless the type is audio
+static bool is_playlist(const char *type) {
+  if (strcasecmp(type, "application/vnd.apple.mpegurl") == 0 ||
+      strcasecmp(type, "application/x-mpegurl") == 0 ||
+      strcasecmp(type, "audio/mpegurl") == 0 ||
+      strcasecmp(type, "audio/x-mpegurl") == 0 ||
+      strcasecmp(type, "audio/x-scpls") == 0)
+    return true;
+
+  return strncasecmp(type, "audio/", 6) != 0 &&
+         (has_suffix(path, ".pls") || has_suffix(path, ".m3u") ||
+          has_suffix(path, ".m3u8"));
+}
 
-free_buffer:
-  free(buffer);
-out:
-  return ret;
+static bool is_redirect(int status) {
+  return status == 301 || status == 302 || status == 303 || status == 307 ||
+         status == 308;
 }
 
-static void parse_metadata(const char *s, int len) {
-  static enum { INIT, OTHER, ARTIST, TITLE } state = INIT;
-  static char buf[64];
-  static int buf_pos = 0;
+// Called once the reply header is complete. Follows redirects and decides
+// where the body goes. Returns true if the body should be received.
+static bool receive_header(const struct http_response *response) {
+  printf("HTTP status %d\n", response->status);
+  store_pending = false;
 
-  while (len > 0) {
-    int available = sizeof(buf) - buf_pos;
-    if (available == 0) {
-      // If we run of out buffer space, we can't loop forever. If we're in the
-      // middle of parsing the artist or the title, we just termiate the string
-      // and use the incomplete string. That's probably better than skipping it
-      // altogether.
-      buf[sizeof(buf) - 1] = '\0';
-      switch (state) {
-      case ARTIST:
-        metadata_cb(STREAM_ARTIST, buf);
-        break;
-      case TITLE:
-        metadata_cb(STREAM_TITLE, buf);
-        break;
-      default:
+  if (is_redirect(response->status) && response->location[0] != '\0') {
+    printf("redirected to %s\n", response->location);
+    redirect = set_location(response->location) == 0;
+    return false;
+  }
+
+  if (response->status != 200) {
+    printf("unexpected reply status\n");
+    return false;
+  }
+
+  if (is_playlist(response->content_type)) {
+    // relative URIs refer to the playlist after redirects, they would resolve
+    // against the wrong URL if it was cut short
+    const char *scheme = secure ? "https" : "http";
+    const int len =
+        port != default_port()
+            ? snprintf(playlist_url, sizeof(playlist_url), "%s://%s:%u%s",
+                       scheme, host, port, path)
+            : snprintf(playlist_url, sizeof(playlist_url), "%s://%s%s", scheme,
+                       host, path);
+    if (len >= sizeof(playlist_url)) {
+      printf("playlist URL too long\n");
+      return false;
+    }
+    body_type = BODY_PLAYLIST;
+    hls_playlist_init(&playlist);
+    return true;
+  }
+
+  if (hls) {
+    // the segments' Content-Type says nothing about the codec, the decoder
+    // has to probe the stream
+    body_type = BODY_SEGMENT;
+    segment_start = true;
+    ++stats.segments;
+    return true;
+  }
+
+  body_type = BODY_STREAM;
+  if (cached && endpoint_expired(cached_date, response->date)) {
+    printf("Cached endpoint expired\n");
+    return false;
+  }
+  store_pending = resolving || cached;
+  store_reached = false;
+  store_pos = fifo_write_count();
+  store_date = response->date;
+  strcpy(content_type, response->content_type);
+  printf("metaint=%d bitrate=%u\n", response->metaint, response->bitrate);
+  bitrate = response->bitrate;
+  icy_init(&icy, response->metaint, receive_audio, receive_metadata);
+  return true;
+}
+
+// Processes one span of received data. Returns 0 as long as the connection
+// should be kept.
+static int receive(const uint8_t *data, size_t len) {
+  stats.received += len;
+  total_received += len;
+  ++stats.spans;
+
+  return http_parse(&http, data, len) != HTTP_CONTINUE;
+}
+
+// Sizes the lwIP receive buffer to about half a second of the stream, but not
+// more than the FIFO can take. Once the buffer is full, TCP flow control
+// kicks in, so less buffering is needed while the FIFO is filling up.
+static void tune_receive(struct netconn *conn) {
+#if LWIP_SO_RCVBUF
+  int size = bitrate > 0 ? bitrate * 1000 / 8 / 2 : RECVBUF_MAX;
+  size = min(size, fifo_free());
+  if (size < RECVBUF_MIN)
+    size = RECVBUF_MIN;
+  if (size > RECVBUF_MAX)
+    size = RECVBUF_MAX;
+  netconn_set_recvbufsize(conn, size);
+
+  const int avail = conn->recv_avail;
+  if (avail > stats.recvbuf_max)
+    stats.recvbuf_max = avail;
+#endif
+}
+
+// Updates the inter-arrival statistics for a buffer received now
+static void track_arrival(void) {
+  const uint32_t now = sdk_system_get_time();
+  const uint32_t interval = now - last_arrival;
+  last_arrival = now;
+
+  if (interval > STALL_THRESHOLD)
+    stats.stall_time += interval / 1000;
+  if (interval / 1000 > stats.max_interval)
+    stats.max_interval = interval / 1000;
+
+  // smoothed mean deviation from the smoothed interval, like RFC 3550 jitter
+  const int32_t deviation = interval - avg_interval;
+  avg_interval += deviation / 16;
+  stats.jitter += ((deviation < 0 ? -deviation : deviation) -
+                   (int32_t)stats.jitter) / 16;
+}
+
+static void close_connection(void) {
+  if (conn == NULL)
+    return;
+#ifdef STREAM_TLS
+  if (conn_secure)
+    tls_close();
+#endif
+  netconn_close(conn);
+  netconn_delete(conn);
+  conn = NULL;
+}
+
+// Connects to host and port unless the kept connection already goes there.
+// Returns 0 on success.
+static int open_connection(void) {
+  if (conn != NULL) {
+    if (strcmp(conn_host, host) == 0 && conn_port == port &&
+        conn_secure == secure)
+      return 0;
+    close_connection();
+  }
+
+  ip_addr_t addr;
+  if (dns_lookup(host, &addr)) {
+    printf("DNS lookup for %s failed\n", host);
+    return 1;
+  }
+
+  conn = netconn_new(NETCONN_TCP);
+  if (conn == NULL) {
+    printf("Failed to allocate connection\n");
+    return 1;
+  }
+
+  if (netconn_connect(conn, &addr, port) != ERR_OK) {
+    printf("Connecting failed\n");
+    netconn_delete(conn);
+    conn = NULL;
+    return 1;
+  }
+
+  // wake up once in a while to check whether we're supposed to stop
+  netconn_set_recvtimeout(conn, 1000);
+
+#ifdef STREAM_TLS
+  if (secure && tls_connect(conn, host)) {
+    netconn_close(conn);
+    netconn_delete(conn);
+    conn = NULL;
+    return 1;
+  }
+#endif
+
+  strcpy(conn_host, host);
+  conn_port = port;
+  conn_secure = secure;
+  return 0;
+}
+
+// Accounts for a received buffer and adapts the receive buffer every second
+static void track_buffer(uint32_t *last_tune) {
+  ++stats.buffers;
+  track_arrival();
+  if (last_arrival - *last_tune > 1000000) {
+    tune_receive(conn);
+    *last_tune = last_arrival;
+  }
+}
+
+// Receives the reply until it's complete, the connection fails, the server
+// redirects us or the stream is stopped. Returns true if data was received.
+static bool receive_reply(void) {
+  bool received = false;
+
+  http_parser_init(&http, receive_header, receive_body);
+  bitrate = 0;
+  last_arrival = sdk_system_get_time();
+  uint32_t last_tune = last_arrival;
+  tune_receive(conn);
+
+  // A dropped Wi-Fi link often doesn't close the connection, so it is given
+  // up after a few seconds without data.
+  unsigned int idle = 0;
+  while (!stop && !zap) {
+    int ret;
+
+#ifdef STREAM_TLS
+    if (conn_secure) {
+      const int n = tls_read(tls_buf, sizeof(tls_buf));
+      if (n == TLS_TIMEOUT && ++idle < STALL_TIMEOUT)
+        continue;
+      if (n <= 0) {
+        printf("receiving failed ret=%d\n", n);
         break;
       }
-      state = INIT;
-      available = sizeof(buf);
-      buf_pos = 0;
+      idle = 0;
+      received = true;
+
+      track_buffer(&last_tune);
+      if (receive(tls_buf, n) != 0)
+        break;
+      continue;
     }
-    int n = min(len, available);
-    memcpy(buf + buf_pos, s, n);
-    buf_pos += n;
-    s += n;
-    len -= n;
-
-    // get rid of trailing zero bytes
-    while (buf_pos > 0 && buf[buf_pos - 1] == '\0')
-      --buf_pos;
-
-    // work on buf
-    char *next_start = buf;
+#endif
+
+    struct netbuf *buf;
+    const err_t err = netconn_recv(conn, &buf);
+    if (err == ERR_TIMEOUT && ++idle < STALL_TIMEOUT)
+      continue;
+    if (err != ERR_OK) {
+      printf("receiving failed err=%d\n", err);
+      break;
+    }
+    idle = 0;
+    received = true;
+
+    track_buffer(&last_tune);
     do {
-      int distance = next_start - buf;
-      if (distance > 0) {
-        memmove(buf, next_start, sizeof(buf) - distance);
-        buf_pos -= distance;
-      }
+      void *data;
+      u16_t len;
+      netbuf_data(buf, &data, &len);
+      ret = receive(data, len);
+    } while (ret == 0 && netbuf_next(buf) >= 0);
+    netbuf_delete(buf);
+
+    if (ret != 0)
+      break;
+  }
 
-      switch (state) {
-      case INIT:
-        next_start = strnstr(buf, "='", buf_pos);
-        if (next_start) {
-          if (strncmp(buf, "StreamTitle", next_start - buf) == 0) {
-            state = ARTIST;
-          } else {
-            state = OTHER;
-          }
-          next_start += 2;
-        }
-        break;
-      case OTHER:
-        next_start = strnstr(buf, ";", buf_pos);
-        if (next_start) {
-          ++next_start;
-          state = INIT;
-        } else {
-          next_start = buf + buf_pos;
-        }
-        break;
-      case ARTIST:
-        next_start = strnstr(buf, " - ", buf_pos);
-        if (next_start) {
-          *next_start = '\0';
-          metadata_cb(STREAM_ARTIST, buf);
-          next_start += 3;
-          state = TITLE;
-        }
+  return received;
+}
+
+// Sends a single request and receives the reply. Returns 0 if the reply was
+// received completely, which is never the case for a continuous stream.
+static int request(void) {
+  // A kept connection may have been closed by the server in the meantime,
+  // in that case the request is repeated on a new connection.
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    const bool reused = conn != NULL;
+    if (open_connection())
+      return 1;
+
+    const bool sent = send_http_request() == ERR_OK;
+    const bool received = sent && receive_reply();
+    const bool complete = http.state == HTTP_END;
+
+    if (!http_reusable(&http))
+      close_connection();
+    if (complete)
+      return 0;
+    if (received || !reused) {
+      if (!sent)
+        printf("Sending HTTP request failed\n");
+      return 1;
+    }
+  }
+
+  return 1;
+}
+
+// Requests url and follows redirects. Returns 0 if the reply was received
+// completely.
+static int fetch(const char *url) {
+  if (set_location(url))
+    return 1;
+
+  for (int i = 0; i <= MAX_REDIRECTS && !stop && !zap; ++i) {
+    redirect = false;
+    const int ret = request();
+    if (!redirect)
+      return ret;
+  }
+
+  printf("too many redirects\n");
+  return 1;
+}
+
+// Fetches the media playlist, picks the first variant of a master playlist.
+// Returns 0 on success.
+static int fetch_playlist(const char *url) {
+  for (int i = 0; i < 2; ++i) {
+    if (fetch(url))
+      return 1;
+    hls_playlist_finish(&playlist);
+    if (!playlist.master)
+      return 0;
+
+    if (playlist.count == 0 ||
+        hls_resolve(playlist_url, playlist.entries[0].uri, segment_url,
+                    sizeof(segment_url)))
+      return 1;
+    url = segment_url;
+  }
+
+  return 1;
+}
+
+// Plays a live or on-demand HLS stream. The segments are fetched one after
+// the other, the FIFO holds the audio of the segments that have been
+// downloaded ahead. Its flow control keeps the download ahead of playback
+// without buffering more than the FIFO. The media playlist is reloaded when
+// all of its segments have been fetched.
+static void run_hls(void) {
+  // fetch_playlist() changes playlist_url when following a variant
+  char *media_url = malloc(HTTP_LINE_MAX);
+  if (media_url == NULL)
+    return;
+  strcpy(media_url, playlist_url);
+
+  uint32_t next = playlist.end || playlist.count <= HLS_LIVE_SEGMENTS
+                      ? playlist.sequence
+                      : playlist.sequence + playlist.count - HLS_LIVE_SEGMENTS;
+  TickType_t loaded = xTaskGetTickCount();
+  // the first load counts as a change
+  bool changed = true;
+
+  while (!stop && !zap) {
+    // we fell behind the live edge
+    if ((int32_t)(next - playlist.sequence) < 0)
+      next = playlist.sequence;
+
+    const uint32_t index = next - playlist.sequence;
+    if (index < playlist.count) {
+      if (hls_resolve(media_url, playlist.entries[index].uri, segment_url,
+                      sizeof(segment_url)) ||
+          fetch(segment_url))
         break;
-      case TITLE:
-        next_start = strnstr(buf, "';", buf_pos);
-        if (next_start) {
-          *next_start = '\0';
-          metadata_cb(STREAM_TITLE, buf);
-          next_start += 2;
-          state = INIT;
-        }
+      ++next;
+      continue;
+    }
+
+    if (playlist.end)
+      break;
+
+    // The playlist is reloaded after the target duration if it had a new
+    // segment, otherwise after half of it, counted from the start of the last
+    // load (RFC 8216, 6.3.4).
+    TickType_t interval = playlist.target_duration * 1000 / portTICK_PERIOD_MS;
+    if (!changed)
+      interval /= 2;
+    while (!stop && !zap &&
+           (int32_t)(xTaskGetTickCount() - loaded) < (int32_t)interval)
+      vTaskDelay(100 / portTICK_PERIOD_MS);
+
+    const uint32_t end = playlist.sequence + playlist.count;
+    loaded = xTaskGetTickCount();
+    if (fetch_playlist(media_url))
+      break;
+    ++stats.playlists;
+    changed = playlist.sequence + playlist.count != end;
+  }
+
+  free(media_url);
+}
+
+// Plays the stream a playlist resolved to before. Returns true if it worked
+// or the stream was stopped or switched in the meantime. An entry that has
+// expired by the server's Date is dropped like one that failed.
+static bool run_cached(void) {
+  if (endpoint_lookup(task_url, segment_url, sizeof(segment_url),
+                      &cached_date))
+    return false;
+
+  printf("Using cached endpoint %s\n", segment_url);
+  body_type = BODY_STREAM;
+  cached = true;
+  fetch(segment_url);
+  cached = false;
+  if (receiving || stop || zap)
+    return true;
+
+  printf("Dropping cached endpoint\n");
+  endpoint_forget(task_url);
+  return false;
+}
+
+// The entries of PLS and M3U playlists are usually mirrors of the same
+// stream. They are tried in turn, starting with the one that worked last,
+// until one of them plays. Returns true if an entry is another playlist,
+// whose URL is left in segment_url.
+static bool run_mirrors(void) {
+  const size_t count = playlist.count;
+  for (size_t i = 0; i < count && !receiving && !stop && !zap; ++i) {
+    const size_t entry = (mirror + i) % count;
+    if (hls_resolve(playlist_url, playlist.entries[entry].uri, segment_url,
+                    sizeof(segment_url)))
+      continue;
+
+    printf("Trying %s\n", segment_url);
+    body_type = BODY_STREAM;
+    resolving = true;
+    fetch(segment_url);
+    resolving = false;
+
+    if (body_type == BODY_PLAYLIST)
+      return true;
+    if (receiving)
+      mirror = entry;
+  }
+
+  return false;
+}
+
+// Requests the stream URL. PLS and M3U playlists are resolved to the first
+// of their streams that plays, the result is cached. An HLS playlist is
+// played segment by segment.
+static void run_connection(void) {
+  hls = false;
+  playlist_url[0] = '\0';
+
+  if (run_cached()) {
+    close_connection();
+    return;
+  }
+
+  const char *url = task_url;
+  for (int i = 0; i < 2 && !stop && !zap; ++i) {
+    body_type = BODY_STREAM;
+    if (fetch(url) || body_type != BODY_PLAYLIST)
+      break;
+
+    hls_playlist_finish(&playlist);
+    if (hls_is_hls(&playlist)) {
+      if (playlist.master && fetch_playlist(playlist_url))
         break;
-      }
-    } while (next_start && buf_pos > 0);
+      hls = true;
+      content_type[0] = '\0';
+      run_hls();
+      break;
+    }
+
+    if (!run_mirrors())
+      break;
+    url = segment_url;
   }
+
+  close_connection();
 }
 
-static void stream_task(void *arg) {
-  const struct addrinfo hints = {
-      .ai_family = AF_INET,
-      .ai_socktype = SOCK_STREAM,
-  };
-  struct addrinfo *res;
-
-  printf("Waiting for DHCP...\n");
-  while (sdk_wifi_station_get_connect_status() != STATION_GOT_IP) {
+// Waits for the given time in ms, but returns early if the stream is stopped
+// or switched
+static void backoff_delay(unsigned int ms) {
+  const TickType_t end = xTaskGetTickCount() + ms / portTICK_PERIOD_MS;
+  while (!stop && !zap && (int32_t)(end - xTaskGetTickCount()) > 0)
     vTaskDelay(100 / portTICK_PERIOD_MS);
+}
+
+// Copies the URL requested last for the stream task, one that doesn't fit
+// fails to connect
+static void take_url(void) {
+  const char *url = stream_url;
+  if (strlen(url) < sizeof(task_url)) {
+    strcpy(task_url, url);
+  } else {
+    printf("URL too long\n");
+    task_url[0] = '\0';
   }
+}
 
-  printf("Running DNS lookup for %s\n", stream_host);
-  int err = getaddrinfo(stream_host, "80", &hints, &res);
-  if (err != 0 || res == NULL) {
-    printf("DNS lookup failed err=%d res=%p\n", err, res);
-    if (res)
-      freeaddrinfo(res);
-    goto terminate_task;
-  }
-
-  // TODO: inet_ntoa is non-reentrant, look at ipaddr_ntoa_r
-  struct in_addr *addr = &((struct sockaddr_in *)res->ai_addr)->sin_addr;
-  printf("DNS lookup succeeded. IP=%s\n", inet_ntoa(*addr));
-
-  int s = socket(res->ai_family, res->ai_socktype, 0);
-  if (s < 0) {
-    printf("Failed to allocate socket\n");
-    freeaddrinfo(res);
-    goto terminate_task;
-  }
-
-  if (connect(s, res->ai_addr, res->ai_addrlen) != 0) {
-    freeaddrinfo(res);
-    printf("Socket connect failed\n");
-    goto close_socket;
-  }
-  freeaddrinfo(res);
-
-  if (send_http_request(s, stream_host, stream_path) <= 0) {
-    printf("Sending HTTP request failed\n");
-    goto close_socket;
-  }
-
-  int metaint = -1, metapos = -1;
-  if (read_header(s, &metaint, &metapos) < 0) {
-    printf("Reading reply header failed\n");
-    goto close_socket;
-  }
-  printf("metaint=%d metapos=%d\n", metaint, metapos);
-
-  up_cb();
-
-  int n;
-  char buf[64];
-  // length of the metadata block in bytes excluding the length field
-  int meta_length = 0;
-  size_t read_next = sizeof(buf); // TODO
-  while (!stop && (n = read(s, buf, read_next)) > 0) {
-    if (metaint != -1) {
-      metapos += n;
-      if (metapos < metaint) {
-        fifo_enqueue(buf, n);
-        read_next = (size_t)(metaint - metapos);
-      } else if (metapos == metaint) {
-        fifo_enqueue(buf, n);
-        // we have reached the end of the payload,
-        // read metadata length field (1 byte) next
-        read_next = 1;
-      } else {
-        if (metapos == metaint + 1) {
-          // the first byte after a payload block tells us
-          // the length of the following metadata
-          meta_length = 16 * (*(const uint8_t *)buf);
-        } else {
-          parse_metadata(buf, n);
-          meta_length -= n;
-        }
-        if (meta_length == 0) {
-          metapos = 0;
-          read_next = (size_t)(metaint - metapos);
-        } else {
-          read_next = (size_t)meta_length;
-        }
-      }
+// Keeps the stream connected. After a connection is lost, the decoder keeps
+// playing from the FIFO while reconnect attempts are spaced out with
+// exponential backoff and random jitter.
+static void stream_task(void *arg) {
+  unsigned int backoff = BACKOFF_MIN;
 
-      if (read_next > sizeof(buf)) {
-        read_next = sizeof(buf);
-      }
-    } else {
-      fifo_enqueue(buf, n);
+  while (!stop) {
+    printf("Waiting for DHCP...\n");
+    while (!stop && sdk_wifi_station_get_connect_status() != STATION_GOT_IP) {
+      vTaskDelay(100 / portTICK_PERIOD_MS);
+    }
+    if (stop)
+      break;
+
+    if (zap) {
+      zap = false;
+      take_url();
+      zapping = !moving;
+      moving = false;
+      mirror = 0;
+      resync = true;
+      backoff = BACKOFF_MIN;
+    }
+
+    receiving = false;
+    run_connection();
+    if (stop)
+      break;
+    if (zap)
+      continue;
+
+    if (receiving) {
+      // the connection worked for a while, start over with a short delay
+      backoff = BACKOFF_MIN;
+      lost_time = sdk_system_get_time();
+      resync = true;
+    } else if (backoff < BACKOFF_MAX) {
+      backoff *= 2;
     }
+
+    const unsigned int delay = backoff / 2 + hwrand() % (backoff / 2);
+    printf("Connection lost, reconnecting in %u ms\n", delay);
+    ++stats.reconnects;
+    backoff_delay(delay);
   }
 
-close_socket:
-  close(s);
-terminate_task:
   vTaskDelete(NULL);
 }
 
-int stream_start(const char *host, const char *path, stream_up_cb up,
-                 stream_metadata_cb meta) {
-  stream_host = host;
-  stream_path = path;
-  up_cb = up;
+void stream_get_and_reset_stats(struct stream_stats *s) {
+  const uint32_t now = sdk_system_get_time();
+  const uint32_t jitter = stats.jitter;
+
+  *s = stats;
+  s->interval = (now - stats_time) / 1000;
+  s->stack_free = handle != NULL ? uxTaskGetStackHighWaterMark(handle) : 0;
+
+  memset(&stats, 0, sizeof(stats));
+  // the jitter is a running estimate
+  stats.jitter = jitter;
+  stats_time = now;
+}
+
+int stream_start(const char *url, stream_up_cb on_up, stream_metadata_cb meta) {
+  stream_url = url;
+  take_url();
+  up_cb = on_up;
   metadata_cb = meta;
+  if (metadata_init())
+    return 1;
   stop = false;
+  up = false;
+  resync = false;
+  zap = false;
+  zapping = false;
+  moving = false;
+  start_time = sdk_system_get_time() | 1;
+
+  if (xTaskCreate(stream_task, "stream", STREAM_STACK_SIZE, NULL, 3,
+                  &handle) != pdPASS)
+    return 1;
+
+  return 0;
+}
 
-  if (xTaskCreate(stream_task, "stream", 384, NULL, 3, &handle) != pdPASS)
+int stream_switch(const char *url) {
+  if (handle == NULL || eTaskGetState(handle) == eDeleted)
     return 1;
 
+  stream_url = url;
+  start_time = sdk_system_get_time() | 1;
+  moving = false;
+  zap = true;
   return 0;
 }
 
+int stream_move(const char *url) {
+  if (handle == NULL || eTaskGetState(handle) == eDeleted)
+    return 1;
+
+  stream_url = url;
+  moving = true;
+  zap = true;
+  return 0;
+}
+
+uint32_t stream_received(void) { return total_received; }
+
+void stream_poll_metadata(void) {
+  metadata_deliver(fifo_read_count(), metadata_cb);
+}
+
 void stream_stop(void) {
   stop = true;
   do {
@@ -1,37 +1,106 @@
+#include "terminal.h"
 #include "lcd_font.h"
 #include "mi0283qt.h"
 
 #include "FreeRTOS.h"
-#include "semphr.h"
+#include "task.h"
+
+#include "esp/uart.h"
+#include "espressif/esp_common.h"
 
 #include <unistd.h>
 
 #include <stdio.h>
+#include <string.h>
 #include <stdout_redirect.h>
 
 #define COL_WIDTH (FONT_WIDTH + FONT_MARGIN)
 #define LINE_HEIGHT (FONT_HEIGHT + FONT_MARGIN)
-#define Y_START 0 // (LCD_HEIGHT * 3 / 4)
+// The terminal takes the bottom quarter, the UI the rest. The hardware scroll
+// area belongs to the UI, so the output wraps around to the top of the
+// quarter instead of scrolling.
+#define Y_START (LCD_HEIGHT * 3 / 4)
+// Size of the log ring in bytes, a power of two
+#define LOG_SIZE 2048
+// How often the render task looks for new output
+#define RENDER_INTERVAL_MS 20
 
 static uint16_t x, y;
 
+// Output waiting to be rendered. The positions count bytes and wrap around.
+// head is advanced by the writers with interrupts masked, tail only by the
+// render task. The LX106 has no compare-and-swap, so masking interrupts for
+// the copy is what keeps writers of several tasks and ISRs apart.
+static char ring[LOG_SIZE];
+static volatile uint32_t head;
+static volatile uint32_t tail;
+
+static unsigned int dropped;
+static uint32_t max_write_time; // us
+static TaskHandle_t render_handle;
+
 static ssize_t term_stdout(struct _reent *r, int fd, const void *ptr,
                            size_t len);
+static void render_task(void *p);
 
 void term_init(void) {
   x = 0;
   y = Y_START;
 
   lcd_rect(RGB(0, 0, 0), 0, Y_START, LCD_WIDTH - 1, LCD_HEIGHT - 1);
-  lcd_scroll_on(Y_START, 0);
   set_write_stdout(term_stdout);
+  // lcd_stringn() and the snprintf() of the drop note overflowed 256 words
+  if (xTaskCreate(render_task, "term", 512, NULL, 1, &render_handle) !=
+      pdPASS)
+    set_write_stdout(NULL);
   printf("Terminal ok\n");
 }
 
+// Copies the output into the ring in constant time, or drops all of it if
+// it doesn't fit. Called with interrupts masked.
+static void ring_write(const void *ptr, size_t len) {
+  if (len > LOG_SIZE - (head - tail)) {
+    ++dropped;
+    return;
+  }
+  const size_t pos = head % LOG_SIZE;
+  const size_t n = len < LOG_SIZE - pos ? len : LOG_SIZE - pos;
+  memcpy(ring + pos, ptr, n);
+  memcpy(ring, (const char *)ptr + n, len - n);
+  head += len;
+}
+
 static ssize_t term_stdout(struct _reent *r, int fd, const void *ptr,
                            size_t len) {
-  const char *str = (const char *)ptr;
+  const uint32_t start = sdk_system_get_time();
+
+  taskENTER_CRITICAL();
+  ring_write(ptr, len);
+  taskEXIT_CRITICAL();
+
+  const uint32_t time = sdk_system_get_time() - start;
+  if (time > max_write_time)
+    max_write_time = time;
+  return len;
+}
+
+// taskEXIT_CRITICAL() would enable the interrupts in the handler, this
+// restores the mask the handler ran with
+void term_write_from_isr(const char *str, size_t len) {
+  const UBaseType_t state = taskENTER_CRITICAL_FROM_ISR();
+  ring_write(str, len);
+  taskEXIT_CRITICAL_FROM_ISR(state);
+}
+
+static void uart_write(const char *str, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    if (str[i] == '\n')
+      uart_putc(0, '\r');
+    uart_putc(0, str[i]);
+  }
+}
 
+static void render(const char *str, size_t len) {
   size_t i = 0;
   while (i < len) {
     bool line_feed = false;
@@ -53,14 +122,63 @@ static ssize_t term_stdout(struct _reent *r, int fd, const void *ptr,
       y = (y + LINE_HEIGHT);
       if (y >= LCD_HEIGHT)
         y = Y_START;
-      lcd_scroll(y);
+      // the blank line after the newest one marks where the output wraps
+      const uint16_t next = y + LINE_HEIGHT < LCD_HEIGHT ? y + LINE_HEIGHT
+                                                         : Y_START;
+      lcd_rect(RGB(0, 0, 0), 0, next, LCD_WIDTH - 1, next + LINE_HEIGHT - 1);
     }
 
     i += j;
 
-    if (str[i] == '\n')
+    if (i < len && str[i] == '\n')
       ++i;
   }
+}
+
+// Renders the contiguous output at the tail of the ring, the writers don't
+// touch it until the tail has moved past
+static void render_task(void *p) {
+  char note[32];
+
+  while (1) {
+    while (tail != head) {
+      const size_t pos = tail % LOG_SIZE;
+      const uint32_t avail = head - tail;
+      const size_t n = avail < LOG_SIZE - pos ? avail : LOG_SIZE - pos;
+      uart_write(ring + pos, n);
+      lcd_lock();
+      render(ring + pos, n);
+      lcd_unlock();
+      tail += n;
+    }
+
+    if (dropped > 0) {
+      const int n = snprintf(note, sizeof(note), "[%u dropped]\n",
+                             term_get_and_reset_dropped());
+      uart_write(note, n);
+      lcd_lock();
+      render(note, n);
+      lcd_unlock();
+    }
+
+    vTaskDelay(RENDER_INTERVAL_MS / portTICK_PERIOD_MS);
+  }
+}
+
+unsigned int term_get_and_reset_dropped(void) {
+  taskENTER_CRITICAL();
+  const unsigned int d = dropped;
+  dropped = 0;
+  taskEXIT_CRITICAL();
+  return d;
+}
+
+uint32_t term_get_and_reset_max_write_time(void) {
+  const uint32_t t = max_write_time;
+  max_write_time = 0;
+  return t;
+}
 
-  return i;
+unsigned int term_get_stack_free(void) {
+  return render_handle != NULL ? uxTaskGetStackHighWaterMark(render_handle) : 0;
 }
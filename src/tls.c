@@ -0,0 +1,242 @@
+#ifdef STREAM_TLS
+
+#include "tls.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "espressif/esp_common.h"
+
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ssl.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool initialized = false;
+static mbedtls_entropy_context entropy;
+static mbedtls_ctr_drbg_context ctr_drbg;
+static mbedtls_ssl_config conf;
+
+// Only allocated while a connection is open, the record buffers are the
+// largest part of the TLS memory footprint
+static mbedtls_ssl_context *ssl;
+
+// Session of the last connection for resumption
+static mbedtls_ssl_session session;
+static char session_host[64];
+static bool session_valid = false;
+
+// The netbuf that is currently being read from and the position within it
+static struct netconn *tls_conn;
+static struct netbuf *pending;
+static size_t pending_pos;
+
+static struct tls_stats stats;
+
+static void track_heap(void) {
+  const uint32_t free_heap = xPortGetFreeHeapSize();
+  if (stats.min_free_heap == 0 || free_heap < stats.min_free_heap)
+    stats.min_free_heap = free_heap;
+}
+
+static int bio_send(void *ctx, const unsigned char *buf, size_t len) {
+  track_heap();
+  if (netconn_write(tls_conn, buf, len, NETCONN_COPY) != ERR_OK)
+    return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+  return len;
+}
+
+// Hands out the received netbufs piece by piece
+static int bio_recv(void *ctx, unsigned char *buf, size_t len) {
+  track_heap();
+
+  if (pending == NULL) {
+    const err_t err = netconn_recv(tls_conn, &pending);
+    if (err == ERR_TIMEOUT)
+      return MBEDTLS_ERR_SSL_WANT_READ;
+    // end of file
+    if (err == ERR_CLSD)
+      return 0;
+    if (err != ERR_OK)
+      return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+    pending_pos = 0;
+  }
+
+  const size_t n = netbuf_copy_partial(pending, buf, len, pending_pos);
+  pending_pos += n;
+  if (pending_pos >= netbuf_len(pending)) {
+    netbuf_delete(pending);
+    pending = NULL;
+  }
+
+  return n;
+}
+
+static int init(void) {
+  mbedtls_entropy_init(&entropy);
+  mbedtls_ctr_drbg_init(&ctr_drbg);
+  mbedtls_ssl_config_init(&conf);
+  mbedtls_ssl_session_init(&session);
+
+  static const char personalization[] = "open-esp-webradio";
+  int ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
+                                  (const unsigned char *)personalization,
+                                  sizeof(personalization) - 1);
+  if (ret != 0)
+    return ret;
+
+  ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT,
+                                    MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT);
+  if (ret != 0)
+    return ret;
+
+  // There is no room for a CA store. The streams are public, so the server
+  // is not authenticated.
+  mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_NONE);
+  mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &ctr_drbg);
+#ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+  // Ask for small records, so a record fits into the reduced buffers of the
+  // mbedtls configuration. Not all servers honor this.
+  mbedtls_ssl_conf_max_frag_len(&conf, MBEDTLS_SSL_MAX_FRAG_LEN_4096);
+#endif
+#ifdef MBEDTLS_SSL_SESSION_TICKETS
+  mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+
+  initialized = true;
+  return 0;
+}
+
+int tls_connect(struct netconn *conn, const char *host) {
+  int ret;
+
+  if (!initialized && (ret = init()) != 0) {
+    printf("TLS initialization failed (-0x%x)\n", -ret);
+    return 1;
+  }
+
+  track_heap();
+  ssl = malloc(sizeof(*ssl));
+  if (ssl == NULL)
+    return 1;
+  mbedtls_ssl_init(ssl);
+
+  tls_conn = conn;
+  pending = NULL;
+
+  if ((ret = mbedtls_ssl_setup(ssl, &conf)) != 0 ||
+      (ret = mbedtls_ssl_set_hostname(ssl, host)) != 0)
+    goto fail;
+
+  const bool resume = session_valid && strcmp(session_host, host) == 0;
+  if (resume && (ret = mbedtls_ssl_set_session(ssl, &session)) != 0)
+    goto fail;
+
+  mbedtls_ssl_set_bio(ssl, NULL, bio_send, bio_recv, NULL);
+
+  // give up if the server doesn't answer within a few receive timeouts
+  const uint32_t start = sdk_system_get_time();
+  int timeouts = 0;
+  do {
+    ret = mbedtls_ssl_handshake(ssl);
+  } while ((ret == MBEDTLS_ERR_SSL_WANT_READ && ++timeouts < 5) ||
+           ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+  if (ret != 0)
+    goto fail;
+  const uint32_t time = (sdk_system_get_time() - start) / 1000;
+
+  // The server may refuse to resume the session and do a full handshake
+  // instead, which yields a new session ID.
+  mbedtls_ssl_session current;
+  mbedtls_ssl_session_init(&current);
+  const bool have_session = mbedtls_ssl_get_session(ssl, &current) == 0;
+  const bool resumed = resume && have_session && current.id_len > 0 &&
+                       current.id_len == session.id_len &&
+                       memcmp(current.id, session.id, session.id_len) == 0;
+  if (resumed) {
+    ++stats.resumed;
+    stats.resumed_time = time;
+  } else {
+    ++stats.handshakes;
+    stats.handshake_time = time;
+  }
+  printf("TLS handshake with %s took %u ms%s\n", host, time,
+         resumed ? " (resumed)" : "");
+
+  // the copy of the new session is kept for the next connection
+  mbedtls_ssl_session_free(&session);
+  session = current;
+  session_valid = have_session && strlen(host) < sizeof(session_host);
+  if (session_valid)
+    strcpy(session_host, host);
+
+  return 0;
+
+fail:
+  printf("TLS handshake failed (-0x%x)\n", -ret);
+  // a stale session must not prevent the next handshake
+  session_valid = false;
+  tls_close();
+  return 1;
+}
+
+int tls_write(const void *data, size_t len) {
+  const unsigned char *p = data;
+  // A write that has to read first waits for the receive timeout in
+  // bio_recv(), it's given up after a few of them like the handshake. The
+  // other retries yield, so the loop doesn't starve lower priority tasks.
+  int timeouts = 0;
+  while (len > 0) {
+    const int ret = mbedtls_ssl_write(ssl, p, len);
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+      if (++timeouts >= 5)
+        return 1;
+      vTaskDelay(1);
+      continue;
+    }
+    if (ret < 0)
+      return 1;
+    timeouts = 0;
+    p += ret;
+    len -= ret;
+  }
+  return 0;
+}
+
+int tls_read(void *data, size_t len) {
+  const int ret = mbedtls_ssl_read(ssl, data, len);
+  if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE)
+    return TLS_TIMEOUT;
+  if (ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY ||
+      ret == MBEDTLS_ERR_SSL_CONN_EOF)
+    return 0;
+  return ret;
+}
+
+void tls_close(void) {
+  if (ssl == NULL)
+    return;
+
+  mbedtls_ssl_close_notify(ssl);
+  mbedtls_ssl_free(ssl);
+  free(ssl);
+  ssl = NULL;
+
+  if (pending != NULL) {
+    netbuf_delete(pending);
+    pending = NULL;
+  }
+  tls_conn = NULL;
+}
+
+void tls_get_and_reset_stats(struct tls_stats *s) {
+  *s = stats;
+  memset(&stats, 0, sizeof(stats));
+}
+
+#endif /* STREAM_TLS */
@@ -0,0 +1,142 @@
+#include "ts.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define TS_SYNC_BYTE 0x47
+#define PAT_PID 0x0000
+
+// stream types of the elementary streams we can decode
+#define STREAM_TYPE_MPEG1_AUDIO 0x03
+#define STREAM_TYPE_MPEG2_AUDIO 0x04
+
+void ts_init(struct ts_demuxer *ts, ts_payload_cb payload) {
+  memset(ts, 0, sizeof(*ts));
+  ts->payload_cb = payload;
+}
+
+static inline uint16_t pid13(const uint8_t *p) {
+  return ((p[0] & 0x1f) << 8) | p[1];
+}
+
+static inline uint16_t length12(const uint8_t *p) {
+  return ((p[0] & 0x0f) << 8) | p[1];
+}
+
+// Returns the start of the PSI section in a payload that starts with a
+// pointer field, or NULL if it doesn't fit into the packet.
+static const uint8_t *section(const uint8_t *p, const uint8_t *end,
+                              uint8_t table_id, const uint8_t **section_end) {
+  p += 1 + p[0];
+  if (p + 3 > end || p[0] != table_id)
+    return NULL;
+
+  // the section length includes the CRC at the end
+  *section_end = p + 3 + length12(p + 1) - 4;
+  if (*section_end > end)
+    return NULL;
+  return p;
+}
+
+static void parse_pat(struct ts_demuxer *ts, const uint8_t *p,
+                      const uint8_t *end) {
+  const uint8_t *section_end;
+  p = section(p, end, 0x00, &section_end);
+  if (p == NULL)
+    return;
+
+  for (p += 8; p + 4 <= section_end; p += 4) {
+    // program number 0 is the network information table
+    if (p[0] != 0 || p[1] != 0) {
+      ts->pmt_pid = pid13(p + 2);
+      return;
+    }
+  }
+}
+
+static void parse_pmt(struct ts_demuxer *ts, const uint8_t *p,
+                      const uint8_t *end) {
+  const uint8_t *section_end;
+  p = section(p, end, 0x02, &section_end);
+  if (p == NULL || p + 12 > section_end)
+    return;
+
+  for (p += 12 + length12(p + 10); p + 5 <= section_end;
+       p += 5 + length12(p + 3)) {
+    if (p[0] == STREAM_TYPE_MPEG1_AUDIO || p[0] == STREAM_TYPE_MPEG2_AUDIO) {
+      ts->stream_type = p[0];
+      ts->audio_pid = pid13(p + 1);
+      return;
+    }
+  }
+}
+
+static void parse_packet(struct ts_demuxer *ts, const uint8_t *packet) {
+  const uint8_t *end = packet + TS_PACKET_SIZE;
+  const uint16_t pid = pid13(packet + 1);
+  const bool unit_start = packet[1] & 0x40;
+  const uint8_t adaptation = (packet[3] >> 4) & 0x03;
+
+  const uint8_t *p = packet + 4;
+  if (adaptation & 0x02)
+    p += 1 + p[0];
+  if (!(adaptation & 0x01) || p >= end)
+    return;
+
+  if (pid == PAT_PID) {
+    if (unit_start)
+      parse_pat(ts, p, end);
+  } else if (pid == ts->pmt_pid && ts->pmt_pid != 0) {
+    if (unit_start)
+      parse_pmt(ts, p, end);
+  } else if (pid == ts->audio_pid && ts->audio_pid != 0) {
+    // skip the PES header at the start of every access unit
+    if (unit_start) {
+      if (p + 9 > end || p[0] != 0 || p[1] != 0 || p[2] != 1)
+        return;
+      p += 9 + p[8];
+      if (p >= end)
+        return;
+    }
+    ts->payload_cb(p, end - p);
+  }
+}
+
+void ts_feed(struct ts_demuxer *ts, const uint8_t *data, size_t len) {
+  while (len > 0) {
+    // complete a packet that was split across chunks
+    if (ts->packet_len > 0) {
+      size_t n = TS_PACKET_SIZE - ts->packet_len;
+      if (n > len)
+        n = len;
+      memcpy(ts->packet + ts->packet_len, data, n);
+      ts->packet_len += n;
+      data += n;
+      len -= n;
+      if (ts->packet_len < TS_PACKET_SIZE)
+        return;
+      parse_packet(ts, ts->packet);
+      ts->packet_len = 0;
+      continue;
+    }
+
+    // resynchronize on the next sync byte after damaged data
+    if (data[0] != TS_SYNC_BYTE) {
+      const uint8_t *sync = memchr(data, TS_SYNC_BYTE, len);
+      const size_t skip = sync != NULL ? sync - data : len;
+      data += skip;
+      len -= skip;
+      continue;
+    }
+
+    if (len < TS_PACKET_SIZE) {
+      memcpy(ts->packet, data, len);
+      ts->packet_len = len;
+      return;
+    }
+
+    parse_packet(ts, data);
+    data += TS_PACKET_SIZE;
+    len -= TS_PACKET_SIZE;
+  }
+}
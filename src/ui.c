@@ -0,0 +1,348 @@
+#include "ui.h"
+#include "common.h"
+#include "mi0283qt.h"
+
+#include <string.h>
+
+static struct ui_widget *widgets[UI_MAX_WIDGETS];
+static size_t widget_count;
+// Widget the next update starts with, so one that keeps changing can't
+// starve the others
+static size_t next;
+
+static inline bool is_dirty(const struct ui_widget *w) {
+  return w->dirty_x0 <= w->dirty_x1;
+}
+
+// Adds a rectangle relative to the widget to its dirty area
+static void mark_dirty(struct ui_widget *w, uint16_t x0, uint16_t y0,
+                       uint16_t x1, uint16_t y1) {
+  if (!is_dirty(w)) {
+    w->dirty_x0 = x0;
+    w->dirty_y0 = y0;
+    w->dirty_x1 = x1;
+    w->dirty_y1 = y1;
+    return;
+  }
+
+  w->dirty_x0 = min(w->dirty_x0, x0);
+  w->dirty_y0 = min(w->dirty_y0, y0);
+  w->dirty_x1 = x1 > w->dirty_x1 ? x1 : w->dirty_x1;
+  w->dirty_y1 = y1 > w->dirty_y1 ? y1 : w->dirty_y1;
+}
+
+static void init(struct ui_widget *w, enum ui_type type, uint16_t x,
+                 uint16_t y, uint16_t width, uint16_t height, uint16_t fg,
+                 uint16_t bg) {
+  memset(w, 0, sizeof(*w));
+  w->type = type;
+  w->x = x;
+  w->y = y;
+  w->width = width;
+  w->height = height;
+  w->fg = fg;
+  w->bg = bg;
+  w->scale = 1;
+  mark_dirty(w, 0, 0, width - 1, height - 1);
+}
+
+void ui_label_init(struct ui_widget *w, uint16_t x, uint16_t y,
+                   uint16_t width, uint16_t fg, uint16_t bg) {
+  init(w, UI_LABEL, x, y, width, UI_LINE_HEIGHT, fg, bg);
+}
+
+void ui_label_set(struct ui_widget *w, const char *text) {
+  if (strncmp(w->label.text, text, UI_TEXT_MAX) == 0)
+    return;
+  strncpy(w->label.text, text, UI_TEXT_MAX);
+  w->label.text[UI_TEXT_MAX] = '\0';
+  mark_dirty(w, 0, 0, w->width - 1, w->height - 1);
+}
+
+void ui_label_scale(struct ui_widget *w, uint8_t scale) {
+  w->scale = scale;
+  w->height = UI_LINE_HEIGHT * scale;
+  mark_dirty(w, 0, 0, w->width - 1, w->height - 1);
+}
+
+void ui_bar_init(struct ui_widget *w, uint16_t x, uint16_t y, uint16_t width,
+                 uint16_t height, uint16_t fg, uint16_t bg) {
+  init(w, UI_BAR, x, y, width, height, fg, bg);
+}
+
+void ui_meter_init(struct ui_widget *w, uint16_t x, uint16_t y,
+                   uint16_t width, uint16_t height, uint16_t fg, uint16_t warn,
+                   uint16_t bg) {
+  init(w, UI_METER, x, y, width, height, fg, bg);
+  w->bar.warn = warn;
+}
+
+void ui_bar_set(struct ui_widget *w, uint32_t value, uint32_t max) {
+  const uint16_t filled =
+      max > 0 && value < max ? (uint64_t)value * w->width / max : w->width;
+  if (filled == w->bar.filled)
+    return;
+
+  // only the columns between the old and the new level change
+  const uint16_t x0 = min(filled, w->bar.filled);
+  const uint16_t x1 = (filled > w->bar.filled ? filled : w->bar.filled) - 1;
+  w->bar.filled = filled;
+  mark_dirty(w, x0, 0, x1, w->height - 1);
+}
+
+void ui_list_init(struct ui_widget *w, uint16_t x, uint16_t y,
+                  uint16_t width, ui_item_cb item, size_t count,
+                  uint16_t fg, uint16_t bg) {
+  init(w, UI_LIST, x, y, width, count * UI_LINE_HEIGHT, fg, bg);
+  w->list.item = item;
+  w->list.count = count;
+}
+
+static void mark_row(struct ui_widget *w, size_t row) {
+  mark_dirty(w, 0, row * UI_LINE_HEIGHT, w->width - 1,
+             (row + 1) * UI_LINE_HEIGHT - 1);
+}
+
+void ui_list_select(struct ui_widget *w, size_t index) {
+  if (index == w->list.selected)
+    return;
+  mark_row(w, w->list.selected);
+  mark_row(w, index);
+  w->list.selected = index;
+}
+
+// Returns the length of the line that starts at str, broken after the last
+// space that fits if the text is too wide
+static size_t line_length(const char *str, uint16_t width) {
+  const size_t len = strlen(str);
+  const size_t fit = font_fit(&font_latin1, str, len, width, 1);
+  if (fit == len)
+    return len;
+  for (size_t i = fit; i > 0; --i) {
+    if (str[i] == ' ')
+      return i;
+  }
+  return fit;
+}
+
+// Returns the start of the line after the one at pos, wrapping around to the
+// first one
+static size_t next_line(const char *text, size_t pos, uint16_t width) {
+  pos += line_length(text + pos, width);
+  while (text[pos] == ' ')
+    ++pos;
+  return text[pos] != '\0' ? pos : 0;
+}
+
+void ui_marquee_init(struct ui_widget *w, uint16_t x, uint16_t y,
+                     uint16_t width, char *text, size_t size, uint16_t fg,
+                     uint16_t bg) {
+  init(w, UI_MARQUEE, x, y, width, UI_LINE_HEIGHT, fg, bg);
+  w->marquee.text = text;
+  w->marquee.size = size;
+  text[0] = '\0';
+}
+
+void ui_marquee_set(struct ui_widget *w, const char *text) {
+  if (strncmp(w->marquee.text, text, w->marquee.size - 1) == 0)
+    return;
+  strncpy(w->marquee.text, text, w->marquee.size - 1);
+  w->marquee.text[w->marquee.size - 1] = '\0';
+  w->marquee.pos = 0;
+  w->marquee.next = next_line(w->marquee.text, 0, w->width);
+  mark_dirty(w, 0, 0, w->width - 1, w->height - 1);
+}
+
+// Height of a bar that hasn't been drawn yet
+#define UNDRAWN UINT8_MAX
+
+void ui_spectrum_init(struct ui_widget *w, uint16_t x, uint16_t y,
+                      uint16_t width, uint16_t height, uint8_t count,
+                      uint16_t fg, uint16_t bg) {
+  init(w, UI_SPECTRUM, x, y, width, height, fg, bg);
+  w->spectrum.count = min(count, UI_SPECTRUM_MAX);
+  memset(w->spectrum.drawn, UNDRAWN, sizeof(w->spectrum.drawn));
+}
+
+void ui_spectrum_set(struct ui_widget *w, const uint8_t *levels, uint8_t max) {
+  for (int i = 0; i < w->spectrum.count; ++i) {
+    const uint8_t height = min(levels[i], max) * w->height / max;
+    if (height == w->spectrum.height[i])
+      continue;
+    w->spectrum.height[i] = height;
+    mark_dirty(w, 0, 0, w->width - 1, w->height - 1);
+  }
+}
+
+int ui_add(struct ui_widget *w) {
+  if (widget_count == UI_MAX_WIDGETS)
+    return 1;
+  widgets[widget_count++] = w;
+  return 0;
+}
+
+static void fill(const struct ui_widget *w, int x0, int x1, uint16_t color) {
+  if (x0 <= x1)
+    lcd_rect(color, w->x + x0, w->y, w->x + x1, w->y + w->height - 1);
+}
+
+// Draws n bytes as a line of text, clipped and padded to width
+static void draw_textn(uint16_t x, uint16_t y, uint16_t width,
+                       const char *text, size_t n, int scale, uint16_t fg,
+                       uint16_t bg) {
+  n = font_fit(&font_latin1, text, n, width, scale);
+  const uint16_t end = lcd_text(&font_latin1, scale, x, y, text, n, fg, bg);
+  if (end < x + width)
+    lcd_rect(bg, end, y, x + width - 1, y + UI_LINE_HEIGHT * scale - 1);
+}
+
+static void draw_text(uint16_t x, uint16_t y, uint16_t width, const char *text,
+                      int scale, uint16_t fg, uint16_t bg) {
+  draw_textn(x, y, width, text, strlen(text), scale, fg, bg);
+}
+
+static void draw_bar(const struct ui_widget *w, int x0, int x1) {
+  const int filled = w->bar.filled;
+  if (w->type == UI_METER) {
+    const int warn_x = w->width * 3 / 4;
+    fill(w, x0, min(x1, min(filled, warn_x) - 1), w->fg);
+    fill(w, x0 > warn_x ? x0 : warn_x, min(x1, filled - 1), w->bar.warn);
+  } else {
+    fill(w, x0, min(x1, filled - 1), w->fg);
+  }
+  fill(w, x0 > filled ? x0 : filled, x1, w->bg);
+}
+
+static void draw_list(const struct ui_widget *w, int y0, int y1) {
+  for (int row = y0 / UI_LINE_HEIGHT; row <= y1 / UI_LINE_HEIGHT; ++row) {
+    const bool selected = row == w->list.selected;
+    draw_text(w->x, w->y + row * UI_LINE_HEIGHT, w->width,
+              w->list.item(row), 1, selected ? w->bg : w->fg,
+              selected ? w->fg : w->bg);
+  }
+}
+
+// Draws the rows each bar grew or shrank by since it was last drawn, with a
+// column between the bars. Returns the number of pixels drawn.
+static unsigned int draw_spectrum(struct ui_widget *w) {
+  const int bar_width = w->width / w->spectrum.count;
+  const int bottom = w->y + w->height - 1;
+  unsigned int drawn = 0;
+
+  for (int i = 0; i < w->spectrum.count; ++i) {
+    const int height = w->spectrum.height[i];
+    int old = w->spectrum.drawn[i];
+    if (height == old)
+      continue;
+
+    const int x = w->x + i * bar_width;
+    if (old == UNDRAWN) {
+      // the whole column with the gap, as an empty bar
+      lcd_rect(w->bg, x, w->y, x + bar_width - 1, bottom);
+      drawn += bar_width * w->height;
+      old = 0;
+    }
+    if (height > old)
+      lcd_rect(w->fg, x, bottom - height + 1, x + bar_width - 2, bottom - old);
+    else if (height < old)
+      lcd_rect(w->bg, x, bottom - old + 1, x + bar_width - 2,
+               bottom - height);
+    w->spectrum.drawn[i] = height;
+    drawn += (height > old ? height - old : old - height) * (bar_width - 1);
+  }
+
+  return drawn;
+}
+
+// Shows the current line of a marquee with the scroll area at rest
+static void draw_marquee(struct ui_widget *w) {
+  const char *line = w->marquee.text + w->marquee.pos;
+
+  lcd_scroll_on(w->y, LCD_HEIGHT - w->y - w->height);
+  lcd_scroll(w->y);
+  draw_textn(w->x, w->y, w->width, line, line_length(line, w->width), 1,
+             w->fg, w->bg);
+  w->marquee.step = 0;
+  w->marquee.wait = UI_MARQUEE_PAUSE;
+}
+
+// Scrolls the next line of a marquee in by a row. The row of display memory
+// that leaves the top of the scroll area comes back in at the bottom, so
+// only it is overwritten with the same row of the next line. Returns the
+// number of pixels drawn.
+static unsigned int scroll_marquee(struct ui_widget *w) {
+  if (w->marquee.next == w->marquee.pos)
+    return 0;
+  if (w->marquee.wait > 0) {
+    --w->marquee.wait;
+    return 0;
+  }
+
+  const char *line = w->marquee.text + w->marquee.next;
+  const uint16_t y = w->y + w->marquee.step;
+  const uint16_t end =
+      lcd_text_row(&font_latin1, w->x, y, line, line_length(line, w->width),
+                   w->marquee.step, w->fg, w->bg);
+  if (end < w->x + w->width)
+    lcd_rect(w->bg, end, y, w->x + w->width - 1, y);
+
+  w->marquee.step = (w->marquee.step + 1) % w->height;
+  lcd_scroll(w->y + w->marquee.step);
+  if (w->marquee.step == 0) {
+    w->marquee.pos = w->marquee.next;
+    w->marquee.next = next_line(w->marquee.text, w->marquee.pos, w->width);
+    w->marquee.wait = UI_MARQUEE_PAUSE;
+  }
+
+  return w->width;
+}
+
+unsigned int ui_update(unsigned int budget) {
+  unsigned int drawn = 0;
+
+  for (size_t i = 0; i < widget_count && drawn < budget; ++i) {
+    struct ui_widget *w = widgets[next];
+    next = (next + 1) % widget_count;
+    if (!is_dirty(w)) {
+      // marquees move on their own
+      if (w->type == UI_MARQUEE) {
+        lcd_lock();
+        drawn += scroll_marquee(w);
+        lcd_unlock();
+      }
+      continue;
+    }
+
+    const int x0 = w->dirty_x0, y0 = w->dirty_y0;
+    const int x1 = w->dirty_x1, y1 = w->dirty_y1;
+    w->dirty_x0 = 1;
+    w->dirty_x1 = 0;
+
+    lcd_lock();
+    switch (w->type) {
+    case UI_LABEL:
+      draw_text(w->x, w->y, w->width, w->label.text, w->scale, w->fg, w->bg);
+      drawn += w->width * w->height;
+      break;
+    case UI_BAR:
+    case UI_METER:
+      draw_bar(w, x0, x1);
+      drawn += (x1 - x0 + 1) * w->height;
+      break;
+    case UI_LIST:
+      draw_list(w, y0, y1);
+      drawn += (y1 - y0 + 1) * w->width;
+      break;
+    case UI_MARQUEE:
+      draw_marquee(w);
+      drawn += w->width * w->height;
+      break;
+    case UI_SPECTRUM:
+      drawn += draw_spectrum(w);
+      break;
+    }
+    lcd_unlock();
+  }
+
+  return drawn;
+}
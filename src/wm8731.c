@@ -64,6 +64,12 @@ int wm8731_set_sample_rate(unsigned int sample_rate) {
   case 48000:
     // BOSR=0; SR=0x0
     break;
+  case 32000:
+    config_val |= 0x18; // BOSR=0; SR=0x6
+    break;
+  case 8000:
+    config_val |= 0x0c; // BOSR=0; SR=0x3
+    break;
   default:
     return 1;
   }